@@ -0,0 +1,92 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "ImageTypes.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Stone::Core::Image {
+
+/**
+ * A block compressed image with its mip chain, as stored in DDS and KTX2 files.
+ * The levels are stored one after the other in data, the first one being the largest.
+ */
+struct CompressedImage {
+	BlockFormat format = BlockFormat::None;
+	Size size = Size(0);
+	std::vector<MipLevel> mipLevels;
+	std::vector<uint8_t> data;
+};
+
+/** Number of bytes of a 4x4 block of the format. */
+size_t blockByteSize(BlockFormat format);
+
+/** Number of bytes of an image of the given size once compressed, partial blocks included. */
+size_t blockCompressedSize(BlockFormat format, Size size);
+
+/** Checks if the bytes start with the identifier of a DDS or a KTX2 file. */
+bool isBlockCompressedFile(const std::vector<char> &bytes);
+
+/**
+ * Reads a DDS file holding a single 2D block compressed image, with either a legacy FourCC or a DX10 header.
+ *
+ * @param bytes The content of the file.
+ * @return The image and its stored mip chain.
+ * @throws std::runtime_error If the file is invalid or holds another kind of image.
+ */
+CompressedImage readDDS(const std::vector<char> &bytes);
+
+/**
+ * Reads a KTX2 file holding a single 2D block compressed image without supercompression.
+ *
+ * @param bytes The content of the file.
+ * @return The image and its stored mip chain.
+ * @throws std::runtime_error If the file is invalid, supercompressed or holds another kind of image.
+ */
+CompressedImage readKTX2(const std::vector<char> &bytes);
+
+/**
+ * Writes a DDS file with a DX10 header, readable by readDDS and by the usual texture tools.
+ *
+ * @param image The image to write.
+ * @return The content of the file.
+ */
+std::vector<char> writeDDS(const CompressedImage &image);
+
+/**
+ * Compresses RGBA8 pixels into blocks. The encoder fits each block on the bounding box of its colors,
+ * which is fast enough to run at import time but does not match the quality of dedicated tools.
+ *
+ * @param format The format to encode, one of BC1, BC3, BC4 (red channel) or BC5 (red and green channels).
+ * @param rgba The pixels, four bytes each, row by row.
+ * @param size The size of the image in pixels.
+ * @return The blocks, row by row.
+ * @throws std::runtime_error If the format has no encoder.
+ */
+std::vector<uint8_t> encodeBlocks(BlockFormat format, const uint8_t *rgba, Size size);
+
+/**
+ * Decompresses blocks into RGBA8 pixels, used when the device cannot sample the format.
+ *
+ * @param format The format of the blocks, one of BC1, BC2, BC3, BC4 or BC5.
+ * @param blocks The blocks, row by row.
+ * @param size The size of the image in pixels.
+ * @return The pixels, four bytes each, row by row.
+ * @throws std::runtime_error If the format has no decoder.
+ */
+std::vector<uint8_t> decodeBlocks(BlockFormat format, const uint8_t *blocks, Size size);
+
+/**
+ * Compresses RGBA8 pixels into a block compressed image, with a full mip chain downsampled with a box filter.
+ *
+ * @param format The format to encode, see encodeBlocks.
+ * @param rgba The pixels, four bytes each, row by row.
+ * @param size The size of the image in pixels.
+ * @param generateMipmaps Whether to generate the mip chain or to keep a single level.
+ * @return The compressed image.
+ */
+CompressedImage compressImage(BlockFormat format, const uint8_t *rgba, Size size, bool generateMipmaps = true);
+
+} // namespace Stone::Core::Image
@@ -5,6 +5,8 @@
 #include "Core/Object.hpp"
 #include "ImageTypes.hpp"
 
+#include <vector>
+
 namespace Stone::Core::Image {
 
 class ImageSource;
@@ -23,16 +25,37 @@ public:
 	[[nodiscard]] const Size &getSize() const;
 	[[nodiscard]] Channel getChannels() const;
 	[[nodiscard]] const uint8_t *getData() const;
+	[[nodiscard]] size_t getDataSize() const;
+
+	/** The block compression of the data, None for the raw pixels decoded from PNG or JPEG files. */
+	[[nodiscard]] BlockFormat getBlockFormat() const;
+	[[nodiscard]] bool isCompressed() const;
+
+	/** The levels stored in the data, a raw image holds a single level. */
+	[[nodiscard]] const std::vector<MipLevel> &getMipLevels() const;
 
 	std::shared_ptr<ImageSource> getSource() const;
 
 	ImageData(const std::string &filepath, Channel channels);
 
+	/**
+	 * Creates an image from raw 8 bit pixels, such as a frame read back from the GPU.
+	 *
+	 * @param size The size of the image in pixels.
+	 * @param channels The channels of each pixel.
+	 * @param pixels The pixels row by row, size.x * size.y * channels bytes.
+	 */
+	ImageData(const Size &size, Channel channels, std::vector<uint8_t> pixels);
+
 protected:
 	Size _size = Size(0);
 	int _channels = 0;
 	uint8_t *_data = nullptr;
 
+	BlockFormat _blockFormat = BlockFormat::None;
+	std::vector<uint8_t> _ownedData; /**< The data when it was not allocated by stb_image. */
+	std::vector<MipLevel> _mipLevels;
+
 	std::weak_ptr<ImageSource> _source;
 
 	friend ImageSource;
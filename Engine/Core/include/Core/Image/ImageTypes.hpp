@@ -3,6 +3,7 @@
 #pragma once
 
 #include <glm/vec2.hpp>
+#include <cstddef>
 #include <iostream>
 
 namespace Stone::Core::Image {
@@ -18,4 +19,29 @@ enum class Channel : int {
 
 std::ostream &operator<<(std::ostream &stream, Channel channel);
 
+/**
+ * Block compression of the image data. Images decoded by stb_image are stored as raw pixels with the format None.
+ */
+enum class BlockFormat : int {
+	None = 0,
+	BC1,
+	BC2,
+	BC3,
+	BC4,
+	BC5,
+	BC6H,
+	BC7
+};
+
+std::ostream &operator<<(std::ostream &stream, BlockFormat format);
+
+/**
+ * A level of the mip chain stored in the image data.
+ */
+struct MipLevel {
+	Size size = Size(0);
+	size_t offset = 0;
+	size_t byteSize = 0;
+};
+
 } // namespace Stone::Core::Image
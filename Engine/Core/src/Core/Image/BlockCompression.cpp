@@ -0,0 +1,651 @@
+// Copyright 2024 Stone-Engine
+
+#include "Core/Image/BlockCompression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace Stone::Core::Image {
+
+namespace {
+
+using Block = std::array<std::array<uint8_t, 4>, 16>;
+
+constexpr uint32_t makeFourCC(char a, char b, char c, char d) {
+	return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8) |
+		   (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) |
+		   (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+}
+
+constexpr uint32_t ddsMagic = makeFourCC('D', 'D', 'S', ' ');
+constexpr uint32_t ddsHeaderSize = 124;
+constexpr size_t ddsDataOffset = 4 + ddsHeaderSize;
+constexpr size_t ddsDX10DataOffset = ddsDataOffset + 20;
+constexpr uint32_t ddsPixelFormatFourCC = 0x4;
+constexpr uint32_t ddsCaps2CubeMap = 0x200;
+constexpr uint32_t ddsResourceDimensionTexture2D = 3;
+
+constexpr std::array<uint8_t, 12> ktx2Identifier = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32,
+													0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr size_t ktx2LevelIndexOffset = 80;
+constexpr size_t ktx2LevelIndexEntrySize = 24;
+
+template <typename T>
+T readValue(const std::vector<char> &bytes, size_t offset) {
+	if (offset + sizeof(T) > bytes.size()) {
+		throw std::runtime_error("Unexpected end of image file");
+	}
+	T value;
+	std::memcpy(&value, bytes.data() + offset, sizeof(T));
+	return value;
+}
+
+template <typename T>
+void writeValue(std::vector<char> &bytes, T value) {
+	const char *begin = reinterpret_cast<const char *>(&value);
+	bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+BlockFormat dxgiFormatToBlockFormat(uint32_t dxgiFormat) {
+	switch (dxgiFormat) {
+	case 70: // DXGI_FORMAT_BC1_TYPELESS
+	case 71: // DXGI_FORMAT_BC1_UNORM
+	case 72: // DXGI_FORMAT_BC1_UNORM_SRGB
+		return BlockFormat::BC1;
+	case 73: // DXGI_FORMAT_BC2_TYPELESS
+	case 74: // DXGI_FORMAT_BC2_UNORM
+	case 75: // DXGI_FORMAT_BC2_UNORM_SRGB
+		return BlockFormat::BC2;
+	case 76: // DXGI_FORMAT_BC3_TYPELESS
+	case 77: // DXGI_FORMAT_BC3_UNORM
+	case 78: // DXGI_FORMAT_BC3_UNORM_SRGB
+		return BlockFormat::BC3;
+	case 79: // DXGI_FORMAT_BC4_TYPELESS
+	case 80: // DXGI_FORMAT_BC4_UNORM
+		return BlockFormat::BC4;
+	case 82: // DXGI_FORMAT_BC5_TYPELESS
+	case 83: // DXGI_FORMAT_BC5_UNORM
+		return BlockFormat::BC5;
+	case 94: // DXGI_FORMAT_BC6H_TYPELESS
+	case 95: // DXGI_FORMAT_BC6H_UF16
+		return BlockFormat::BC6H;
+	case 97: // DXGI_FORMAT_BC7_TYPELESS
+	case 98: // DXGI_FORMAT_BC7_UNORM
+	case 99: // DXGI_FORMAT_BC7_UNORM_SRGB
+		return BlockFormat::BC7;
+	default: throw std::runtime_error("Unsupported DXGI format: " + std::to_string(dxgiFormat));
+	}
+}
+
+uint32_t blockFormatToDxgiFormat(BlockFormat format) {
+	switch (format) {
+	case BlockFormat::BC1: return 71;
+	case BlockFormat::BC2: return 74;
+	case BlockFormat::BC3: return 77;
+	case BlockFormat::BC4: return 80;
+	case BlockFormat::BC5: return 83;
+	case BlockFormat::BC6H: return 95;
+	case BlockFormat::BC7: return 98;
+	default: throw std::runtime_error("Unsupported block format");
+	}
+}
+
+BlockFormat fourCCToBlockFormat(uint32_t fourCC) {
+	switch (fourCC) {
+	case makeFourCC('D', 'X', 'T', '1'): return BlockFormat::BC1;
+	case makeFourCC('D', 'X', 'T', '2'):
+	case makeFourCC('D', 'X', 'T', '3'): return BlockFormat::BC2;
+	case makeFourCC('D', 'X', 'T', '4'):
+	case makeFourCC('D', 'X', 'T', '5'): return BlockFormat::BC3;
+	case makeFourCC('A', 'T', 'I', '1'):
+	case makeFourCC('B', 'C', '4', 'U'): return BlockFormat::BC4;
+	case makeFourCC('A', 'T', 'I', '2'):
+	case makeFourCC('B', 'C', '5', 'U'): return BlockFormat::BC5;
+	default: throw std::runtime_error("Unsupported DDS FourCC format");
+	}
+}
+
+BlockFormat vkFormatToBlockFormat(uint32_t vkFormat) {
+	switch (vkFormat) {
+	case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+	case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+	case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+	case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		return BlockFormat::BC1;
+	case 135: // VK_FORMAT_BC2_UNORM_BLOCK
+	case 136: // VK_FORMAT_BC2_SRGB_BLOCK
+		return BlockFormat::BC2;
+	case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+	case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+		return BlockFormat::BC3;
+	case 139: // VK_FORMAT_BC4_UNORM_BLOCK
+		return BlockFormat::BC4;
+	case 141: // VK_FORMAT_BC5_UNORM_BLOCK
+		return BlockFormat::BC5;
+	case 143: // VK_FORMAT_BC6H_UFLOAT_BLOCK
+		return BlockFormat::BC6H;
+	case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+	case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+		return BlockFormat::BC7;
+	default: throw std::runtime_error("Unsupported KTX2 format: " + std::to_string(vkFormat));
+	}
+}
+
+Size mipLevelSize(Size size, uint32_t level) {
+	return {std::max(1, size.x >> level), std::max(1, size.y >> level)};
+}
+
+/** The number of levels of the full mip chain of an image, down to a 1x1 level. */
+uint32_t maxMipLevelCount(Size size) {
+	uint32_t levelCount = 1;
+	for (int extent = std::max(size.x, size.y); extent > 1; extent >>= 1) {
+		++levelCount;
+	}
+	return levelCount;
+}
+
+/** Copies the pixels of a block, repeating the last row and column for the blocks crossing the border. */
+Block fetchBlock(const uint8_t *rgba, Size size, int blockX, int blockY) {
+	Block block;
+	for (int y = 0; y < 4; ++y) {
+		int pixelY = std::min(blockY * 4 + y, size.y - 1);
+		for (int x = 0; x < 4; ++x) {
+			int pixelX = std::min(blockX * 4 + x, size.x - 1);
+			std::memcpy(block[y * 4 + x].data(), rgba + (static_cast<size_t>(pixelY) * size.x + pixelX) * 4, 4);
+		}
+	}
+	return block;
+}
+
+void storeBlock(const Block &block, uint8_t *rgba, Size size, int blockX, int blockY) {
+	for (int y = 0; y < 4 && blockY * 4 + y < size.y; ++y) {
+		for (int x = 0; x < 4 && blockX * 4 + x < size.x; ++x) {
+			size_t pixel = static_cast<size_t>(blockY * 4 + y) * size.x + blockX * 4 + x;
+			std::memcpy(rgba + pixel * 4, block[y * 4 + x].data(), 4);
+		}
+	}
+}
+
+uint16_t packColor565(const std::array<int, 3> &color) {
+	return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 |
+								 ((color[2] * 31 + 127) / 255));
+}
+
+std::array<int, 3> unpackColor565(uint16_t color) {
+	int red = (color >> 11) & 0x1f;
+	int green = (color >> 5) & 0x3f;
+	int blue = color & 0x1f;
+	return {(red << 3) | (red >> 2), (green << 2) | (green >> 4), (blue << 3) | (blue >> 2)};
+}
+
+std::array<std::array<int, 3>, 4> colorPalette(uint16_t color0, uint16_t color1, bool fourColors) {
+	std::array<int, 3> endpoint0 = unpackColor565(color0);
+	std::array<int, 3> endpoint1 = unpackColor565(color1);
+	std::array<std::array<int, 3>, 4> palette = {endpoint0, endpoint1};
+	for (int channel = 0; channel < 3; ++channel) {
+		if (fourColors) {
+			palette[2][channel] = (2 * endpoint0[channel] + endpoint1[channel]) / 3;
+			palette[3][channel] = (endpoint0[channel] + 2 * endpoint1[channel]) / 3;
+		} else {
+			palette[2][channel] = (endpoint0[channel] + endpoint1[channel]) / 2;
+			palette[3][channel] = 0;
+		}
+	}
+	return palette;
+}
+
+std::array<int, 8> alphaPalette(int alpha0, int alpha1) {
+	std::array<int, 8> palette = {alpha0, alpha1};
+	if (alpha0 > alpha1) {
+		for (int i = 2; i < 8; ++i) {
+			palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+		}
+	} else {
+		for (int i = 2; i < 6; ++i) {
+			palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+	return palette;
+}
+
+/** Encodes the RGB channels of a block into the 8 bytes of a BC1 color block, always in four colors mode. */
+void encodeColorBlock(const Block &block, uint8_t *output) {
+	std::array<int, 3> minColor = {255, 255, 255};
+	std::array<int, 3> maxColor = {0, 0, 0};
+	std::array<int, 3> mean = {0, 0, 0};
+	for (const auto &pixel : block) {
+		for (int channel = 0; channel < 3; ++channel) {
+			minColor[channel] = std::min<int>(minColor[channel], pixel[channel]);
+			maxColor[channel] = std::max<int>(maxColor[channel], pixel[channel]);
+			mean[channel] += pixel[channel];
+		}
+	}
+
+	// The bounding box diagonal only follows the colors when red and blue vary in the same direction as green.
+	std::array<int, 3> covariance = {0, 0, 0};
+	for (const auto &pixel : block) {
+		int green = pixel[1] * 16 - mean[1];
+		covariance[0] += (pixel[0] * 16 - mean[0]) * green;
+		covariance[2] += (pixel[2] * 16 - mean[2]) * green;
+	}
+
+	for (int channel = 0; channel < 3; ++channel) {
+		// Insetting the box by a sixteenth of its range reduces the error of the interpolated colors.
+		int inset = (maxColor[channel] - minColor[channel]) / 16;
+		minColor[channel] += inset;
+		maxColor[channel] -= inset;
+		if (covariance[channel] < 0) {
+			std::swap(minColor[channel], maxColor[channel]);
+		}
+	}
+
+	uint16_t color0 = packColor565(maxColor);
+	uint16_t color1 = packColor565(minColor);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		std::array<std::array<int, 3>, 4> palette = colorPalette(color0, color1, true);
+		for (size_t i = 0; i < block.size(); ++i) {
+			int bestDistance = INT32_MAX;
+			uint32_t bestIndex = 0;
+			for (uint32_t index = 0; index < 4; ++index) {
+				int distance = 0;
+				for (int channel = 0; channel < 3; ++channel) {
+					int delta = block[i][channel] - palette[index][channel];
+					distance += delta * delta;
+				}
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = index;
+				}
+			}
+			indices |= bestIndex << (i * 2);
+		}
+	}
+
+	std::memcpy(output, &color0, 2);
+	std::memcpy(output + 2, &color1, 2);
+	std::memcpy(output + 4, &indices, 4);
+}
+
+/** Encodes one channel of a block into the 8 bytes of a BC3 alpha block, also used by BC4 and BC5. */
+void encodeAlphaBlock(const Block &block, int channel, uint8_t *output) {
+	int minValue = 255;
+	int maxValue = 0;
+	for (const auto &pixel : block) {
+		minValue = std::min<int>(minValue, pixel[channel]);
+		maxValue = std::max<int>(maxValue, pixel[channel]);
+	}
+
+	uint64_t indices = 0;
+	if (maxValue != minValue) {
+		std::array<int, 8> palette = alphaPalette(maxValue, minValue);
+		for (size_t i = 0; i < block.size(); ++i) {
+			int bestDistance = INT32_MAX;
+			uint64_t bestIndex = 0;
+			for (uint64_t index = 0; index < 8; ++index) {
+				int distance = std::abs(block[i][channel] - palette[index]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = index;
+				}
+			}
+			indices |= bestIndex << (i * 3);
+		}
+	}
+
+	output[0] = static_cast<uint8_t>(maxValue);
+	output[1] = static_cast<uint8_t>(minValue);
+	for (int i = 0; i < 6; ++i) {
+		output[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+void decodeColorBlock(const uint8_t *input, bool forceFourColors, Block &block) {
+	uint16_t color0;
+	uint16_t color1;
+	uint32_t indices;
+	std::memcpy(&color0, input, 2);
+	std::memcpy(&color1, input + 2, 2);
+	std::memcpy(&indices, input + 4, 4);
+
+	bool fourColors = forceFourColors || color0 > color1;
+	std::array<std::array<int, 3>, 4> palette = colorPalette(color0, color1, fourColors);
+	for (size_t i = 0; i < block.size(); ++i) {
+		uint32_t index = (indices >> (i * 2)) & 0x3;
+		for (int channel = 0; channel < 3; ++channel) {
+			block[i][channel] = static_cast<uint8_t>(palette[index][channel]);
+		}
+		block[i][3] = (!fourColors && index == 3) ? 0 : 255;
+	}
+}
+
+void decodeAlphaBlock(const uint8_t *input, int channel, Block &block) {
+	std::array<int, 8> palette = alphaPalette(input[0], input[1]);
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; ++i) {
+		indices |= static_cast<uint64_t>(input[2 + i]) << (i * 8);
+	}
+	for (size_t i = 0; i < block.size(); ++i) {
+		block[i][channel] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 0x7]);
+	}
+}
+
+void decodeExplicitAlphaBlock(const uint8_t *input, Block &block) {
+	for (size_t i = 0; i < block.size(); ++i) {
+		block[i][3] = static_cast<uint8_t>(((input[i / 2] >> ((i % 2) * 4)) & 0xf) * 17);
+	}
+}
+
+std::vector<uint8_t> downsample(const std::vector<uint8_t> &rgba, Size size, Size targetSize) {
+	std::vector<uint8_t> result(static_cast<size_t>(targetSize.x) * targetSize.y * 4);
+	for (int y = 0; y < targetSize.y; ++y) {
+		int y0 = std::min(y * 2, size.y - 1);
+		int y1 = std::min(y * 2 + 1, size.y - 1);
+		for (int x = 0; x < targetSize.x; ++x) {
+			int x0 = std::min(x * 2, size.x - 1);
+			int x1 = std::min(x * 2 + 1, size.x - 1);
+			for (int channel = 0; channel < 4; ++channel) {
+				auto texel = [&](int texelX, int texelY) {
+					return rgba[(static_cast<size_t>(texelY) * size.x + texelX) * 4 + channel];
+				};
+				int sum = texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1);
+				result[(static_cast<size_t>(y) * targetSize.x + x) * 4 + channel] = static_cast<uint8_t>((sum + 2) / 4);
+			}
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+size_t blockByteSize(BlockFormat format) {
+	switch (format) {
+	case BlockFormat::BC1:
+	case BlockFormat::BC4: return 8;
+	case BlockFormat::BC2:
+	case BlockFormat::BC3:
+	case BlockFormat::BC5:
+	case BlockFormat::BC6H:
+	case BlockFormat::BC7: return 16;
+	default: throw std::runtime_error("Unsupported block format");
+	}
+}
+
+size_t blockCompressedSize(BlockFormat format, Size size) {
+	size_t blocksX = (static_cast<size_t>(size.x) + 3) / 4;
+	size_t blocksY = (static_cast<size_t>(size.y) + 3) / 4;
+	return blocksX * blocksY * blockByteSize(format);
+}
+
+bool isBlockCompressedFile(const std::vector<char> &bytes) {
+	if (bytes.size() >= 4 && readValue<uint32_t>(bytes, 0) == ddsMagic) {
+		return true;
+	}
+	return bytes.size() >= ktx2Identifier.size() &&
+		   std::memcmp(bytes.data(), ktx2Identifier.data(), ktx2Identifier.size()) == 0;
+}
+
+/** DDS */
+
+CompressedImage readDDS(const std::vector<char> &bytes) {
+	if (readValue<uint32_t>(bytes, 0) != ddsMagic || readValue<uint32_t>(bytes, 4) != ddsHeaderSize) {
+		throw std::runtime_error("Invalid DDS file");
+	}
+
+	CompressedImage image;
+	image.size.y = static_cast<int>(readValue<uint32_t>(bytes, 12));
+	image.size.x = static_cast<int>(readValue<uint32_t>(bytes, 16));
+	uint32_t mipLevelCount = std::max(1u, readValue<uint32_t>(bytes, 28));
+	uint32_t pixelFormatFlags = readValue<uint32_t>(bytes, 80);
+	uint32_t fourCC = readValue<uint32_t>(bytes, 84);
+	uint32_t caps2 = readValue<uint32_t>(bytes, 112);
+
+	if (caps2 & ddsCaps2CubeMap) {
+		throw std::runtime_error("Cube map DDS files are not supported");
+	}
+	if (!(pixelFormatFlags & ddsPixelFormatFourCC)) {
+		throw std::runtime_error("Uncompressed DDS files are not supported");
+	}
+
+	size_t offset = ddsDataOffset;
+	if (fourCC == makeFourCC('D', 'X', '1', '0')) {
+		image.format = dxgiFormatToBlockFormat(readValue<uint32_t>(bytes, ddsDataOffset));
+		if (readValue<uint32_t>(bytes, ddsDataOffset + 4) != ddsResourceDimensionTexture2D ||
+			readValue<uint32_t>(bytes, ddsDataOffset + 12) > 1) {
+			throw std::runtime_error("Only single 2D DDS textures are supported");
+		}
+		offset = ddsDX10DataOffset;
+	} else {
+		image.format = fourCCToBlockFormat(fourCC);
+	}
+
+	if (image.size.x <= 0 || image.size.y <= 0) {
+		throw std::runtime_error("Invalid DDS image size");
+	}
+	if (mipLevelCount > maxMipLevelCount(image.size)) {
+		throw std::runtime_error("Invalid DDS mip count");
+	}
+
+	for (uint32_t level = 0; level < mipLevelCount; ++level) {
+		MipLevel mipLevel;
+		mipLevel.size = mipLevelSize(image.size, level);
+		mipLevel.offset = image.data.size();
+		mipLevel.byteSize = blockCompressedSize(image.format, mipLevel.size);
+		if (offset + mipLevel.byteSize > bytes.size()) {
+			throw std::runtime_error("Unexpected end of DDS file");
+		}
+		image.data.insert(image.data.end(), bytes.begin() + static_cast<std::ptrdiff_t>(offset),
+						  bytes.begin() + static_cast<std::ptrdiff_t>(offset + mipLevel.byteSize));
+		image.mipLevels.push_back(mipLevel);
+		offset += mipLevel.byteSize;
+	}
+	return image;
+}
+
+std::vector<char> writeDDS(const CompressedImage &image) {
+	std::vector<char> bytes;
+	bytes.reserve(ddsDX10DataOffset + image.data.size());
+
+	const uint32_t mipLevelCount = static_cast<uint32_t>(image.mipLevels.size());
+	// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE
+	const uint32_t flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+	// DDSCAPS_TEXTURE, with DDSCAPS_COMPLEX | DDSCAPS_MIPMAP when there is a mip chain
+	const uint32_t caps = 0x1000 | (mipLevelCount > 1 ? 0x8 | 0x400000 : 0);
+
+	writeValue(bytes, ddsMagic);
+	writeValue(bytes, ddsHeaderSize);
+	writeValue(bytes, flags);
+	writeValue(bytes, static_cast<uint32_t>(image.size.y));
+	writeValue(bytes, static_cast<uint32_t>(image.size.x));
+	writeValue(bytes, static_cast<uint32_t>(image.mipLevels.empty() ? 0 : image.mipLevels.front().byteSize));
+	writeValue(bytes, uint32_t(0)); // Depth
+	writeValue(bytes, mipLevelCount);
+	for (int i = 0; i < 11; ++i) {
+		writeValue(bytes, uint32_t(0)); // Reserved
+	}
+	writeValue(bytes, uint32_t(32)); // Pixel format size
+	writeValue(bytes, ddsPixelFormatFourCC);
+	writeValue(bytes, makeFourCC('D', 'X', '1', '0'));
+	for (int i = 0; i < 5; ++i) {
+		writeValue(bytes, uint32_t(0)); // Bit count and masks
+	}
+	writeValue(bytes, caps);
+	for (int i = 0; i < 4; ++i) {
+		writeValue(bytes, uint32_t(0)); // Caps 2 to 4 and reserved
+	}
+
+	writeValue(bytes, blockFormatToDxgiFormat(image.format));
+	writeValue(bytes, ddsResourceDimensionTexture2D);
+	writeValue(bytes, uint32_t(0)); // Misc flags
+	writeValue(bytes, uint32_t(1)); // Array size
+	writeValue(bytes, uint32_t(0)); // Alpha mode
+
+	for (const MipLevel &mipLevel : image.mipLevels) {
+		const uint8_t *begin = image.data.data() + mipLevel.offset;
+		bytes.insert(bytes.end(), begin, begin + mipLevel.byteSize);
+	}
+	return bytes;
+}
+
+/** KTX2 */
+
+CompressedImage readKTX2(const std::vector<char> &bytes) {
+	if (bytes.size() < ktx2LevelIndexOffset ||
+		std::memcmp(bytes.data(), ktx2Identifier.data(), ktx2Identifier.size()) != 0) {
+		throw std::runtime_error("Invalid KTX2 file");
+	}
+
+	CompressedImage image;
+	uint32_t vkFormat = readValue<uint32_t>(bytes, 12);
+	image.size.x = static_cast<int>(readValue<uint32_t>(bytes, 20));
+	image.size.y = static_cast<int>(readValue<uint32_t>(bytes, 24));
+	uint32_t pixelDepth = readValue<uint32_t>(bytes, 28);
+	uint32_t layerCount = readValue<uint32_t>(bytes, 32);
+	uint32_t faceCount = readValue<uint32_t>(bytes, 36);
+	uint32_t mipLevelCount = std::max(1u, readValue<uint32_t>(bytes, 40));
+	uint32_t supercompressionScheme = readValue<uint32_t>(bytes, 44);
+
+	if (supercompressionScheme != 0) {
+		throw std::runtime_error("Supercompressed KTX2 files are not supported");
+	}
+	if (pixelDepth > 1 || layerCount > 1 || faceCount != 1) {
+		throw std::runtime_error("Only single 2D KTX2 textures are supported");
+	}
+	if (image.size.x <= 0 || image.size.y <= 0) {
+		throw std::runtime_error("Invalid KTX2 image size");
+	}
+	if (mipLevelCount > maxMipLevelCount(image.size)) {
+		throw std::runtime_error("Invalid KTX2 mip count");
+	}
+	image.format = vkFormatToBlockFormat(vkFormat);
+
+	for (uint32_t level = 0; level < mipLevelCount; ++level) {
+		size_t indexOffset = ktx2LevelIndexOffset + level * ktx2LevelIndexEntrySize;
+		auto byteOffset = static_cast<size_t>(readValue<uint64_t>(bytes, indexOffset));
+		auto byteLength = static_cast<size_t>(readValue<uint64_t>(bytes, indexOffset + 8));
+
+		MipLevel mipLevel;
+		mipLevel.size = mipLevelSize(image.size, level);
+		mipLevel.offset = image.data.size();
+		mipLevel.byteSize = blockCompressedSize(image.format, mipLevel.size);
+		if (byteLength != mipLevel.byteSize || byteOffset > bytes.size() || byteLength > bytes.size() - byteOffset) {
+			throw std::runtime_error("Invalid KTX2 level index");
+		}
+		image.data.insert(image.data.end(), bytes.begin() + static_cast<std::ptrdiff_t>(byteOffset),
+						  bytes.begin() + static_cast<std::ptrdiff_t>(byteOffset + byteLength));
+		image.mipLevels.push_back(mipLevel);
+	}
+	return image;
+}
+
+/** Encoding */
+
+std::vector<uint8_t> encodeBlocks(BlockFormat format, const uint8_t *rgba, Size size) {
+	if (format != BlockFormat::BC1 && format != BlockFormat::BC3 && format != BlockFormat::BC4 &&
+		format != BlockFormat::BC5) {
+		throw std::runtime_error("No encoder for the block format");
+	}
+
+	const int blocksX = (size.x + 3) / 4;
+	const int blocksY = (size.y + 3) / 4;
+	const size_t blockSize = blockByteSize(format);
+	std::vector<uint8_t> blocks(blockCompressedSize(format, size));
+
+	for (int blockY = 0; blockY < blocksY; ++blockY) {
+		for (int blockX = 0; blockX < blocksX; ++blockX) {
+			Block block = fetchBlock(rgba, size, blockX, blockY);
+			uint8_t *output = blocks.data() + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+			switch (format) {
+			case BlockFormat::BC1: encodeColorBlock(block, output); break;
+			case BlockFormat::BC3:
+				encodeAlphaBlock(block, 3, output);
+				encodeColorBlock(block, output + 8);
+				break;
+			case BlockFormat::BC4: encodeAlphaBlock(block, 0, output); break;
+			case BlockFormat::BC5:
+				encodeAlphaBlock(block, 0, output);
+				encodeAlphaBlock(block, 1, output + 8);
+				break;
+			default: break;
+			}
+		}
+	}
+	return blocks;
+}
+
+std::vector<uint8_t> decodeBlocks(BlockFormat format, const uint8_t *blocks, Size size) {
+	if (format != BlockFormat::BC1 && format != BlockFormat::BC2 && format != BlockFormat::BC3 &&
+		format != BlockFormat::BC4 && format != BlockFormat::BC5) {
+		throw std::runtime_error("No decoder for the block format");
+	}
+
+	const int blocksX = (size.x + 3) / 4;
+	const int blocksY = (size.y + 3) / 4;
+	const size_t blockSize = blockByteSize(format);
+	std::vector<uint8_t> rgba(static_cast<size_t>(size.x) * size.y * 4);
+
+	for (int blockY = 0; blockY < blocksY; ++blockY) {
+		for (int blockX = 0; blockX < blocksX; ++blockX) {
+			const uint8_t *input = blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+			Block block = {};
+			switch (format) {
+			case BlockFormat::BC1: decodeColorBlock(input, false, block); break;
+			case BlockFormat::BC2:
+				decodeColorBlock(input + 8, true, block);
+				decodeExplicitAlphaBlock(input, block);
+				break;
+			case BlockFormat::BC3:
+				decodeColorBlock(input + 8, true, block);
+				decodeAlphaBlock(input, 3, block);
+				break;
+			case BlockFormat::BC4:
+			case BlockFormat::BC5:
+				decodeAlphaBlock(input, 0, block);
+				if (format == BlockFormat::BC5) {
+					decodeAlphaBlock(input + 8, 1, block);
+				}
+				for (auto &pixel : block) {
+					pixel[3] = 255;
+				}
+				break;
+			default: break;
+			}
+			storeBlock(block, rgba.data(), size, blockX, blockY);
+		}
+	}
+	return rgba;
+}
+
+CompressedImage compressImage(BlockFormat format, const uint8_t *rgba, Size size, bool generateMipmaps) {
+	CompressedImage image;
+	image.format = format;
+	image.size = size;
+
+	std::vector<uint8_t> level(rgba, rgba + static_cast<size_t>(size.x) * size.y * 4);
+	Size levelSize = size;
+	while (true) {
+		std::vector<uint8_t> blocks = encodeBlocks(format, level.data(), levelSize);
+		image.mipLevels.push_back({levelSize, image.data.size(), blocks.size()});
+		image.data.insert(image.data.end(), blocks.begin(), blocks.end());
+
+		if (!generateMipmaps || (levelSize.x == 1 && levelSize.y == 1)) {
+			break;
+		}
+		Size nextSize = {std::max(1, levelSize.x / 2), std::max(1, levelSize.y / 2)};
+		level = downsample(level, levelSize, nextSize);
+		levelSize = nextSize;
+	}
+	return image;
+}
+
+} // namespace Stone::Core::Image
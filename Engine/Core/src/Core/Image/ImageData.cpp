@@ -2,9 +2,12 @@
 
 #include "Core/Image/ImageData.hpp"
 
+#include "Core/Image/BlockCompression.hpp"
+#include "Utils/FileSystem.hpp"
 #include "Utils/Glm.hpp"
 
 #define GLM_ENABLE_EXPERIMENTAL
+#include <cstring>
 #include <glm/gtx/io.hpp>
 #include <stb_image.h>
 
@@ -18,6 +21,8 @@ ImageData::~ImageData() {
 
 std::ostream &ImageData::writeToStream(std::ostream &stream, bool closing_bracer) const {
 	stream << "{size:" << _size << ",channels:" << _channels;
+	if (isCompressed())
+		stream << ",format:" << _blockFormat << ",mipLevels:" << _mipLevels.size();
 	if (closing_bracer)
 		stream << "}";
 	return stream;
@@ -32,7 +37,23 @@ Channel ImageData::getChannels() const {
 }
 
 const uint8_t *ImageData::getData() const {
-	return _data;
+	return _data != nullptr ? _data : _ownedData.data();
+}
+
+size_t ImageData::getDataSize() const {
+	return _data != nullptr ? _mipLevels.front().byteSize : _ownedData.size();
+}
+
+BlockFormat ImageData::getBlockFormat() const {
+	return _blockFormat;
+}
+
+bool ImageData::isCompressed() const {
+	return _blockFormat != BlockFormat::None;
+}
+
+const std::vector<MipLevel> &ImageData::getMipLevels() const {
+	return _mipLevels;
 }
 
 std::shared_ptr<ImageSource> ImageData::getSource() const {
@@ -40,12 +61,42 @@ std::shared_ptr<ImageSource> ImageData::getSource() const {
 }
 
 ImageData::ImageData(const std::string &filepath, Channel channels) {
-	_data = stbi_load(filepath.c_str(), &_size.x, &_size.y, &_channels, static_cast<int>(channels));
+	std::vector<char> bytes = Utils::readBinaryFile(filepath);
+
+	if (isBlockCompressedFile(bytes)) {
+		// Compressed files are uploaded as they are stored, the requested channels do not apply.
+		CompressedImage image = std::memcmp(bytes.data(), "DDS ", 4) == 0 ? readDDS(bytes) : readKTX2(bytes);
+		_size = image.size;
+		_blockFormat = image.format;
+		_ownedData = std::move(image.data);
+		_mipLevels = std::move(image.mipLevels);
+		switch (_blockFormat) {
+		case BlockFormat::BC4: _channels = static_cast<int>(Channel::GREY); break;
+		case BlockFormat::BC5: _channels = static_cast<int>(Channel::DUAL); break;
+		case BlockFormat::BC6H: _channels = static_cast<int>(Channel::RGB); break;
+		default: _channels = static_cast<int>(Channel::RGBA); break;
+		}
+		return;
+	}
+
+	_data = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(bytes.data()), static_cast<int>(bytes.size()),
+								  &_size.x, &_size.y, &_channels, static_cast<int>(channels));
 	if (_data == nullptr) {
 		throw std::runtime_error("Failed to load image: " + filepath +
 								 " with channels: " + std::to_string(static_cast<int>(channels)));
 	}
+	// stb_image reports the channels of the file, the data holds the requested ones.
+	_channels = static_cast<int>(channels);
 	assert(_channels >= 1 && _channels <= 4);
+	_mipLevels.push_back({_size, 0, static_cast<size_t>(_size.x) * _size.y * _channels});
+}
+
+ImageData::ImageData(const Size &size, Channel channels, std::vector<uint8_t> pixels)
+	: _size(size), _channels(static_cast<int>(channels)), _ownedData(std::move(pixels)) {
+	if (_ownedData.size() != static_cast<size_t>(_size.x) * _size.y * _channels) {
+		throw std::runtime_error("Image pixels do not match the image size");
+	}
+	_mipLevels.push_back({_size, 0, _ownedData.size()});
 }
 
 } // namespace Stone::Core::Image
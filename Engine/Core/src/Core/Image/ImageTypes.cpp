@@ -14,4 +14,18 @@ std::ostream &operator<<(std::ostream &stream, Channel channel) {
 	return stream;
 }
 
+std::ostream &operator<<(std::ostream &stream, BlockFormat format) {
+	switch (format) {
+	case BlockFormat::None: stream << "None"; break;
+	case BlockFormat::BC1: stream << "BC1"; break;
+	case BlockFormat::BC2: stream << "BC2"; break;
+	case BlockFormat::BC3: stream << "BC3"; break;
+	case BlockFormat::BC4: stream << "BC4"; break;
+	case BlockFormat::BC5: stream << "BC5"; break;
+	case BlockFormat::BC6H: stream << "BC6H"; break;
+	case BlockFormat::BC7: stream << "BC7"; break;
+	}
+	return stream;
+}
+
 } // namespace Stone::Core::Image
@@ -0,0 +1,170 @@
+#include "Core/Image/BlockCompression.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <gtest/gtest.h>
+
+using namespace Stone::Core::Image;
+
+static std::vector<uint8_t> makeGradient(Size size) {
+	std::vector<uint8_t> rgba(static_cast<size_t>(size.x) * size.y * 4);
+	for (int y = 0; y < size.y; ++y) {
+		for (int x = 0; x < size.x; ++x) {
+			uint8_t *pixel = rgba.data() + (static_cast<size_t>(y) * size.x + x) * 4;
+			pixel[0] = static_cast<uint8_t>(x * 255 / std::max(1, size.x - 1));
+			pixel[1] = static_cast<uint8_t>(y * 255 / std::max(1, size.y - 1));
+			pixel[2] = 64;
+			pixel[3] = static_cast<uint8_t>(255 - x * 255 / std::max(1, size.x - 1));
+		}
+	}
+	return rgba;
+}
+
+static int maxChannelError(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b, int channelCount) {
+	int maxError = 0;
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (static_cast<int>(i % 4) < channelCount) {
+			maxError = std::max(maxError, std::abs(a[i] - b[i]));
+		}
+	}
+	return maxError;
+}
+
+/** Writes a BC1 KTX2 file holding the single level of the image. */
+static std::vector<char> makeKTX2(const CompressedImage &image) {
+	std::vector<char> file = {'\xAB', 'K', 'T', 'X', ' ', '2', '0', '\xBB', '\r', '\n', '\x1A', '\n'};
+	auto write = [&file](auto value) {
+		const char *begin = reinterpret_cast<const char *>(&value);
+		file.insert(file.end(), begin, begin + sizeof(value));
+	};
+	// vkFormat BC1_RGBA_UNORM, typeSize, width, height, depth, layers, faces, levels, supercompression
+	for (uint32_t value : {133u, 1u, static_cast<uint32_t>(image.size.x), static_cast<uint32_t>(image.size.y), 0u, 0u,
+						   1u, 1u, 0u}) {
+		write(value);
+	}
+	for (int i = 0; i < 4; ++i) {
+		write(uint32_t(0)); // Data format descriptor and key values
+	}
+	write(uint64_t(0)); // Supercompression global data
+	write(uint64_t(0));
+	write(uint64_t(file.size() + 24)); // Level index
+	write(uint64_t(image.data.size()));
+	write(uint64_t(image.data.size()));
+	file.insert(file.end(), image.data.begin(), image.data.end());
+	return file;
+}
+
+TEST(BlockCompression, CompressedSize) {
+	EXPECT_EQ(blockCompressedSize(BlockFormat::BC1, Size(4, 4)), 8u);
+	EXPECT_EQ(blockCompressedSize(BlockFormat::BC1, Size(5, 3)), 16u);
+	EXPECT_EQ(blockCompressedSize(BlockFormat::BC3, Size(1, 1)), 16u);
+	EXPECT_EQ(blockCompressedSize(BlockFormat::BC7, Size(256, 128)), 64u * 32u * 16u);
+}
+
+TEST(BlockCompression, SolidColorIsExact) {
+	Size size(8, 8);
+	std::vector<uint8_t> rgba(static_cast<size_t>(size.x) * size.y * 4);
+	for (size_t i = 0; i < rgba.size(); i += 4) {
+		rgba[i] = 255;
+		rgba[i + 1] = 0;
+		rgba[i + 2] = 255;
+		rgba[i + 3] = 128;
+	}
+
+	std::vector<uint8_t> blocks = encodeBlocks(BlockFormat::BC3, rgba.data(), size);
+	EXPECT_EQ(decodeBlocks(BlockFormat::BC3, blocks.data(), size), rgba);
+}
+
+TEST(BlockCompression, GradientRoundTrip) {
+	Size size(62, 30);
+	std::vector<uint8_t> rgba = makeGradient(size);
+
+	std::vector<uint8_t> bc1 = encodeBlocks(BlockFormat::BC1, rgba.data(), size);
+	ASSERT_EQ(bc1.size(), blockCompressedSize(BlockFormat::BC1, size));
+	EXPECT_LE(maxChannelError(rgba, decodeBlocks(BlockFormat::BC1, bc1.data(), size), 3), 16);
+
+	std::vector<uint8_t> bc3 = encodeBlocks(BlockFormat::BC3, rgba.data(), size);
+	EXPECT_LE(maxChannelError(rgba, decodeBlocks(BlockFormat::BC3, bc3.data(), size), 4), 16);
+
+	std::vector<uint8_t> bc5 = encodeBlocks(BlockFormat::BC5, rgba.data(), size);
+	EXPECT_LE(maxChannelError(rgba, decodeBlocks(BlockFormat::BC5, bc5.data(), size), 2), 4);
+}
+
+TEST(BlockCompression, DDSRoundTrip) {
+	Size size(32, 16);
+	std::vector<uint8_t> rgba = makeGradient(size);
+	CompressedImage image = compressImage(BlockFormat::BC3, rgba.data(), size);
+	ASSERT_EQ(image.mipLevels.size(), 6u);
+	EXPECT_EQ(image.mipLevels.back().size, Size(1, 1));
+
+	std::vector<char> file = writeDDS(image);
+	EXPECT_TRUE(isBlockCompressedFile(file));
+
+	CompressedImage loaded = readDDS(file);
+	EXPECT_EQ(loaded.format, BlockFormat::BC3);
+	EXPECT_EQ(loaded.size, size);
+	ASSERT_EQ(loaded.mipLevels.size(), image.mipLevels.size());
+	for (size_t i = 0; i < loaded.mipLevels.size(); ++i) {
+		EXPECT_EQ(loaded.mipLevels[i].size, image.mipLevels[i].size);
+		EXPECT_EQ(loaded.mipLevels[i].offset, image.mipLevels[i].offset);
+		EXPECT_EQ(loaded.mipLevels[i].byteSize, image.mipLevels[i].byteSize);
+	}
+	EXPECT_EQ(loaded.data, image.data);
+}
+
+TEST(BlockCompression, ReadKTX2) {
+	Size size(8, 4);
+	CompressedImage image = compressImage(BlockFormat::BC1, makeGradient(size).data(), size, false);
+
+	std::vector<char> file = makeKTX2(image);
+	EXPECT_TRUE(isBlockCompressedFile(file));
+	CompressedImage loaded = readKTX2(file);
+	EXPECT_EQ(loaded.format, BlockFormat::BC1);
+	EXPECT_EQ(loaded.size, size);
+	ASSERT_EQ(loaded.mipLevels.size(), 1u);
+	EXPECT_EQ(loaded.data, image.data);
+}
+
+TEST(BlockCompression, RejectsInvalidFiles) {
+	std::vector<char> png = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n', 0, 0, 0, 0};
+	EXPECT_FALSE(isBlockCompressedFile(png));
+	EXPECT_THROW(readDDS(png), std::runtime_error);
+	EXPECT_THROW(readKTX2(png), std::runtime_error);
+
+	CompressedImage image = compressImage(BlockFormat::BC1, makeGradient(Size(8, 8)).data(), Size(8, 8));
+	std::vector<char> truncated = writeDDS(image);
+	truncated.resize(truncated.size() - 1);
+	EXPECT_THROW(readDDS(truncated), std::runtime_error);
+}
+
+TEST(BlockCompression, RejectsInvalidMipCount) {
+	auto setMipCount = [](std::vector<char> file, size_t offset, uint32_t mipLevelCount) {
+		std::memcpy(file.data() + offset, &mipLevelCount, sizeof(mipLevelCount));
+		return file;
+	};
+
+	// An 8x4 image has a full chain of 4 levels.
+	Size size(8, 4);
+	CompressedImage image = compressImage(BlockFormat::BC1, makeGradient(size).data(), size);
+	ASSERT_EQ(image.mipLevels.size(), 4u);
+
+	std::vector<char> dds = writeDDS(image);
+	EXPECT_NO_THROW(readDDS(setMipCount(dds, 28, 4)));
+	EXPECT_THROW(readDDS(setMipCount(dds, 28, 5)), std::runtime_error);
+	EXPECT_THROW(readDDS(setMipCount(dds, 28, 40)), std::runtime_error);
+
+	std::vector<char> ktx2 = makeKTX2(compressImage(BlockFormat::BC1, makeGradient(size).data(), size, false));
+	EXPECT_THROW(readKTX2(setMipCount(ktx2, 40, 5)), std::runtime_error);
+	EXPECT_THROW(readKTX2(setMipCount(ktx2, 40, 40)), std::runtime_error);
+}
+
+TEST(BlockCompression, RejectsOverflowingLevelIndex) {
+	Size size(8, 4);
+	CompressedImage image = compressImage(BlockFormat::BC1, makeGradient(size).data(), size, false);
+	std::vector<char> file = makeKTX2(image);
+
+	// The offset and length of the level wrap around when added.
+	uint64_t byteOffset = ~uint64_t(0) - image.data.size() + 2;
+	std::memcpy(file.data() + 80, &byteOffset, sizeof(byteOffset));
+	EXPECT_THROW(readKTX2(file), std::runtime_error);
+}
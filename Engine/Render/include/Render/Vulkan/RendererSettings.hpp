@@ -23,6 +23,20 @@ struct RendererSettings {
 	std::function<VkResult(VkInstance, const VkAllocationCallbacks *, VkSurfaceKHR *)> createSurface = nullptr;
 	std::vector<const char *> deviceExt = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 	std::pair<uint32_t, uint32_t> frame_size = {};
+	uint32_t framesInFlight = 2; // Frames recorded while the GPU renders the previous ones, at least one.
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR; // Falls back to FIFO, the only mode always supported.
+	std::optional<size_t> recordingWorkers = {}; // Threads of the draws, shaders and pipelines, default per hardware.
+	bool gpuDrivenDrawing = false; // Cull on the GPU and draw with indirect commands, when the device supports it.
+	bool headless = false; // Render into offscreen images of frame_size, no window surface nor swap chain is needed.
+	bool profiling = false; // Record CPU and GPU timings of the frames, when the device supports timestamps.
+	bool depthPrepass = false; // Lay the depth of the opaque draws from their positions alone before shading them.
+	std::string shaderCacheDirectory = {}; // Keeps the compiled shaders between runs, empty to disable.
+	std::string shaderVariantManifest = {}; // Variants compiled at startup, empty to disable.
+	std::string pipelineManifest = {}; // Pipelines created at startup, empty to disable.
+	std::string pipelineCacheFile = {}; // Keeps the driver pipeline cache between runs, empty to disable.
+	bool textureStreaming = false; // Load the textures at a low mip first, then the mips their draws cover on screen.
+	uint32_t textureStartSize = 64; // Size of the level the streamed textures start at.
+	VkDeviceSize textureBudget = 512ull << 20; // Texture bytes past which high mips are evicted, 0 for none.
 };
 
 } // namespace Stone::Render::Vulkan
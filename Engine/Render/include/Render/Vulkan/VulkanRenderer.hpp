@@ -5,6 +5,18 @@
 #include "Render/Renderer.hpp"
 #include "Render/Vulkan/RendererSettings.hpp"
 
+#include <future>
+#include <vector>
+
+namespace Stone {
+class ThreadPool;
+class TraceRecorder;
+}
+
+namespace Stone::Core::Image {
+class ImageData;
+}
+
 namespace Stone::Scene {
 class WorldNode;
 }
@@ -12,9 +24,25 @@ class WorldNode;
 namespace Stone::Render::Vulkan {
 
 class Device;
+class DescriptorAllocator;
+class DescriptorLayoutCache;
 class RenderPass;
 class FramesRenderer;
+class FrameUniformBuffer;
+class GpuCulling;
+class GpuProfiler;
+class GpuSkinning;
+class LightClusters;
+class OffscreenTarget;
+class PipelineCache;
+class RenderQueue;
+class SecondaryCommandBuffers;
+class ShaderCompiler;
+class ShadowMaps;
 class SwapChain;
+class TextureStreamer;
+struct FrameContext;
+struct RenderContext;
 struct ImageContext;
 
 class VulkanRenderer : public Renderer {
@@ -38,17 +66,124 @@ public:
 	[[nodiscard]] const std::shared_ptr<RenderPass> &getRenderPass() const;
 	[[nodiscard]] const std::shared_ptr<FramesRenderer> &getFramesRenderer() const;
 	[[nodiscard]] const std::shared_ptr<SwapChain> &getSwapChain() const;
+	[[nodiscard]] const std::shared_ptr<FrameUniformBuffer> &getFrameUniformBuffer() const;
+	[[nodiscard]] const std::shared_ptr<DescriptorLayoutCache> &getDescriptorLayoutCache() const;
+	[[nodiscard]] const std::shared_ptr<DescriptorAllocator> &getDescriptorAllocator() const;
+	[[nodiscard]] const std::shared_ptr<PipelineCache> &getPipelineCache() const;
+	[[nodiscard]] const std::shared_ptr<OffscreenTarget> &getOffscreenTarget() const;
+	[[nodiscard]] const std::shared_ptr<GpuSkinning> &getGpuSkinning() const;
+
+	/** Returns the streamer of the texture mips, null unless texture streaming is enabled. */
+	[[nodiscard]] const std::shared_ptr<TextureStreamer> &getTextureStreamer() const;
+
+	/** Returns the compiler of the GLSL shaders, caching their SPIR-V in the shader cache directory of the settings. */
+	[[nodiscard]] const std::shared_ptr<ShaderCompiler> &getShaderCompiler() const;
+
+	/**
+	 * Returns the GPU profiler, null unless profiling is enabled and supported.
+	 * Its timings are read as many frames late as there are frames in flight.
+	 */
+	[[nodiscard]] const std::shared_ptr<GpuProfiler> &getGpuProfiler() const;
+
+	/**
+	 * Returns the recorder of the CPU and GPU timings of the frames, null unless profiling is enabled.
+	 * The recorder writes them as a Chrome trace, viewed in chrome://tracing or Perfetto.
+	 */
+	[[nodiscard]] const std::shared_ptr<TraceRecorder> &getTraceRecorder() const;
+
+	[[nodiscard]] bool isHeadless() const;
+
+	/** Whether the opaque draws are preceded by a depth prepass, their pipelines then only shade visible fragments. */
+	[[nodiscard]] bool hasDepthPrepass() const;
+
+	/**
+	 * Selects the present mode of the swap chain, which is recreated before the next frame.
+	 * FIFO waits for the vertical blank, MAILBOX replaces the queued image and IMMEDIATE presents without waiting.
+	 *
+	 * @param presentMode The preferred present mode, FIFO is used when the surface does not support it.
+	 */
+	void setPresentMode(VkPresentModeKHR presentMode);
+
+	/**
+	 * Requests a copy of the next rendered frame, only available when the renderer is headless.
+	 * The copy is recorded with the frame and read back once the GPU completed it, without stalling the rendering.
+	 *
+	 * @return A future fulfilled with the RGBA pixels of the frame by processFrameCaptures.
+	 */
+	std::future<std::shared_ptr<Core::Image::ImageData>> captureNextFrame();
+
+	/**
+	 * Fulfills the captures of the frames the GPU completed. renderWorld calls it without waiting.
+	 *
+	 * @param wait Whether to wait for the GPU to complete every captured frame.
+	 */
+	void processFrameCaptures(bool wait = false);
 
 private:
-	void _recreateSwapChain(std::pair<uint32_t, uint32_t> size);
-
-	void _recordCommandBuffer(VkCommandBuffer commandBuffer, ImageContext *imageContext,
+	struct FrameCapture {
+		uint32_t imageIndex;
+		VkFence fence;
+		std::vector<std::promise<std::shared_ptr<Core::Image::ImageData>>> promises;
+	};
+
+	struct RetiredSwapChain {
+		std::shared_ptr<SwapChain> swapChain;
+		uint64_t releaseFrame; /**< The first frame after which no frame in flight uses the swap chain. */
+	};
+
+	/**
+	 * Replaces the swap chain without waiting for the device, the previous one is released once its frames completed.
+	 *
+	 * @return False when the surface has no area, while the window is minimized.
+	 */
+	bool _recreateSwapChain();
+	void _releaseRetiredSwapChains();
+
+	void _recreateOffscreenTarget();
+
+	[[nodiscard]] VkExtent2D _getFrameExtent() const;
+
+	void _recordCommandBuffer(const FrameContext &frameContext, ImageContext *imageContext,
 							  const std::shared_ptr<Scene::WorldNode> &world);
 
+	/** Sets the viewport, the scissor and the frame set, which secondary command buffers do not inherit. */
+	void _setDrawStates(VkCommandBuffer commandBuffer, const RenderContext &context) const;
+	void _recordDraws(VkCommandBuffer commandBuffer, const RenderContext &context, size_t first, size_t last) const;
+	void _recordDepthDraws(VkCommandBuffer commandBuffer, const RenderContext &context, size_t first,
+						   size_t last) const;
+	void _recordColorDraws(VkCommandBuffer commandBuffer, const RenderContext &context, size_t first,
+						   size_t last) const;
+
 	std::shared_ptr<Device> _device;
+	std::shared_ptr<DescriptorLayoutCache> _descriptorLayoutCache;
+	std::shared_ptr<DescriptorAllocator> _descriptorAllocator;
 	std::shared_ptr<RenderPass> _renderPass;
 	std::shared_ptr<FramesRenderer> _framesRenderer;
 	std::shared_ptr<SwapChain> _swapChain;
+	std::vector<RetiredSwapChain> _retiredSwapChains;
+	std::shared_ptr<OffscreenTarget> _offscreenTarget;
+	std::shared_ptr<FrameUniformBuffer> _frameUniformBuffer;
+	std::shared_ptr<ShaderCompiler> _shaderCompiler;
+	std::shared_ptr<PipelineCache> _pipelineCache;
+	std::shared_ptr<RenderQueue> _renderQueue;
+	std::shared_ptr<GpuCulling> _gpuCulling;
+	std::shared_ptr<GpuSkinning> _gpuSkinning;
+	std::shared_ptr<LightClusters> _lightClusters;
+	std::shared_ptr<ShadowMaps> _shadowMaps;
+	std::shared_ptr<TextureStreamer> _textureStreamer;
+	std::shared_ptr<TraceRecorder> _traceRecorder;
+	std::shared_ptr<GpuProfiler> _gpuProfiler;
+	std::shared_ptr<ThreadPool> _threadPool;
+	std::shared_ptr<SecondaryCommandBuffers> _secondaryCommandBuffers;
+
+	std::pair<uint32_t, uint32_t> _frameSize;
+	VkPresentModeKHR _presentMode;
+	bool _swapChainOutdated = false;
+	bool _depthPrepass;
+	uint64_t _frameNumber = 0;
+
+	std::vector<std::promise<std::shared_ptr<Core::Image::ImageData>>> _requestedCaptures;
+	std::vector<FrameCapture> _frameCaptures;
 };
 
 } // namespace Stone::Render::Vulkan
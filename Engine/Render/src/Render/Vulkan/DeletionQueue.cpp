@@ -0,0 +1,58 @@
+// Copyright 2024 Stone-Engine
+
+#include "DeletionQueue.hpp"
+
+namespace Stone::Render::Vulkan {
+
+DeletionQueue::~DeletionQueue() {
+	flush();
+}
+
+void DeletionQueue::push(std::function<void()> deleter) {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_frameNumber > _completedFrame) {
+			_entries.push_back({_frameNumber, std::move(deleter)});
+			return;
+		}
+	}
+	deleter();
+}
+
+void DeletionQueue::beginFrame(uint64_t frameNumber, uint64_t completedFrame) {
+	std::deque<Entry> completed;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_frameNumber = frameNumber;
+		_completedFrame = completedFrame;
+		while (!_entries.empty() && _entries.front().frame <= completedFrame) {
+			completed.push_back(std::move(_entries.front()));
+			_entries.pop_front();
+		}
+	}
+	_run(completed);
+}
+
+void DeletionQueue::flush() {
+	std::deque<Entry> completed;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_completedFrame = _frameNumber;
+		completed.swap(_entries);
+	}
+	_run(completed);
+}
+
+size_t DeletionQueue::size() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _entries.size();
+}
+
+void DeletionQueue::_run(std::deque<Entry> &entries) {
+	// The deleters run outside of the lock, a deleter may release the resources it owned.
+	for (Entry &entry : entries) {
+		entry.deleter();
+	}
+}
+
+} // namespace Stone::Render::Vulkan
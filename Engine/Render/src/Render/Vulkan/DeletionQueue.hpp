@@ -0,0 +1,62 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace Stone::Render::Vulkan {
+
+/**
+ * Destroys the GPU resources released while frames are in flight, once the device completed the frames using them.
+ *
+ * A released resource is tagged with the frame being prepared, the last one that may use it, and destroyed when the
+ * renderer begins a frame after waiting for the fence of that frame. Nothing waits for the device, so resources can
+ * be released in the middle of a frame. While no frame is in flight, releasing a resource destroys it at once.
+ *
+ * The deleters capture the handles they destroy, never an owner of the device, which owns the queue.
+ */
+class DeletionQueue {
+public:
+	DeletionQueue() = default;
+	DeletionQueue(const DeletionQueue &) = delete;
+
+	virtual ~DeletionQueue();
+
+	/**
+	 * Destroys a resource once the frames in flight completed, or at once when there are none.
+	 *
+	 * @param deleter Destroys the resource.
+	 */
+	void push(std::function<void()> deleter);
+
+	/**
+	 * Starts a frame, destroying the resources released up to the last frame the device completed.
+	 *
+	 * @param frameNumber The frame being prepared, the resources released from now on are tagged with it.
+	 * @param completedFrame The last frame whose fence was waited on.
+	 */
+	void beginFrame(uint64_t frameNumber, uint64_t completedFrame);
+
+	/** Destroys every released resource, once the device is idle. */
+	void flush();
+
+	[[nodiscard]] size_t size() const;
+
+private:
+	struct Entry {
+		uint64_t frame; /**< The last frame that may use the resource. */
+		std::function<void()> deleter;
+	};
+
+	static void _run(std::deque<Entry> &entries);
+
+	mutable std::mutex _mutex;
+	std::deque<Entry> _entries; /**< Ordered by frame, as the frames only advance. */
+	uint64_t _frameNumber = 0;
+	uint64_t _completedFrame = 0;
+};
+
+} // namespace Stone::Render::Vulkan
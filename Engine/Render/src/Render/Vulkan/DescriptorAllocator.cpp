@@ -0,0 +1,113 @@
+// Copyright 2024 Stone-Engine
+
+#include "DescriptorAllocator.hpp"
+
+#include "Device.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+namespace {
+
+constexpr uint32_t initialPoolSize = 64;
+constexpr uint32_t maxPoolSize = 4096;
+
+/** Number of descriptors of each type reserved per set in a pool. */
+constexpr std::array<std::pair<VkDescriptorType, uint32_t>, 5> poolRatios = {{
+	{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+	{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+	{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+	{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+	{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1},
+}};
+
+} // namespace
+
+DescriptorAllocator::DescriptorAllocator(const std::shared_ptr<Device> &device)
+	: _device(device), _nextPoolSize(initialPoolSize) {
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+	_destroyPools();
+}
+
+DescriptorAllocation DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	DescriptorAllocation allocation;
+
+	// Newest pools are the most likely to have room left, older ones get slots back when sets are freed.
+	for (auto it = _pools.rbegin(); it != _pools.rend(); ++it) {
+		allocInfo.descriptorPool = *it;
+		VkResult result = vkAllocateDescriptorSets(_device->getDevice(), &allocInfo, &allocation.descriptorSet);
+		if (result == VK_SUCCESS) {
+			allocation.descriptorPool = *it;
+			return allocation;
+		}
+		if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+			throw std::runtime_error("Failed to allocate descriptor set");
+		}
+	}
+
+	allocInfo.descriptorPool = _createPool(_nextPoolSize);
+	_nextPoolSize = std::min(_nextPoolSize * 2, maxPoolSize);
+
+	if (vkAllocateDescriptorSets(_device->getDevice(), &allocInfo, &allocation.descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate descriptor set");
+	}
+	allocation.descriptorPool = allocInfo.descriptorPool;
+	return allocation;
+}
+
+void DescriptorAllocator::free(DescriptorAllocation &allocation) {
+	if (allocation.descriptorSet != VK_NULL_HANDLE) {
+		vkFreeDescriptorSets(_device->getDevice(), allocation.descriptorPool, 1, &allocation.descriptorSet);
+	}
+	allocation = {};
+}
+
+void DescriptorAllocator::release(DescriptorAllocation &allocation) {
+	if (allocation.descriptorSet != VK_NULL_HANDLE) {
+		_device->getDeletionQueue().push([device = _device->getDevice(), allocation]() {
+			vkFreeDescriptorSets(device, allocation.descriptorPool, 1, &allocation.descriptorSet);
+		});
+	}
+	allocation = {};
+}
+
+VkDescriptorPool DescriptorAllocator::_createPool(uint32_t maxSets) {
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.reserve(poolRatios.size());
+	for (const auto &[type, ratio] : poolRatios) {
+		poolSizes.push_back({type, ratio * maxSets});
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = maxSets;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(_device->getDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor pool");
+	}
+	_pools.push_back(pool);
+	return pool;
+}
+
+void DescriptorAllocator::_destroyPools() {
+	for (VkDescriptorPool pool : _pools) {
+		vkDestroyDescriptorPool(_device->getDevice(), pool, nullptr);
+	}
+	_pools.clear();
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,72 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class Device;
+
+/**
+ * A descriptor set together with the pool it was allocated from.
+ */
+struct DescriptorAllocation {
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
+
+/**
+ * Renderer wide descriptor set allocator.
+ *
+ * Sets are allocated from a list of pools that grows on demand, each new pool being twice as large as the previous
+ * one. Sets can be freed individually and their slots are reused by later allocations.
+ */
+class DescriptorAllocator {
+public:
+	DescriptorAllocator() = delete;
+	explicit DescriptorAllocator(const std::shared_ptr<Device> &device);
+	DescriptorAllocator(const DescriptorAllocator &) = delete;
+
+	virtual ~DescriptorAllocator();
+
+	/**
+	 * Allocates a descriptor set with the given layout, creating a new pool if every existing one is full.
+	 *
+	 * @param layout The layout of the descriptor set.
+	 * @return The allocated set and its pool.
+	 */
+	[[nodiscard]] DescriptorAllocation allocate(VkDescriptorSetLayout layout);
+
+	/**
+	 * Returns the set to its pool and resets the allocation.
+	 *
+	 * @param allocation The allocation to release.
+	 */
+	void free(DescriptorAllocation &allocation);
+
+	/**
+	 * Returns the set to its pool once the frames in flight no longer use it, see DeletionQueue, and resets the
+	 * allocation.
+	 *
+	 * @param allocation The allocation to release.
+	 */
+	void release(DescriptorAllocation &allocation);
+
+	[[nodiscard]] size_t getPoolCount() const {
+		return _pools.size();
+	}
+
+private:
+	VkDescriptorPool _createPool(uint32_t maxSets);
+	void _destroyPools();
+
+	std::shared_ptr<Device> _device;
+
+	std::vector<VkDescriptorPool> _pools;
+	uint32_t _nextPoolSize;
+};
+
+} // namespace Stone::Render::Vulkan
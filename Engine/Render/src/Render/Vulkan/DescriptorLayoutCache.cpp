@@ -0,0 +1,92 @@
+// Copyright 2024 Stone-Engine
+
+#include "DescriptorLayoutCache.hpp"
+
+#include "Device.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+DescriptorLayoutCache::DescriptorLayoutCache(const std::shared_ptr<Device> &device) : _device(device) {
+}
+
+DescriptorLayoutCache::~DescriptorLayoutCache() {
+	_destroyLayouts();
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::getLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings) {
+	LayoutKey key = {bindings};
+	std::sort(key.bindings.begin(), key.bindings.end(),
+			  [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b) {
+				  return a.binding < b.binding;
+			  });
+
+	auto it = _layouts.find(key);
+	if (it != _layouts.end()) {
+		return it->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+	layoutInfo.pBindings = key.bindings.data();
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if (vkCreateDescriptorSetLayout(_device->getDevice(), &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor set layout");
+	}
+
+	_layouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+const std::vector<VkDescriptorSetLayoutBinding> *
+DescriptorLayoutCache::findBindings(VkDescriptorSetLayout layout) const {
+	// Only looked up when recording a new pipeline, a linear search over the few layouts is enough.
+	for (const auto &[key, cachedLayout] : _layouts) {
+		if (cachedLayout == layout) {
+			return &key.bindings;
+		}
+	}
+	return nullptr;
+}
+
+bool DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey &other) const {
+	if (bindings.size() != other.bindings.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < bindings.size(); ++i) {
+		const VkDescriptorSetLayoutBinding &a = bindings[i];
+		const VkDescriptorSetLayoutBinding &b = other.bindings[i];
+		if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+			a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey &key) const {
+	size_t seed = key.bindings.size();
+	for (const VkDescriptorSetLayoutBinding &binding : key.bindings) {
+		assert(binding.pImmutableSamplers == nullptr);
+		size_t packed = static_cast<size_t>(binding.binding) | (static_cast<size_t>(binding.descriptorType) << 8) |
+						(static_cast<size_t>(binding.descriptorCount) << 16) |
+						(static_cast<size_t>(binding.stageFlags) << 24);
+		seed ^= std::hash<size_t>()(packed) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+	return seed;
+}
+
+void DescriptorLayoutCache::_destroyLayouts() {
+	for (auto &it : _layouts) {
+		vkDestroyDescriptorSetLayout(_device->getDevice(), it.second, nullptr);
+	}
+	_layouts.clear();
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,66 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class Device;
+
+/**
+ * Renderer wide cache of descriptor set layouts, keyed by their binding signature.
+ *
+ * Layouts returned by the cache are owned by it and must not be destroyed by the caller.
+ */
+class DescriptorLayoutCache {
+public:
+	DescriptorLayoutCache() = delete;
+	explicit DescriptorLayoutCache(const std::shared_ptr<Device> &device);
+	DescriptorLayoutCache(const DescriptorLayoutCache &) = delete;
+
+	virtual ~DescriptorLayoutCache();
+
+	/**
+	 * Returns the layout matching the bindings, creating it on first request.
+	 * The order of the bindings does not matter, immutable samplers are not supported.
+	 *
+	 * @param bindings The bindings of the layout.
+	 * @return The cached descriptor set layout.
+	 */
+	[[nodiscard]] VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+
+	/**
+	 * Returns the bindings a cached layout was created with.
+	 *
+	 * @param layout A layout returned by the cache.
+	 * @return The bindings sorted by index, null for a layout the cache does not own.
+	 */
+	[[nodiscard]] const std::vector<VkDescriptorSetLayoutBinding> *findBindings(VkDescriptorSetLayout layout) const;
+
+	[[nodiscard]] size_t getLayoutCount() const {
+		return _layouts.size();
+	}
+
+private:
+	struct LayoutKey {
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+		bool operator==(const LayoutKey &other) const;
+	};
+
+	struct LayoutKeyHash {
+		size_t operator()(const LayoutKey &key) const;
+	};
+
+	void _destroyLayouts();
+
+	std::shared_ptr<Device> _device;
+
+	std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> _layouts;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -4,8 +4,10 @@
 
 #include "Utilities/VulkanUtilities.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <set>
+#include <string>
 
 namespace Stone::Render::Vulkan {
 
@@ -25,6 +27,12 @@ VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBits
 
 Device::Device(RendererSettings &settings) {
 	std::cout << "Device created" << std::endl;
+	if (settings.headless) {
+		// Nothing is presented, devices without the swap chain extension such as server drivers remain usable.
+		std::erase_if(settings.deviceExt, [](const char *extension) {
+			return std::string(extension) == VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+		});
+	}
 	_createInstance(settings);
 	_setupDebugMessenger();
 	_createSurface(settings);
@@ -35,6 +43,7 @@ Device::Device(RendererSettings &settings) {
 
 Device::~Device() {
 	waitIdle();
+	_deletionQueue.flush();
 
 	_destroyCommandPool();
 	_destroyLogicalDevice();
@@ -62,13 +71,14 @@ void Device::waitIdle() const {
 	vkDeviceWaitIdle(_device);
 }
 
-SwapChainProperties Device::createSwapChainProperties(const std::pair<uint32_t, uint32_t> &size) const {
+SwapChainProperties Device::createSwapChainProperties(const std::pair<uint32_t, uint32_t> &size,
+													  VkPresentModeKHR presentMode) const {
 	SwapChainProperties settings;
 
 	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(_physicalDevice, _surface);
 
 	settings.surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-	settings.presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+	settings.presentMode = chooseSwapPresentMode(swapChainSupport.presentModes, presentMode);
 
 	settings.capabilities = swapChainSupport.capabilities;
 
@@ -153,6 +163,68 @@ void Device::withSingleCommandBuffer(const std::function<void(VkCommandBuffer)>
 	vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
 }
 
+SingleSubmission Device::submitSingleCommandBuffer(const std::function<void(VkCommandBuffer)> &lambda) const {
+	SingleSubmission submission;
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = _commandPool;
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(_device, &allocInfo, &submission.commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate command buffer");
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	if (vkCreateFence(_device, &fenceInfo, nullptr, &submission.fence) != VK_SUCCESS) {
+		freeSubmission(submission);
+		throw std::runtime_error("Failed to create submission fence");
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(submission.commandBuffer, &beginInfo);
+
+	lambda(submission.commandBuffer);
+
+	vkEndCommandBuffer(submission.commandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &submission.commandBuffer;
+
+	if (vkQueueSubmit(_graphicsQueue, 1, &submitInfo, submission.fence) != VK_SUCCESS) {
+		freeSubmission(submission);
+		throw std::runtime_error("Failed to submit command buffer");
+	}
+
+	return submission;
+}
+
+bool Device::isSubmissionComplete(const SingleSubmission &submission) const {
+	return vkGetFenceStatus(_device, submission.fence) == VK_SUCCESS;
+}
+
+void Device::waitSubmission(const SingleSubmission &submission) const {
+	vkWaitForFences(_device, 1, &submission.fence, VK_TRUE, UINT64_MAX);
+}
+
+void Device::freeSubmission(SingleSubmission &submission) const {
+	if (submission.fence != VK_NULL_HANDLE) {
+		vkDestroyFence(_device, submission.fence, nullptr);
+	}
+	if (submission.commandBuffer != VK_NULL_HANDLE) {
+		vkFreeCommandBuffers(_device, _commandPool, 1, &submission.commandBuffer);
+	}
+	submission = {};
+}
+
 std::pair<VkBuffer, VkDeviceMemory> Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
 														 VkMemoryPropertyFlags properties) const {
 	VkBuffer buffer;
@@ -195,6 +267,14 @@ void Device::destroyBuffer(VkBuffer buffer, VkDeviceMemory memory) const {
 	}
 }
 
+void Device::releaseBuffer(VkBuffer buffer, VkDeviceMemory memory) {
+	if (buffer == VK_NULL_HANDLE && memory == VK_NULL_HANDLE) {
+		return;
+	}
+	// The device owns the queue, it outlives the deleter.
+	_deletionQueue.push([this, buffer, memory]() { destroyBuffer(buffer, memory); });
+}
+
 void Device::bufferCopy(VkBuffer dstBuffer, VkBuffer srcBuffer, VkDeviceSize size,
 						std::optional<VkCommandBuffer> commandBuffer) const {
 
@@ -257,7 +337,7 @@ std::pair<VkImage, VkDeviceMemory> Device::createImage(uint32_t width, uint32_t
 }
 
 void Device::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout,
-								   std::optional<VkCommandBuffer> commandBuffer) const {
+								   uint32_t mipLevels, std::optional<VkCommandBuffer> commandBuffer) const {
 	(void)format;
 	auto lambda = [&](VkCommandBuffer cmdBuff) {
 		VkImageMemoryBarrier barrier = {};
@@ -277,7 +357,7 @@ void Device::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout
 			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		}
 		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.levelCount = mipLevels;
 		barrier.subresourceRange.baseArrayLayer = 0;
 		barrier.subresourceRange.layerCount = 1;
 
@@ -320,6 +400,86 @@ void Device::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout
 	}
 }
 
+void Device::generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels,
+							 std::optional<VkCommandBuffer> commandBuffer) const {
+	auto lambda = [&](VkCommandBuffer cmdBuff) {
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		int32_t mipWidth = static_cast<int32_t>(width);
+		int32_t mipHeight = static_cast<int32_t>(height);
+
+		for (uint32_t level = 1; level < mipLevels; ++level) {
+			int32_t nextWidth = std::max(mipWidth / 2, 1);
+			int32_t nextHeight = std::max(mipHeight / 2, 1);
+
+			barrier.subresourceRange.baseMipLevel = level - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+								 0, nullptr, 1, &barrier);
+
+			VkImageBlit blit = {};
+			blit.srcOffsets[0] = {0, 0, 0};
+			blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = level - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+			blit.dstOffsets[0] = {0, 0, 0};
+			blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = level;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+			vkCmdBlitImage(cmdBuff, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+						   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+								 nullptr, 0, nullptr, 1, &barrier);
+
+			mipWidth = nextWidth;
+			mipHeight = nextHeight;
+		}
+
+		// The last level is only written by the blits.
+		barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+							 nullptr, 0, nullptr, 1, &barrier);
+	};
+
+	if (commandBuffer) {
+		lambda(*commandBuffer);
+	} else {
+		withSingleCommandBuffer(lambda);
+	}
+}
+
+bool Device::supportsLinearBlit(VkFormat format) const {
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &props);
+
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+									VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (props.optimalTilingFeatures & required) == required;
+}
 
 void Device::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height,
 							   std::optional<VkCommandBuffer> commandBuffer) const {
@@ -347,7 +507,8 @@ void Device::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, u
 	}
 }
 
-VkImageView Device::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) const {
+VkImageView Device::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+									uint32_t mipLevels) const {
 	VkImageViewCreateInfo viewInfo = {};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewInfo.image = image;
@@ -355,7 +516,7 @@ VkImageView Device::createImageView(VkImage image, VkFormat format, VkImageAspec
 	viewInfo.format = format;
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
 	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.levelCount = mipLevels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
 
@@ -458,6 +619,9 @@ void Device::_destroyDebugMessenger() {
 /** Surface */
 
 void Device::_createSurface(RendererSettings &settings) {
+	if (settings.headless) {
+		return;
+	}
 	if (settings.createSurface != nullptr) {
 		if (settings.createSurface(_instance, nullptr, &_surface) == VK_SUCCESS) {
 			return;
@@ -520,9 +684,11 @@ int deviceSuitability(VkPhysicalDevice device, VkSurfaceKHR surface,
 		return -1;
 	}
 
-	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
-	if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
-		return -1;
+	if (surface != VK_NULL_HANDLE) {
+		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
+		if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
+			return -1;
+		}
 	}
 
 	score += static_cast<int>(properties.limits.maxImageDimension2D);
@@ -574,8 +740,19 @@ void Device::_createLogicalDevice(RendererSettings &settings) {
 		queueCreateInfos.emplace_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	// Used by the GPU driven drawing when the device has them.
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	// Block compressed textures are decoded on the CPU when the device cannot sample them.
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	// Counted by the GPU profiler, across the secondary command buffers of the main pass.
+	deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+	deviceFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
 
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -596,6 +773,8 @@ void Device::_createLogicalDevice(RendererSettings &settings) {
 		throw std::runtime_error("Failed to create logical device");
 	}
 
+	_enabledFeatures = deviceFeatures;
+	_graphicsQueueFamily = indices.graphicsFamily.value();
 	vkGetDeviceQueue(_device, indices.graphicsFamily.value(), 0, &_graphicsQueue);
 	vkGetDeviceQueue(_device, indices.presentFamily.value(), 0, &_presentQueue);
 }
@@ -612,12 +791,10 @@ void Device::_destroyLogicalDevice() {
 /** Command Pool */
 
 void Device::_createCommandPool() {
-	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(_physicalDevice, _surface);
-
 	VkCommandPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+	poolInfo.queueFamilyIndex = _graphicsQueueFamily;
 
 	if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create command pool");
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "DeletionQueue.hpp"
 #include "Render/Vulkan/RendererSettings.hpp"
 #include "Utilities/SwapChainProperties.hpp"
 
@@ -9,6 +10,12 @@
 
 namespace Stone::Render::Vulkan {
 
+/** A command buffer submitted without waiting for it, see Device::submitSingleCommandBuffer. */
+struct SingleSubmission {
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE; /**< Signaled when the commands completed. */
+};
+
 class Device {
 public:
 	Device() = delete;
@@ -39,13 +46,27 @@ public:
 		return _presentQueue;
 	}
 
+	[[nodiscard]] uint32_t getGraphicsQueueFamily() const {
+		return _graphicsQueueFamily;
+	}
+
+	[[nodiscard]] const VkPhysicalDeviceFeatures &getEnabledFeatures() const {
+		return _enabledFeatures;
+	}
+
 	const VkCommandPool &getCommandPool() {
 		return _commandPool;
 	}
 
 	void waitIdle() const;
 
-	[[nodiscard]] SwapChainProperties createSwapChainProperties(const std::pair<uint32_t, uint32_t> &size) const;
+	/** Destroys the resources released while frames are in flight, the renderer advances its frames. */
+	DeletionQueue &getDeletionQueue() {
+		return _deletionQueue;
+	}
+
+	[[nodiscard]] SwapChainProperties createSwapChainProperties(const std::pair<uint32_t, uint32_t> &size,
+																VkPresentModeKHR presentMode) const;
 
 	[[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
 
@@ -61,11 +82,40 @@ public:
 	 */
 	void withSingleCommandBuffer(const std::function<void(VkCommandBuffer)> &lambda) const;
 
+	/**
+	 * Records a single command buffer with the provided lambda and submits it to the graphics queue without waiting.
+	 *
+	 * @param lambda The lambda function recording the commands.
+	 * @return The submission, to be freed with freeSubmission once complete.
+	 */
+	[[nodiscard]] SingleSubmission submitSingleCommandBuffer(const std::function<void(VkCommandBuffer)> &lambda) const;
+
+	/** Whether the commands of a submission completed, without waiting. */
+	[[nodiscard]] bool isSubmissionComplete(const SingleSubmission &submission) const;
+
+	/** Waits for the commands of a submission, and only them, to complete. */
+	void waitSubmission(const SingleSubmission &submission) const;
+
+	/**
+	 * Frees the command buffer and the fence of a completed submission, and resets it.
+	 *
+	 * @param submission The submission, complete or never submitted.
+	 */
+	void freeSubmission(SingleSubmission &submission) const;
+
 	std::pair<VkBuffer, VkDeviceMemory> createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
 													 VkMemoryPropertyFlags properties) const;
 
 	void destroyBuffer(VkBuffer buffer, VkDeviceMemory memory) const;
 
+	/**
+	 * Destroys a buffer once the frames in flight no longer use it, see DeletionQueue.
+	 *
+	 * @param buffer The buffer to destroy, may be VK_NULL_HANDLE.
+	 * @param memory The memory bound to the buffer, may be VK_NULL_HANDLE.
+	 */
+	void releaseBuffer(VkBuffer buffer, VkDeviceMemory memory);
+
 	/**
 	 * Copies data from one Vulkan buffer to another.
 	 *
@@ -84,13 +134,37 @@ public:
 												   VkMemoryPropertyFlags properties) const;
 
 	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout,
+							   uint32_t mipLevels = 1,
 							   std::optional<VkCommandBuffer> commandBuffer = std::nullopt) const;
 
+	/**
+	 * Fills the mip chain of an image by blitting each level into the next one with a linear filter.
+	 * Every level is expected in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL with the first one filled, they all end in
+	 * VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+	 *
+	 * @param image The image to fill.
+	 * @param width The width of the first level.
+	 * @param height The height of the first level.
+	 * @param mipLevels The number of levels of the image.
+	 * @param commandBuffer The command buffer to record into. If nullptr, a new command buffer will be allocated.
+	 */
+	void generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels,
+						 std::optional<VkCommandBuffer> commandBuffer = std::nullopt) const;
+
+	/**
+	 * Checks if images of the given format can be blitted with a linear filter, as generateMipmaps does.
+	 *
+	 * @param format The format of the image.
+	 * @return True if the format supports linear blits with optimal tiling.
+	 */
+	[[nodiscard]] bool supportsLinearBlit(VkFormat format) const;
+
 	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height,
 						   std::optional<VkCommandBuffer> commandBuffer = std::nullopt) const;
 
 	VkImageView createImageView(VkImage image, VkFormat format,
-								VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT) const;
+								VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT,
+								uint32_t mipLevels = 1) const;
 
 private:
 	void _createInstance(RendererSettings &settings);
@@ -117,9 +191,13 @@ private:
 	VkSurfaceKHR _surface = VK_NULL_HANDLE;
 	VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
 	VkDevice _device = VK_NULL_HANDLE;
+	VkPhysicalDeviceFeatures _enabledFeatures = {};
+	uint32_t _graphicsQueueFamily = 0;
 	VkQueue _graphicsQueue = VK_NULL_HANDLE;
 	VkQueue _presentQueue = VK_NULL_HANDLE;
 	VkCommandPool _commandPool = VK_NULL_HANDLE;
+
+	DeletionQueue _deletionQueue;
 };
 
 } // namespace Stone::Render::Vulkan
@@ -41,7 +41,7 @@ SwapChainProperties VulkanDevice::createSwapChainProperties(const std::pair<uint
 	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(_core->getPhysicalDevice(), _core->getSurface());
 
 	settings.surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-	settings.presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+	settings.presentMode = chooseSwapPresentMode(swapChainSupport.presentModes, VK_PRESENT_MODE_MAILBOX_KHR);
 
 	settings.capabilities = swapChainSupport.capabilities;
 
@@ -0,0 +1,240 @@
+// Copyright 2024 Stone-Engine
+
+#include "FrameUniformBuffer.hpp"
+
+#include "DescriptorLayoutCache.hpp"
+#include "Device.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace Stone::Render::Vulkan {
+
+FrameUniformBuffer::FrameUniformBuffer(const std::shared_ptr<Device> &device,
+									   const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+									   const std::shared_ptr<DescriptorAllocator> &descriptorAllocator,
+									   uint32_t frameCount)
+	: _device(device), _descriptorAllocator(descriptorAllocator), _frameCount(frameCount) {
+	_createBuffer();
+	_createDescriptorSetLayout(layoutCache);
+	_createPipelineLayout();
+	_createDescriptorSet();
+}
+
+FrameUniformBuffer::~FrameUniformBuffer() {
+	_destroyDescriptorSet();
+	_destroyPipelineLayout();
+	_destroyDescriptorSetLayout();
+	_destroyBuffer();
+}
+
+void FrameUniformBuffer::update(uint32_t frameIndex, const FrameUniforms &uniforms) {
+	assert(frameIndex < _frameCount);
+	std::memcpy(static_cast<char *>(_bufferMapped) + getDynamicOffset(frameIndex), &uniforms, sizeof(FrameUniforms));
+}
+
+void FrameUniformBuffer::setLightBuffers(VkBuffer lightBuffer, VkDeviceSize lightRegionSize, VkBuffer clusterBuffer,
+										 VkDeviceSize clusterRegionSize) {
+	_lightBuffer = lightBuffer;
+	_lightRegionSize = lightRegionSize;
+	_clusterBuffer = clusterBuffer;
+	_clusterRegionSize = clusterRegionSize;
+	_replaceDescriptorSet();
+}
+
+void FrameUniformBuffer::setShadowResources(VkImageView atlasView, VkSampler atlasSampler, VkBuffer tileBuffer,
+											VkDeviceSize tileRegionSize) {
+	_shadowAtlasView = atlasView;
+	_shadowAtlasSampler = atlasSampler;
+	_shadowTileBuffer = tileBuffer;
+	_shadowTileRegionSize = tileRegionSize;
+	_replaceDescriptorSet();
+}
+
+void FrameUniformBuffer::bind(VkCommandBuffer commandBuffer, uint32_t frameIndex) const {
+	uint32_t dynamicOffsets[] = {getDynamicOffset(frameIndex), static_cast<uint32_t>(_lightRegionSize * frameIndex),
+								 static_cast<uint32_t>(_clusterRegionSize * frameIndex),
+								 static_cast<uint32_t>(_shadowTileRegionSize * frameIndex)};
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1,
+							&_descriptorSet.descriptorSet, 4, dynamicOffsets);
+}
+
+uint32_t FrameUniformBuffer::getDynamicOffset(uint32_t frameIndex) const {
+	return static_cast<uint32_t>(_alignedSize * frameIndex);
+}
+
+VkPushConstantRange FrameUniformBuffer::getPushConstantRange() {
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ObjectPushConstants);
+	return pushConstantRange;
+}
+
+
+/** Buffer */
+
+void FrameUniformBuffer::_createBuffer() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device->getPhysicalDevice(), &properties);
+
+	VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+	_alignedSize = sizeof(FrameUniforms);
+	if (alignment > 0) {
+		_alignedSize = (_alignedSize + alignment - 1) & ~(alignment - 1);
+	}
+
+	VkDeviceSize bufferSize = _alignedSize * _frameCount;
+	std::tie(_buffer, _bufferMemory) =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	vkMapMemory(_device->getDevice(), _bufferMemory, 0, bufferSize, 0, &_bufferMapped);
+}
+
+void FrameUniformBuffer::_destroyBuffer() {
+	if (_bufferMapped != nullptr) {
+		vkUnmapMemory(_device->getDevice(), _bufferMemory);
+		_bufferMapped = nullptr;
+	}
+	_device->destroyBuffer(_buffer, _bufferMemory);
+	_buffer = VK_NULL_HANDLE;
+	_bufferMemory = VK_NULL_HANDLE;
+}
+
+
+/** Descriptor Set Layout */
+
+void FrameUniformBuffer::_createDescriptorSetLayout(const std::shared_ptr<DescriptorLayoutCache> &layoutCache) {
+	VkDescriptorSetLayoutBinding uboLayoutBinding = {};
+	uboLayoutBinding.binding = 0;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	uboLayoutBinding.descriptorCount = 1;
+	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	uboLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding lightsBinding = {};
+	lightsBinding.binding = 1;
+	lightsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	lightsBinding.descriptorCount = 1;
+	lightsBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	lightsBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding clustersBinding = lightsBinding;
+	clustersBinding.binding = 2;
+
+	VkDescriptorSetLayoutBinding shadowAtlasBinding = {};
+	shadowAtlasBinding.binding = 3;
+	shadowAtlasBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	shadowAtlasBinding.descriptorCount = 1;
+	shadowAtlasBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shadowAtlasBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding shadowTilesBinding = lightsBinding;
+	shadowTilesBinding.binding = 4;
+
+	_descriptorSetLayout = layoutCache->getLayout(
+		{uboLayoutBinding, lightsBinding, clustersBinding, shadowAtlasBinding, shadowTilesBinding});
+}
+
+void FrameUniformBuffer::_destroyDescriptorSetLayout() {
+	// The layout is owned by the cache.
+	_descriptorSetLayout = VK_NULL_HANDLE;
+}
+
+
+/** Pipeline Layout */
+
+void FrameUniformBuffer::_createPipelineLayout() {
+	VkPushConstantRange pushConstantRange = getPushConstantRange();
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(_device->getDevice(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create frame pipeline layout");
+	}
+}
+
+void FrameUniformBuffer::_destroyPipelineLayout() {
+	if (_pipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(_device->getDevice(), _pipelineLayout, nullptr);
+	}
+	_pipelineLayout = VK_NULL_HANDLE;
+}
+
+
+/** Descriptor Set */
+
+void FrameUniformBuffer::_createDescriptorSet() {
+	_descriptorSet = _descriptorAllocator->allocate(_descriptorSetLayout);
+
+	// Every resource bound so far is written, the bindings not set yet are left for their first setter.
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = _buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = sizeof(FrameUniforms);
+
+	VkDescriptorBufferInfo lightsInfo = {};
+	lightsInfo.buffer = _lightBuffer;
+	lightsInfo.offset = 0;
+	lightsInfo.range = _lightRegionSize;
+
+	VkDescriptorBufferInfo clustersInfo = {};
+	clustersInfo.buffer = _clusterBuffer;
+	clustersInfo.offset = 0;
+	clustersInfo.range = _clusterRegionSize;
+
+	VkDescriptorImageInfo atlasInfo = {};
+	atlasInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	atlasInfo.imageView = _shadowAtlasView;
+	atlasInfo.sampler = _shadowAtlasSampler;
+
+	VkDescriptorBufferInfo tilesInfo = {};
+	tilesInfo.buffer = _shadowTileBuffer;
+	tilesInfo.offset = 0;
+	tilesInfo.range = _shadowTileRegionSize;
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+	auto addWrite = [&](uint32_t binding, VkDescriptorType type) -> VkWriteDescriptorSet & {
+		VkWriteDescriptorSet &descriptorWrite = descriptorWrites.emplace_back();
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = _descriptorSet.descriptorSet;
+		descriptorWrite.dstBinding = binding;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = type;
+		descriptorWrite.descriptorCount = 1;
+		return descriptorWrite;
+	};
+
+	addWrite(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC).pBufferInfo = &bufferInfo;
+	if (_lightBuffer != VK_NULL_HANDLE) {
+		addWrite(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC).pBufferInfo = &lightsInfo;
+		addWrite(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC).pBufferInfo = &clustersInfo;
+	}
+	if (_shadowTileBuffer != VK_NULL_HANDLE) {
+		addWrite(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER).pImageInfo = &atlasInfo;
+		addWrite(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC).pBufferInfo = &tilesInfo;
+	}
+
+	vkUpdateDescriptorSets(_device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+						   descriptorWrites.data(), 0, nullptr);
+}
+
+void FrameUniformBuffer::_replaceDescriptorSet() {
+	// The frames in flight keep the set they recorded, writing it again would change what they read.
+	_descriptorAllocator->release(_descriptorSet);
+	_createDescriptorSet();
+}
+
+void FrameUniformBuffer::_destroyDescriptorSet() {
+	_descriptorAllocator->free(_descriptorSet);
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,152 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "DescriptorAllocator.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class DescriptorLayoutCache;
+class Device;
+
+/** Must match maxDirectionalLights in frag.glsl, the directional lights past it are dropped. */
+constexpr uint32_t maxDirectionalLights = 4;
+
+/**
+ * A directional light of the frame, laid out as std140. The shadow of an infinite light is split in cascades along
+ * the view depth, one shadow tile each.
+ */
+struct GpuDirectionalLight {
+	/** Direction of the light in view space, index of the first shadow tile in w or -1 without shadow. */
+	alignas(16) glm::vec4 direction = glm::vec4(0.0f, 0.0f, -1.0f, -1.0f);
+	/** Color times intensity, w is 1 when the shadow tiles are cascades and 0 for a single tile. */
+	alignas(16) glm::vec4 color = glm::vec4(0.0f);
+	/** The view depth where each cascade ends. */
+	alignas(16) glm::vec4 cascadeSplits = glm::vec4(0.0f);
+};
+
+/**
+ * Uniforms shared by every draw of a frame, bound once at set 0.
+ */
+struct FrameUniforms {
+	alignas(16) glm::mat4 viewMatrix = glm::mat4(1.0f);
+	alignas(16) glm::mat4 projMatrix = glm::mat4(1.0f);
+	/** Sum of the ambient lights in rgb, w is 0 when the frame has no light and is drawn unlit. */
+	alignas(16) glm::vec4 ambientLight = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+	/** Size of the cluster tiles in pixels in xy, scale and bias of the logarithmic depth slices in zw. */
+	alignas(16) glm::vec4 clusterScale = glm::vec4(0.0f);
+	/** The directional lights, shading every fragment. */
+	alignas(16) GpuDirectionalLight directionalLights[maxDirectionalLights];
+	alignas(16) uint32_t directionalLightCount = 0;
+};
+
+/**
+ * Per draw data pushed with vkCmdPushConstants.
+ */
+struct ObjectPushConstants {
+	alignas(16) glm::mat4 modelMatrix = glm::mat4(1.0f);
+};
+
+/**
+ * Ring of FrameUniforms, one slot per frame in flight, stored in a single persistently mapped buffer.
+ *
+ * The slots are addressed with a dynamic offset so that the same descriptor set is used for every frame.
+ *
+ * The set also binds the lights of the frame, their cluster grid and their shadows, read by the fragment shaders.
+ * Set 0 is shared by every pipeline, so the lights stay bound when the pipelines change. Binding new light or shadow
+ * buffers writes a new set, the previous one being still bound by the frames in flight.
+ */
+class FrameUniformBuffer {
+public:
+	FrameUniformBuffer() = delete;
+	FrameUniformBuffer(const std::shared_ptr<Device> &device, const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+					   const std::shared_ptr<DescriptorAllocator> &descriptorAllocator, uint32_t frameCount);
+	FrameUniformBuffer(const FrameUniformBuffer &) = delete;
+
+	virtual ~FrameUniformBuffer();
+
+	void update(uint32_t frameIndex, const FrameUniforms &uniforms);
+
+	/**
+	 * Binds the light buffers in a new frame set, each frame in flight reading its own region of them.
+	 *
+	 * @param lightBuffer The storage buffer of the lights.
+	 * @param lightRegionSize The size of the region of each frame in the light buffer.
+	 * @param clusterBuffer The storage buffer of the light lists of the clusters.
+	 * @param clusterRegionSize The size of the region of each frame in the cluster buffer.
+	 */
+	void setLightBuffers(VkBuffer lightBuffer, VkDeviceSize lightRegionSize, VkBuffer clusterBuffer,
+						 VkDeviceSize clusterRegionSize);
+
+	/**
+	 * Binds the shadow atlas and the shadow tiles in a new frame set, each frame in flight reading its own tiles.
+	 *
+	 * @param atlasView The depth view of the shadow atlas, in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+	 * @param atlasSampler The comparison sampler of the shadow atlas.
+	 * @param tileBuffer The storage buffer of the shadow tiles.
+	 * @param tileRegionSize The size of the region of each frame in the tile buffer.
+	 */
+	void setShadowResources(VkImageView atlasView, VkSampler atlasSampler, VkBuffer tileBuffer,
+							VkDeviceSize tileRegionSize);
+
+	void bind(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+
+	[[nodiscard]] uint32_t getDynamicOffset(uint32_t frameIndex) const;
+
+	[[nodiscard]] const VkDescriptorSetLayout &getDescriptorSetLayout() const {
+		return _descriptorSetLayout;
+	}
+
+	[[nodiscard]] const VkPipelineLayout &getPipelineLayout() const {
+		return _pipelineLayout;
+	}
+
+	/**
+	 * The push constant range shared by every mesh pipeline, so that they keep the frame set bound. Visible to the
+	 * fragment stage for the material shaders reading the object data.
+	 */
+	[[nodiscard]] static VkPushConstantRange getPushConstantRange();
+
+private:
+	void _createBuffer();
+	void _destroyBuffer();
+
+	void _createDescriptorSetLayout(const std::shared_ptr<DescriptorLayoutCache> &layoutCache);
+	void _destroyDescriptorSetLayout();
+
+	void _createPipelineLayout();
+	void _destroyPipelineLayout();
+
+	void _createDescriptorSet();
+	void _replaceDescriptorSet();
+	void _destroyDescriptorSet();
+
+	std::shared_ptr<Device> _device;
+	std::shared_ptr<DescriptorAllocator> _descriptorAllocator;
+	uint32_t _frameCount;
+
+	VkDeviceSize _alignedSize = 0;
+	VkDeviceSize _lightRegionSize = 0;
+	VkDeviceSize _clusterRegionSize = 0;
+	VkDeviceSize _shadowTileRegionSize = 0;
+	VkBuffer _lightBuffer = VK_NULL_HANDLE;
+	VkBuffer _clusterBuffer = VK_NULL_HANDLE;
+	VkBuffer _shadowTileBuffer = VK_NULL_HANDLE;
+	VkImageView _shadowAtlasView = VK_NULL_HANDLE;
+	VkSampler _shadowAtlasSampler = VK_NULL_HANDLE;
+	VkBuffer _buffer = VK_NULL_HANDLE;
+	VkDeviceMemory _bufferMemory = VK_NULL_HANDLE;
+	void *_bufferMapped = nullptr;
+
+	VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+
+	DescriptorAllocation _descriptorSet;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -20,7 +20,6 @@ SyncronizedObjects::SyncronizedObjects(const VkDevice &device) : _device(device)
 	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
 	if (vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &imageAvailable) != VK_SUCCESS ||
-		vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &renderFinished) != VK_SUCCESS ||
 		vkCreateFence(_device, &fenceInfo, nullptr, &inFlight) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create synchronization objects for a frame");
 	}
@@ -31,16 +30,13 @@ SyncronizedObjects::~SyncronizedObjects() {
 	if (imageAvailable != VK_NULL_HANDLE) {
 		vkDestroySemaphore(_device, imageAvailable, nullptr);
 	}
-	if (renderFinished != VK_NULL_HANDLE) {
-		vkDestroySemaphore(_device, renderFinished, nullptr);
-	}
 	if (inFlight != VK_NULL_HANDLE) {
 		vkDestroyFence(_device, inFlight, nullptr);
 	}
 }
 
-FramesRenderer::FramesRenderer(const std::shared_ptr<Device> &device, uint32_t imageCount)
-	: _device(device), _imageCount(imageCount) {
+FramesRenderer::FramesRenderer(const std::shared_ptr<Device> &device, uint32_t frameCount)
+	: _device(device), _frameCount(frameCount) {
 	std::cout << "Creating frames renderer" << std::endl;
 	_createCommandBuffers();
 	_createSyncObjects();
@@ -58,8 +54,8 @@ FramesRenderer::~FramesRenderer() {
 
 FrameContext FramesRenderer::newFrameContext() {
 	uint32_t currentFrame = _currentFrame;
-	_currentFrame = (_currentFrame + 1) % _imageCount;
-	return {_commandBuffers[currentFrame], _syncObjects[currentFrame]};
+	_currentFrame = (_currentFrame + 1) % _frameCount;
+	return {_commandBuffers[currentFrame], _syncObjects[currentFrame], currentFrame};
 }
 
 
@@ -67,7 +63,7 @@ FrameContext FramesRenderer::newFrameContext() {
 
 void FramesRenderer::_createCommandBuffers() {
 
-	_commandBuffers.resize(_imageCount);
+	_commandBuffers.resize(_frameCount);
 
 	VkCommandBufferAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -12,9 +12,12 @@ namespace Stone::Render::Vulkan {
 
 class Device;
 
+/**
+ * The synchronization of a frame in flight. The semaphores signaled once rendering finished belong to the swap chain
+ * images, as the presentation of an image is the only thing known to be done with them.
+ */
 struct SyncronizedObjects {
 	VkSemaphore imageAvailable = VK_NULL_HANDLE;
-	VkSemaphore renderFinished = VK_NULL_HANDLE;
 	VkFence inFlight = VK_NULL_HANDLE;
 	const VkDevice &_device;
 
@@ -25,18 +28,23 @@ struct SyncronizedObjects {
 struct FrameContext {
 	VkCommandBuffer &commandBuffer;
 	SyncronizedObjects &syncObject;
+	uint32_t frameIndex;
 };
 
+/**
+ * The command buffers and synchronization of the frames in flight, used in turn.
+ * Their number is independent of the swap chain images, so the resources of a frame are keyed by the frame index.
+ */
 class FramesRenderer {
 public:
 	FramesRenderer() = delete;
-	FramesRenderer(const std::shared_ptr<Device> &device, uint32_t imageCount);
+	FramesRenderer(const std::shared_ptr<Device> &device, uint32_t frameCount);
 	FramesRenderer(const FramesRenderer &) = delete;
 
 	virtual ~FramesRenderer();
 
-	[[nodiscard]] uint32_t getImageCount() const {
-		return _imageCount;
+	[[nodiscard]] uint32_t getFrameCount() const {
+		return _frameCount;
 	}
 
 	FrameContext newFrameContext();
@@ -49,7 +57,7 @@ private:
 	void _destroySyncObjects();
 
 	std::shared_ptr<Device> _device;
-	uint32_t _imageCount;
+	uint32_t _frameCount;
 
 	std::vector<VkCommandBuffer> _commandBuffers = {};
 
@@ -0,0 +1,449 @@
+// Copyright 2024 Stone-Engine
+
+#include "GpuCulling.hpp"
+
+#include "DescriptorLayoutCache.hpp"
+#include "Device.hpp"
+#include "PipelineCache.hpp"
+#include "RenderQueue.hpp"
+#include "Utils/FileSystem.hpp"
+#include "VulkanRenderable/Material.hpp"
+#include "VulkanRenderable/Mesh.hpp"
+#include "VulkanRenderable/MeshNode.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+/** Objects the buffers can hold before growing for the first time. */
+constexpr uint32_t initialCapacity = 1024;
+
+/** Clusters the buffers can hold before growing for the first time. */
+constexpr uint32_t initialClusterCapacity = 4096;
+
+/** Must match local_size_x in cull.glsl. */
+constexpr uint32_t cullingGroupSize = 64;
+
+GpuCulling::GpuCulling(const std::shared_ptr<Device> &device, const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+					   const std::shared_ptr<DescriptorAllocator> &descriptorAllocator,
+					   const std::shared_ptr<PipelineCache> &pipelineCache, uint32_t frameCount, bool depthPrepass)
+	: _device(device), _descriptorAllocator(descriptorAllocator), _pipelineCache(pipelineCache),
+	  _frameCount(frameCount), _depthPrepass(depthPrepass) {
+	if (_device->getEnabledFeatures().multiDrawIndirect) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(_device->getPhysicalDevice(), &properties);
+		_maxDrawCount = std::max(properties.limits.maxDrawIndirectCount, 1u);
+	}
+
+	_createBuffers(initialCapacity, initialClusterCapacity);
+	_createDescriptorSetLayouts(layoutCache);
+	_createComputePipeline();
+	_createDescriptorSets();
+}
+
+GpuCulling::~GpuCulling() {
+	_destroyDescriptorSets();
+	_destroyComputePipeline();
+	_destroyDescriptorSetLayouts();
+	_destroyBuffers();
+}
+
+bool GpuCulling::isSupported(const std::shared_ptr<Device> &device) {
+	return device->getEnabledFeatures().drawIndirectFirstInstance == VK_TRUE;
+}
+
+void GpuCulling::prepare(uint32_t frameIndex, const RenderQueue &renderQueue) {
+	assert(frameIndex < _frameCount);
+
+	_batches.clear();
+	_objectCount = 0;
+	_clusterCount = 0;
+
+	size_t drawCount = renderQueue.size();
+	size_t clusterCount = 0;
+	for (size_t i = 0; i < drawCount; ++i) {
+		clusterCount += std::max<size_t>(renderQueue.getDrawItem(i).meshNode->getMesh()->getMeshlets().size(), 1);
+	}
+	if (drawCount > _capacity || clusterCount > _clusterCapacity) {
+		uint32_t capacity = std::max(static_cast<uint32_t>(drawCount), _capacity * 2);
+		uint32_t clusterCapacity = std::max(static_cast<uint32_t>(clusterCount), _clusterCapacity * 2);
+
+		// The regions of the frames in flight are still read by the device, the buffers are released with their sets.
+		_destroyDescriptorSets();
+		_destroyBuffers();
+		_createBuffers(capacity, clusterCapacity);
+		_createDescriptorSets();
+	}
+
+	auto objects = reinterpret_cast<GpuObject *>(static_cast<char *>(_objectBufferMapped) +
+												  _objectRegionSize * frameIndex);
+	auto clusters = reinterpret_cast<GpuCluster *>(static_cast<char *>(_clusterBufferMapped) +
+													_clusterRegionSize * frameIndex);
+
+	for (size_t i = 0; i < drawCount; ++i) {
+		const DrawItem &drawItem = renderQueue.getDrawItem(i);
+		const Mesh *mesh = drawItem.meshNode->getMesh().get();
+		const Material *material = drawItem.meshNode->getMaterial().get();
+		DrawPass pass = renderQueue.getDrawPass(i);
+
+		GpuObject object;
+		object.modelMatrix = drawItem.modelMatrix * mesh->getPositionTransform();
+		objects[_objectCount] = object;
+
+		// The queue is sorted by state, so the draws of a batch are contiguous.
+		if (_batches.empty() || _batches.back().mesh != mesh || _batches.back().material != material ||
+			_batches.back().pass != pass) {
+			VkDescriptorSetLayout materialSetLayout = material ? material->getDescriptorSetLayout() : VK_NULL_HANDLE;
+			const GraphicPipeline &graphicPipeline =
+				_pipelineCache->getPipeline(materialSetLayout, _objectSetLayout, mesh->getVertexFormat(),
+											material ? material->getFragmentShader() : nullptr);
+			const GraphicPipeline *depthPipeline = nullptr;
+			if (_depthPrepass && pass == DrawPass::Opaque) {
+				depthPipeline = &_pipelineCache->getDepthPipeline(_objectSetLayout, mesh->getVertexFormat());
+			}
+			// Decided once, so that a pipeline created during the frame does not shade a batch without its depth.
+			bool ready = graphicPipeline.isReady() && (!depthPipeline || depthPipeline->isReady());
+			_batches.push_back({&graphicPipeline, depthPipeline, pass, material, mesh, _clusterCount, 0, ready});
+		}
+
+		// The clusters of an object follow each other, so the commands of a batch stay contiguous.
+		const std::vector<Scene::Meshlet> &meshlets = mesh->getMeshlets();
+		if (meshlets.empty()) {
+			GpuCluster cluster;
+			cluster.boundingSphere = mesh->getBoundingSphere();
+			cluster.indexCount = mesh->getIndexCount();
+			cluster.objectIndex = _objectCount;
+			clusters[_clusterCount++] = cluster;
+		}
+		for (const Scene::Meshlet &meshlet : meshlets) {
+			GpuCluster cluster;
+			cluster.boundingSphere = meshlet.boundingSphere;
+			cluster.normalCone = meshlet.normalCone;
+			cluster.firstIndex = meshlet.firstIndex;
+			cluster.indexCount = meshlet.indexCount;
+			cluster.objectIndex = _objectCount;
+			clusters[_clusterCount++] = cluster;
+		}
+		_batches.back().commandCount += static_cast<uint32_t>(std::max<size_t>(meshlets.size(), 1));
+		++_objectCount;
+	}
+}
+
+void GpuCulling::cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4 &viewProjection,
+					  const glm::vec3 &cameraPosition) const {
+	if (_clusterCount == 0) {
+		return;
+	}
+
+	// Each plane combines the last row of the matrix with one of the others, normalized to measure distances.
+	CullingPushConstants pushConstants;
+	glm::vec4 lastRow(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	for (int axis = 0; axis < 3; ++axis) {
+		glm::vec4 row(viewProjection[0][axis], viewProjection[1][axis], viewProjection[2][axis],
+					  viewProjection[3][axis]);
+		pushConstants.frustumPlanes[axis * 2] = lastRow + row;
+		pushConstants.frustumPlanes[axis * 2 + 1] = lastRow - row;
+	}
+	for (glm::vec4 &plane : pushConstants.frustumPlanes) {
+		plane = plane / glm::length(glm::vec3(plane));
+	}
+	pushConstants.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+	pushConstants.clusterCount = _clusterCount;
+
+	uint32_t dynamicOffsets[] = {static_cast<uint32_t>(_objectRegionSize * frameIndex),
+								 static_cast<uint32_t>(_commandRegionSize * frameIndex),
+								 static_cast<uint32_t>(_clusterRegionSize * frameIndex)};
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullingPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullingPipelineLayout, 0, 1,
+							&_cullingSet.descriptorSet, 3, dynamicOffsets);
+	vkCmdPushConstants(commandBuffer, _cullingPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+					   sizeof(CullingPushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, (_clusterCount + cullingGroupSize - 1) / cullingGroupSize, 1, 1);
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = _commandBuffer;
+	barrier.offset = _commandRegionSize * frameIndex;
+	barrier.size = _commandRegionSize;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0,
+						 nullptr, 1, &barrier, 0, nullptr);
+}
+
+void GpuCulling::draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) const {
+	uint32_t objectOffset = static_cast<uint32_t>(_objectRegionSize * frameIndex);
+	VkDeviceSize commandOffset = _commandRegionSize * frameIndex;
+
+	BoundDrawState boundState;
+	for (const Batch &batch : _batches) {
+		if (!batch.ready) {
+			continue;
+		}
+		VkPipelineLayout pipelineLayout = batch.graphicPipeline->pipelineLayout;
+
+		if (boundState.pipeline != batch.graphicPipeline->pipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.graphicPipeline->pipeline);
+			// Set 1 differs between the pipelines, which disturbs the object set bound after it.
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 2, 1,
+									&_objectSet.descriptorSet, 1, &objectOffset);
+			boundState.pipeline = batch.graphicPipeline->pipeline;
+			boundState.material = nullptr;
+		}
+
+		if (batch.material && boundState.material != batch.material) {
+			batch.material->bind(commandBuffer, pipelineLayout);
+			boundState.material = batch.material;
+		}
+
+		if (boundState.mesh != batch.mesh) {
+			batch.mesh->bind(commandBuffer);
+			boundState.mesh = batch.mesh;
+		}
+
+		_recordIndirectDraws(commandBuffer, batch, commandOffset);
+	}
+}
+
+void GpuCulling::drawDepth(VkCommandBuffer commandBuffer, uint32_t frameIndex) const {
+	uint32_t objectOffset = static_cast<uint32_t>(_objectRegionSize * frameIndex);
+	VkDeviceSize commandOffset = _commandRegionSize * frameIndex;
+
+	BoundDrawState boundState;
+	for (const Batch &batch : _batches) {
+		if (batch.depthPipeline == nullptr || !batch.ready) {
+			continue;
+		}
+
+		if (boundState.pipeline != batch.depthPipeline->pipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.depthPipeline->pipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.depthPipeline->pipelineLayout,
+									2, 1, &_objectSet.descriptorSet, 1, &objectOffset);
+			boundState.pipeline = batch.depthPipeline->pipeline;
+		}
+
+		if (boundState.mesh != batch.mesh) {
+			batch.mesh->bind(commandBuffer, VertexStreams::Position);
+			boundState.mesh = batch.mesh;
+		}
+
+		_recordIndirectDraws(commandBuffer, batch, commandOffset);
+	}
+}
+
+void GpuCulling::_recordIndirectDraws(VkCommandBuffer commandBuffer, const Batch &batch,
+									  VkDeviceSize commandOffset) const {
+	constexpr uint32_t commandStride = sizeof(VkDrawIndexedIndirectCommand);
+	for (uint32_t first = 0; first < batch.commandCount; first += _maxDrawCount) {
+		uint32_t drawCount = std::min(_maxDrawCount, batch.commandCount - first);
+		vkCmdDrawIndexedIndirect(commandBuffer, _commandBuffer,
+								 commandOffset + (batch.firstCommand + first) * commandStride, drawCount,
+								 commandStride);
+	}
+}
+
+
+/** Buffers */
+
+void GpuCulling::_createBuffers(uint32_t capacity, uint32_t clusterCapacity) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device->getPhysicalDevice(), &properties);
+
+	VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+	auto alignRegion = [alignment](VkDeviceSize size) {
+		return alignment > 0 ? (size + alignment - 1) & ~(alignment - 1) : size;
+	};
+
+	_capacity = capacity;
+	_clusterCapacity = clusterCapacity;
+	_objectRegionSize = alignRegion(sizeof(GpuObject) * capacity);
+	_clusterRegionSize = alignRegion(sizeof(GpuCluster) * clusterCapacity);
+	_commandRegionSize = alignRegion(sizeof(VkDrawIndexedIndirectCommand) * clusterCapacity);
+
+	std::tie(_objectBuffer, _objectBufferMemory) =
+		_device->createBuffer(_objectRegionSize * _frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	vkMapMemory(_device->getDevice(), _objectBufferMemory, 0, _objectRegionSize * _frameCount, 0,
+				&_objectBufferMapped);
+
+	std::tie(_clusterBuffer, _clusterBufferMemory) =
+		_device->createBuffer(_clusterRegionSize * _frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	vkMapMemory(_device->getDevice(), _clusterBufferMemory, 0, _clusterRegionSize * _frameCount, 0,
+				&_clusterBufferMapped);
+
+	std::tie(_commandBuffer, _commandBufferMemory) =
+		_device->createBuffer(_commandRegionSize * _frameCount,
+							  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void GpuCulling::_destroyBuffers() {
+	if (_objectBufferMapped != nullptr) {
+		vkUnmapMemory(_device->getDevice(), _objectBufferMemory);
+		_objectBufferMapped = nullptr;
+	}
+	_device->releaseBuffer(_objectBuffer, _objectBufferMemory);
+	_objectBuffer = VK_NULL_HANDLE;
+	_objectBufferMemory = VK_NULL_HANDLE;
+	if (_clusterBufferMapped != nullptr) {
+		vkUnmapMemory(_device->getDevice(), _clusterBufferMemory);
+		_clusterBufferMapped = nullptr;
+	}
+	_device->releaseBuffer(_clusterBuffer, _clusterBufferMemory);
+	_clusterBuffer = VK_NULL_HANDLE;
+	_clusterBufferMemory = VK_NULL_HANDLE;
+	_device->releaseBuffer(_commandBuffer, _commandBufferMemory);
+	_commandBuffer = VK_NULL_HANDLE;
+	_commandBufferMemory = VK_NULL_HANDLE;
+	_capacity = 0;
+	_clusterCapacity = 0;
+}
+
+
+/** Descriptor Set Layouts */
+
+void GpuCulling::_createDescriptorSetLayouts(const std::shared_ptr<DescriptorLayoutCache> &layoutCache) {
+	VkDescriptorSetLayoutBinding objectsBinding = {};
+	objectsBinding.binding = 0;
+	objectsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	objectsBinding.descriptorCount = 1;
+	objectsBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	objectsBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding commandsBinding = objectsBinding;
+	commandsBinding.binding = 1;
+
+	VkDescriptorSetLayoutBinding clustersBinding = objectsBinding;
+	clustersBinding.binding = 2;
+
+	_cullingSetLayout = layoutCache->getLayout({objectsBinding, commandsBinding, clustersBinding});
+
+	objectsBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	_objectSetLayout = layoutCache->getLayout({objectsBinding});
+}
+
+void GpuCulling::_destroyDescriptorSetLayouts() {
+	// The layouts are owned by the cache.
+	_cullingSetLayout = VK_NULL_HANDLE;
+	_objectSetLayout = VK_NULL_HANDLE;
+}
+
+
+/** Compute Pipeline */
+
+void GpuCulling::_createComputePipeline() {
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullingPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_cullingSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(_device->getDevice(), &pipelineLayoutInfo, nullptr, &_cullingPipelineLayout) !=
+		VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline layout");
+	}
+
+	auto shaderCode = Utils::readBinaryFile("shaders/cull.spv");
+	auto shaderModule = _device->createShaderModule(shaderCode);
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _cullingPipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkResult result =
+		vkCreateComputePipelines(_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_cullingPipeline);
+
+	vkDestroyShaderModule(_device->getDevice(), shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline");
+	}
+}
+
+void GpuCulling::_destroyComputePipeline() {
+	if (_cullingPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(_device->getDevice(), _cullingPipeline, nullptr);
+	}
+	_cullingPipeline = VK_NULL_HANDLE;
+	if (_cullingPipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(_device->getDevice(), _cullingPipelineLayout, nullptr);
+	}
+	_cullingPipelineLayout = VK_NULL_HANDLE;
+}
+
+
+/** Descriptor Sets */
+
+void GpuCulling::_createDescriptorSets() {
+	_cullingSet = _descriptorAllocator->allocate(_cullingSetLayout);
+	_objectSet = _descriptorAllocator->allocate(_objectSetLayout);
+
+	VkDescriptorBufferInfo objectsInfo = {};
+	objectsInfo.buffer = _objectBuffer;
+	objectsInfo.offset = 0;
+	objectsInfo.range = _objectRegionSize;
+
+	VkDescriptorBufferInfo commandsInfo = {};
+	commandsInfo.buffer = _commandBuffer;
+	commandsInfo.offset = 0;
+	commandsInfo.range = _commandRegionSize;
+
+	VkDescriptorBufferInfo clustersInfo = {};
+	clustersInfo.buffer = _clusterBuffer;
+	clustersInfo.offset = 0;
+	clustersInfo.range = _clusterRegionSize;
+
+	std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+	for (VkWriteDescriptorSet &descriptorWrite : descriptorWrites) {
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		descriptorWrite.descriptorCount = 1;
+	}
+
+	descriptorWrites[0].dstSet = _cullingSet.descriptorSet;
+	descriptorWrites[0].dstBinding = 0;
+	descriptorWrites[0].pBufferInfo = &objectsInfo;
+
+	descriptorWrites[1].dstSet = _cullingSet.descriptorSet;
+	descriptorWrites[1].dstBinding = 1;
+	descriptorWrites[1].pBufferInfo = &commandsInfo;
+
+	descriptorWrites[2].dstSet = _cullingSet.descriptorSet;
+	descriptorWrites[2].dstBinding = 2;
+	descriptorWrites[2].pBufferInfo = &clustersInfo;
+
+	descriptorWrites[3].dstSet = _objectSet.descriptorSet;
+	descriptorWrites[3].dstBinding = 0;
+	descriptorWrites[3].pBufferInfo = &objectsInfo;
+
+	vkUpdateDescriptorSets(_device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+						   descriptorWrites.data(), 0, nullptr);
+}
+
+void GpuCulling::_destroyDescriptorSets() {
+	_descriptorAllocator->release(_cullingSet);
+	_descriptorAllocator->release(_objectSet);
+}
+
+} // namespace Stone::Render::Vulkan
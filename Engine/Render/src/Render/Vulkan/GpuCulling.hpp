@@ -0,0 +1,192 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "DescriptorAllocator.hpp"
+#include "RenderQueue.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class DescriptorLayoutCache;
+class Device;
+class Material;
+class Mesh;
+class PipelineCache;
+struct GraphicPipeline;
+
+/**
+ * Per object data read by the culling compute shader and the indirect vertex shader, laid out as std430.
+ */
+struct GpuObject {
+	alignas(16) glm::mat4 modelMatrix = glm::mat4(1.0f);
+};
+
+/**
+ * A range of triangles of an object culled on its own, laid out as std430.
+ *
+ * A mesh with meshlets gives one cluster per meshlet, any other mesh a single cluster covering all its indices.
+ */
+struct GpuCluster {
+	alignas(16) glm::vec4 boundingSphere = glm::vec4(0.0f);		 /**< Center in xyz and radius in w, in object space. */
+	alignas(16) glm::vec4 normalCone = {0.0f, 0.0f, 0.0f, 1.0f}; /**< Axis in xyz and sine of its spread in w. */
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	uint32_t objectIndex = 0;
+};
+
+/**
+ * Push constants of the culling compute shader.
+ */
+struct CullingPushConstants {
+	glm::vec4 frustumPlanes[6];
+	glm::vec4 cameraPosition; /**< World space position in xyz, for the normal cone test. */
+	uint32_t clusterCount = 0;
+};
+
+/**
+ * GPU driven drawing of the render queue.
+ *
+ * The objects of the frame and their clusters are written into storage buffers. A compute pass tests the bounding
+ * sphere of each cluster against the view frustum, and the normal cone of meshlets against the camera position, then
+ * writes one VkDrawIndexedIndirectCommand per cluster, with no instance when it is culled.
+ * The draws are then recorded with one indirect call per pipeline, material and mesh batch, so the command buffer
+ * size no longer depends on the number of objects.
+ *
+ * Each frame in flight uses its own region of the buffers, addressed with dynamic offsets.
+ *
+ * With a depth prepass, the opaque batches are drawn a first time with the depth pipelines of their vertex formats,
+ * reusing the indirect commands of the culling pass.
+ */
+class GpuCulling {
+public:
+	GpuCulling() = delete;
+	GpuCulling(const std::shared_ptr<Device> &device, const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+			   const std::shared_ptr<DescriptorAllocator> &descriptorAllocator,
+			   const std::shared_ptr<PipelineCache> &pipelineCache, uint32_t frameCount, bool depthPrepass = false);
+	GpuCulling(const GpuCulling &) = delete;
+
+	virtual ~GpuCulling();
+
+	/**
+	 * Whether the device can draw with GpuCulling, the instance index of indirect draws selects the object.
+	 *
+	 * @param device The device to check.
+	 * @return True if drawIndirectFirstInstance is enabled on the device.
+	 */
+	[[nodiscard]] static bool isSupported(const std::shared_ptr<Device> &device);
+
+	/**
+	 * Writes the objects of the sorted queue and their clusters into the frame region and groups them in batches.
+	 * Grows the buffers when the queue does not fit, the replaced buffers and sets are released through the deletion
+	 * queue once the frames in flight completed.
+	 *
+	 * @param frameIndex The frame in flight being recorded.
+	 * @param renderQueue The sorted draws of the frame.
+	 */
+	void prepare(uint32_t frameIndex, const RenderQueue &renderQueue);
+
+	/**
+	 * Records the culling dispatch and the barrier making the commands visible to indirect draws.
+	 * Must be recorded outside of the render pass.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param frameIndex The frame in flight being recorded.
+	 * @param viewProjection The matrix the frustum planes are extracted from.
+	 * @param cameraPosition The world space position the back facing meshlets are culled from.
+	 */
+	void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4 &viewProjection,
+			  const glm::vec3 &cameraPosition) const;
+
+	/**
+	 * Records the indirect draws of the prepared batches.
+	 *
+	 * @param commandBuffer The command buffer to record into, with the frame uniforms already bound.
+	 * @param frameIndex The frame in flight being recorded.
+	 */
+	void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+
+	/**
+	 * Records the indirect depth draws of the prepared opaque batches, only binding the position streams.
+	 * Does nothing unless the depth prepass was enabled at creation.
+	 *
+	 * @param commandBuffer The command buffer to record into, with the frame uniforms already bound.
+	 * @param frameIndex The frame in flight being recorded.
+	 */
+	void drawDepth(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+
+	[[nodiscard]] uint32_t getCapacity() const {
+		return _capacity;
+	}
+
+	[[nodiscard]] uint32_t getClusterCapacity() const {
+		return _clusterCapacity;
+	}
+
+private:
+	struct Batch {
+		const GraphicPipeline *graphicPipeline;
+		const GraphicPipeline *depthPipeline; /**< Null for the batches skipping the depth prepass. */
+		DrawPass pass;
+		const Material *material;
+		const Mesh *mesh;
+		uint32_t firstCommand;
+		uint32_t commandCount;
+		bool ready; /**< Whether its pipelines were created when it was prepared, it is not drawn until then. */
+	};
+
+	void _recordIndirectDraws(VkCommandBuffer commandBuffer, const Batch &batch, VkDeviceSize commandOffset) const;
+
+	void _createBuffers(uint32_t capacity, uint32_t clusterCapacity);
+	void _destroyBuffers();
+
+	void _createDescriptorSetLayouts(const std::shared_ptr<DescriptorLayoutCache> &layoutCache);
+	void _destroyDescriptorSetLayouts();
+
+	void _createComputePipeline();
+	void _destroyComputePipeline();
+
+	void _createDescriptorSets();
+	void _destroyDescriptorSets();
+
+	std::shared_ptr<Device> _device;
+	std::shared_ptr<DescriptorAllocator> _descriptorAllocator;
+	std::shared_ptr<PipelineCache> _pipelineCache;
+	uint32_t _frameCount;
+	uint32_t _maxDrawCount = 1;
+	bool _depthPrepass;
+
+	uint32_t _capacity = 0;
+	uint32_t _clusterCapacity = 0;
+	VkDeviceSize _objectRegionSize = 0;
+	VkDeviceSize _clusterRegionSize = 0;
+	VkDeviceSize _commandRegionSize = 0;
+	VkBuffer _objectBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _objectBufferMemory = VK_NULL_HANDLE;
+	void *_objectBufferMapped = nullptr;
+	VkBuffer _clusterBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _clusterBufferMemory = VK_NULL_HANDLE;
+	void *_clusterBufferMapped = nullptr;
+	VkBuffer _commandBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _commandBufferMemory = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout _cullingSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout _objectSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout _cullingPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline _cullingPipeline = VK_NULL_HANDLE;
+
+	DescriptorAllocation _cullingSet;
+	DescriptorAllocation _objectSet;
+
+	uint32_t _objectCount = 0;
+	uint32_t _clusterCount = 0;
+	std::vector<Batch> _batches;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,250 @@
+// Copyright 2024 Stone-Engine
+
+#include "GpuProfiler.hpp"
+
+#include "Device.hpp"
+#include "Utils/TraceRecorder.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+/** The counters of PipelineStatistics, the results are written in the order of the flag bits. */
+constexpr VkQueryPipelineStatisticFlags pipelineStatisticFlags =
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+constexpr uint32_t pipelineStatisticCount = 5;
+
+static uint32_t timestampValidBits(const std::shared_ptr<Device> &device) {
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device->getPhysicalDevice(), &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device->getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+	uint32_t family = device->getGraphicsQueueFamily();
+	return family < queueFamilyCount ? queueFamilies[family].timestampValidBits : 0;
+}
+
+GpuProfiler::GpuProfiler(const std::shared_ptr<Device> &device, uint32_t frameCount, TraceRecorder *traceRecorder,
+						 uint32_t maxScopes)
+	: _device(device), _traceRecorder(traceRecorder), _maxScopes(maxScopes), _frames(frameCount) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device->getPhysicalDevice(), &properties);
+	_timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t validBits = timestampValidBits(_device);
+	_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	// The main pass executes secondary command buffers, which must inherit its statistics query.
+	const VkPhysicalDeviceFeatures &features = _device->getEnabledFeatures();
+	if (features.pipelineStatisticsQuery && features.inheritedQueries) {
+		_statisticFlags = pipelineStatisticFlags;
+	}
+
+	_createQueryPools();
+}
+
+GpuProfiler::~GpuProfiler() {
+	_destroyQueryPools();
+}
+
+bool GpuProfiler::isSupported(const std::shared_ptr<Device> &device) {
+	return timestampValidBits(device) > 0;
+}
+
+VkQueryPipelineStatisticFlags GpuProfiler::getActiveStatistics(uint32_t frameIndex) const {
+	assert(frameIndex < _frames.size());
+	return _frames[frameIndex].statisticsActive ? _statisticFlags : 0;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	assert(frameIndex < _frames.size());
+	Frame &frame = _frames[frameIndex];
+
+	if (frame.recorded) {
+		_readResults(frame);
+	}
+
+	frame.scopes.clear();
+	frame.openScopes.clear();
+	frame.statisticsQueryCount = 0;
+	frame.statisticsActive = false;
+	frame.recorded = true;
+	frame.cpuStartUs = _traceRecorder ? _traceRecorder->now() : 0.0;
+
+	vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, _maxScopes * 2);
+	if (frame.statisticsPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, _maxScopes);
+	}
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t frameIndex, std::string name) {
+	assert(frameIndex < _frames.size());
+	Frame &frame = _frames[frameIndex];
+
+	if (frame.scopes.size() >= _maxScopes) {
+		frame.openScopes.emplace_back();
+		return;
+	}
+
+	auto index = static_cast<uint32_t>(frame.scopes.size());
+	auto depth = static_cast<uint32_t>(frame.openScopes.size());
+	std::optional<uint32_t> statisticsQuery;
+	if (frame.statisticsPool != VK_NULL_HANDLE && !frame.statisticsActive) {
+		statisticsQuery = frame.statisticsQueryCount++;
+		frame.statisticsActive = true;
+	}
+
+	frame.scopes.push_back({std::move(name), depth, statisticsQuery});
+	frame.openScopes.emplace_back(index);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, index * 2);
+	if (statisticsQuery.has_value()) {
+		vkCmdBeginQuery(commandBuffer, frame.statisticsPool, statisticsQuery.value(), 0);
+	}
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	assert(frameIndex < _frames.size());
+	Frame &frame = _frames[frameIndex];
+	assert(!frame.openScopes.empty());
+
+	std::optional<uint32_t> index = frame.openScopes.back();
+	frame.openScopes.pop_back();
+	if (!index.has_value()) {
+		return;
+	}
+
+	const Scope &scope = frame.scopes[index.value()];
+	if (scope.statisticsQuery.has_value()) {
+		vkCmdEndQuery(commandBuffer, frame.statisticsPool, scope.statisticsQuery.value());
+		frame.statisticsActive = false;
+	}
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool,
+						index.value() * 2 + 1);
+}
+
+void GpuProfiler::_readResults(Frame &frame) {
+	if (frame.scopes.empty()) {
+		return;
+	}
+
+	// The fence of the frame was waited on, the results are only missing if the frame was never submitted.
+	std::vector<uint64_t> timestamps(frame.scopes.size() * 2);
+	VkResult result = vkGetQueryPoolResults(_device->getDevice(), frame.timestampPool, 0,
+											static_cast<uint32_t>(timestamps.size()),
+											timestamps.size() * sizeof(uint64_t), timestamps.data(),
+											sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	std::vector<uint64_t> statistics(static_cast<size_t>(frame.statisticsQueryCount) * pipelineStatisticCount);
+	if (!statistics.empty()) {
+		result = vkGetQueryPoolResults(_device->getDevice(), frame.statisticsPool, 0, frame.statisticsQueryCount,
+									   statistics.size() * sizeof(uint64_t), statistics.data(),
+									   pipelineStatisticCount * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS) {
+			statistics.clear();
+		}
+	}
+
+	// Only the valid bits are compared, the differences wrap around like the counter.
+	auto toMilliseconds = [this](uint64_t begin, uint64_t end) {
+		return static_cast<double>((end - begin) & _timestampMask) * _timestampPeriod * 1e-6;
+	};
+
+	_lastFrameTimings.clear();
+	for (size_t i = 0; i < frame.scopes.size(); ++i) {
+		const Scope &scope = frame.scopes[i];
+
+		GpuScopeTiming timing;
+		timing.name = scope.name;
+		timing.depth = scope.depth;
+		timing.startMs = toMilliseconds(timestamps[0], timestamps[i * 2]);
+		timing.durationMs = toMilliseconds(timestamps[i * 2], timestamps[i * 2 + 1]);
+		if (scope.statisticsQuery.has_value() && !statistics.empty()) {
+			const uint64_t *values = statistics.data() + scope.statisticsQuery.value() * pipelineStatisticCount;
+			timing.statistics = PipelineStatistics{values[0], values[1], values[2], values[3], values[4]};
+		}
+
+		if (_traceRecorder) {
+			TraceRecorder::Event event = {timing.name, "GPU", frame.cpuStartUs + timing.startMs * 1000.0,
+										  timing.durationMs * 1000.0};
+			if (timing.statistics.has_value()) {
+				const PipelineStatistics &stats = timing.statistics.value();
+				event.args = {{"inputAssemblyPrimitives", static_cast<double>(stats.inputAssemblyPrimitives)},
+							  {"vertexShaderInvocations", static_cast<double>(stats.vertexShaderInvocations)},
+							  {"clippingPrimitives", static_cast<double>(stats.clippingPrimitives)},
+							  {"fragmentShaderInvocations", static_cast<double>(stats.fragmentShaderInvocations)},
+							  {"computeShaderInvocations", static_cast<double>(stats.computeShaderInvocations)}};
+			}
+			_traceRecorder->addEvent(std::move(event));
+		}
+
+		_lastFrameTimings.push_back(std::move(timing));
+	}
+}
+
+
+/** Query Pools */
+
+void GpuProfiler::_createQueryPools() {
+	for (Frame &frame : _frames) {
+		VkQueryPoolCreateInfo timestampPoolInfo = {};
+		timestampPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		timestampPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		timestampPoolInfo.queryCount = _maxScopes * 2;
+
+		if (vkCreateQueryPool(_device->getDevice(), &timestampPoolInfo, nullptr, &frame.timestampPool) !=
+			VK_SUCCESS) {
+			throw std::runtime_error("Failed to create timestamp query pool");
+		}
+
+		if (_statisticFlags == 0) {
+			continue;
+		}
+
+		VkQueryPoolCreateInfo statisticsPoolInfo = {};
+		statisticsPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		statisticsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		statisticsPoolInfo.queryCount = _maxScopes;
+		statisticsPoolInfo.pipelineStatistics = _statisticFlags;
+
+		if (vkCreateQueryPool(_device->getDevice(), &statisticsPoolInfo, nullptr, &frame.statisticsPool) !=
+			VK_SUCCESS) {
+			throw std::runtime_error("Failed to create pipeline statistics query pool");
+		}
+	}
+}
+
+void GpuProfiler::_destroyQueryPools() {
+	for (Frame &frame : _frames) {
+		vkDestroyQueryPool(_device->getDevice(), frame.timestampPool, nullptr);
+		vkDestroyQueryPool(_device->getDevice(), frame.statisticsPool, nullptr);
+		frame.timestampPool = VK_NULL_HANDLE;
+		frame.statisticsPool = VK_NULL_HANDLE;
+	}
+}
+
+
+/** GpuProfileScope */
+
+GpuProfileScope::GpuProfileScope(GpuProfiler *profiler, VkCommandBuffer commandBuffer, uint32_t frameIndex,
+								 std::string name)
+	: _profiler(profiler), _commandBuffer(commandBuffer), _frameIndex(frameIndex) {
+	if (_profiler) {
+		_profiler->beginScope(_commandBuffer, _frameIndex, std::move(name));
+	}
+}
+
+GpuProfileScope::~GpuProfileScope() {
+	if (_profiler) {
+		_profiler->endScope(_commandBuffer, _frameIndex);
+	}
+}
+
+} // namespace Stone::Render::Vulkan
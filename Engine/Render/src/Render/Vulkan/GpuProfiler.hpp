@@ -0,0 +1,170 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone {
+class TraceRecorder;
+}
+
+namespace Stone::Render::Vulkan {
+
+class Device;
+
+/**
+ * Counters of the pipeline statistics queries, accumulated over a scope.
+ */
+struct PipelineStatistics {
+	uint64_t inputAssemblyPrimitives = 0;
+	uint64_t vertexShaderInvocations = 0;
+	uint64_t clippingPrimitives = 0;
+	uint64_t fragmentShaderInvocations = 0;
+	uint64_t computeShaderInvocations = 0;
+};
+
+/**
+ * The GPU time of a profiled scope.
+ */
+struct GpuScopeTiming {
+	std::string name;
+	uint32_t depth = 0;	   /**< Number of scopes enclosing this one. */
+	double startMs = 0.0;  /**< Start time relative to the first scope of the frame. */
+	double durationMs = 0.0;
+	std::optional<PipelineStatistics> statistics = {}; /**< Only measured for the outermost scopes. */
+};
+
+/**
+ * Measures the GPU time of named scopes of the frame command buffers with timestamp queries.
+ *
+ * Each frame in flight owns its query pools. The results of a frame are read when its slot is recorded again, after
+ * the fence of the frame was waited on, so reading them never stalls the rendering. The timings are thus available
+ * as many frames later as there are frames in flight.
+ *
+ * When the device supports pipeline statistics queries, the outermost scopes also count the primitives and shader
+ * invocations they issued. Only one statistics query can be active at a time, nested scopes only have a duration.
+ *
+ * The timings are added to the "GPU" track of a trace recorder, placed relative to the CPU time the frame was
+ * recorded at. The clocks are not calibrated, the GPU events show the cost of the scopes rather than their latency.
+ */
+class GpuProfiler {
+public:
+	GpuProfiler() = delete;
+	GpuProfiler(const std::shared_ptr<Device> &device, uint32_t frameCount, TraceRecorder *traceRecorder,
+				uint32_t maxScopes = 64);
+	GpuProfiler(const GpuProfiler &) = delete;
+
+	virtual ~GpuProfiler();
+
+	/**
+	 * Whether the device can profile the frames, the graphics queue must write timestamps.
+	 *
+	 * @param device The device to check.
+	 * @return True if the graphics queue family has valid timestamp bits.
+	 */
+	[[nodiscard]] static bool isSupported(const std::shared_ptr<Device> &device);
+
+	[[nodiscard]] bool hasPipelineStatistics() const {
+		return _statisticFlags != 0;
+	}
+
+	/**
+	 * Returns the statistics counted by the query active in a frame, for the secondary command buffers to inherit.
+	 *
+	 * @param frameIndex The frame in flight being recorded.
+	 * @return The statistic flags of the active query, or 0 when none is active.
+	 */
+	[[nodiscard]] VkQueryPipelineStatisticFlags getActiveStatistics(uint32_t frameIndex) const;
+
+	/**
+	 * Reads the results of the previous use of the frame slot, then resets its queries.
+	 * Must be recorded first in the command buffer, outside of any render pass.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param frameIndex The frame in flight being recorded.
+	 */
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	/**
+	 * Records the start of a scope. Scopes over the capacity of the frame are ignored.
+	 * An outermost scope measuring statistics must begin and end on the same side of a render pass.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param frameIndex The frame in flight being recorded.
+	 * @param name The name of the scope.
+	 */
+	void beginScope(VkCommandBuffer commandBuffer, uint32_t frameIndex, std::string name);
+
+	/**
+	 * Records the end of the innermost open scope.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param frameIndex The frame in flight being recorded.
+	 */
+	void endScope(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	/**
+	 * Returns the scopes of the most recent frame whose results were read, in the order they began.
+	 */
+	[[nodiscard]] const std::vector<GpuScopeTiming> &getLastFrameTimings() const {
+		return _lastFrameTimings;
+	}
+
+private:
+	struct Scope {
+		std::string name;
+		uint32_t depth;
+		std::optional<uint32_t> statisticsQuery;
+	};
+
+	struct Frame {
+		VkQueryPool timestampPool = VK_NULL_HANDLE;
+		VkQueryPool statisticsPool = VK_NULL_HANDLE;
+		std::vector<Scope> scopes = {};
+		std::vector<std::optional<uint32_t>> openScopes = {}; /**< Empty for the scopes over capacity. */
+		uint32_t statisticsQueryCount = 0;
+		bool statisticsActive = false;
+		bool recorded = false;
+		double cpuStartUs = 0.0;
+	};
+
+	void _createQueryPools();
+	void _destroyQueryPools();
+
+	void _readResults(Frame &frame);
+
+	std::shared_ptr<Device> _device;
+	TraceRecorder *_traceRecorder;
+	uint32_t _maxScopes;
+
+	double _timestampPeriod = 1.0;
+	uint64_t _timestampMask = ~0ull;
+	VkQueryPipelineStatisticFlags _statisticFlags = 0;
+
+	std::vector<Frame> _frames;
+	std::vector<GpuScopeTiming> _lastFrameTimings;
+};
+
+/**
+ * Profiles the commands recorded during its lifetime. Does nothing when the profiler is null.
+ */
+class GpuProfileScope {
+public:
+	GpuProfileScope(GpuProfiler *profiler, VkCommandBuffer commandBuffer, uint32_t frameIndex, std::string name);
+	GpuProfileScope(const GpuProfileScope &) = delete;
+
+	~GpuProfileScope();
+
+	GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+private:
+	GpuProfiler *_profiler;
+	VkCommandBuffer _commandBuffer;
+	uint32_t _frameIndex;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,295 @@
+// Copyright 2024 Stone-Engine
+
+#include "GpuSkinning.hpp"
+
+#include "DescriptorLayoutCache.hpp"
+#include "Device.hpp"
+#include "Scene/Vertex.hpp"
+#include "Utils/FileSystem.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+/** Bones the palette can hold per frame before growing for the first time. */
+constexpr uint32_t initialBoneCapacity = 1024;
+
+/** Must match local_size_x in skin.glsl. */
+constexpr uint32_t skinningGroupSize = 64;
+
+// skin.glsl addresses the vertices as arrays of floats, the bone ids of the weighted vertices being reinterpreted.
+static_assert(sizeof(Scene::WeightVertex) == 22 * sizeof(float), "skin.glsl expects packed weighted vertices");
+static_assert(sizeof(Scene::Vertex) == 14 * sizeof(float), "skin.glsl expects packed posed vertices");
+
+GpuSkinning::GpuSkinning(const std::shared_ptr<Device> &device,
+						 const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+						 const std::shared_ptr<DescriptorAllocator> &descriptorAllocator, uint32_t frameCount)
+	: _device(device), _descriptorAllocator(descriptorAllocator), _frameCount(frameCount) {
+	_createPaletteBuffer(initialBoneCapacity);
+	_createDescriptorSetLayouts(layoutCache);
+	_createComputePipeline();
+	_createPaletteSet();
+}
+
+GpuSkinning::~GpuSkinning() {
+	_destroyPaletteSet();
+	_destroyComputePipeline();
+	_destroyDescriptorSetLayouts();
+	_destroyPaletteBuffer();
+}
+
+void GpuSkinning::clear() {
+	_palette.clear();
+	_jobs.clear();
+}
+
+void GpuSkinning::push(VkDescriptorSet vertexSet, uint32_t vertexCount, const std::vector<glm::mat4> &boneMatrices) {
+	if (vertexCount == 0) {
+		return;
+	}
+
+	Job job;
+	job.vertexSet = vertexSet;
+	job.pushConstants.vertexCount = vertexCount;
+	job.pushConstants.boneOffset = static_cast<uint32_t>(_palette.size());
+	job.pushConstants.boneCount = static_cast<uint32_t>(boneMatrices.size());
+	_jobs.push_back(job);
+
+	_palette.insert(_palette.end(), boneMatrices.begin(), boneMatrices.end());
+}
+
+void GpuSkinning::dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	assert(frameIndex < _frameCount);
+
+	if (_jobs.empty()) {
+		return;
+	}
+
+	if (_palette.size() > _boneCapacity) {
+		uint32_t boneCapacity = std::max(static_cast<uint32_t>(_palette.size()), _boneCapacity * 2);
+
+		// The regions of the frames in flight are still read by the device, the buffer is released with their set.
+		_destroyPaletteSet();
+		_destroyPaletteBuffer();
+		_createPaletteBuffer(boneCapacity);
+		_createPaletteSet();
+	}
+
+	std::memcpy(static_cast<char *>(_paletteBufferMapped) + _paletteRegionSize * frameIndex, _palette.data(),
+				_palette.size() * sizeof(glm::mat4));
+
+	// The previous frames may still read the posed vertices, they are only overwritten once their vertex input is done.
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+						 nullptr, 0, nullptr, 0, nullptr);
+
+	uint32_t paletteOffset = static_cast<uint32_t>(_paletteRegionSize * frameIndex);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _skinningPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _skinningPipelineLayout, 0, 1,
+							&_paletteSet.descriptorSet, 1, &paletteOffset);
+
+	for (const Job &job : _jobs) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _skinningPipelineLayout, 1, 1,
+								&job.vertexSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, _skinningPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+						   sizeof(SkinningPushConstants), &job.pushConstants);
+		vkCmdDispatch(commandBuffer, (job.pushConstants.vertexCount + skinningGroupSize - 1) / skinningGroupSize, 1,
+					  1);
+	}
+
+	// A global barrier covers the posed buffers of every mesh at once.
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1,
+						 &barrier, 0, nullptr, 0, nullptr);
+}
+
+DescriptorAllocation GpuSkinning::createVertexSet(VkBuffer sourceBuffer, VkBuffer posedBuffer) {
+	DescriptorAllocation vertexSet = _descriptorAllocator->allocate(_vertexSetLayout);
+
+	VkDescriptorBufferInfo sourceInfo = {};
+	sourceInfo.buffer = sourceBuffer;
+	sourceInfo.offset = 0;
+	sourceInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo posedInfo = {};
+	posedInfo.buffer = posedBuffer;
+	posedInfo.offset = 0;
+	posedInfo.range = VK_WHOLE_SIZE;
+
+	std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+	for (VkWriteDescriptorSet &descriptorWrite : descriptorWrites) {
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = vertexSet.descriptorSet;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrite.descriptorCount = 1;
+	}
+
+	descriptorWrites[0].dstBinding = 0;
+	descriptorWrites[0].pBufferInfo = &sourceInfo;
+
+	descriptorWrites[1].dstBinding = 1;
+	descriptorWrites[1].pBufferInfo = &posedInfo;
+
+	vkUpdateDescriptorSets(_device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+						   descriptorWrites.data(), 0, nullptr);
+
+	return vertexSet;
+}
+
+void GpuSkinning::freeVertexSet(DescriptorAllocation &vertexSet) {
+	_descriptorAllocator->release(vertexSet);
+}
+
+
+/** Palette Buffer */
+
+void GpuSkinning::_createPaletteBuffer(uint32_t boneCapacity) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device->getPhysicalDevice(), &properties);
+
+	VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+	VkDeviceSize size = sizeof(glm::mat4) * boneCapacity;
+
+	_boneCapacity = boneCapacity;
+	_paletteRegionSize = alignment > 0 ? (size + alignment - 1) & ~(alignment - 1) : size;
+
+	std::tie(_paletteBuffer, _paletteBufferMemory) =
+		_device->createBuffer(_paletteRegionSize * _frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	vkMapMemory(_device->getDevice(), _paletteBufferMemory, 0, _paletteRegionSize * _frameCount, 0,
+				&_paletteBufferMapped);
+}
+
+void GpuSkinning::_destroyPaletteBuffer() {
+	if (_paletteBufferMapped != nullptr) {
+		vkUnmapMemory(_device->getDevice(), _paletteBufferMemory);
+		_paletteBufferMapped = nullptr;
+	}
+	_device->releaseBuffer(_paletteBuffer, _paletteBufferMemory);
+	_paletteBuffer = VK_NULL_HANDLE;
+	_paletteBufferMemory = VK_NULL_HANDLE;
+	_boneCapacity = 0;
+}
+
+
+/** Descriptor Set Layouts */
+
+void GpuSkinning::_createDescriptorSetLayouts(const std::shared_ptr<DescriptorLayoutCache> &layoutCache) {
+	VkDescriptorSetLayoutBinding paletteBinding = {};
+	paletteBinding.binding = 0;
+	paletteBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	paletteBinding.descriptorCount = 1;
+	paletteBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	paletteBinding.pImmutableSamplers = nullptr;
+
+	_paletteSetLayout = layoutCache->getLayout({paletteBinding});
+
+	VkDescriptorSetLayoutBinding sourceBinding = paletteBinding;
+	sourceBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+	VkDescriptorSetLayoutBinding posedBinding = sourceBinding;
+	posedBinding.binding = 1;
+
+	_vertexSetLayout = layoutCache->getLayout({sourceBinding, posedBinding});
+}
+
+void GpuSkinning::_destroyDescriptorSetLayouts() {
+	// The layouts are owned by the cache.
+	_paletteSetLayout = VK_NULL_HANDLE;
+	_vertexSetLayout = VK_NULL_HANDLE;
+}
+
+
+/** Compute Pipeline */
+
+void GpuSkinning::_createComputePipeline() {
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(SkinningPushConstants);
+
+	std::array<VkDescriptorSetLayout, 2> setLayouts = {_paletteSetLayout, _vertexSetLayout};
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(_device->getDevice(), &pipelineLayoutInfo, nullptr, &_skinningPipelineLayout) !=
+		VK_SUCCESS) {
+		throw std::runtime_error("Failed to create skinning pipeline layout");
+	}
+
+	auto shaderCode = Utils::readBinaryFile("shaders/skin.spv");
+	auto shaderModule = _device->createShaderModule(shaderCode);
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _skinningPipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkResult result =
+		vkCreateComputePipelines(_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_skinningPipeline);
+
+	vkDestroyShaderModule(_device->getDevice(), shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create skinning pipeline");
+	}
+}
+
+void GpuSkinning::_destroyComputePipeline() {
+	if (_skinningPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(_device->getDevice(), _skinningPipeline, nullptr);
+	}
+	_skinningPipeline = VK_NULL_HANDLE;
+	if (_skinningPipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(_device->getDevice(), _skinningPipelineLayout, nullptr);
+	}
+	_skinningPipelineLayout = VK_NULL_HANDLE;
+}
+
+
+/** Palette Set */
+
+void GpuSkinning::_createPaletteSet() {
+	_paletteSet = _descriptorAllocator->allocate(_paletteSetLayout);
+
+	VkDescriptorBufferInfo paletteInfo = {};
+	paletteInfo.buffer = _paletteBuffer;
+	paletteInfo.offset = 0;
+	paletteInfo.range = _paletteRegionSize;
+
+	VkWriteDescriptorSet descriptorWrite = {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = _paletteSet.descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &paletteInfo;
+
+	vkUpdateDescriptorSets(_device->getDevice(), 1, &descriptorWrite, 0, nullptr);
+}
+
+void GpuSkinning::_destroyPaletteSet() {
+	_descriptorAllocator->release(_paletteSet);
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,129 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "DescriptorAllocator.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class DescriptorLayoutCache;
+class Device;
+
+/**
+ * Push constants of the skinning compute shader.
+ */
+struct SkinningPushConstants {
+	uint32_t vertexCount = 0;
+	uint32_t boneOffset = 0; /**< Index of the first bone of the mesh in the palette of the frame. */
+	uint32_t boneCount = 0;
+};
+
+/**
+ * Compute pre-pass posing the skin meshes of a frame on the GPU.
+ *
+ * The skin mesh nodes push their bone matrices during the traversal. The matrices of every mesh are written once per
+ * frame into a bone palette storage buffer, then one dispatch per mesh blends the weighted vertices of the skin mesh
+ * into the posed vertex buffer of the node. The posed buffers are drawn like static meshes, so every pass drawing the
+ * node reads the same posed vertices without skinning them again.
+ *
+ * Each frame in flight uses its own region of the palette, addressed with a dynamic offset. The posed buffers are
+ * shared by the frames in flight, the dispatches wait for the vertex input of the previous frames before rewriting
+ * them.
+ */
+class GpuSkinning {
+public:
+	GpuSkinning() = delete;
+	GpuSkinning(const std::shared_ptr<Device> &device, const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+				const std::shared_ptr<DescriptorAllocator> &descriptorAllocator, uint32_t frameCount);
+	GpuSkinning(const GpuSkinning &) = delete;
+
+	virtual ~GpuSkinning();
+
+	/** Removes the meshes pushed for the previous frame, keeping the storage. */
+	void clear();
+
+	/**
+	 * Adds a mesh to pose in the frame.
+	 *
+	 * @param vertexSet The set created with createVertexSet for the mesh.
+	 * @param vertexCount The number of vertices of the mesh.
+	 * @param boneMatrices The matrices moving the vertices from the bind pose, indexed by the bone ids of the vertices.
+	 */
+	void push(VkDescriptorSet vertexSet, uint32_t vertexCount, const std::vector<glm::mat4> &boneMatrices);
+
+	/**
+	 * Writes the bone palette of the frame and records the dispatches of the pushed meshes, followed by the barrier
+	 * making the posed vertices visible to the vertex input. Must be recorded outside of the render pass.
+	 * Grows the palette when the bones do not fit, the replaced palette and its set are released through the deletion
+	 * queue once the frames in flight completed.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param frameIndex The frame in flight being recorded.
+	 */
+	void dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	/**
+	 * Allocates the descriptor set binding the weighted vertices of a mesh and the posed vertices blended from them.
+	 *
+	 * @param sourceBuffer The storage buffer of the weighted vertices.
+	 * @param posedBuffer The storage buffer of the posed vertices.
+	 * @return The allocated set, released with freeVertexSet.
+	 */
+	[[nodiscard]] DescriptorAllocation createVertexSet(VkBuffer sourceBuffer, VkBuffer posedBuffer);
+
+	/** Releases a vertex set once the frames in flight no longer use it. */
+	void freeVertexSet(DescriptorAllocation &vertexSet);
+
+	[[nodiscard]] size_t getMeshCount() const {
+		return _jobs.size();
+	}
+
+	[[nodiscard]] uint32_t getBoneCapacity() const {
+		return _boneCapacity;
+	}
+
+private:
+	struct Job {
+		VkDescriptorSet vertexSet;
+		SkinningPushConstants pushConstants;
+	};
+
+	void _createPaletteBuffer(uint32_t boneCapacity);
+	void _destroyPaletteBuffer();
+
+	void _createDescriptorSetLayouts(const std::shared_ptr<DescriptorLayoutCache> &layoutCache);
+	void _destroyDescriptorSetLayouts();
+
+	void _createComputePipeline();
+	void _destroyComputePipeline();
+
+	void _createPaletteSet();
+	void _destroyPaletteSet();
+
+	std::shared_ptr<Device> _device;
+	std::shared_ptr<DescriptorAllocator> _descriptorAllocator;
+	uint32_t _frameCount;
+
+	uint32_t _boneCapacity = 0;
+	VkDeviceSize _paletteRegionSize = 0;
+	VkBuffer _paletteBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _paletteBufferMemory = VK_NULL_HANDLE;
+	void *_paletteBufferMapped = nullptr;
+
+	VkDescriptorSetLayout _paletteSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout _vertexSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout _skinningPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline _skinningPipeline = VK_NULL_HANDLE;
+
+	DescriptorAllocation _paletteSet;
+
+	std::vector<glm::mat4> _palette;
+	std::vector<Job> _jobs;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,319 @@
+// Copyright 2024 Stone-Engine
+
+#include "LightClusters.hpp"
+
+#include "DescriptorLayoutCache.hpp"
+#include "Device.hpp"
+#include "FrameUniformBuffer.hpp"
+#include "Utils/FileSystem.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <glm/matrix.hpp>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+/** Lights the buffer can hold per frame before growing for the first time. */
+constexpr uint32_t initialLightCapacity = 1024;
+
+/** Must match clusterGrid in cluster-lights.glsl and frag.glsl. */
+constexpr uint32_t clusterCountX = 16;
+constexpr uint32_t clusterCountY = 9;
+constexpr uint32_t clusterCountZ = 24;
+constexpr uint32_t clusterCount = clusterCountX * clusterCountY * clusterCountZ;
+
+/** Must match maxLightsPerCluster in cluster-lights.glsl and frag.glsl, the lights past it are dropped. */
+constexpr uint32_t maxLightsPerCluster = 128;
+
+/** Must match local_size_x in cluster-lights.glsl. */
+constexpr uint32_t clusteringGroupSize = 64;
+
+LightClusters::LightClusters(const std::shared_ptr<Device> &device,
+							 const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+							 const std::shared_ptr<DescriptorAllocator> &descriptorAllocator,
+							 const std::shared_ptr<FrameUniformBuffer> &frameUniformBuffer, uint32_t frameCount)
+	: _device(device), _descriptorAllocator(descriptorAllocator), _frameUniformBuffer(frameUniformBuffer),
+	  _frameCount(frameCount) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device->getPhysicalDevice(), &properties);
+	_storageAlignment = properties.limits.minStorageBufferOffsetAlignment;
+
+	_createLightBuffer(initialLightCapacity);
+	_createClusterBuffer();
+	_createDescriptorSetLayout(layoutCache);
+	_createComputePipeline();
+	_createDescriptorSet();
+}
+
+LightClusters::~LightClusters() {
+	_destroyDescriptorSet();
+	_destroyComputePipeline();
+	_destroyDescriptorSetLayout();
+	_destroyClusterBuffer();
+	_destroyLightBuffer();
+}
+
+void LightClusters::clear() {
+	_lights.clear();
+	_directionalLights.clear();
+	_ambientLight = glm::vec3(0.0f);
+	_hasAmbientLight = false;
+}
+
+void LightClusters::push(const GpuLight &light) {
+	if (light.boundingSphere.w <= 0.0f) {
+		return;
+	}
+	_lights.push_back(light);
+}
+
+void LightClusters::pushDirectional(const GpuDirectionalLight &light) {
+	if (_directionalLights.size() < maxDirectionalLights) {
+		_directionalLights.push_back(light);
+	}
+}
+
+void LightClusters::pushAmbient(const glm::vec3 &color) {
+	_ambientLight += color;
+	_hasAmbientLight = true;
+}
+
+void LightClusters::prepare(uint32_t frameIndex, const glm::mat4 &projMatrix, VkExtent2D extent,
+							FrameUniforms &frameUniforms) {
+	assert(frameIndex < _frameCount);
+
+	if (_lights.size() > _lightCapacity) {
+		uint32_t lightCapacity = std::max(static_cast<uint32_t>(_lights.size()), _lightCapacity * 2);
+
+		// The regions of the frames in flight are still read by the device, the buffer is released with its set.
+		_destroyDescriptorSet();
+		_destroyLightBuffer();
+		_createLightBuffer(lightCapacity);
+		_createDescriptorSet();
+	}
+
+	std::memcpy(static_cast<char *>(_lightBufferMapped) + _lightRegionSize * frameIndex, _lights.data(),
+				_lights.size() * sizeof(GpuLight));
+
+	// The depth range drawn by Vulkan is the normalized depth from 0 to 1, whatever the convention of the projection.
+	glm::mat4 inverseProjection = glm::inverse(projMatrix);
+	glm::vec4 nearPoint = inverseProjection * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	glm::vec4 farPoint = inverseProjection * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	float zFar = std::max(-farPoint.z / farPoint.w, 1e-3f);
+	float zNear = std::clamp(-nearPoint.z / nearPoint.w, zFar * 1e-5f, zFar * 0.5f);
+
+	_pushConstants.inverseProjection = inverseProjection;
+	_pushConstants.zNear = zNear;
+	_pushConstants.zFar = zFar;
+	_pushConstants.lightCount = static_cast<uint32_t>(_lights.size());
+
+	// A frame without any light keeps the unlit look of the scenes made before lighting.
+	bool lit = _hasAmbientLight || !_lights.empty() || !_directionalLights.empty();
+	frameUniforms.ambientLight = lit ? glm::vec4(_ambientLight, 1.0f) : glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+
+	std::copy(_directionalLights.begin(), _directionalLights.end(), frameUniforms.directionalLights);
+	frameUniforms.directionalLightCount = static_cast<uint32_t>(_directionalLights.size());
+
+	// The slice of a view depth z is log(z / zNear) * clusterCountZ / log(zFar / zNear).
+	float sliceScale = static_cast<float>(clusterCountZ) / std::log(zFar / zNear);
+	frameUniforms.clusterScale =
+		glm::vec4(static_cast<float>(extent.width) / clusterCountX, static_cast<float>(extent.height) / clusterCountY,
+				  sliceScale, sliceScale * std::log(zNear));
+}
+
+void LightClusters::dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex) const {
+	// The previous frames may still read the cluster lists, they are only overwritten once their shading is done.
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+						 0, nullptr, 0, nullptr, 0, nullptr);
+
+	uint32_t dynamicOffsets[] = {static_cast<uint32_t>(_lightRegionSize * frameIndex),
+								 static_cast<uint32_t>(_clusterRegionSize * frameIndex)};
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _clusteringPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _clusteringPipelineLayout, 0, 1,
+							&_clusteringSet.descriptorSet, 2, dynamicOffsets);
+	vkCmdPushConstants(commandBuffer, _clusteringPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+					   sizeof(ClusteringPushConstants), &_pushConstants);
+	vkCmdDispatch(commandBuffer, (clusterCount + clusteringGroupSize - 1) / clusteringGroupSize, 1, 1);
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = _clusterBuffer;
+	barrier.offset = _clusterRegionSize * frameIndex;
+	barrier.size = _clusterRegionSize;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+						 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+
+/** Buffers */
+
+void LightClusters::_createLightBuffer(uint32_t lightCapacity) {
+	VkDeviceSize alignment = _storageAlignment;
+	VkDeviceSize regionSize = sizeof(GpuLight) * lightCapacity;
+
+	_lightCapacity = lightCapacity;
+	_lightRegionSize = alignment > 0 ? (regionSize + alignment - 1) & ~(alignment - 1) : regionSize;
+
+	std::tie(_lightBuffer, _lightBufferMemory) =
+		_device->createBuffer(_lightRegionSize * _frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	vkMapMemory(_device->getDevice(), _lightBufferMemory, 0, _lightRegionSize * _frameCount, 0, &_lightBufferMapped);
+}
+
+void LightClusters::_destroyLightBuffer() {
+	if (_lightBufferMapped != nullptr) {
+		vkUnmapMemory(_device->getDevice(), _lightBufferMemory);
+		_lightBufferMapped = nullptr;
+	}
+	_device->releaseBuffer(_lightBuffer, _lightBufferMemory);
+	_lightBuffer = VK_NULL_HANDLE;
+	_lightBufferMemory = VK_NULL_HANDLE;
+	_lightCapacity = 0;
+}
+
+void LightClusters::_createClusterBuffer() {
+	// The light counts of the clusters are followed by their fixed size lists of light indices.
+	VkDeviceSize alignment = _storageAlignment;
+	VkDeviceSize regionSize = sizeof(uint32_t) * clusterCount * (1 + maxLightsPerCluster);
+	_clusterRegionSize = alignment > 0 ? (regionSize + alignment - 1) & ~(alignment - 1) : regionSize;
+
+	std::tie(_clusterBuffer, _clusterBufferMemory) = _device->createBuffer(
+		_clusterRegionSize * _frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void LightClusters::_destroyClusterBuffer() {
+	_device->destroyBuffer(_clusterBuffer, _clusterBufferMemory);
+	_clusterBuffer = VK_NULL_HANDLE;
+	_clusterBufferMemory = VK_NULL_HANDLE;
+}
+
+
+/** Descriptor Set Layout */
+
+void LightClusters::_createDescriptorSetLayout(const std::shared_ptr<DescriptorLayoutCache> &layoutCache) {
+	VkDescriptorSetLayoutBinding lightsBinding = {};
+	lightsBinding.binding = 0;
+	lightsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	lightsBinding.descriptorCount = 1;
+	lightsBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	lightsBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding clustersBinding = lightsBinding;
+	clustersBinding.binding = 1;
+
+	_clusteringSetLayout = layoutCache->getLayout({lightsBinding, clustersBinding});
+}
+
+void LightClusters::_destroyDescriptorSetLayout() {
+	// The layout is owned by the cache.
+	_clusteringSetLayout = VK_NULL_HANDLE;
+}
+
+
+/** Compute Pipeline */
+
+void LightClusters::_createComputePipeline() {
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ClusteringPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_clusteringSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(_device->getDevice(), &pipelineLayoutInfo, nullptr, &_clusteringPipelineLayout) !=
+		VK_SUCCESS) {
+		throw std::runtime_error("Failed to create light clustering pipeline layout");
+	}
+
+	auto shaderCode = Utils::readBinaryFile("shaders/cluster-lights.spv");
+	auto shaderModule = _device->createShaderModule(shaderCode);
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _clusteringPipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkResult result = vkCreateComputePipelines(_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+											   &_clusteringPipeline);
+
+	vkDestroyShaderModule(_device->getDevice(), shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create light clustering pipeline");
+	}
+}
+
+void LightClusters::_destroyComputePipeline() {
+	if (_clusteringPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(_device->getDevice(), _clusteringPipeline, nullptr);
+	}
+	_clusteringPipeline = VK_NULL_HANDLE;
+	if (_clusteringPipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(_device->getDevice(), _clusteringPipelineLayout, nullptr);
+	}
+	_clusteringPipelineLayout = VK_NULL_HANDLE;
+}
+
+
+/** Descriptor Set */
+
+void LightClusters::_createDescriptorSet() {
+	_clusteringSet = _descriptorAllocator->allocate(_clusteringSetLayout);
+
+	VkDescriptorBufferInfo lightsInfo = {};
+	lightsInfo.buffer = _lightBuffer;
+	lightsInfo.offset = 0;
+	lightsInfo.range = _lightRegionSize;
+
+	VkDescriptorBufferInfo clustersInfo = {};
+	clustersInfo.buffer = _clusterBuffer;
+	clustersInfo.offset = 0;
+	clustersInfo.range = _clusterRegionSize;
+
+	std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+	for (VkWriteDescriptorSet &descriptorWrite : descriptorWrites) {
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = _clusteringSet.descriptorSet;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		descriptorWrite.descriptorCount = 1;
+	}
+
+	descriptorWrites[0].dstBinding = 0;
+	descriptorWrites[0].pBufferInfo = &lightsInfo;
+
+	descriptorWrites[1].dstBinding = 1;
+	descriptorWrites[1].pBufferInfo = &clustersInfo;
+
+	vkUpdateDescriptorSets(_device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+						   descriptorWrites.data(), 0, nullptr);
+
+	// The fragment shaders read the same buffers through the frame set.
+	_frameUniformBuffer->setLightBuffers(_lightBuffer, _lightRegionSize, _clusterBuffer, _clusterRegionSize);
+}
+
+void LightClusters::_destroyDescriptorSet() {
+	_descriptorAllocator->release(_clusteringSet);
+}
+
+} // namespace Stone::Render::Vulkan
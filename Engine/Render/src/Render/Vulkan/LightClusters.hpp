@@ -0,0 +1,168 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "DescriptorAllocator.hpp"
+#include "FrameUniformBuffer.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class DescriptorLayoutCache;
+class Device;
+
+/**
+ * A point or spot light of the frame, read by the clustering compute shader and the fragment shaders, laid out as
+ * std430. Positions and directions are in view space.
+ *
+ * The light fades between its inner and outer cones, a point light has cone cosines of -1 and -2 to light every way.
+ * The w of the attenuation is the index of the shadow tile of a spot light, -1 without shadow.
+ */
+struct GpuLight {
+	alignas(16) glm::vec4 boundingSphere = glm::vec4(0.0f);	/**< Sphere containing the lit volume, radius in w. */
+	alignas(16) glm::vec4 position = glm::vec4(0.0f);		/**< Position in xyz and range in w. */
+	alignas(16) glm::vec4 direction = glm::vec4(0.0f);		/**< Spot axis in xyz, outer cone cosine in w. */
+	alignas(16) glm::vec4 color = glm::vec4(0.0f);			/**< Color times intensity, inner cone cosine in w. */
+	alignas(16) glm::vec4 specular = glm::vec4(0.0f);		/**< Specular color times intensity. */
+	alignas(16) glm::vec4 attenuation = glm::vec4(0.0f);	/**< Constant, linear and quadratic, shadow tile in w. */
+};
+
+/**
+ * Push constants of the clustering compute shader.
+ */
+struct ClusteringPushConstants {
+	glm::mat4 inverseProjection;
+	float zNear = 0.0f;
+	float zFar = 0.0f;
+	uint32_t lightCount = 0;
+};
+
+/**
+ * Clustered forward lighting of the point and spot lights of a frame.
+ *
+ * The light nodes push their lights during the traversal. The view frustum is sliced into a grid of clusters, screen
+ * tiles split along the depth in logarithmic slices. A compute pass tests the bounding sphere of every light against
+ * the bounds of every cluster and writes the list of lights reaching each cluster. The fragment shaders find the
+ * cluster of their fragment and only loop over its lights, so the cost of shading depends on the lights around the
+ * surface rather than on the lights of the scene.
+ *
+ * The directional lights reach every fragment, they are passed to the fragment shaders in the frame uniforms.
+ *
+ * The lights and the cluster lists are bound in the frame set. Each frame in flight uses its own region of the
+ * buffers, addressed with dynamic offsets.
+ */
+class LightClusters {
+public:
+	LightClusters() = delete;
+	LightClusters(const std::shared_ptr<Device> &device, const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+				  const std::shared_ptr<DescriptorAllocator> &descriptorAllocator,
+				  const std::shared_ptr<FrameUniformBuffer> &frameUniformBuffer, uint32_t frameCount);
+	LightClusters(const LightClusters &) = delete;
+
+	virtual ~LightClusters();
+
+	/** Removes the lights pushed for the previous frame, keeping the storage. */
+	void clear();
+
+	/**
+	 * Adds a point or spot light to the frame.
+	 *
+	 * @param light The light, in view space.
+	 */
+	void push(const GpuLight &light);
+
+	/**
+	 * Adds a directional light to the frame, ignored past maxDirectionalLights.
+	 *
+	 * @param light The light, in view space.
+	 */
+	void pushDirectional(const GpuDirectionalLight &light);
+
+	/**
+	 * Adds an ambient light to the frame, lighting every surface evenly.
+	 *
+	 * @param color The color of the light times its intensity.
+	 */
+	void pushAmbient(const glm::vec3 &color);
+
+	/**
+	 * Writes the lights of the frame into its region and the clustering parameters into the frame uniforms.
+	 * Grows the light buffer when the lights do not fit, the replaced buffer and its set are released through the
+	 * deletion queue once the frames in flight completed.
+	 *
+	 * @param frameIndex The frame in flight being recorded.
+	 * @param projMatrix The projection of the camera the clusters slice.
+	 * @param extent The size of the frame in pixels.
+	 * @param frameUniforms The uniforms receiving the ambient and directional lights and the cluster scale.
+	 */
+	void prepare(uint32_t frameIndex, const glm::mat4 &projMatrix, VkExtent2D extent, FrameUniforms &frameUniforms);
+
+	/**
+	 * Records the clustering dispatch and the barrier making the cluster lists visible to the fragment shaders.
+	 * Must be recorded outside of the render pass.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param frameIndex The frame in flight being recorded.
+	 */
+	void dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+
+	[[nodiscard]] size_t getLightCount() const {
+		return _lights.size();
+	}
+
+	[[nodiscard]] uint32_t getLightCapacity() const {
+		return _lightCapacity;
+	}
+
+private:
+	void _createLightBuffer(uint32_t lightCapacity);
+	void _destroyLightBuffer();
+
+	void _createClusterBuffer();
+	void _destroyClusterBuffer();
+
+	void _createDescriptorSetLayout(const std::shared_ptr<DescriptorLayoutCache> &layoutCache);
+	void _destroyDescriptorSetLayout();
+
+	void _createComputePipeline();
+	void _destroyComputePipeline();
+
+	void _createDescriptorSet();
+	void _destroyDescriptorSet();
+
+	std::shared_ptr<Device> _device;
+	std::shared_ptr<DescriptorAllocator> _descriptorAllocator;
+	std::shared_ptr<FrameUniformBuffer> _frameUniformBuffer;
+	uint32_t _frameCount;
+	VkDeviceSize _storageAlignment = 0;
+
+	uint32_t _lightCapacity = 0;
+	VkDeviceSize _lightRegionSize = 0;
+	VkBuffer _lightBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _lightBufferMemory = VK_NULL_HANDLE;
+	void *_lightBufferMapped = nullptr;
+
+	VkDeviceSize _clusterRegionSize = 0;
+	VkBuffer _clusterBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _clusterBufferMemory = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout _clusteringSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout _clusteringPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline _clusteringPipeline = VK_NULL_HANDLE;
+
+	DescriptorAllocation _clusteringSet;
+
+	std::vector<GpuLight> _lights;
+	std::vector<GpuDirectionalLight> _directionalLights;
+	glm::vec3 _ambientLight = glm::vec3(0.0f);
+	bool _hasAmbientLight = false;
+	ClusteringPushConstants _pushConstants;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,190 @@
+// Copyright 2024 Stone-Engine
+
+#include "OffscreenTarget.hpp"
+
+#include "Core/Image/ImageData.hpp"
+#include "Device.hpp"
+
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+OffscreenTarget::OffscreenTarget(const std::shared_ptr<Device> &device, const VkRenderPass &renderPass,
+								 VkFormat format, VkExtent2D extent, uint32_t imageCount)
+	: _device(device), _imageFormat(format), _extent(extent), _imageCount(imageCount) {
+	std::cout << "Creating offscreen target" << std::endl;
+	_createImages();
+	_createDepthResources();
+	_createFramebuffers(renderPass);
+	_createReadbackBuffers();
+}
+
+OffscreenTarget::~OffscreenTarget() {
+	if (_device) {
+		_device->waitIdle();
+	}
+
+	_destroyReadbackBuffers();
+	_destroyFramebuffers();
+	_destroyDepthResources();
+	_destroyImages();
+	std::cout << "Destroying offscreen target" << std::endl;
+}
+
+ImageContext OffscreenTarget::getImageContext(uint32_t index) const {
+	return {index, _images[index], _imageViews[index], _framebuffers[index]};
+}
+
+void OffscreenTarget::recordReadback(VkCommandBuffer commandBuffer, uint32_t index) const {
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = {0, 0, 0};
+	region.imageExtent = {_extent.width, _extent.height, 1};
+
+	vkCmdCopyImageToBuffer(commandBuffer, _images[index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+						   _readbackBuffers[index], 1, &region);
+
+	// The fence of the frame only makes the copy visible to the host with this barrier.
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = _readbackBuffers[index];
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+						 &barrier, 0, nullptr);
+}
+
+std::shared_ptr<Core::Image::ImageData> OffscreenTarget::readImage(uint32_t index) const {
+	std::vector<uint8_t> pixels(static_cast<size_t>(_readbackSize));
+
+	void *data;
+	vkMapMemory(_device->getDevice(), _readbackMemories[index], 0, _readbackSize, 0, &data);
+	std::memcpy(pixels.data(), data, pixels.size());
+	vkUnmapMemory(_device->getDevice(), _readbackMemories[index]);
+
+	Core::Image::Size size(static_cast<int>(_extent.width), static_cast<int>(_extent.height));
+	return std::make_shared<Core::Image::ImageData>(size, Core::Image::Channel::RGBA, std::move(pixels));
+}
+
+
+/** Images */
+
+void OffscreenTarget::_createImages() {
+	_images.resize(_imageCount);
+	_imageMemories.resize(_imageCount);
+	_imageViews.resize(_imageCount);
+
+	for (uint32_t i = 0; i < _imageCount; ++i) {
+		std::tie(_images[i], _imageMemories[i]) = _device->createImage(
+			_extent.width, _extent.height, 1, VK_SAMPLE_COUNT_1_BIT, _imageFormat, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		_imageViews[i] = _device->createImageView(_images[i], _imageFormat);
+	}
+}
+
+void OffscreenTarget::_destroyImages() {
+	for (uint32_t i = 0; i < _images.size(); ++i) {
+		vkDestroyImageView(_device->getDevice(), _imageViews[i], nullptr);
+		vkDestroyImage(_device->getDevice(), _images[i], nullptr);
+		vkFreeMemory(_device->getDevice(), _imageMemories[i], nullptr);
+	}
+	_imageViews.clear();
+	_images.clear();
+	_imageMemories.clear();
+}
+
+
+/** Depth Resources */
+
+void OffscreenTarget::_createDepthResources() {
+	VkFormat depthFormat = _device->findDepthFormat();
+
+	std::tie(_depthImage, _depthImageMemory) = _device->createImage(
+		_extent.width, _extent.height, 1, VK_SAMPLE_COUNT_1_BIT, depthFormat, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	_depthImageView = _device->createImageView(_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+	_device->transitionImageLayout(_depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED,
+								   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+}
+
+void OffscreenTarget::_destroyDepthResources() {
+	vkDestroyImageView(_device->getDevice(), _depthImageView, nullptr);
+	vkDestroyImage(_device->getDevice(), _depthImage, nullptr);
+	vkFreeMemory(_device->getDevice(), _depthImageMemory, nullptr);
+	_depthImageView = VK_NULL_HANDLE;
+	_depthImage = VK_NULL_HANDLE;
+	_depthImageMemory = VK_NULL_HANDLE;
+}
+
+
+/** Framebuffers */
+
+void OffscreenTarget::_createFramebuffers(const VkRenderPass &renderPass) {
+	_framebuffers.resize(_imageCount);
+
+	for (uint32_t i = 0; i < _imageCount; ++i) {
+		std::array<VkImageView, 2> attachments = {_imageViews[i], _depthImageView};
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		framebufferInfo.pAttachments = attachments.data();
+		framebufferInfo.width = _extent.width;
+		framebufferInfo.height = _extent.height;
+		framebufferInfo.layers = 1;
+
+		if (vkCreateFramebuffer(_device->getDevice(), &framebufferInfo, nullptr, &_framebuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create framebuffer");
+		}
+	}
+}
+
+void OffscreenTarget::_destroyFramebuffers() {
+	for (auto framebuffer : _framebuffers) {
+		vkDestroyFramebuffer(_device->getDevice(), framebuffer, nullptr);
+	}
+	_framebuffers.clear();
+}
+
+
+/** Readback Buffers */
+
+void OffscreenTarget::_createReadbackBuffers() {
+	// The offscreen formats have four 8 bit channels.
+	_readbackSize = static_cast<VkDeviceSize>(_extent.width) * _extent.height * 4;
+	_readbackBuffers.resize(_imageCount);
+	_readbackMemories.resize(_imageCount);
+
+	for (uint32_t i = 0; i < _imageCount; ++i) {
+		std::tie(_readbackBuffers[i], _readbackMemories[i]) =
+			_device->createBuffer(_readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+								  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	}
+}
+
+void OffscreenTarget::_destroyReadbackBuffers() {
+	for (uint32_t i = 0; i < _readbackBuffers.size(); ++i) {
+		_device->destroyBuffer(_readbackBuffers[i], _readbackMemories[i]);
+	}
+	_readbackBuffers.clear();
+	_readbackMemories.clear();
+}
+
+
+} // namespace Stone::Render::Vulkan
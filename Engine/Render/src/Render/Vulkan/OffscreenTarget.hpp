@@ -0,0 +1,99 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "RenderContext.hpp"
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Core::Image {
+class ImageData;
+} // namespace Stone::Core::Image
+
+namespace Stone::Render::Vulkan {
+
+class Device;
+
+/**
+ * Device images rendered in place of the swap chain when the renderer runs without a window.
+ *
+ * There is one image per frame in flight, selected by the frame index, so an image is free again once the fence of
+ * its frame is signaled. Each image has a host visible buffer its content can be copied into and read back from.
+ */
+class OffscreenTarget {
+public:
+	OffscreenTarget() = delete;
+	OffscreenTarget(const std::shared_ptr<Device> &device, const VkRenderPass &renderPass, VkFormat format,
+					VkExtent2D extent, uint32_t imageCount);
+	OffscreenTarget(const OffscreenTarget &) = delete;
+
+	virtual ~OffscreenTarget();
+
+	[[nodiscard]] const VkFormat &getImageFormat() const {
+		return _imageFormat;
+	}
+
+	[[nodiscard]] const VkExtent2D &getExtent() const {
+		return _extent;
+	}
+
+	[[nodiscard]] uint32_t getImageCount() const {
+		return _imageCount;
+	}
+
+	[[nodiscard]] ImageContext getImageContext(uint32_t index) const;
+
+	/**
+	 * Records the copy of a rendered image into its readback buffer.
+	 * Must be recorded after the render pass, which leaves the image in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param index The index of the image.
+	 */
+	void recordReadback(VkCommandBuffer commandBuffer, uint32_t index) const;
+
+	/**
+	 * Reads the readback buffer of an image, the command buffer copying it must have completed.
+	 *
+	 * @param index The index of the image.
+	 * @return The pixels of the image as RGBA.
+	 */
+	[[nodiscard]] std::shared_ptr<Core::Image::ImageData> readImage(uint32_t index) const;
+
+private:
+	void _createImages();
+	void _destroyImages();
+
+	void _createDepthResources();
+	void _destroyDepthResources();
+
+	void _createFramebuffers(const VkRenderPass &renderPass);
+	void _destroyFramebuffers();
+
+	void _createReadbackBuffers();
+	void _destroyReadbackBuffers();
+
+	std::shared_ptr<Device> _device;
+
+	VkFormat _imageFormat;
+	VkExtent2D _extent;
+	uint32_t _imageCount;
+
+	std::vector<VkImage> _images = {};
+	std::vector<VkDeviceMemory> _imageMemories = {};
+	std::vector<VkImageView> _imageViews = {};
+
+	std::vector<VkFramebuffer> _framebuffers = {};
+
+	VkImage _depthImage = VK_NULL_HANDLE;
+	VkDeviceMemory _depthImageMemory = VK_NULL_HANDLE;
+	VkImageView _depthImageView = VK_NULL_HANDLE;
+
+	VkDeviceSize _readbackSize = 0;
+	std::vector<VkBuffer> _readbackBuffers = {};
+	std::vector<VkDeviceMemory> _readbackMemories = {};
+};
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,619 @@
+// Copyright 2024 Stone-Engine
+
+#include "PipelineCache.hpp"
+
+#include "DescriptorLayoutCache.hpp"
+#include "Device.hpp"
+#include "FrameUniformBuffer.hpp"
+#include "RenderPass.hpp"
+#include "ShaderCompiler.hpp"
+#include "Utilities/VertexBinding.hpp"
+#include "Utils/FileSystem.hpp"
+#include "Utils/ThreadPool.hpp"
+#include "VulkanRenderable/Shader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace Stone::Render::Vulkan {
+
+namespace {
+
+/** Checks that a pipeline provides what a shader reads, before any of its modules is created. */
+void checkShaderInterface(const ShaderReflection &reflection, const VertexInputDescription &vertexInput) {
+	for (const ReflectedVertexInput &input : reflection.vertexInputs) {
+		if (std::none_of(vertexInput.attributes.begin(), vertexInput.attributes.end(),
+						 [&](const VkVertexInputAttributeDescription &attribute) {
+							 return attribute.location == input.location;
+						 })) {
+			throw std::runtime_error("Failed to find the vertex input " + std::to_string(input.location) +
+									 " read by the shader");
+		}
+	}
+
+	// Every mesh pipeline has the same push constant range, the shaders read the object data from it.
+	if (reflection.pushConstants.has_value()) {
+		VkPushConstantRange range = FrameUniformBuffer::getPushConstantRange();
+		const VkPushConstantRange &pushConstants = *reflection.pushConstants;
+		if ((pushConstants.stageFlags & ~range.stageFlags) != 0 ||
+			pushConstants.offset + pushConstants.size > range.offset + range.size) {
+			throw std::runtime_error("Failed to fit the push constants of the shader in the object push constants");
+		}
+	}
+}
+
+/** Splits a line of the manifest on its tabs, the last field taking the rest of the line. */
+std::vector<std::string> splitFields(const std::string &line, size_t count) {
+	std::vector<std::string> fields;
+	size_t start = 0;
+	while (fields.size() + 1 < count) {
+		size_t end = line.find('\t', start);
+		if (end == std::string::npos) {
+			return {};
+		}
+		fields.push_back(line.substr(start, end - start));
+		start = end + 1;
+	}
+	fields.push_back(line.substr(start));
+	return fields;
+}
+
+/** Parses an unsigned decimal field of the manifest. */
+std::optional<uint32_t> parseNumber(const std::string &field) {
+	if (field.empty() || field.find_first_not_of("0123456789") != std::string::npos) {
+		return std::nullopt;
+	}
+	return static_cast<uint32_t>(std::stoul(field));
+}
+
+/** Checks that pipeline cache data was written by the same driver and device, before handing it to the driver. */
+bool isCompatibleCacheData(const std::vector<char> &data, const VkPhysicalDeviceProperties &properties) {
+	// The header is the size of the header, its version, the vendor and device IDs, then the UUID of the cache.
+	uint32_t fields[4] = {};
+	if (data.size() < sizeof(fields) + VK_UUID_SIZE) {
+		return false;
+	}
+	std::memcpy(fields, data.data(), sizeof(fields));
+	return fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && fields[2] == properties.vendorID &&
+		   fields[3] == properties.deviceID &&
+		   std::memcmp(data.data() + sizeof(fields), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+} // namespace
+
+PipelineCache::PipelineCache(const std::shared_ptr<Device> &device, const std::shared_ptr<RenderPass> &renderPass,
+							 const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+							 const std::shared_ptr<ShaderCompiler> &shaderCompiler,
+							 const std::shared_ptr<ThreadPool> &threadPool, VkDescriptorSetLayout frameSetLayout,
+							 std::string cacheFile)
+	: _device(device), _renderPass(renderPass), _layoutCache(layoutCache), _shaderCompiler(shaderCompiler),
+	  _frameSetLayout(frameSetLayout), _emptySetLayout(layoutCache->getLayout({})), _cacheFile(std::move(cacheFile)),
+	  _threadPool(threadPool) {
+	_createVkPipelineCache();
+}
+
+PipelineCache::~PipelineCache() {
+	// The pending pipelines are dropped, the one being created is finished before its handles are destroyed.
+	_stopping = true;
+	waitIdle();
+
+	_saveVkPipelineCache();
+	_destroyGraphicPipelines();
+	_destroyPipelineLayouts();
+	_destroyVkPipelineCache();
+}
+
+const GraphicPipeline &PipelineCache::getPipeline(VkDescriptorSetLayout materialSetLayout,
+												  VkDescriptorSetLayout objectSetLayout,
+												  Scene::VertexFormat vertexFormat,
+												  const std::shared_ptr<ShaderVariant> &fragmentShader) {
+	PipelineKey key = {materialSetLayout, objectSetLayout, vertexFormat, false,
+					   fragmentShader ? fragmentShader->getKey() : 0};
+	return _requestPipeline(key, fragmentShader);
+}
+
+const GraphicPipeline &PipelineCache::getDepthPipeline(VkDescriptorSetLayout objectSetLayout,
+													   Scene::VertexFormat vertexFormat) {
+	PipelineKey key = {VK_NULL_HANDLE, objectSetLayout, vertexFormat, true, 0};
+	return _requestPipeline(key, nullptr);
+}
+
+size_t PipelineCache::loadManifest(const std::string &path) {
+	_manifestPath = path;
+
+	// Each line is the vertex format, whether the pipeline is depth only, the bindings of its material and object
+	// sets, then the fragment shader variant as listed in the manifest of the shader compiler, empty for the default.
+	size_t count = 0;
+	std::ifstream file(path);
+	std::string line;
+	while (std::getline(file, line)) {
+		std::vector<std::string> fields = splitFields(line, 5);
+		if (fields.empty() || !_manifestEntries.insert(line).second) {
+			continue;
+		}
+		// A pipeline of a removed shader or of an older build stays in the manifest, it is skipped until deleted.
+		try {
+			std::optional<uint32_t> vertexFormat = parseNumber(fields[0]);
+			std::optional<uint32_t> depthOnly = parseNumber(fields[1]);
+			if (!vertexFormat.has_value() || !depthOnly.has_value()) {
+				continue;
+			}
+			std::shared_ptr<ShaderVariant> fragmentShader;
+			if (!fields[4].empty()) {
+				std::optional<ShaderSource> source = ShaderCompiler::parseSource(fields[4]);
+				if (!source.has_value()) {
+					continue;
+				}
+				uint64_t key = ShaderCompiler::computeSourceKey(*source);
+				std::string function = source->entryPoint;
+				fragmentShader = std::make_shared<ShaderVariant>(_shaderCompiler->compileAsync(*source),
+																 std::move(function), 0, key, source);
+			}
+			PipelineKey key = {_parseSetLayout(fields[2]), _parseSetLayout(fields[3]),
+							   static_cast<Scene::VertexFormat>(*vertexFormat), *depthOnly != 0,
+							   fragmentShader ? fragmentShader->getKey() : 0};
+			(void)_requestPipeline(key, fragmentShader);
+			++count;
+		} catch (const std::exception &) {
+		}
+	}
+	return count;
+}
+
+void PipelineCache::waitIdle() {
+	std::unique_lock<std::mutex> lock(_jobMutex);
+	_idleCondition.wait(lock, [this]() { return !_jobScheduled; });
+}
+
+bool PipelineCache::PipelineKey::operator==(const PipelineKey &other) const {
+	return materialSetLayout == other.materialSetLayout && objectSetLayout == other.objectSetLayout &&
+		   vertexFormat == other.vertexFormat && depthOnly == other.depthOnly &&
+		   fragmentShaderKey == other.fragmentShaderKey;
+}
+
+size_t PipelineCache::PipelineKeyHash::operator()(const PipelineKey &key) const {
+	size_t seed = std::hash<VkDescriptorSetLayout>()(key.materialSetLayout);
+	seed ^= std::hash<VkDescriptorSetLayout>()(key.objectSetLayout) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	seed ^= std::hash<uint8_t>()(static_cast<uint8_t>(key.vertexFormat)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	seed ^= std::hash<bool>()(key.depthOnly) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	seed ^= std::hash<uint64_t>()(key.fragmentShaderKey) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	return seed;
+}
+
+size_t PipelineCache::SetLayoutsHash::operator()(const std::vector<VkDescriptorSetLayout> &setLayouts) const {
+	size_t seed = setLayouts.size();
+	for (VkDescriptorSetLayout setLayout : setLayouts) {
+		seed ^= std::hash<VkDescriptorSetLayout>()(setLayout) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+	return seed;
+}
+
+const GraphicPipeline &PipelineCache::_requestPipeline(const PipelineKey &key,
+													   const std::shared_ptr<ShaderVariant> &fragmentShader) {
+	auto it = _pipelines.find(key);
+	if (it != _pipelines.end()) {
+		return *it->second;
+	}
+
+	auto newPipeline = std::make_unique<GraphicPipeline>();
+	newPipeline->id = static_cast<uint32_t>(_pipelines.size());
+	GraphicPipeline &graphicPipeline = *_pipelines.emplace(key, std::move(newPipeline)).first->second;
+	_recordPipeline(key, fragmentShader.get());
+
+	// The job owns the variant, the pipeline is owned by the cache which waits for its jobs before destroying it.
+	_scheduleJob([this, key, fragmentShader, &graphicPipeline]() {
+		if (_stopping) {
+			return;
+		}
+		try {
+			_createGraphicPipeline(key, fragmentShader.get(), graphicPipeline);
+		} catch (const std::exception &e) {
+			std::cerr << "Failed to create pipeline: " << e.what() << std::endl;
+		}
+	});
+	return graphicPipeline;
+}
+
+void PipelineCache::_scheduleJob(std::function<void()> job) {
+	{
+		std::unique_lock<std::mutex> lock(_jobMutex);
+		_jobs.push_back(std::move(job));
+		if (_jobScheduled) {
+			return;
+		}
+		_jobScheduled = true;
+	}
+	_threadPool->submit([this]() { _runNextJob(); });
+}
+
+void PipelineCache::_runNextJob() {
+	std::function<void()> job;
+	{
+		std::unique_lock<std::mutex> lock(_jobMutex);
+		job = std::move(_jobs.front());
+		_jobs.pop_front();
+	}
+	job();
+
+	{
+		std::unique_lock<std::mutex> lock(_jobMutex);
+		if (_jobs.empty()) {
+			_jobScheduled = false;
+			_idleCondition.notify_all();
+			return;
+		}
+	}
+	// Each job is a task of its own, queued behind the shaders submitted meanwhile that the next pipelines wait for.
+	_threadPool->submit([this]() { _runNextJob(); });
+}
+
+void PipelineCache::_createGraphicPipeline(const PipelineKey &key, const ShaderVariant *fragmentShader,
+										   GraphicPipeline &graphicPipeline) {
+	// The Packed and Quantized formats share their shaders, the quantized positions are normalized by the vertex input
+	// and their dequantization is folded in the model matrix.
+	// The depth shaders read the position alone, the same declaration for every format.
+	bool packed = key.vertexFormat != Scene::VertexFormat::Float;
+	bool indirect = key.objectSetLayout != VK_NULL_HANDLE;
+	const char *vertShaderPath = nullptr;
+	if (key.depthOnly) {
+		vertShaderPath = indirect ? "shaders/vert-indirect-depth.spv" : "shaders/vert-depth.spv";
+	} else if (indirect) {
+		vertShaderPath = packed ? "shaders/vert-indirect-packed.spv" : "shaders/vert-indirect.spv";
+	} else {
+		vertShaderPath = packed ? "shaders/vert-packed.spv" : "shaders/vert.spv";
+	}
+
+	// Depth pipelines have no fragment stage. The code of the material shader is waited for and the interfaces are
+	// checked before creating any module, a shader failing to compile throws without leaking them.
+	const ShaderFile &vertShader = _loadShaderFile(vertShaderPath);
+	const std::vector<char> *fragShaderCode = nullptr;
+	const ShaderReflection *fragShaderReflection = nullptr;
+	if (fragmentShader && !key.depthOnly) {
+		fragShaderCode = &fragmentShader->getCode();
+		fragShaderReflection = &fragmentShader->getReflection();
+	} else if (!key.depthOnly) {
+		const ShaderFile &fragShader = _loadShaderFile("shaders/frag.spv");
+		fragShaderCode = &fragShader.code;
+		fragShaderReflection = &fragShader.reflection;
+	}
+
+	VertexInputDescription vertexInput = vertexInputDescription(
+		key.vertexFormat, key.depthOnly ? VertexStreams::Position : VertexStreams::All);
+	checkShaderInterface(vertShader.reflection, vertexInput);
+	if (fragShaderReflection) {
+		checkShaderInterface(*fragShaderReflection, vertexInput);
+	}
+
+	auto vertShaderModule = _device->createShaderModule(vertShader.code);
+	VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+	if (fragShaderCode) {
+		fragShaderModule = _device->createShaderModule(*fragShaderCode);
+	}
+
+	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertShaderStageInfo.module = vertShaderModule;
+	vertShaderStageInfo.pName = "main";
+
+	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fragShaderStageInfo.module = fragShaderModule;
+	fragShaderStageInfo.pName = fragmentShader ? fragmentShader->getFunction().c_str() : "main";
+
+	VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInput.bindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInput.attributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	// Viewport and scissor are dynamic states, only their count is part of the pipeline.
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_FALSE;
+	rasterizer.depthBiasConstantFactor = 0.0f;
+	rasterizer.depthBiasClamp = 0.0f;
+	rasterizer.depthBiasSlopeFactor = 0.0f;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.minSampleShading = 1.0f;
+	multisampling.pSampleMask = nullptr;
+	multisampling.alphaToCoverageEnable = VK_FALSE;
+	multisampling.alphaToOneEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask =
+		key.depthOnly ? 0
+					  : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+							VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = key.depthOnly ? VK_FALSE : VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+	colorBlending.blendConstants[0] = 0.0f;
+	colorBlending.blendConstants[1] = 0.0f;
+	colorBlending.blendConstants[2] = 0.0f;
+	colorBlending.blendConstants[3] = 0.0f;
+
+	// Set 0 is the frame uniforms bound once per command buffer, set 1 holds the material textures.
+	// Set 2 holds the objects of indirect draws, an empty set 1 fills the gap for materials without textures.
+	std::vector<VkDescriptorSetLayout> setLayouts = {_frameSetLayout};
+	if (key.materialSetLayout != VK_NULL_HANDLE) {
+		setLayouts.push_back(key.materialSetLayout);
+	} else if (key.objectSetLayout != VK_NULL_HANDLE) {
+		setLayouts.push_back(_emptySetLayout);
+	}
+	if (key.objectSetLayout != VK_NULL_HANDLE) {
+		setLayouts.push_back(key.objectSetLayout);
+	}
+
+	VkPipelineLayout pipelineLayout = _getPipelineLayout(setLayouts);
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = key.depthOnly ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_LESS_OR_EQUAL;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.minDepthBounds = 0.0f;
+	depthStencil.maxDepthBounds = 1.0f;
+	depthStencil.stencilTestEnable = VK_FALSE;
+	depthStencil.front = {};
+	depthStencil.back = {};
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = key.depthOnly ? 1 : 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicStateCreateInfo;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.renderPass = _renderPass->getRenderPass();
+	pipelineInfo.subpass = 0;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result =
+		vkCreateGraphicsPipelines(_device->getDevice(), _vkPipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+
+	vkDestroyShaderModule(_device->getDevice(), vertShaderModule, nullptr);
+	vkDestroyShaderModule(_device->getDevice(), fragShaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create graphics pipeline");
+	}
+
+	graphicPipeline.pipeline = pipeline;
+	graphicPipeline.pipelineLayout = pipelineLayout;
+	graphicPipeline.ready.store(true, std::memory_order_release);
+}
+
+void PipelineCache::_destroyGraphicPipelines() {
+	for (auto &[key, graphicPipeline] : _pipelines) {
+		vkDestroyPipeline(_device->getDevice(), graphicPipeline->pipeline, nullptr);
+	}
+	_pipelines.clear();
+}
+
+void PipelineCache::_recordPipeline(const PipelineKey &key, const ShaderVariant *fragmentShader) {
+	// Inline and compiled shaders cannot be compiled again from the manifest.
+	if (_manifestPath.empty() || (fragmentShader && !fragmentShader->getSource().has_value())) {
+		return;
+	}
+	std::ostringstream line;
+	line << static_cast<uint32_t>(key.vertexFormat) << '\t' << (key.depthOnly ? 1 : 0) << '\t'
+		 << _serializeSetLayout(key.materialSetLayout) << '\t' << _serializeSetLayout(key.objectSetLayout) << '\t';
+	if (fragmentShader) {
+		line << ShaderCompiler::serializeSource(*fragmentShader->getSource());
+	}
+	if (_manifestEntries.insert(line.str()).second) {
+		std::ofstream file(_manifestPath, std::ios::app);
+		file << line.str() << '\n';
+	}
+}
+
+std::string PipelineCache::_serializeSetLayout(VkDescriptorSetLayout setLayout) const {
+	// The layouts are recorded by their bindings, the handles change between runs.
+	const std::vector<VkDescriptorSetLayoutBinding> *bindings =
+		setLayout != VK_NULL_HANDLE ? _layoutCache->findBindings(setLayout) : nullptr;
+	if (!bindings) {
+		return "-";
+	}
+	std::ostringstream field;
+	for (size_t i = 0; i < bindings->size(); ++i) {
+		const VkDescriptorSetLayoutBinding &binding = (*bindings)[i];
+		field << (i == 0 ? "" : ",") << binding.binding << ':' << static_cast<uint32_t>(binding.descriptorType) << ':'
+			  << binding.descriptorCount << ':' << binding.stageFlags;
+	}
+	return field.str();
+}
+
+VkDescriptorSetLayout PipelineCache::_parseSetLayout(const std::string &field) {
+	if (field == "-") {
+		return VK_NULL_HANDLE;
+	}
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	std::istringstream stream(field);
+	std::string entry;
+	while (std::getline(stream, entry, ',')) {
+		std::vector<std::optional<uint32_t>> values;
+		std::istringstream entryStream(entry);
+		std::string value;
+		while (std::getline(entryStream, value, ':')) {
+			values.push_back(parseNumber(value));
+		}
+		if (values.size() != 4 || std::find(values.begin(), values.end(), std::nullopt) != values.end()) {
+			throw std::runtime_error("Failed to parse the bindings of a recorded pipeline");
+		}
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = *values[0];
+		binding.descriptorType = static_cast<VkDescriptorType>(*values[1]);
+		binding.descriptorCount = *values[2];
+		binding.stageFlags = *values[3];
+		bindings.push_back(binding);
+	}
+	// The cache returns the layout of the same bindings, the one the scene will request.
+	return _layoutCache->getLayout(bindings);
+}
+
+VkPipelineLayout PipelineCache::_getPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts) {
+	std::unique_lock<std::mutex> lock(_layoutMutex);
+	auto it = _pipelineLayouts.find(setLayouts);
+	if (it != _pipelineLayouts.end()) {
+		return it->second;
+	}
+
+	VkPushConstantRange pushConstantRange = FrameUniformBuffer::getPushConstantRange();
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	if (vkCreatePipelineLayout(_device->getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline layout");
+	}
+	_pipelineLayouts.emplace(setLayouts, pipelineLayout);
+	return pipelineLayout;
+}
+
+void PipelineCache::_destroyPipelineLayouts() {
+	for (auto &[setLayouts, pipelineLayout] : _pipelineLayouts) {
+		vkDestroyPipelineLayout(_device->getDevice(), pipelineLayout, nullptr);
+	}
+	_pipelineLayouts.clear();
+}
+
+const PipelineCache::ShaderFile &PipelineCache::_loadShaderFile(const std::string &path) {
+	auto it = _shaderFiles.find(path);
+	if (it != _shaderFiles.end()) {
+		return it->second;
+	}
+
+	ShaderFile shaderFile;
+	shaderFile.code = Utils::readBinaryFile(path);
+	shaderFile.reflection = reflectShader(shaderFile.code);
+	return _shaderFiles.emplace(path, std::move(shaderFile)).first->second;
+}
+
+void PipelineCache::_createVkPipelineCache() {
+	// A missing, stale or foreign file only costs the compilation of the pipelines, the cache then starts empty.
+	std::vector<char> data;
+	std::error_code error;
+	if (!_cacheFile.empty() && std::filesystem::is_regular_file(_cacheFile, error)) {
+		try {
+			data = Utils::readBinaryFile(_cacheFile);
+		} catch (const std::exception &) {
+			data.clear();
+		}
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(_device->getPhysicalDevice(), &properties);
+		if (!isCompatibleCacheData(data, properties)) {
+			data.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(_device->getDevice(), &cacheInfo, nullptr, &_vkPipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline cache");
+	}
+}
+
+void PipelineCache::_saveVkPipelineCache() const {
+	if (_cacheFile.empty() || _vkPipelineCache == VK_NULL_HANDLE) {
+		return;
+	}
+
+	size_t size = 0;
+	if (vkGetPipelineCacheData(_device->getDevice(), _vkPipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+		return;
+	}
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(_device->getDevice(), _vkPipelineCache, &size, data.data()) != VK_SUCCESS) {
+		return;
+	}
+	data.resize(size);
+
+	// Written aside then renamed, an interrupted run never leaves a truncated cache behind.
+	std::string temporaryPath = _cacheFile + ".tmp";
+	try {
+		Utils::writeFile(temporaryPath, data);
+		std::filesystem::rename(temporaryPath, _cacheFile);
+	} catch (const std::exception &e) {
+		std::error_code error;
+		std::filesystem::remove(temporaryPath, error);
+		std::cerr << "Failed to save pipeline cache: " << e.what() << std::endl;
+	}
+}
+
+void PipelineCache::_destroyVkPipelineCache() {
+	vkDestroyPipelineCache(_device->getDevice(), _vkPipelineCache, nullptr);
+	_vkPipelineCache = VK_NULL_HANDLE;
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,212 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "Scene/Vertex.hpp"
+#include "ShaderReflection.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone {
+class ThreadPool;
+} // namespace Stone
+
+namespace Stone::Render::Vulkan {
+
+class DescriptorLayoutCache;
+class Device;
+class RenderPass;
+class ShaderCompiler;
+class ShaderVariant;
+
+/**
+ * A graphics pipeline with its layout, owned by the PipelineCache. The layout is shared by the pipelines of the same
+ * descriptor set layouts.
+ *
+ * The handles are written by a worker thread of the renderer, they are only read once the pipeline is ready.
+ */
+struct GraphicPipeline {
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	uint32_t id = 0; /**< Request index, used to group the draws of the same pipeline in the render queue. */
+	std::atomic<bool> ready = false;
+
+	/** Whether the pipeline is created. A pipeline failing to be created is never ready. */
+	[[nodiscard]] bool isReady() const {
+		return ready.load(std::memory_order_acquire);
+	}
+};
+
+/**
+ * Renderer wide cache of the mesh pipelines, keyed by the layouts of their material and object sets, by the vertex
+ * format of the meshes they draw and by the fragment shader of their material.
+ *
+ * Set 0 of every pipeline is the frame uniforms layout, so switching between them keeps the frame set bound.
+ * Pipelines with an object set read the model matrices from a storage buffer at set 2 instead of push constants,
+ * indexed by the instance index of indirect draws.
+ *
+ * Depth pipelines only read the position stream and write no color, they lay the depth of the opaque draws before
+ * shading them. Every vertex shader computes the positions the same invariant way, so the shading pipelines test the
+ * depth with LESS_OR_EQUAL and only shade the visible fragments.
+ *
+ * The shaders are reflected once: the vertex inputs they read must be provided by the vertex format and their push
+ * constants must fit in the range of the renderer. The pipeline layouts are cached by their set layouts, the set
+ * layouts of the materials being themselves reflected and cached, so identical shaders share their pipeline layouts.
+ *
+ * The pipelines are created one at a time on the thread pool of the renderer, their shaders compiled first, so that a
+ * new material never stalls the frame: its nodes are not drawn until their pipelines are ready. A manifest records the
+ * keys of the pipelines created in a run, the next run creates them ahead of time, before the scene requests them.
+ *
+ * Every pipeline is created through a driver pipeline cache, read from a file at startup and written back to it on
+ * destruction, so that the next run skips the compilation of the pipelines it already created.
+ */
+class PipelineCache {
+public:
+	PipelineCache() = delete;
+	/**
+	 * @param threadPool The pool of the renderer, running the creation of the pipelines between its other tasks.
+	 * @param cacheFile The file keeping the driver pipeline cache between runs, created when missing. Empty to only
+	 * keep the cache for the run.
+	 */
+	PipelineCache(const std::shared_ptr<Device> &device, const std::shared_ptr<RenderPass> &renderPass,
+				  const std::shared_ptr<DescriptorLayoutCache> &layoutCache,
+				  const std::shared_ptr<ShaderCompiler> &shaderCompiler, const std::shared_ptr<ThreadPool> &threadPool,
+				  VkDescriptorSetLayout frameSetLayout, std::string cacheFile = {});
+	PipelineCache(const PipelineCache &) = delete;
+
+	virtual ~PipelineCache();
+
+	/**
+	 * Returns the pipeline drawing meshes with the given layouts, starting its creation on first request.
+	 *
+	 * @param materialSetLayout The layout of set 1, VK_NULL_HANDLE for materials without textures.
+	 * @param objectSetLayout The layout of set 2 holding the objects, VK_NULL_HANDLE for push constant draws.
+	 * @param vertexFormat The layout of the vertex buffers, the compact formats use the packed vertex shaders.
+	 * @param fragmentShader The variant of the fragment shader of the material, null for the default shader. A new
+	 * pipeline waits for its compilation on the thread pool.
+	 * @return The cached pipeline, not ready until the thread pool created it.
+	 */
+	[[nodiscard]] const GraphicPipeline &getPipeline(VkDescriptorSetLayout materialSetLayout,
+													 VkDescriptorSetLayout objectSetLayout = VK_NULL_HANDLE,
+													 Scene::VertexFormat vertexFormat = Scene::VertexFormat::Float,
+													 const std::shared_ptr<ShaderVariant> &fragmentShader = nullptr);
+
+	/**
+	 * Returns the pipeline writing the depth of meshes with the given vertex format, starting its creation on first
+	 * request.
+	 *
+	 * @param objectSetLayout The layout of set 2 holding the objects, VK_NULL_HANDLE for push constant draws.
+	 * @param vertexFormat The layout of the vertex buffers, only their position stream is read.
+	 * @return The cached pipeline, not ready until the thread pool created it.
+	 */
+	[[nodiscard]] const GraphicPipeline &getDepthPipeline(VkDescriptorSetLayout objectSetLayout,
+														  Scene::VertexFormat vertexFormat);
+
+	/**
+	 * Starts the creation of the pipelines listed in a manifest, then records the new pipelines into it.
+	 * Only the pipelines of the default fragment shader or of a shader file are recorded, inline shaders are not
+	 * known before the scene is loaded.
+	 *
+	 * @param path The manifest file, created with the first pipeline recorded when missing.
+	 * @return The number of pipelines listed in the manifest.
+	 */
+	size_t loadManifest(const std::string &path);
+
+	/** Waits for the thread pool to create the requested pipelines. */
+	void waitIdle();
+
+	[[nodiscard]] size_t getPipelineCount() const {
+		return _pipelines.size();
+	}
+
+	[[nodiscard]] size_t getPipelineLayoutCount() const {
+		std::unique_lock<std::mutex> lock(_layoutMutex);
+		return _pipelineLayouts.size();
+	}
+
+private:
+	struct PipelineKey {
+		VkDescriptorSetLayout materialSetLayout;
+		VkDescriptorSetLayout objectSetLayout;
+		Scene::VertexFormat vertexFormat;
+		bool depthOnly;
+		uint64_t fragmentShaderKey; /**< The key of the shader variant, 0 for the default fragment shader. */
+
+		bool operator==(const PipelineKey &other) const;
+	};
+
+	struct PipelineKeyHash {
+		size_t operator()(const PipelineKey &key) const;
+	};
+
+	struct SetLayoutsHash {
+		size_t operator()(const std::vector<VkDescriptorSetLayout> &setLayouts) const;
+	};
+
+	/** The SPIR-V of a shader of the renderer, read and reflected once. */
+	struct ShaderFile {
+		std::vector<char> code;
+		ShaderReflection reflection;
+	};
+
+	[[nodiscard]] const GraphicPipeline &_requestPipeline(const PipelineKey &key,
+														  const std::shared_ptr<ShaderVariant> &fragmentShader);
+	void _createGraphicPipeline(const PipelineKey &key, const ShaderVariant *fragmentShader,
+								GraphicPipeline &graphicPipeline);
+	void _destroyGraphicPipelines();
+
+	void _scheduleJob(std::function<void()> job);
+	void _runNextJob();
+
+	void _recordPipeline(const PipelineKey &key, const ShaderVariant *fragmentShader);
+	[[nodiscard]] std::string _serializeSetLayout(VkDescriptorSetLayout setLayout) const;
+	[[nodiscard]] VkDescriptorSetLayout _parseSetLayout(const std::string &field);
+
+	[[nodiscard]] VkPipelineLayout _getPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts);
+	void _destroyPipelineLayouts();
+
+	[[nodiscard]] const ShaderFile &_loadShaderFile(const std::string &path);
+
+	void _createVkPipelineCache();
+	void _saveVkPipelineCache() const;
+	void _destroyVkPipelineCache();
+
+	std::shared_ptr<Device> _device;
+	std::shared_ptr<RenderPass> _renderPass;
+	std::shared_ptr<DescriptorLayoutCache> _layoutCache;
+	std::shared_ptr<ShaderCompiler> _shaderCompiler;
+	VkDescriptorSetLayout _frameSetLayout;
+	VkDescriptorSetLayout _emptySetLayout;
+
+	std::string _cacheFile;
+	VkPipelineCache _vkPipelineCache = VK_NULL_HANDLE;
+
+	/** Only modified on the rendering thread, the nodes keep the addresses of its pipelines. */
+	std::unordered_map<PipelineKey, std::unique_ptr<GraphicPipeline>, PipelineKeyHash> _pipelines;
+
+	mutable std::mutex _layoutMutex;
+	std::unordered_map<std::vector<VkDescriptorSetLayout>, VkPipelineLayout, SetLayoutsHash> _pipelineLayouts;
+	std::unordered_map<std::string, ShaderFile> _shaderFiles; /**< Only read by the running job. */
+
+	std::shared_ptr<ThreadPool> _threadPool;
+	std::mutex _jobMutex;
+	std::condition_variable _idleCondition;
+	std::deque<std::function<void()>> _jobs; /**< The pipelines waiting to be created, in request order. */
+	bool _jobScheduled = false;				 /**< Whether a task of the pool runs the next job. */
+	std::atomic<bool> _stopping = false;	 /**< Drops the pending pipelines on destruction. */
+
+	std::string _manifestPath;
+	std::unordered_set<std::string> _manifestEntries; /**< The lines of the manifest. */
+};
+
+} // namespace Stone::Render::Vulkan
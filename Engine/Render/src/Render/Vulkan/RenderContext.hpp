@@ -8,10 +8,30 @@
 
 namespace Stone::Render::Vulkan {
 
+class GpuSkinning;
+class LightClusters;
+class RenderQueue;
+class ShadowMaps;
+
+/**
+ * The image a frame is rendered into, from the swap chain or from the offscreen target.
+ */
+struct ImageContext {
+	uint32_t index;
+	VkImage image;
+	VkImageView imageView;
+	VkFramebuffer framebuffer;
+};
+
 struct RenderContext : public Scene::RenderContext {
 	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
 	VkExtent2D extent = {};
 	uint32_t imageIndex = 0;
+	uint32_t frameIndex = 0;
+	RenderQueue *renderQueue = nullptr; /**< Collects the draws emitted by the traversal. */
+	GpuSkinning *skinning = nullptr;	/**< Collects the skin meshes to pose before the draws. */
+	LightClusters *lights = nullptr;	/**< Collects the lights shading the draws. */
+	ShadowMaps *shadows = nullptr;		/**< Collects the shadow maps of the casting lights. */
 };
 
 } // namespace Stone::Render::Vulkan
@@ -5,10 +5,12 @@
 #include "Device.hpp"
 
 #include <stdexcept>
+#include <vector>
 
 namespace Stone::Render::Vulkan {
 
-RenderPass::RenderPass(const std::shared_ptr<Device> &device, VkFormat format) : _device(device), _format(format) {
+RenderPass::RenderPass(const std::shared_ptr<Device> &device, VkFormat format, VkImageLayout finalLayout)
+	: _device(device), _format(format), _finalLayout(finalLayout) {
 	_createRenderPass();
 }
 
@@ -29,7 +31,7 @@ void RenderPass::_createRenderPass() {
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.finalLayout = _finalLayout;
 
 	VkAttachmentReference colorAttachmentRef = {};
 	colorAttachmentRef.attachment = 0;
@@ -65,6 +67,19 @@ void RenderPass::_createRenderPass() {
 		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+	std::vector<VkSubpassDependency> dependencies = {dependency};
+	if (_finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+		// Makes the color writes available to the copies recorded after the render pass.
+		VkSubpassDependency copyDependency = {};
+		copyDependency.srcSubpass = 0;
+		copyDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		copyDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		copyDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		copyDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		copyDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		dependencies.push_back(copyDependency);
+	}
+
 	std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
 	VkRenderPassCreateInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -72,8 +87,8 @@ void RenderPass::_createRenderPass() {
 	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
 
 	if (vkCreateRenderPass(_device->getDevice(), &renderPassInfo, nullptr, &_renderPass) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create render pass");
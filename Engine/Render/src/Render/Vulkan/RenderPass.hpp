@@ -12,7 +12,14 @@ class Device;
 class RenderPass {
 public:
 	RenderPass() = delete;
-	RenderPass(const std::shared_ptr<Device> &device, VkFormat format);
+	/**
+	 * @param device The device owning the render pass.
+	 * @param format The format of the color attachment.
+	 * @param finalLayout The layout of the color attachment once rendered, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL makes
+	 * the image ready to be copied.
+	 */
+	RenderPass(const std::shared_ptr<Device> &device, VkFormat format,
+			   VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 	RenderPass(const RenderPass &) = delete;
 
 	virtual ~RenderPass();
@@ -33,6 +40,7 @@ private:
 
 	VkRenderPass _renderPass = VK_NULL_HANDLE;
 	VkFormat _format = VK_FORMAT_UNDEFINED;
+	VkImageLayout _finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 };
 
 } // namespace Stone::Render::Vulkan
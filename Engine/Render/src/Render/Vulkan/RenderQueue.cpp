@@ -0,0 +1,49 @@
+// Copyright 2024 Stone-Engine
+
+#include "RenderQueue.hpp"
+
+#include "Utils/RadixSort.hpp"
+
+#include <cstring>
+
+namespace Stone::Render::Vulkan {
+
+constexpr uint64_t depthBits = 20;
+constexpr uint64_t meshBits = 16;
+constexpr uint64_t materialBits = 16;
+constexpr uint64_t pipelineBits = 10;
+
+void RenderQueue::clear() {
+	_drawItems.clear();
+	_entries.clear();
+}
+
+void RenderQueue::push(uint64_t sortKey, const MeshNode *meshNode, const glm::mat4 &modelMatrix) {
+	_entries.push_back({sortKey, static_cast<uint32_t>(_drawItems.size())});
+	_drawItems.push_back({meshNode, modelMatrix});
+}
+
+void RenderQueue::sort() {
+	radixSort(_entries, _sortScratch, [](const SortEntry &entry) { return entry.sortKey; });
+}
+
+uint64_t RenderQueue::makeSortKey(DrawPass pass, uint32_t pipelineId, uint32_t materialId, uint32_t meshId,
+								  float viewDepth) {
+	// The bits of a positive float increase with its value, the top ones are enough to order the draws.
+	uint32_t depthFloatBits = 0;
+	float clampedDepth = viewDepth > 0.0f ? viewDepth : 0.0f;
+	std::memcpy(&depthFloatBits, &clampedDepth, sizeof(depthFloatBits));
+	uint64_t depth = depthFloatBits >> (31 - depthBits);
+	if (pass == DrawPass::Transparent) {
+		depth = ((1ull << depthBits) - 1) - depth;
+	}
+
+	uint64_t key = static_cast<uint64_t>(pass);
+	key = (key << pipelineBits) | (pipelineId & ((1ull << pipelineBits) - 1));
+	key = (key << materialBits) | (materialId & ((1ull << materialBits) - 1));
+	key = (key << meshBits) | (meshId & ((1ull << meshBits) - 1));
+	key = (key << depthBits) | depth;
+	return key;
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,119 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class Material;
+class Mesh;
+class MeshNode;
+
+/**
+ * The passes of the render queue, in drawing order. They occupy the most significant bits of the sort keys.
+ */
+enum class DrawPass : uint8_t {
+	Opaque = 0,		 /**< Sorted by state then front to back to limit overdraw. */
+	Transparent = 1, /**< Sorted back to front for blending. */
+};
+
+/**
+ * A draw collected during the scene traversal, recorded later into a command buffer.
+ */
+struct DrawItem {
+	const MeshNode *meshNode = nullptr;
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+};
+
+/**
+ * The state last bound in a command buffer, used to skip redundant binds between consecutive draws.
+ */
+struct BoundDrawState {
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	const Material *material = nullptr;
+	const Mesh *mesh = nullptr;
+};
+
+/**
+ * Draws of a frame ordered by 64-bit sort keys.
+ *
+ * The key packs, from the most significant bits: the pass (2 bits), the pipeline (10 bits), the material (16 bits),
+ * the mesh (16 bits) and the quantized view depth (20 bits). Sorting the keys groups the draws sharing states and
+ * orders them by depth inside a group. Identifiers wider than their field only degrade the grouping.
+ *
+ * The storage is kept between frames, so a cleared queue does not allocate once it reached its peak size.
+ */
+class RenderQueue {
+public:
+	RenderQueue() = default;
+	RenderQueue(const RenderQueue &) = delete;
+
+	virtual ~RenderQueue() = default;
+
+	/** Removes the draws of the previous frame, keeping the storage. */
+	void clear();
+
+	/**
+	 * Adds a draw to the queue.
+	 *
+	 * @param sortKey The key built with makeSortKey.
+	 * @param meshNode The node recording the draw.
+	 * @param modelMatrix The world matrix of the node.
+	 */
+	void push(uint64_t sortKey, const MeshNode *meshNode, const glm::mat4 &modelMatrix);
+
+	/** Orders the draws by their keys, draws with the same key keep their submission order. */
+	void sort();
+
+	[[nodiscard]] size_t size() const {
+		return _drawItems.size();
+	}
+
+	/**
+	 * Returns the draw at the given position, in key order once sorted.
+	 *
+	 * @param index The position of the draw in the queue.
+	 * @return The draw.
+	 */
+	[[nodiscard]] const DrawItem &getDrawItem(size_t index) const {
+		return _drawItems[_entries[index].itemIndex];
+	}
+
+	/**
+	 * Returns the pass of the draw at the given position, read from its sort key.
+	 *
+	 * @param index The position of the draw in the queue.
+	 * @return The pass of the draw.
+	 */
+	[[nodiscard]] DrawPass getDrawPass(size_t index) const {
+		return static_cast<DrawPass>(_entries[index].sortKey >> 62);
+	}
+
+	/**
+	 * Builds the sort key of a draw.
+	 *
+	 * @param pass The pass of the draw.
+	 * @param pipelineId The identifier of the pipeline.
+	 * @param materialId The identifier of the material.
+	 * @param meshId The identifier of the mesh.
+	 * @param viewDepth The distance between the camera and the draw.
+	 * @return The sort key.
+	 */
+	[[nodiscard]] static uint64_t makeSortKey(DrawPass pass, uint32_t pipelineId, uint32_t materialId, uint32_t meshId,
+											  float viewDepth);
+
+private:
+	struct SortEntry {
+		uint64_t sortKey;
+		uint32_t itemIndex;
+	};
+
+	std::vector<DrawItem> _drawItems;
+	std::vector<SortEntry> _entries;
+	std::vector<SortEntry> _sortScratch;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -4,15 +4,23 @@
 
 #include "Device.hpp"
 #include "Render/Vulkan/VulkanRenderer.hpp"
+#include "Scene/Node/LightNode.hpp"
+#include "Scene/Node/LodMeshNode.hpp"
 #include "Scene/Node/MeshNode.hpp"
+#include "Scene/Node/SkinMeshNode.hpp"
 #include "Scene/Renderable/Material.hpp"
 #include "Scene/Renderable/Mesh.hpp"
 #include "Scene/Renderable/Shader.hpp"
+#include "Scene/Renderable/SkinMesh.hpp"
 #include "Scene/Renderable/Texture.hpp"
+#include "VulkanRenderable/LightNode.hpp"
+#include "VulkanRenderable/LodMeshNode.hpp"
 #include "VulkanRenderable/Material.hpp"
 #include "VulkanRenderable/Mesh.hpp"
 #include "VulkanRenderable/MeshNode.hpp"
 #include "VulkanRenderable/Shader.hpp"
+#include "VulkanRenderable/SkinMesh.hpp"
+#include "VulkanRenderable/SkinMeshNode.hpp"
 #include "VulkanRenderable/Texture.hpp"
 
 namespace Stone::Render::Vulkan {
@@ -24,7 +32,9 @@ RendererObjectManager::RendererObjectManager(const std::shared_ptr<VulkanRendere
 void RendererObjectManager::updateMeshNode(const std::shared_ptr<Scene::MeshNode> &meshNode) {
 	Scene::RendererObjectManager::updateMeshNode(meshNode);
 
-	if (meshNode->getRendererObject<Vulkan::MeshNode>()) {
+	// The renderer object is kept, only the static flag of the node is read again.
+	if (auto existingMeshNode = meshNode->getRendererObject<Vulkan::MeshNode>()) {
+		existingMeshNode->setStatic(meshNode->isStatic());
 		return;
 	}
 
@@ -32,10 +42,85 @@ void RendererObjectManager::updateMeshNode(const std::shared_ptr<Scene::MeshNode
 	setRendererObjectTo(meshNode.get(), newMeshNode);
 }
 
+void RendererObjectManager::updateLodMeshNode(const std::shared_ptr<Scene::LodMeshNode> &lodMeshNode) {
+	Scene::RendererObjectManager::updateLodMeshNode(lodMeshNode);
+
+	if (auto existingLodMeshNode = lodMeshNode->getRendererObject<Vulkan::LodMeshNode>()) {
+		existingLodMeshNode->setStatic(lodMeshNode->isStatic());
+		return;
+	}
+
+	auto newLodMeshNode = std::make_shared<Vulkan::LodMeshNode>(lodMeshNode, _renderer);
+	setRendererObjectTo(lodMeshNode.get(), newLodMeshNode);
+}
+
+void RendererObjectManager::updateSkinMeshNode(const std::shared_ptr<Scene::SkinMeshNode> &skinMeshNode) {
+	Scene::RendererObjectManager::updateSkinMeshNode(skinMeshNode);
+
+	if (skinMeshNode->getRendererObject<Vulkan::SkinMeshNode>()) {
+		return;
+	}
+
+	auto newSkinMeshNode = std::make_shared<Vulkan::SkinMeshNode>(skinMeshNode, _renderer);
+	setRendererObjectTo(skinMeshNode.get(), newSkinMeshNode);
+}
+
+void RendererObjectManager::updateAmbientLightNode(const std::shared_ptr<Scene::AmbientLightNode> &ambientLightNode) {
+	Scene::RendererObjectManager::updateAmbientLightNode(ambientLightNode);
+
+	// The light is dirty when its properties changed, they are copied again into the existing light.
+	if (auto lightNode = ambientLightNode->getRendererObject<Vulkan::LightNode>()) {
+		lightNode->update(ambientLightNode);
+		return;
+	}
+
+	auto newLightNode = std::make_shared<Vulkan::LightNode>(ambientLightNode);
+	setRendererObjectTo(ambientLightNode.get(), newLightNode);
+}
+
+void RendererObjectManager::updatePointLightNode(const std::shared_ptr<Scene::PointLightNode> &pointLightNode) {
+	Scene::RendererObjectManager::updatePointLightNode(pointLightNode);
+
+	if (auto lightNode = pointLightNode->getRendererObject<Vulkan::LightNode>()) {
+		lightNode->update(pointLightNode);
+		return;
+	}
+
+	auto newLightNode = std::make_shared<Vulkan::LightNode>(pointLightNode);
+	setRendererObjectTo(pointLightNode.get(), newLightNode);
+}
+
+void RendererObjectManager::updateSpotLightNode(const std::shared_ptr<Scene::SpotLightNode> &spotLightNode) {
+	Scene::RendererObjectManager::updateSpotLightNode(spotLightNode);
+
+	if (auto lightNode = spotLightNode->getRendererObject<Vulkan::LightNode>()) {
+		lightNode->update(spotLightNode);
+		return;
+	}
+
+	auto newLightNode = std::make_shared<Vulkan::LightNode>(spotLightNode);
+	setRendererObjectTo(spotLightNode.get(), newLightNode);
+}
+
+void RendererObjectManager::updateDirectionalLightNode(
+	const std::shared_ptr<Scene::DirectionalLightNode> &directionalLightNode) {
+	Scene::RendererObjectManager::updateDirectionalLightNode(directionalLightNode);
+
+	if (auto lightNode = directionalLightNode->getRendererObject<Vulkan::LightNode>()) {
+		lightNode->update(directionalLightNode);
+		return;
+	}
+
+	auto newLightNode = std::make_shared<Vulkan::LightNode>(directionalLightNode);
+	setRendererObjectTo(directionalLightNode.get(), newLightNode);
+}
+
 void RendererObjectManager::updateMaterial(const std::shared_ptr<Scene::Material> &material) {
 	Scene::RendererObjectManager::updateMaterial(material);
 
-	if (material->getRendererObject<Vulkan::Material>()) {
+	// A keyword toggled selects another variant, the material is built again in place for every node sharing it.
+	if (auto existingMaterial = material->getRendererObject<Vulkan::Material>()) {
+		existingMaterial->update(material);
 		return;
 	}
 
@@ -44,16 +129,50 @@ void RendererObjectManager::updateMaterial(const std::shared_ptr<Scene::Material
 }
 
 void RendererObjectManager::updateDynamicMesh(const std::shared_ptr<Scene::DynamicMesh> &mesh) {
+	// The dirty vertex ranges are read before the base update clears them.
+	if (auto existingMesh = mesh->getRendererObject<Vulkan::Mesh>()) {
+		existingMesh->update(mesh);
+	} else {
+		auto newMesh = std::make_shared<Vulkan::Mesh>(mesh, _renderer);
+		setRendererObjectTo(mesh.get(), newMesh);
+	}
+
 	Scene::RendererObjectManager::updateDynamicMesh(mesh);
+}
 
-	if (mesh->getRendererObject<Vulkan::Mesh>()) {
+void RendererObjectManager::updateStaticMesh(const std::shared_ptr<Scene::StaticMesh> &mesh) {
+	Scene::RendererObjectManager::updateStaticMesh(mesh);
+
+	if (mesh->getRendererObject<Vulkan::Mesh>() || mesh->getSourceMesh() == nullptr) {
 		return;
 	}
 
-	auto newMesh = std::make_shared<Vulkan::Mesh>(mesh, _renderer);
+	auto newMesh = std::make_shared<Vulkan::Mesh>(mesh->getSourceMesh(), _renderer);
 	setRendererObjectTo(mesh.get(), newMesh);
 }
 
+void RendererObjectManager::updateDynamicSkinMesh(const std::shared_ptr<Scene::DynamicSkinMesh> &skinmesh) {
+	Scene::RendererObjectManager::updateDynamicSkinMesh(skinmesh);
+
+	if (skinmesh->getRendererObject<Vulkan::SkinMesh>()) {
+		return;
+	}
+
+	auto newSkinMesh = std::make_shared<Vulkan::SkinMesh>(skinmesh, _renderer);
+	setRendererObjectTo(skinmesh.get(), newSkinMesh);
+}
+
+void RendererObjectManager::updateStaticSkinMesh(const std::shared_ptr<Scene::StaticSkinMesh> &skinmesh) {
+	Scene::RendererObjectManager::updateStaticSkinMesh(skinmesh);
+
+	if (skinmesh->getRendererObject<Vulkan::SkinMesh>() || skinmesh->getSourceMesh() == nullptr) {
+		return;
+	}
+
+	auto newSkinMesh = std::make_shared<Vulkan::SkinMesh>(skinmesh->getSourceMesh(), _renderer);
+	setRendererObjectTo(skinmesh.get(), newSkinMesh);
+}
+
 void RendererObjectManager::updateTexture(const std::shared_ptr<Scene::Texture> &texture) {
 	Scene::RendererObjectManager::updateTexture(texture);
 
@@ -22,13 +22,27 @@ public:
 
 	// void updateInstancedMeshNode(const std::shared_ptr<Scene::InstancedMeshNode> &instancedMeshNode) override;
 
-	// void updateSkinMeshNode(const std::shared_ptr<Scene::SkinMeshNode> &skinMeshNode) override;
+	void updateLodMeshNode(const std::shared_ptr<Scene::LodMeshNode> &lodMeshNode) override;
+
+	void updateSkinMeshNode(const std::shared_ptr<Scene::SkinMeshNode> &skinMeshNode) override;
+
+	void updateAmbientLightNode(const std::shared_ptr<Scene::AmbientLightNode> &ambientLightNode) override;
+
+	void updatePointLightNode(const std::shared_ptr<Scene::PointLightNode> &pointLightNode) override;
+
+	void updateSpotLightNode(const std::shared_ptr<Scene::SpotLightNode> &spotLightNode) override;
+
+	void updateDirectionalLightNode(const std::shared_ptr<Scene::DirectionalLightNode> &directionalLightNode) override;
 
 	void updateMaterial(const std::shared_ptr<Scene::Material> &material) override;
 
 	void updateDynamicMesh(const std::shared_ptr<Scene::DynamicMesh> &mesh) override;
 
-	// void updateSkinMesh(const std::shared_ptr<Scene::SkinMesh> &skinmesh) override;
+	void updateStaticMesh(const std::shared_ptr<Scene::StaticMesh> &mesh) override;
+
+	void updateDynamicSkinMesh(const std::shared_ptr<Scene::DynamicSkinMesh> &skinmesh) override;
+
+	void updateStaticSkinMesh(const std::shared_ptr<Scene::StaticSkinMesh> &skinmesh) override;
 
 	void updateTexture(const std::shared_ptr<Scene::Texture> &texture) override;
 
@@ -0,0 +1,74 @@
+// Copyright 2024 Stone-Engine
+
+#include "SecondaryCommandBuffers.hpp"
+
+#include "Device.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+SecondaryCommandBuffers::SecondaryCommandBuffers(const std::shared_ptr<Device> &device, uint32_t frameCount,
+												 uint32_t slotCount)
+	: _device(device), _frameCount(frameCount), _slotCount(slotCount) {
+	_createCommandPools();
+}
+
+SecondaryCommandBuffers::~SecondaryCommandBuffers() {
+	_destroyCommandPools();
+}
+
+void SecondaryCommandBuffers::reset(uint32_t frameIndex) {
+	assert(frameIndex < _frameCount);
+	for (uint32_t slot = 0; slot < _slotCount; ++slot) {
+		vkResetCommandPool(_device->getDevice(), _commandPools[frameIndex * _slotCount + slot], 0);
+	}
+}
+
+VkCommandBuffer SecondaryCommandBuffers::getCommandBuffer(uint32_t frameIndex, uint32_t slotIndex) const {
+	assert(frameIndex < _frameCount && slotIndex < _slotCount);
+	return _commandBuffers[frameIndex * _slotCount + slotIndex];
+}
+
+
+/** Command Pools */
+
+void SecondaryCommandBuffers::_createCommandPools() {
+	_commandPools.resize(static_cast<size_t>(_frameCount) * _slotCount, VK_NULL_HANDLE);
+	_commandBuffers.resize(_commandPools.size(), VK_NULL_HANDLE);
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = _device->getGraphicsQueueFamily();
+
+	for (size_t i = 0; i < _commandPools.size(); ++i) {
+		if (vkCreateCommandPool(_device->getDevice(), &poolInfo, nullptr, &_commandPools[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create secondary command pool");
+		}
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = _commandPools[i];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(_device->getDevice(), &allocInfo, &_commandBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate secondary command buffer");
+		}
+	}
+}
+
+void SecondaryCommandBuffers::_destroyCommandPools() {
+	// Destroying a pool frees the buffers allocated from it.
+	for (VkCommandPool commandPool : _commandPools) {
+		if (commandPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(_device->getDevice(), commandPool, nullptr);
+		}
+	}
+	_commandPools.clear();
+	_commandBuffers.clear();
+}
+
+} // namespace Stone::Render::Vulkan
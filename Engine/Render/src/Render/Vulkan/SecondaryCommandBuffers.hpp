@@ -0,0 +1,52 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class Device;
+
+/**
+ * Secondary command buffers used to record a frame from several threads.
+ *
+ * Each frame in flight owns one command pool per recording slot. A thread recording a slot is the only one touching
+ * its pool, and all the buffers of a frame are recycled with one pool reset once the frame fence is signaled.
+ */
+class SecondaryCommandBuffers {
+public:
+	SecondaryCommandBuffers() = delete;
+	SecondaryCommandBuffers(const std::shared_ptr<Device> &device, uint32_t frameCount, uint32_t slotCount);
+	SecondaryCommandBuffers(const SecondaryCommandBuffers &) = delete;
+
+	virtual ~SecondaryCommandBuffers();
+
+	/**
+	 * Resets every command buffer of the frame. The frame must not be in use by the GPU anymore.
+	 *
+	 * @param frameIndex The frame in flight to reset.
+	 */
+	void reset(uint32_t frameIndex);
+
+	[[nodiscard]] VkCommandBuffer getCommandBuffer(uint32_t frameIndex, uint32_t slotIndex) const;
+
+	[[nodiscard]] uint32_t getSlotCount() const {
+		return _slotCount;
+	}
+
+private:
+	void _createCommandPools();
+	void _destroyCommandPools();
+
+	std::shared_ptr<Device> _device;
+	uint32_t _frameCount;
+	uint32_t _slotCount;
+
+	std::vector<VkCommandPool> _commandPools = {};	   /**< One pool per frame and slot. */
+	std::vector<VkCommandBuffer> _commandBuffers = {}; /**< One buffer allocated from each pool. */
+};
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,387 @@
+// Copyright 2024 Stone-Engine
+
+#include "ShaderCompiler.hpp"
+
+#include "Utils/FileSystem.hpp"
+#include "Utils/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <shaderc/shaderc.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace Stone::Render::Vulkan {
+
+/** Changed with the compile options, invalidating the shaders cached by previous versions. */
+constexpr uint64_t cacheFormatVersion = 1;
+
+/** The first word of every SPIR-V module. */
+constexpr uint32_t spirvMagicNumber = 0x07230203;
+
+namespace {
+
+struct Fnv1a {
+	uint64_t hash = 14695981039346656037ull;
+
+	void mix(const void *data, size_t size) {
+		const auto *bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+
+	void mix(const std::string &text) {
+		uint64_t size = text.size();
+		mix(&size, sizeof(size));
+		mix(text.data(), text.size());
+	}
+};
+
+/** Finds the include directives of a code, quoted or not, including the ones disabled by the preprocessor. */
+std::vector<std::pair<std::string, bool>> findIncludes(const std::string &code) {
+	std::vector<std::pair<std::string, bool>> includes;
+	std::istringstream stream(code);
+	std::string line;
+	while (std::getline(stream, line)) {
+		size_t i = line.find_first_not_of(" \t");
+		if (i == std::string::npos || line[i] != '#') {
+			continue;
+		}
+		i = line.find_first_not_of(" \t", i + 1);
+		if (i == std::string::npos || line.compare(i, 7, "include") != 0) {
+			continue;
+		}
+		i = line.find_first_not_of(" \t", i + 7);
+		if (i == std::string::npos || (line[i] != '"' && line[i] != '<')) {
+			continue;
+		}
+		bool relative = line[i] == '"';
+		size_t end = line.find(relative ? '"' : '>', i + 1);
+		if (end != std::string::npos) {
+			includes.emplace_back(line.substr(i + 1, end - i - 1), relative);
+		}
+	}
+	return includes;
+}
+
+/** Gives shaderc the files included by a shader, found like the cache key finds them. */
+class FileIncluder : public shaderc::CompileOptions::IncluderInterface {
+public:
+	explicit FileIncluder(const ShaderCompiler &compiler) : _compiler(compiler) {
+	}
+
+	shaderc_include_result *GetInclude(const char *requestedSource, shaderc_include_type type,
+									   const char *requestingSource, size_t includeDepth) override {
+		(void)includeDepth;
+		auto include = std::make_unique<Include>();
+		include->path = _compiler.resolveInclude(requestedSource, requestingSource,
+												  type == shaderc_include_type_relative);
+		// An empty source name reports the content as the error.
+		if (include->path.empty()) {
+			include->content = "Failed to find the included file " + std::string(requestedSource);
+		} else {
+			include->content = Utils::readTextFile(include->path);
+		}
+		include->result.source_name = include->path.c_str();
+		include->result.source_name_length = include->path.size();
+		include->result.content = include->content.c_str();
+		include->result.content_length = include->content.size();
+		include->result.user_data = include.get();
+		return &include.release()->result;
+	}
+
+	void ReleaseInclude(shaderc_include_result *data) override {
+		delete static_cast<Include *>(data->user_data);
+	}
+
+private:
+	struct Include {
+		std::string path;
+		std::string content;
+		shaderc_include_result result = {};
+	};
+
+	const ShaderCompiler &_compiler;
+};
+
+shaderc_shader_kind shaderKind(const std::optional<VkShaderStageFlagBits> &stage) {
+	if (!stage.has_value()) {
+		return shaderc_glsl_infer_from_source;
+	}
+	switch (*stage) {
+	case VK_SHADER_STAGE_VERTEX_BIT: return shaderc_glsl_vertex_shader;
+	case VK_SHADER_STAGE_FRAGMENT_BIT: return shaderc_glsl_fragment_shader;
+	case VK_SHADER_STAGE_COMPUTE_BIT: return shaderc_glsl_compute_shader;
+	case VK_SHADER_STAGE_GEOMETRY_BIT: return shaderc_glsl_geometry_shader;
+	case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT: return shaderc_glsl_tess_control_shader;
+	case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT: return shaderc_glsl_tess_evaluation_shader;
+	default: throw std::runtime_error("Unsupported shader stage");
+	}
+}
+
+bool isSpirv(const std::vector<char> &code) {
+	uint32_t magicNumber = 0;
+	if (code.size() < sizeof(magicNumber) || code.size() % sizeof(uint32_t) != 0) {
+		return false;
+	}
+	std::memcpy(&magicNumber, code.data(), sizeof(magicNumber));
+	return magicNumber == spirvMagicNumber;
+}
+
+} // namespace
+
+ShaderCompiler::ShaderCompiler(std::string cacheDirectory, std::vector<std::string> includeDirectories,
+							   std::shared_ptr<ThreadPool> threadPool)
+	: _cacheDirectory(std::move(cacheDirectory)), _includeDirectories(std::move(includeDirectories)),
+	  _threadPool(std::move(threadPool)) {
+	// Without its directory the cache is disabled, every shader is then compiled.
+	if (!_cacheDirectory.empty()) {
+		std::error_code error;
+		std::filesystem::create_directories(_cacheDirectory, error);
+		if (error) {
+			_cacheDirectory.clear();
+		}
+	}
+}
+
+ShaderCompiler::~ShaderCompiler() {
+	// The pending jobs are run before the compiler they use is destroyed, so that no future is left without a value.
+	_threadPool->waitIdle();
+}
+
+std::shared_future<std::vector<char>> ShaderCompiler::compileAsync(ShaderSource source) {
+	auto task = std::make_shared<std::packaged_task<std::vector<char>()>>(
+		[this, source = std::move(source)]() { return compile(source); });
+	std::shared_future<std::vector<char>> future = task->get_future().share();
+	_threadPool->submit([task]() { (*task)(); });
+	return future;
+}
+
+std::vector<char> ShaderCompiler::compile(const ShaderSource &source) const {
+	std::vector<char> code = _readOrCompile(source);
+	_recordVariant(source);
+	return code;
+}
+
+std::vector<char> ShaderCompiler::_readOrCompile(const ShaderSource &source) const {
+	ShaderSource loadedSource = source;
+	if (loadedSource.code.empty() && !loadedSource.path.empty()) {
+		loadedSource.code = Utils::readTextFile(loadedSource.path);
+	}
+
+	std::string cachePath;
+	if (!_cacheDirectory.empty()) {
+		cachePath = _cachePath(computeCacheKey(loadedSource));
+		std::error_code error;
+		if (std::filesystem::is_regular_file(cachePath, error)) {
+			std::vector<char> code = Utils::readBinaryFile(cachePath);
+			if (isSpirv(code)) {
+				++_cachedCount;
+				return code;
+			}
+		}
+	}
+
+	std::vector<char> code = _compileGlsl(loadedSource);
+	++_compiledCount;
+
+	// The file is written aside then renamed, the other threads never read a partial entry. The cache only saves
+	// time, a shader failing to be written is compiled again the next time.
+	if (!cachePath.empty()) {
+		std::ostringstream temporaryPath;
+		temporaryPath << cachePath << '.' << std::this_thread::get_id() << ".tmp";
+		try {
+			Utils::writeFile(temporaryPath.str(), code);
+			std::filesystem::rename(temporaryPath.str(), cachePath);
+		} catch (const std::exception &) {
+			std::error_code error;
+			std::filesystem::remove(temporaryPath.str(), error);
+		}
+	}
+
+	return code;
+}
+
+uint64_t ShaderCompiler::computeCacheKey(const ShaderSource &source) const {
+	std::string code = source.code;
+	if (code.empty() && !source.path.empty()) {
+		code = Utils::readTextFile(source.path);
+	}
+
+	Fnv1a hash;
+	hash.mix(&cacheFormatVersion, sizeof(cacheFormatVersion));
+	uint32_t stage = source.stage.has_value() ? static_cast<uint32_t>(*source.stage) : 0;
+	hash.mix(&stage, sizeof(stage));
+	hash.mix(source.entryPoint);
+	for (const auto &[name, value] : source.defines) {
+		hash.mix(name);
+		hash.mix(value);
+	}
+	hash.mix(code);
+
+	// The includes are hashed in the order they are met, each file once.
+	std::unordered_set<std::string> visited;
+	std::function<void(const std::string &, const std::string &)> mixIncludes = [&](const std::string &includingCode,
+																					 const std::string &includingPath) {
+		for (const auto &[requested, relative] : findIncludes(includingCode)) {
+			std::string path = resolveInclude(requested, includingPath, relative);
+			hash.mix(path.empty() ? requested : path);
+			if (path.empty() || !visited.insert(path).second) {
+				continue;
+			}
+			std::string includedCode = Utils::readTextFile(path);
+			hash.mix(includedCode);
+			mixIncludes(includedCode, path);
+		}
+	};
+	mixIncludes(code, source.path);
+
+	return hash.hash;
+}
+
+size_t ShaderCompiler::loadManifest(const std::string &path) {
+	std::vector<ShaderSource> sources;
+	{
+		std::unique_lock<std::mutex> lock(_manifestMutex);
+		_manifestPath = path;
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line)) {
+			std::optional<ShaderSource> source = parseSource(line);
+			if (source.has_value() && _manifestEntries.insert(line).second) {
+				sources.push_back(std::move(*source));
+			}
+		}
+	}
+
+	// A variant of a removed or broken shader stays in the manifest, it is skipped until the manifest is deleted.
+	size_t count = sources.size();
+	for (ShaderSource &source : sources) {
+		_threadPool->submit([this, source = std::move(source)]() {
+			try {
+				(void)_readOrCompile(source);
+			} catch (const std::exception &) {
+			}
+		});
+	}
+	return count;
+}
+
+uint64_t ShaderCompiler::computeSourceKey(const ShaderSource &source) {
+	Fnv1a hash;
+	hash.mix(&cacheFormatVersion, sizeof(cacheFormatVersion));
+	hash.mix(serializeSource(source));
+	hash.mix(source.code);
+	return hash.hash;
+}
+
+std::string ShaderCompiler::serializeSource(const ShaderSource &source) {
+	std::ostringstream line;
+	line << source.path << '\t' << source.entryPoint << '\t';
+	if (source.stage.has_value()) {
+		line << static_cast<uint32_t>(*source.stage);
+	}
+	line << '\t';
+	for (size_t i = 0; i < source.defines.size(); ++i) {
+		line << (i == 0 ? "" : " ") << source.defines[i].first << '=' << source.defines[i].second;
+	}
+	return line.str();
+}
+
+std::optional<ShaderSource> ShaderCompiler::parseSource(const std::string &line) {
+	std::istringstream stream(line);
+	std::string stage;
+	std::string defines;
+	ShaderSource source;
+	if (!std::getline(stream, source.path, '\t') || !std::getline(stream, source.entryPoint, '\t') ||
+		!std::getline(stream, stage, '\t') || source.path.empty()) {
+		return std::nullopt;
+	}
+	std::getline(stream, defines);
+	if (!stage.empty()) {
+		if (stage.find_first_not_of("0123456789") != std::string::npos) {
+			return std::nullopt;
+		}
+		source.stage = static_cast<VkShaderStageFlagBits>(std::stoul(stage));
+	}
+	std::istringstream definesStream(defines);
+	std::string define;
+	while (definesStream >> define) {
+		size_t separator = define.find('=');
+		source.defines.emplace_back(define.substr(0, separator),
+									separator == std::string::npos ? "" : define.substr(separator + 1));
+	}
+	return source;
+}
+
+std::string ShaderCompiler::resolveInclude(const std::string &requested, const std::string &requesting,
+										   bool relative) const {
+	std::error_code error;
+	if (relative) {
+		std::filesystem::path candidate = std::filesystem::path(requesting).parent_path() / requested;
+		if (std::filesystem::is_regular_file(candidate, error)) {
+			return candidate.lexically_normal().string();
+		}
+	}
+	for (const std::string &directory : _includeDirectories) {
+		std::filesystem::path candidate = std::filesystem::path(directory) / requested;
+		if (std::filesystem::is_regular_file(candidate, error)) {
+			return candidate.lexically_normal().string();
+		}
+	}
+	return {};
+}
+
+std::vector<char> ShaderCompiler::_compileGlsl(const ShaderSource &source) const {
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	options.SetIncluder(std::make_unique<FileIncluder>(*this));
+	for (const auto &[name, value] : source.defines) {
+		options.AddMacroDefinition(name, value);
+	}
+
+	std::string sourceName = source.path.empty() ? "inline" : source.path;
+	shaderc::Compiler compiler;
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(
+		source.code, shaderKind(source.stage), sourceName.c_str(), source.entryPoint.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+		throw std::runtime_error("Failed to compile shader " + sourceName + ": " + result.GetErrorMessage());
+	}
+
+	std::vector<char> code(static_cast<size_t>(result.cend() - result.cbegin()) * sizeof(uint32_t));
+	std::memcpy(code.data(), result.cbegin(), code.size());
+	return code;
+}
+
+void ShaderCompiler::_recordVariant(const ShaderSource &source) const {
+	// Inline code cannot be compiled again from the manifest.
+	if (source.path.empty()) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(_manifestMutex);
+	if (_manifestPath.empty()) {
+		return;
+	}
+	std::string line = serializeSource(source);
+	if (_manifestEntries.insert(line).second) {
+		std::ofstream file(_manifestPath, std::ios::app);
+		file << line << '\n';
+	}
+}
+
+std::string ShaderCompiler::_cachePath(uint64_t key) const {
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << key << ".spv";
+	return (std::filesystem::path(_cacheDirectory) / name.str()).string();
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,166 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone {
+class ThreadPool;
+} // namespace Stone
+
+namespace Stone::Render::Vulkan {
+
+/**
+ * A GLSL shader to compile into SPIR-V.
+ */
+struct ShaderSource {
+	std::string code; /**< The GLSL code, read from the path when empty. */
+	std::string path; /**< The file of the code, the base of its relative includes. Empty for inline code. */
+	std::string entryPoint = "main";
+	/** The stage of the shader, taken from a `#pragma shader_stage` of the code when empty. */
+	std::optional<VkShaderStageFlagBits> stage;
+	std::vector<std::pair<std::string, std::string>> defines; /**< Macros defined before the code, name and value. */
+};
+
+/**
+ * Compiles GLSL shaders into SPIR-V with shaderc, on the thread pool of the renderer, and caches the results on disk.
+ *
+ * A compiled shader is stored in the cache directory under a hash of everything its SPIR-V depends on: the code, the
+ * content of every file it includes, its defines, stage and entry point. Finding its hash in the cache, a shader is
+ * read back without being compiled, so a warm start does not compile any shader. Editing a shader or one of its
+ * includes changes its hash, the stale entries are left in the cache.
+ *
+ * The includes are looked for next to the including file for the quoted ones, then in the include directories.
+ *
+ * A manifest lists the variants compiled from files, the shaders with their defines. The variants it lists are
+ * compiled into the cache at startup, and the ones it misses are added to it as they are compiled. Shipped with the
+ * cache directory, the manifest of a build has every variant it uses read from the cache, none compiled at runtime.
+ */
+class ShaderCompiler {
+public:
+	ShaderCompiler() = delete;
+
+	/**
+	 * @param cacheDirectory The directory storing the compiled shaders, created when missing. Empty to disable the
+	 * cache.
+	 * @param includeDirectories The directories searched for the included files.
+	 * @param threadPool The pool compiling the shaders, a pool without worker threads compiles them when requested.
+	 */
+	ShaderCompiler(std::string cacheDirectory, std::vector<std::string> includeDirectories,
+				   std::shared_ptr<ThreadPool> threadPool);
+	ShaderCompiler(const ShaderCompiler &) = delete;
+
+	virtual ~ShaderCompiler();
+
+	/**
+	 * Compiles a shader on the thread pool, or reads it from the cache.
+	 *
+	 * @param source The shader to compile.
+	 * @return The future SPIR-V of the shader, holding the compilation error when it failed.
+	 */
+	[[nodiscard]] std::shared_future<std::vector<char>> compileAsync(ShaderSource source);
+
+	/**
+	 * Compiles a shader on the calling thread, or reads it from the cache.
+	 *
+	 * @param source The shader to compile.
+	 * @return The SPIR-V of the shader.
+	 * @throws std::runtime_error When the shader fails to compile.
+	 */
+	[[nodiscard]] std::vector<char> compile(const ShaderSource &source) const;
+
+	/**
+	 * Hashes everything the SPIR-V of a shader depends on, naming its entry in the cache.
+	 *
+	 * @param source The shader, with its code.
+	 * @return The hash of the code, of its includes, defines, stage and entry point.
+	 */
+	[[nodiscard]] uint64_t computeCacheKey(const ShaderSource &source) const;
+
+	/**
+	 * Compiles the variants listed in a manifest on the thread pool, then records the new variants into it.
+	 *
+	 * @param path The manifest file, created with the first variant recorded when missing.
+	 * @return The number of variants listed in the manifest.
+	 */
+	size_t loadManifest(const std::string &path);
+
+	/**
+	 * Hashes the description of a shader without reading its files: its path, inline code, defines, stage and entry
+	 * point. Stable between runs, it identifies a variant before it is compiled.
+	 *
+	 * @param source The shader.
+	 * @return The hash of the description.
+	 */
+	[[nodiscard]] static uint64_t computeSourceKey(const ShaderSource &source);
+
+	/**
+	 * Writes the description of a shader compiled from a file on a single line: its path, entry point, stage and
+	 * defines, separated by tabulations.
+	 *
+	 * @param source The shader, read from a file.
+	 * @return The line describing the shader.
+	 */
+	[[nodiscard]] static std::string serializeSource(const ShaderSource &source);
+
+	/**
+	 * Reads the description of a shader written by serializeSource.
+	 *
+	 * @param line The line describing the shader.
+	 * @return The shader, without code, or nothing when the line is malformed.
+	 */
+	[[nodiscard]] static std::optional<ShaderSource> parseSource(const std::string &line);
+
+	/** Returns the number of shaders compiled by shaderc since the creation of the compiler. */
+	[[nodiscard]] size_t getCompiledCount() const {
+		return _compiledCount;
+	}
+
+	/** Returns the number of shaders read from the cache since the creation of the compiler. */
+	[[nodiscard]] size_t getCachedCount() const {
+		return _cachedCount;
+	}
+
+	/**
+	 * Finds an included file.
+	 *
+	 * @param requested The name of the include.
+	 * @param requesting The file including it, empty for inline code.
+	 * @param relative Whether the include is quoted, looked for next to the including file first.
+	 * @return The path of the included file, empty when it is not found.
+	 */
+	[[nodiscard]] std::string resolveInclude(const std::string &requested, const std::string &requesting,
+											 bool relative) const;
+
+private:
+	[[nodiscard]] std::vector<char> _readOrCompile(const ShaderSource &source) const;
+	[[nodiscard]] std::vector<char> _compileGlsl(const ShaderSource &source) const;
+
+	void _recordVariant(const ShaderSource &source) const;
+
+	[[nodiscard]] std::string _cachePath(uint64_t key) const;
+
+	std::string _cacheDirectory;
+	std::vector<std::string> _includeDirectories;
+
+	std::shared_ptr<ThreadPool> _threadPool;
+
+	mutable std::mutex _manifestMutex;
+	std::string _manifestPath;
+	mutable std::unordered_set<std::string> _manifestEntries; /**< The lines of the manifest. */
+
+	mutable std::atomic<size_t> _compiledCount = 0;
+	mutable std::atomic<size_t> _cachedCount = 0;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,436 @@
+// Copyright 2024 Stone-Engine
+
+#include "ShaderReflection.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Stone::Render::Vulkan {
+
+namespace {
+
+/** The first word of every SPIR-V module. */
+constexpr uint32_t spirvMagicNumber = 0x07230203;
+
+/** The words of the module header, before the first instruction. */
+constexpr size_t spirvHeaderSize = 5;
+
+/** The instructions read by the reflection, from the SPIR-V specification. */
+namespace SpirvOp {
+constexpr uint32_t Name = 5;
+constexpr uint32_t EntryPoint = 15;
+constexpr uint32_t TypeBool = 20;
+constexpr uint32_t TypeInt = 21;
+constexpr uint32_t TypeFloat = 22;
+constexpr uint32_t TypeVector = 23;
+constexpr uint32_t TypeMatrix = 24;
+constexpr uint32_t TypeImage = 25;
+constexpr uint32_t TypeSampler = 26;
+constexpr uint32_t TypeSampledImage = 27;
+constexpr uint32_t TypeArray = 28;
+constexpr uint32_t TypeRuntimeArray = 29;
+constexpr uint32_t TypeStruct = 30;
+constexpr uint32_t TypePointer = 32;
+constexpr uint32_t Constant = 43;
+constexpr uint32_t SpecConstant = 50;
+constexpr uint32_t Variable = 59;
+constexpr uint32_t Decorate = 71;
+constexpr uint32_t MemberDecorate = 72;
+} // namespace SpirvOp
+
+namespace SpirvDecoration {
+constexpr uint32_t BufferBlock = 3;
+constexpr uint32_t ArrayStride = 6;
+constexpr uint32_t MatrixStride = 7;
+constexpr uint32_t BuiltIn = 11;
+constexpr uint32_t Location = 30;
+constexpr uint32_t Binding = 33;
+constexpr uint32_t DescriptorSet = 34;
+constexpr uint32_t Offset = 35;
+} // namespace SpirvDecoration
+
+namespace SpirvStorageClass {
+constexpr uint32_t UniformConstant = 0;
+constexpr uint32_t Input = 1;
+constexpr uint32_t Uniform = 2;
+constexpr uint32_t PushConstant = 9;
+constexpr uint32_t StorageBuffer = 12;
+} // namespace SpirvStorageClass
+
+namespace SpirvDim {
+constexpr uint32_t Buffer = 5;
+constexpr uint32_t SubpassData = 6;
+} // namespace SpirvDim
+
+using Decorations = std::unordered_map<uint32_t, uint32_t>;
+
+/** The declarations of a module, indexed by their result id. */
+struct SpirvModule {
+	struct Variable {
+		uint32_t id;
+		uint32_t pointerType;
+		uint32_t storageClass;
+	};
+
+	std::optional<uint32_t> executionModel;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> types; /**< The operands of the type instructions. */
+	std::unordered_map<uint32_t, uint32_t> constants;		   /**< The first word of the constants. */
+	std::unordered_map<uint32_t, std::string> names;
+	std::unordered_map<uint32_t, Decorations> decorations;
+	std::unordered_map<uint32_t, std::unordered_map<uint32_t, Decorations>> memberDecorations;
+	std::vector<Variable> variables;
+
+	[[nodiscard]] const std::vector<uint32_t> &type(uint32_t id) const {
+		auto it = types.find(id);
+		if (it == types.end()) {
+			throw std::runtime_error("Failed to find a type of the SPIR-V module");
+		}
+		return it->second;
+	}
+
+	[[nodiscard]] std::optional<uint32_t> decoration(uint32_t id, uint32_t decoration) const {
+		auto it = decorations.find(id);
+		if (it == decorations.end()) {
+			return std::nullopt;
+		}
+		auto decorationIt = it->second.find(decoration);
+		if (decorationIt == it->second.end()) {
+			return std::nullopt;
+		}
+		return decorationIt->second;
+	}
+
+	[[nodiscard]] std::optional<uint32_t> memberDecoration(uint32_t id, uint32_t member, uint32_t decoration) const {
+		auto it = memberDecorations.find(id);
+		if (it == memberDecorations.end()) {
+			return std::nullopt;
+		}
+		auto memberIt = it->second.find(member);
+		if (memberIt == it->second.end()) {
+			return std::nullopt;
+		}
+		auto decorationIt = memberIt->second.find(decoration);
+		if (decorationIt == memberIt->second.end()) {
+			return std::nullopt;
+		}
+		return decorationIt->second;
+	}
+
+	[[nodiscard]] std::string name(uint32_t id) const {
+		auto it = names.find(id);
+		return it == names.end() ? std::string() : it->second;
+	}
+};
+
+/** The type instructions keep their opcode first, followed by their operands after the result id. */
+uint32_t typeOpcode(const std::vector<uint32_t> &type) {
+	return type[0];
+}
+
+std::string readString(const uint32_t *words, size_t wordCount) {
+	const char *text = reinterpret_cast<const char *>(words);
+	return std::string(text, strnlen(text, wordCount * sizeof(uint32_t)));
+}
+
+SpirvModule parseModule(const std::vector<char> &code) {
+	if (code.size() < spirvHeaderSize * sizeof(uint32_t) || code.size() % sizeof(uint32_t) != 0) {
+		throw std::runtime_error("Failed to reflect shader, the code is not SPIR-V");
+	}
+	std::vector<uint32_t> words(code.size() / sizeof(uint32_t));
+	std::memcpy(words.data(), code.data(), code.size());
+	if (words[0] != spirvMagicNumber) {
+		throw std::runtime_error("Failed to reflect shader, the code is not SPIR-V");
+	}
+
+	SpirvModule module;
+	for (size_t i = spirvHeaderSize; i < words.size();) {
+		uint32_t opcode = words[i] & 0xffff;
+		uint32_t wordCount = words[i] >> 16;
+		if (wordCount == 0 || i + wordCount > words.size()) {
+			throw std::runtime_error("Failed to reflect shader, the SPIR-V is truncated");
+		}
+		const uint32_t *operands = &words[i + 1];
+		uint32_t operandCount = wordCount - 1;
+
+		switch (opcode) {
+		case SpirvOp::Name:
+			if (operandCount >= 2) {
+				module.names[operands[0]] = readString(operands + 1, operandCount - 1);
+			}
+			break;
+		case SpirvOp::EntryPoint:
+			if (!module.executionModel.has_value() && operandCount >= 1) {
+				module.executionModel = operands[0];
+			}
+			break;
+		case SpirvOp::TypeBool:
+		case SpirvOp::TypeInt:
+		case SpirvOp::TypeFloat:
+		case SpirvOp::TypeVector:
+		case SpirvOp::TypeMatrix:
+		case SpirvOp::TypeImage:
+		case SpirvOp::TypeSampler:
+		case SpirvOp::TypeSampledImage:
+		case SpirvOp::TypeArray:
+		case SpirvOp::TypeRuntimeArray:
+		case SpirvOp::TypeStruct:
+		case SpirvOp::TypePointer: {
+			std::vector<uint32_t> type = {opcode};
+			type.insert(type.end(), operands + 1, operands + operandCount);
+			module.types[operands[0]] = std::move(type);
+			break;
+		}
+		case SpirvOp::Constant:
+		case SpirvOp::SpecConstant:
+			if (operandCount >= 3) {
+				module.constants[operands[1]] = operands[2];
+			}
+			break;
+		case SpirvOp::Variable:
+			if (operandCount >= 3) {
+				module.variables.push_back({operands[1], operands[0], operands[2]});
+			}
+			break;
+		case SpirvOp::Decorate:
+			if (operandCount >= 2) {
+				module.decorations[operands[0]][operands[1]] = operandCount >= 3 ? operands[2] : 0;
+			}
+			break;
+		case SpirvOp::MemberDecorate:
+			if (operandCount >= 3) {
+				module.memberDecorations[operands[0]][operands[1]][operands[2]] = operandCount >= 4 ? operands[3] : 0;
+			}
+			break;
+		default: break;
+		}
+		i += wordCount;
+	}
+	return module;
+}
+
+VkShaderStageFlagBits stageFromExecutionModel(uint32_t executionModel) {
+	switch (executionModel) {
+	case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+	case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+	case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+	case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+	case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+	case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+	default: throw std::runtime_error("Failed to reflect shader, unsupported execution model");
+	}
+}
+
+/** The bytes taken by a value of a type in a block, following the offsets and strides decorating it. */
+uint32_t typeSize(const SpirvModule &module, uint32_t typeId, uint32_t matrixStride = 0) {
+	const std::vector<uint32_t> &type = module.type(typeId);
+	switch (typeOpcode(type)) {
+	case SpirvOp::TypeBool: return 4;
+	case SpirvOp::TypeInt:
+	case SpirvOp::TypeFloat: return type[1] / 8;
+	case SpirvOp::TypeVector: return typeSize(module, type[1]) * type[2];
+	case SpirvOp::TypeMatrix: return (matrixStride != 0 ? matrixStride : typeSize(module, type[1])) * type[2];
+	case SpirvOp::TypeArray: {
+		uint32_t stride = module.decoration(typeId, SpirvDecoration::ArrayStride)
+							  .value_or(typeSize(module, type[1], matrixStride));
+		return stride * module.constants.at(type[2]);
+	}
+	case SpirvOp::TypeStruct: {
+		uint32_t size = 0;
+		for (uint32_t member = 0; member + 1 < type.size(); ++member) {
+			uint32_t offset = module.memberDecoration(typeId, member, SpirvDecoration::Offset).value_or(0);
+			uint32_t memberStride =
+				module.memberDecoration(typeId, member, SpirvDecoration::MatrixStride).value_or(0);
+			size = std::max(size, offset + typeSize(module, type[member + 1], memberStride));
+		}
+		return size;
+	}
+	default: return 0;
+	}
+}
+
+VkFormat vertexInputFormat(const SpirvModule &module, uint32_t typeId) {
+	const std::vector<uint32_t> *type = &module.type(typeId);
+	uint32_t componentCount = 1;
+	if (typeOpcode(*type) == SpirvOp::TypeVector) {
+		componentCount = (*type)[2];
+		type = &module.type((*type)[1]);
+	}
+	bool scalar = typeOpcode(*type) == SpirvOp::TypeFloat || typeOpcode(*type) == SpirvOp::TypeInt;
+	if (!scalar || (*type)[1] != 32 || componentCount < 1 || componentCount > 4) {
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	static constexpr VkFormat floatFormats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+												VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+	static constexpr VkFormat intFormats[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT,
+											  VK_FORMAT_R32G32B32A32_SINT};
+	static constexpr VkFormat uintFormats[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT,
+											   VK_FORMAT_R32G32B32A32_UINT};
+	if (typeOpcode(*type) == SpirvOp::TypeFloat) {
+		return floatFormats[componentCount - 1];
+	}
+	return (*type)[2] != 0 ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+}
+
+/** Finds the descriptor type of a variable, returns false for the types the renderer never binds. */
+bool descriptorType(const SpirvModule &module, uint32_t storageClass, uint32_t typeId, VkDescriptorType &result) {
+	const std::vector<uint32_t> &type = module.type(typeId);
+	if (storageClass == SpirvStorageClass::StorageBuffer) {
+		result = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		return true;
+	}
+	if (storageClass == SpirvStorageClass::Uniform) {
+		bool bufferBlock = module.decoration(typeId, SpirvDecoration::BufferBlock).has_value();
+		result = bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		return true;
+	}
+	switch (typeOpcode(type)) {
+	case SpirvOp::TypeSampledImage: result = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; return true;
+	case SpirvOp::TypeSampler: result = VK_DESCRIPTOR_TYPE_SAMPLER; return true;
+	case SpirvOp::TypeImage: {
+		// The operands of an image are its sampled type, dim, depth, arrayed, multisampled and sampled flags.
+		uint32_t dim = type[2];
+		uint32_t sampled = type[6];
+		if (dim == SpirvDim::SubpassData) {
+			result = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		} else if (dim == SpirvDim::Buffer) {
+			result = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+		} else {
+			result = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+		return true;
+	}
+	default: return false;
+	}
+}
+
+void reflectBinding(const SpirvModule &module, const SpirvModule::Variable &variable, ShaderReflection &reflection) {
+	std::optional<uint32_t> binding = module.decoration(variable.id, SpirvDecoration::Binding);
+	if (!binding.has_value()) {
+		return;
+	}
+
+	uint32_t typeId = module.type(variable.pointerType)[2];
+	uint32_t count = 1;
+	while (typeOpcode(module.type(typeId)) == SpirvOp::TypeArray) {
+		const std::vector<uint32_t> &array = module.type(typeId);
+		count *= module.constants.at(array[2]);
+		typeId = array[1];
+	}
+	if (typeOpcode(module.type(typeId)) == SpirvOp::TypeRuntimeArray) {
+		throw std::runtime_error("Failed to reflect shader, runtime arrays of descriptors are not supported");
+	}
+
+	ReflectedBinding reflected;
+	reflected.set = module.decoration(variable.id, SpirvDecoration::DescriptorSet).value_or(0);
+	reflected.binding = *binding;
+	reflected.descriptorCount = count;
+	if (!descriptorType(module, variable.storageClass, typeId, reflected.descriptorType)) {
+		return;
+	}
+	// A block declared without instance name only names its type.
+	reflected.name = module.name(variable.id);
+	if (reflected.name.empty()) {
+		reflected.name = module.name(typeId);
+	}
+	reflection.bindings.push_back(std::move(reflected));
+}
+
+void reflectPushConstants(const SpirvModule &module, const SpirvModule::Variable &variable,
+						  ShaderReflection &reflection) {
+	uint32_t typeId = module.type(variable.pointerType)[2];
+	const std::vector<uint32_t> &type = module.type(typeId);
+	if (typeOpcode(type) != SpirvOp::TypeStruct || type.size() < 2) {
+		return;
+	}
+
+	// The range starts at the first member, a block can leave the bytes of the previous stages unused.
+	uint32_t begin = UINT32_MAX;
+	for (uint32_t member = 0; member + 1 < type.size(); ++member) {
+		begin = std::min(begin, module.memberDecoration(typeId, member, SpirvDecoration::Offset).value_or(0));
+	}
+	uint32_t end = (typeSize(module, typeId) + 3) & ~3u;
+
+	VkPushConstantRange range = {};
+	range.stageFlags = reflection.stage;
+	range.offset = begin & ~3u;
+	range.size = end - range.offset;
+	reflection.pushConstants = range;
+}
+
+void reflectVertexInput(const SpirvModule &module, const SpirvModule::Variable &variable,
+						ShaderReflection &reflection) {
+	std::optional<uint32_t> location = module.decoration(variable.id, SpirvDecoration::Location);
+	if (!location.has_value() || module.decoration(variable.id, SpirvDecoration::BuiltIn).has_value()) {
+		return;
+	}
+
+	ReflectedVertexInput input;
+	input.location = *location;
+	input.format = vertexInputFormat(module, module.type(variable.pointerType)[2]);
+	input.name = module.name(variable.id);
+	reflection.vertexInputs.push_back(std::move(input));
+}
+
+} // namespace
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetBindings(uint32_t set) const {
+	std::vector<VkDescriptorSetLayoutBinding> setBindings;
+	for (const ReflectedBinding &reflected : bindings) {
+		if (reflected.set != set) {
+			continue;
+		}
+		VkDescriptorSetLayoutBinding layoutBinding = {};
+		layoutBinding.binding = reflected.binding;
+		layoutBinding.descriptorType = reflected.descriptorType;
+		layoutBinding.descriptorCount = reflected.descriptorCount;
+		layoutBinding.stageFlags = stage;
+		layoutBinding.pImmutableSamplers = nullptr;
+		setBindings.push_back(layoutBinding);
+	}
+	return setBindings;
+}
+
+const ReflectedBinding *ShaderReflection::findBinding(uint32_t set, const std::string &name) const {
+	auto it = std::find_if(bindings.begin(), bindings.end(), [&](const ReflectedBinding &reflected) {
+		return reflected.set == set && reflected.name == name;
+	});
+	return it == bindings.end() ? nullptr : &*it;
+}
+
+ShaderReflection reflectShader(const std::vector<char> &code) {
+	SpirvModule module = parseModule(code);
+	if (!module.executionModel.has_value()) {
+		throw std::runtime_error("Failed to reflect shader, the SPIR-V has no entry point");
+	}
+
+	ShaderReflection reflection;
+	reflection.stage = stageFromExecutionModel(*module.executionModel);
+
+	for (const SpirvModule::Variable &variable : module.variables) {
+		switch (variable.storageClass) {
+		case SpirvStorageClass::UniformConstant:
+		case SpirvStorageClass::Uniform:
+		case SpirvStorageClass::StorageBuffer: reflectBinding(module, variable, reflection); break;
+		case SpirvStorageClass::PushConstant: reflectPushConstants(module, variable, reflection); break;
+		case SpirvStorageClass::Input:
+			if (reflection.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+				reflectVertexInput(module, variable, reflection);
+			}
+			break;
+		default: break;
+		}
+	}
+
+	std::sort(reflection.bindings.begin(), reflection.bindings.end(),
+			  [](const ReflectedBinding &a, const ReflectedBinding &b) {
+				  return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+			  });
+	std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+			  [](const ReflectedVertexInput &a, const ReflectedVertexInput &b) { return a.location < b.location; });
+	return reflection;
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,70 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+/**
+ * A descriptor used by a shader.
+ * The buffers are reflected as non dynamic, the shader cannot tell how they are bound.
+ */
+struct ReflectedBinding {
+	uint32_t set = 0;
+	uint32_t binding = 0;
+	VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	uint32_t descriptorCount = 1;
+	std::string name; /**< The name of the variable, or of its block type. Empty for stripped SPIR-V. */
+};
+
+/**
+ * A vertex attribute read by a vertex shader, built-ins excluded.
+ */
+struct ReflectedVertexInput {
+	uint32_t location = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED; /**< The 32 bits format of the declared type. */
+	std::string name;
+};
+
+/**
+ * The interface of a SPIR-V module: its descriptors, push constants and vertex inputs.
+ */
+struct ShaderReflection {
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	std::vector<ReflectedBinding> bindings; /**< Sorted by set then binding. */
+	std::optional<VkPushConstantRange> pushConstants;
+	std::vector<ReflectedVertexInput> vertexInputs; /**< Sorted by location, empty for the other stages. */
+
+	/**
+	 * Returns the layout bindings of a set, visible to the stage of the shader.
+	 *
+	 * @param set The index of the set.
+	 * @return The bindings of the set, empty when the shader does not use it.
+	 */
+	[[nodiscard]] std::vector<VkDescriptorSetLayoutBinding> getSetBindings(uint32_t set) const;
+
+	/**
+	 * Finds a descriptor of a set by name.
+	 *
+	 * @param set The index of the set.
+	 * @param name The name of the variable.
+	 * @return The descriptor, null when the set has no descriptor of this name.
+	 */
+	[[nodiscard]] const ReflectedBinding *findBinding(uint32_t set, const std::string &name) const;
+};
+
+/**
+ * Reflects the interface of the first entry point of a SPIR-V module.
+ *
+ * @param code The SPIR-V module.
+ * @return The descriptors, push constants and vertex inputs of the module.
+ * @throws std::runtime_error When the code is not SPIR-V, or uses descriptors the renderer does not support.
+ */
+[[nodiscard]] ShaderReflection reflectShader(const std::vector<char> &code);
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,877 @@
+// Copyright 2024 Stone-Engine
+
+#include "ShadowMaps.hpp"
+
+#include "Device.hpp"
+#include "FrameUniformBuffer.hpp"
+#include "RenderQueue.hpp"
+#include "Scene/Node/LightNode.hpp"
+#include "Utilities/VertexBinding.hpp"
+#include "Utils/FileSystem.hpp"
+#include "VulkanRenderable/Mesh.hpp"
+#include "VulkanRenderable/MeshNode.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/matrix.hpp>
+#include <stdexcept>
+
+namespace Stone::Render::Vulkan {
+
+/** Width of the shadow atlas and of the static atlas, in texels. */
+constexpr uint32_t shadowAtlasSize = 4096;
+
+/** Smallest tile of the atlas, the requested sizes are rounded up to it. */
+constexpr uint32_t minShadowTileSize = 128;
+
+/** Most tiles of a frame, the requests past it get no shadow. */
+constexpr uint32_t maxShadowTiles = 64;
+
+namespace {
+
+void recordAtlasBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout,
+						VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+						VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+/** The planes of a frustum with a depth from 0 to 1, normalized to measure distances, pointing inward. */
+std::array<glm::vec4, 6> extractFrustumPlanes(const glm::mat4 &viewProjection) {
+	std::array<glm::vec4, 4> rows;
+	for (int row = 0; row < 4; ++row) {
+		rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row],
+							  viewProjection[3][row]);
+	}
+	std::array<glm::vec4, 6> planes = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+									   rows[3] - rows[1], rows[2],			 rows[3] - rows[2]};
+	for (glm::vec4 &plane : planes) {
+		plane = plane / glm::length(glm::vec3(plane));
+	}
+	return planes;
+}
+
+/** Identifies a static caster by its node and its transform, the hashes of the casters of a tile are summed. */
+uint64_t hashCaster(const DrawItem &drawItem) {
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](const void *data, size_t size) {
+		const auto *bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	mix(&drawItem.meshNode, sizeof(drawItem.meshNode));
+	mix(&drawItem.modelMatrix, sizeof(drawItem.modelMatrix));
+	return hash;
+}
+
+uint32_t roundTileSize(uint32_t size) {
+	return std::bit_ceil(std::clamp(size, minShadowTileSize, shadowAtlasSize / 2));
+}
+
+uint32_t blockLevel(uint32_t size) {
+	return static_cast<uint32_t>(std::countr_zero(shadowAtlasSize) - std::countr_zero(size));
+}
+
+} // namespace
+
+ShadowMaps::ShadowMaps(const std::shared_ptr<Device> &device,
+					   const std::shared_ptr<FrameUniformBuffer> &frameUniformBuffer, uint32_t frameCount)
+	: _device(device), _frameUniformBuffer(frameUniformBuffer), _frameCount(frameCount) {
+	_depthFormat = _device->findSupportedFormat(
+		{VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM}, VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+
+	_freeBlocks.resize(blockLevel(minShadowTileSize) + 1);
+	_freeBlocks[0].push_back(glm::uvec2(0));
+
+	_createAtlases();
+	_createRenderPass();
+	_createFramebuffers();
+	_createPipelines();
+	_createTileBuffer();
+	_createSampler();
+
+	_frameUniformBuffer->setShadowResources(_shadowAtlasView, _atlasSampler, _tileBuffer, _tileRegionSize);
+}
+
+ShadowMaps::~ShadowMaps() {
+	_destroySampler();
+	_destroyTileBuffer();
+	_destroyPipelines();
+	_destroyFramebuffers();
+	_destroyRenderPass();
+	_destroyAtlases();
+}
+
+void ShadowMaps::clear() {
+	_frameTileCount = 0;
+	for (auto &[owner, cachedShadow] : _cachedShadows) {
+		cachedShadow.requested = false;
+	}
+}
+
+int32_t ShadowMaps::requestMap(const void *owner, const glm::mat4 &viewProjection, uint32_t size) {
+	return _pushTiles(owner, roundTileSize(size), &viewProjection, 1);
+}
+
+int32_t ShadowMaps::requestCascades(const void *owner, const glm::mat4 &viewMatrix, const glm::mat4 &projMatrix,
+									const glm::vec3 &direction, const glm::vec2 &shadowRange, uint32_t size,
+									glm::vec4 &cascadeSplits) {
+	glm::mat4 inverseProjection = glm::inverse(projMatrix);
+	glm::vec4 nearPoint = inverseProjection * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	glm::vec4 farPoint = inverseProjection * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	float nearDistance = std::max(-nearPoint.z / nearPoint.w, shadowRange.x);
+	float farDistance = std::min(-farPoint.z / farPoint.w, shadowRange.y);
+	if (nearDistance <= 0.0f || farDistance <= nearDistance) {
+		return -1;
+	}
+
+	std::vector<float> splits =
+		Scene::DirectionalLightNode::computeCascadeSplits(nearDistance, farDistance, shadowCascadeCount);
+
+	glm::mat4 inverseView = glm::inverse(viewMatrix);
+	glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+	std::array<glm::mat4, shadowCascadeCount> viewProjections;
+	for (uint32_t cascade = 0; cascade < shadowCascadeCount; ++cascade) {
+		cascadeSplits[cascade] = splits[cascade + 1];
+
+		// The corners of the slice lie on the lines through the corners of the near and far planes of the camera.
+		std::array<glm::vec3, 8> corners;
+		glm::vec3 center(0.0f);
+		for (int corner = 0; corner < 4; ++corner) {
+			glm::vec2 ndc((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f);
+			glm::vec4 nearCorner = inverseProjection * glm::vec4(ndc, 0.0f, 1.0f);
+			glm::vec4 farCorner = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+			glm::vec3 a = glm::vec3(nearCorner) / nearCorner.w;
+			glm::vec3 b = glm::vec3(farCorner) / farCorner.w;
+			for (int end = 0; end < 2; ++end) {
+				float depth = splits[cascade + end];
+				glm::vec3 point = a + (b - a) * ((-depth - a.z) / (b.z - a.z));
+				corners[corner * 2 + end] = glm::vec3(inverseView * glm::vec4(point, 1.0f));
+				center += corners[corner * 2 + end] / 8.0f;
+			}
+		}
+
+		// The radius only depends on the projection of the camera, rounded up so that it stays the same every frame.
+		float radius = 0.0f;
+		for (const glm::vec3 &corner : corners) {
+			radius = std::max(radius, glm::length(corner - center));
+		}
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		// Snapped to a grid of a quarter of its half extent, the center moves by an eighth of the width of the cascade
+		// at most, which the extent leaves room for.
+		float halfExtent = radius * 8.0f / 7.0f;
+		float cell = halfExtent / 4.0f;
+		glm::vec3 lightCenter(lightRotation * glm::vec4(center, 1.0f));
+		glm::vec3 snapped = glm::floor(lightCenter / cell + 0.5f) * cell;
+
+		// The light looks along -z, the casters are looked for up to the far shadow distance toward the light.
+		glm::mat4 projection =
+			glm::ortho(snapped.x - halfExtent, snapped.x + halfExtent, snapped.y - halfExtent, snapped.y + halfExtent,
+					   -(snapped.z + halfExtent + shadowRange.y), -(snapped.z - halfExtent));
+		viewProjections[cascade] = projection * lightRotation;
+	}
+
+	return _pushTiles(owner, roundTileSize(size), viewProjections.data(), shadowCascadeCount);
+}
+
+void ShadowMaps::prepare(uint32_t frameIndex, const RenderQueue &renderQueue, const glm::mat4 &viewMatrix) {
+	assert(frameIndex < _frameCount);
+
+	_placeTiles();
+	_sortCasters(renderQueue);
+
+	glm::mat4 inverseView = glm::inverse(viewMatrix);
+	auto *gpuTiles = reinterpret_cast<GpuShadowTile *>(static_cast<char *>(_tileBufferMapped) +
+													   _tileRegionSize * frameIndex);
+	for (size_t i = 0; i < _frameTileCount; ++i) {
+		const FrameTile &tile = _frameTiles[i];
+		GpuShadowTile gpuTile;
+		gpuTile.matrix = tile.viewProjection * inverseView;
+		if (tile.allocated) {
+			gpuTile.rect = glm::vec4(glm::vec2(tile.offset), glm::vec2(static_cast<float>(tile.size))) /
+						   static_cast<float>(shadowAtlasSize);
+		}
+		gpuTiles[i] = gpuTile;
+	}
+}
+
+void ShadowMaps::record(VkCommandBuffer commandBuffer, const RenderQueue &renderQueue) const {
+	bool renderStatic = false;
+	bool copyStatic = false;
+	bool renderDynamic = false;
+	for (size_t i = 0; i < _frameTileCount; ++i) {
+		renderStatic = renderStatic || _frameTiles[i].renderStatic;
+		copyStatic = copyStatic || _frameTiles[i].copyStatic;
+		renderDynamic = renderDynamic || !_frameTiles[i].dynamicCasters.empty();
+	}
+
+	// Every rendered tile is copied, without any copy the shadow atlas is already up to date.
+	if (!copyStatic) {
+		return;
+	}
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = _renderPass;
+	renderPassInfo.renderArea.offset = {0, 0};
+	renderPassInfo.renderArea.extent = {shadowAtlasSize, shadowAtlasSize};
+	renderPassInfo.clearValueCount = 0;
+
+	if (renderStatic) {
+		renderPassInfo.framebuffer = _staticFramebuffer;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		for (size_t i = 0; i < _frameTileCount; ++i) {
+			const FrameTile &tile = _frameTiles[i];
+			if (!tile.renderStatic) {
+				continue;
+			}
+
+			VkClearAttachment clearAttachment = {};
+			clearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			clearAttachment.clearValue.depthStencil = {1.0f, 0};
+			VkClearRect clearRect = {};
+			clearRect.rect.offset = {static_cast<int32_t>(tile.offset.x), static_cast<int32_t>(tile.offset.y)};
+			clearRect.rect.extent = {tile.size, tile.size};
+			clearRect.baseArrayLayer = 0;
+			clearRect.layerCount = 1;
+			vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+
+			_recordCasters(commandBuffer, renderQueue, tile, tile.staticCasters);
+		}
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	// The previous frames may still sample the shadow atlas, it is only overwritten once their shading is done.
+	recordAtlasBarrier(commandBuffer, _staticAtlas, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+					   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					   VK_ACCESS_TRANSFER_READ_BIT);
+	recordAtlasBarrier(commandBuffer, _shadowAtlas, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+					   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+					   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	std::vector<VkImageCopy> regions;
+	for (size_t i = 0; i < _frameTileCount; ++i) {
+		const FrameTile &tile = _frameTiles[i];
+		if (!tile.copyStatic) {
+			continue;
+		}
+		VkImageCopy region = {};
+		region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+		region.srcOffset = {static_cast<int32_t>(tile.offset.x), static_cast<int32_t>(tile.offset.y), 0};
+		region.dstSubresource = region.srcSubresource;
+		region.dstOffset = region.srcOffset;
+		region.extent = {tile.size, tile.size, 1};
+		regions.push_back(region);
+	}
+	vkCmdCopyImage(commandBuffer, _staticAtlas, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _shadowAtlas,
+				   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	recordAtlasBarrier(commandBuffer, _staticAtlas, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+					   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+	recordAtlasBarrier(commandBuffer, _shadowAtlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					   VK_ACCESS_TRANSFER_WRITE_BIT,
+					   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+					   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+	// The dynamic casters are tested against the copied static depth.
+	if (renderDynamic) {
+		renderPassInfo.framebuffer = _shadowFramebuffer;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		for (size_t i = 0; i < _frameTileCount; ++i) {
+			const FrameTile &tile = _frameTiles[i];
+			if (!tile.dynamicCasters.empty()) {
+				_recordCasters(commandBuffer, renderQueue, tile, tile.dynamicCasters);
+			}
+		}
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	recordAtlasBarrier(commandBuffer, _shadowAtlas, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					   VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+					   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					   VK_ACCESS_SHADER_READ_BIT);
+}
+
+size_t ShadowMaps::getStaticRenderCount() const {
+	return static_cast<size_t>(std::count_if(_frameTiles.begin(), _frameTiles.begin() + _frameTileCount,
+											 [](const FrameTile &tile) { return tile.renderStatic; }));
+}
+
+int32_t ShadowMaps::_pushTiles(const void *owner, uint32_t size, const glm::mat4 *viewProjections, uint32_t count) {
+	if (_frameTileCount + count > maxShadowTiles) {
+		return -1;
+	}
+
+	// A light drawn twice in a frame would render both of its shadows in the same tiles, only the first one has some.
+	CachedShadow &cachedShadow = _cachedShadows[owner];
+	if (cachedShadow.requested) {
+		return -1;
+	}
+	cachedShadow.requested = true;
+
+	if (cachedShadow.size != size || cachedShadow.tiles.size() != count) {
+		for (const CachedTile &cachedTile : cachedShadow.tiles) {
+			if (cachedTile.allocated) {
+				_freeBlock(cachedShadow.size, cachedTile.offset);
+			}
+		}
+		cachedShadow.size = size;
+		cachedShadow.tiles.assign(count, CachedTile());
+	}
+
+	auto firstTile = static_cast<int32_t>(_frameTileCount);
+	if (_frameTiles.size() < _frameTileCount + count) {
+		_frameTiles.resize(_frameTileCount + count);
+	}
+	for (uint32_t i = 0; i < count; ++i) {
+		FrameTile &tile = _frameTiles[_frameTileCount++];
+		tile.owner = owner;
+		tile.index = i;
+		tile.size = size;
+		tile.viewProjection = viewProjections[i];
+	}
+	return firstTile;
+}
+
+void ShadowMaps::_placeTiles() {
+	// The lights that stopped requesting their shadows give their tiles back.
+	for (auto it = _cachedShadows.begin(); it != _cachedShadows.end();) {
+		if (it->second.requested) {
+			++it;
+			continue;
+		}
+		for (const CachedTile &cachedTile : it->second.tiles) {
+			if (cachedTile.allocated) {
+				_freeBlock(it->second.size, cachedTile.offset);
+			}
+		}
+		it = _cachedShadows.erase(it);
+	}
+
+	// The tiles the atlas had no room for are tried again every frame.
+	for (size_t i = 0; i < _frameTileCount; ++i) {
+		FrameTile &tile = _frameTiles[i];
+		CachedTile &cachedTile = _cachedShadows[tile.owner].tiles[tile.index];
+		if (!cachedTile.allocated) {
+			cachedTile.allocated = _allocateBlock(tile.size, cachedTile.offset);
+			cachedTile.staticValid = false;
+		}
+		tile.allocated = cachedTile.allocated;
+		tile.offset = cachedTile.offset;
+	}
+}
+
+void ShadowMaps::_sortCasters(const RenderQueue &renderQueue) {
+	std::vector<std::array<glm::vec4, 6>> tilePlanes(_frameTileCount);
+	std::vector<uint64_t> staticHashes(_frameTileCount, 0);
+	for (size_t i = 0; i < _frameTileCount; ++i) {
+		tilePlanes[i] = extractFrustumPlanes(_frameTiles[i].viewProjection);
+		_frameTiles[i].staticCasters.clear();
+		_frameTiles[i].dynamicCasters.clear();
+	}
+
+	for (size_t drawIndex = 0; drawIndex < renderQueue.size(); ++drawIndex) {
+		if (renderQueue.getDrawPass(drawIndex) != DrawPass::Opaque) {
+			continue;
+		}
+		const DrawItem &drawItem = renderQueue.getDrawItem(drawIndex);
+		const std::shared_ptr<Mesh> &mesh = drawItem.meshNode->getMesh();
+		if (mesh == nullptr) {
+			continue;
+		}
+
+		// The bounding sphere is stored in the space of the positions of the mesh, quantized ones included.
+		glm::mat4 modelMatrix = drawItem.modelMatrix * mesh->getPositionTransform();
+		const glm::vec4 &sphere = mesh->getBoundingSphere();
+		glm::vec3 center(modelMatrix * glm::vec4(glm::vec3(sphere), 1.0f));
+		float scale = std::max({glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])),
+								glm::length(glm::vec3(modelMatrix[2]))});
+		float radius = sphere.w * scale;
+
+		// A streamed mesh deforms while its node stays in place, its shadow is not cached.
+		bool isStatic = drawItem.meshNode->isStatic() && !mesh->isStreamed();
+		uint64_t hash = isStatic ? hashCaster(drawItem) : 0;
+		for (size_t i = 0; i < _frameTileCount; ++i) {
+			FrameTile &tile = _frameTiles[i];
+			if (!tile.allocated) {
+				continue;
+			}
+			bool visible = std::all_of(tilePlanes[i].begin(), tilePlanes[i].end(), [&](const glm::vec4 &plane) {
+				return glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+			});
+			if (!visible) {
+				continue;
+			}
+			if (isStatic) {
+				tile.staticCasters.push_back(static_cast<uint32_t>(drawIndex));
+				staticHashes[i] += hash;
+			} else {
+				tile.dynamicCasters.push_back(static_cast<uint32_t>(drawIndex));
+			}
+		}
+	}
+
+	// The static shadow is rendered again when the light or the static casters it sees changed, the static atlas is
+	// copied whenever the shadow atlas holds something else than the static shadow.
+	for (size_t i = 0; i < _frameTileCount; ++i) {
+		FrameTile &tile = _frameTiles[i];
+		tile.renderStatic = false;
+		tile.copyStatic = false;
+		if (!tile.allocated) {
+			continue;
+		}
+
+		CachedTile &cachedTile = _cachedShadows[tile.owner].tiles[tile.index];
+		tile.renderStatic = !cachedTile.staticValid || cachedTile.viewProjection != tile.viewProjection ||
+							cachedTile.staticHash != staticHashes[i];
+		tile.copyStatic = tile.renderStatic || cachedTile.hasDynamicCasters || !tile.dynamicCasters.empty();
+
+		cachedTile.viewProjection = tile.viewProjection;
+		cachedTile.staticHash = staticHashes[i];
+		cachedTile.staticValid = true;
+		cachedTile.hasDynamicCasters = !tile.dynamicCasters.empty();
+	}
+}
+
+bool ShadowMaps::_allocateBlock(uint32_t size, glm::uvec2 &offset) {
+	uint32_t level = blockLevel(size);
+	uint32_t freeLevel = level;
+	while (_freeBlocks[freeLevel].empty()) {
+		if (freeLevel == 0) {
+			return false;
+		}
+		--freeLevel;
+	}
+
+	offset = _freeBlocks[freeLevel].back();
+	_freeBlocks[freeLevel].pop_back();
+
+	// The larger block is split in four until it has the requested size, the three others are left free.
+	for (; freeLevel < level; ++freeLevel) {
+		uint32_t half = shadowAtlasSize >> (freeLevel + 1);
+		_freeBlocks[freeLevel + 1].push_back(offset + glm::uvec2(half, 0));
+		_freeBlocks[freeLevel + 1].push_back(offset + glm::uvec2(0, half));
+		_freeBlocks[freeLevel + 1].push_back(offset + glm::uvec2(half, half));
+	}
+	return true;
+}
+
+void ShadowMaps::_freeBlock(uint32_t size, const glm::uvec2 &offset) {
+	uint32_t level = blockLevel(size);
+	glm::uvec2 block = offset;
+
+	// A block is merged with its three siblings when they are all free.
+	while (level > 0) {
+		uint32_t blockSize = shadowAtlasSize >> level;
+		glm::uvec2 parent = block - block % (blockSize * 2);
+		std::vector<glm::uvec2> &freeBlocks = _freeBlocks[level];
+
+		std::array<glm::uvec2, 4> siblings = {parent, parent + glm::uvec2(blockSize, 0),
+											  parent + glm::uvec2(0, blockSize),
+											  parent + glm::uvec2(blockSize, blockSize)};
+		bool merge = std::all_of(siblings.begin(), siblings.end(), [&](const glm::uvec2 &sibling) {
+			return sibling == block || std::find(freeBlocks.begin(), freeBlocks.end(), sibling) != freeBlocks.end();
+		});
+		if (!merge) {
+			break;
+		}
+
+		freeBlocks.erase(std::remove_if(freeBlocks.begin(), freeBlocks.end(),
+										[&](const glm::uvec2 &freeBlock) {
+											return std::find(siblings.begin(), siblings.end(), freeBlock) !=
+												   siblings.end();
+										}),
+						 freeBlocks.end());
+		block = parent;
+		--level;
+	}
+	_freeBlocks[level].push_back(block);
+}
+
+void ShadowMaps::_recordCasters(VkCommandBuffer commandBuffer, const RenderQueue &renderQueue, const FrameTile &tile,
+								const std::vector<uint32_t> &casters) const {
+	VkViewport viewport = {};
+	viewport.x = static_cast<float>(tile.offset.x);
+	viewport.y = static_cast<float>(tile.offset.y);
+	viewport.width = static_cast<float>(tile.size);
+	viewport.height = static_cast<float>(tile.size);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.offset = {static_cast<int32_t>(tile.offset.x), static_cast<int32_t>(tile.offset.y)};
+	scissor.extent = {tile.size, tile.size};
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	const Mesh *boundMesh = nullptr;
+	for (uint32_t drawIndex : casters) {
+		const DrawItem &drawItem = renderQueue.getDrawItem(drawIndex);
+		const Mesh &mesh = *drawItem.meshNode->getMesh();
+
+		VkPipeline pipeline = _pipelines[static_cast<size_t>(mesh.getVertexFormat())];
+		if (pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+		}
+
+		if (boundMesh != &mesh) {
+			mesh.bind(commandBuffer, VertexStreams::Position);
+			boundMesh = &mesh;
+		}
+
+		ShadowPushConstants pushConstants;
+		pushConstants.transform = tile.viewProjection * drawItem.modelMatrix * mesh.getPositionTransform();
+		vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowPushConstants),
+						   &pushConstants);
+
+		vkCmdDrawIndexed(commandBuffer, mesh.getIndexCount(), 1, 0, 0, 0);
+	}
+}
+
+
+/** Atlases */
+
+void ShadowMaps::_createAtlases() {
+	std::tie(_staticAtlas, _staticAtlasMemory) = _device->createImage(
+		shadowAtlasSize, shadowAtlasSize, 1, VK_SAMPLE_COUNT_1_BIT, _depthFormat, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	_staticAtlasView = _device->createImageView(_staticAtlas, _depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+	std::tie(_shadowAtlas, _shadowAtlasMemory) = _device->createImage(
+		shadowAtlasSize, shadowAtlasSize, 1, VK_SAMPLE_COUNT_1_BIT, _depthFormat, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	_shadowAtlasView = _device->createImageView(_shadowAtlas, _depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+	// Between frames the static atlas is ready to be rendered and the shadow atlas to be sampled.
+	_device->withSingleCommandBuffer([&](VkCommandBuffer commandBuffer) {
+		recordAtlasBarrier(commandBuffer, _staticAtlas, VK_IMAGE_LAYOUT_UNDEFINED,
+						   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+						   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+						   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+		recordAtlasBarrier(commandBuffer, _shadowAtlas, VK_IMAGE_LAYOUT_UNDEFINED,
+						   VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+						   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	});
+}
+
+void ShadowMaps::_destroyAtlases() {
+	vkDestroyImageView(_device->getDevice(), _shadowAtlasView, nullptr);
+	vkDestroyImage(_device->getDevice(), _shadowAtlas, nullptr);
+	vkFreeMemory(_device->getDevice(), _shadowAtlasMemory, nullptr);
+	_shadowAtlasView = VK_NULL_HANDLE;
+	_shadowAtlas = VK_NULL_HANDLE;
+	_shadowAtlasMemory = VK_NULL_HANDLE;
+
+	vkDestroyImageView(_device->getDevice(), _staticAtlasView, nullptr);
+	vkDestroyImage(_device->getDevice(), _staticAtlas, nullptr);
+	vkFreeMemory(_device->getDevice(), _staticAtlasMemory, nullptr);
+	_staticAtlasView = VK_NULL_HANDLE;
+	_staticAtlas = VK_NULL_HANDLE;
+	_staticAtlasMemory = VK_NULL_HANDLE;
+}
+
+
+/** Render Pass */
+
+void ShadowMaps::_createRenderPass() {
+	// The tiles not rendered in a pass keep their depth, the layouts are changed by the barriers around the passes.
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = _depthFormat;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef = {};
+	depthAttachmentRef.attachment = 0;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 0;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &depthAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	if (vkCreateRenderPass(_device->getDevice(), &renderPassInfo, nullptr, &_renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create shadow render pass");
+	}
+}
+
+void ShadowMaps::_destroyRenderPass() {
+	if (_renderPass != VK_NULL_HANDLE) {
+		vkDestroyRenderPass(_device->getDevice(), _renderPass, nullptr);
+	}
+	_renderPass = VK_NULL_HANDLE;
+}
+
+
+/** Framebuffers */
+
+void ShadowMaps::_createFramebuffers() {
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = _renderPass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.width = shadowAtlasSize;
+	framebufferInfo.height = shadowAtlasSize;
+	framebufferInfo.layers = 1;
+
+	framebufferInfo.pAttachments = &_staticAtlasView;
+	if (vkCreateFramebuffer(_device->getDevice(), &framebufferInfo, nullptr, &_staticFramebuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create static shadow framebuffer");
+	}
+
+	framebufferInfo.pAttachments = &_shadowAtlasView;
+	if (vkCreateFramebuffer(_device->getDevice(), &framebufferInfo, nullptr, &_shadowFramebuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create shadow framebuffer");
+	}
+}
+
+void ShadowMaps::_destroyFramebuffers() {
+	if (_shadowFramebuffer != VK_NULL_HANDLE) {
+		vkDestroyFramebuffer(_device->getDevice(), _shadowFramebuffer, nullptr);
+	}
+	_shadowFramebuffer = VK_NULL_HANDLE;
+	if (_staticFramebuffer != VK_NULL_HANDLE) {
+		vkDestroyFramebuffer(_device->getDevice(), _staticFramebuffer, nullptr);
+	}
+	_staticFramebuffer = VK_NULL_HANDLE;
+}
+
+
+/** Pipelines */
+
+void ShadowMaps::_createPipelines() {
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ShadowPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 0;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(_device->getDevice(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create shadow pipeline layout");
+	}
+
+	auto vertShaderCode = Utils::readBinaryFile("shaders/vert-shadow.spv");
+	auto vertShaderModule = _device->createShaderModule(vertShaderCode);
+
+	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertShaderStageInfo.module = vertShaderModule;
+	vertShaderStageInfo.pName = "main";
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	// Both faces cast, the open meshes included, the depth bias keeps the lit surfaces from shadowing themselves.
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_TRUE;
+	rasterizer.depthBiasConstantFactor = 1.25f;
+	rasterizer.depthBiasClamp = 0.0f;
+	rasterizer.depthBiasSlopeFactor = 1.75f;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.minSampleShading = 1.0f;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 0;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	// One pipeline per vertex format, they only differ by the layout of the position stream.
+	for (Scene::VertexFormat vertexFormat :
+		 {Scene::VertexFormat::Float, Scene::VertexFormat::Packed, Scene::VertexFormat::Quantized}) {
+		VertexInputDescription vertexInput = vertexInputDescription(vertexFormat, VertexStreams::Position);
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInput.bindings.size());
+		vertexInputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInput.attributes.size());
+		vertexInputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
+
+		VkGraphicsPipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = 1;
+		pipelineInfo.pStages = &vertShaderStageInfo;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicStateCreateInfo;
+		pipelineInfo.layout = _pipelineLayout;
+		pipelineInfo.renderPass = _renderPass;
+		pipelineInfo.subpass = 0;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineInfo.basePipelineIndex = -1;
+
+		VkPipeline &pipeline = _pipelines[static_cast<size_t>(vertexFormat)];
+		if (vkCreateGraphicsPipelines(_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) !=
+			VK_SUCCESS) {
+			vkDestroyShaderModule(_device->getDevice(), vertShaderModule, nullptr);
+			throw std::runtime_error("Failed to create shadow pipeline");
+		}
+	}
+
+	vkDestroyShaderModule(_device->getDevice(), vertShaderModule, nullptr);
+}
+
+void ShadowMaps::_destroyPipelines() {
+	for (VkPipeline &pipeline : _pipelines) {
+		if (pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(_device->getDevice(), pipeline, nullptr);
+		}
+		pipeline = VK_NULL_HANDLE;
+	}
+	if (_pipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(_device->getDevice(), _pipelineLayout, nullptr);
+	}
+	_pipelineLayout = VK_NULL_HANDLE;
+}
+
+
+/** Tile Buffer */
+
+void ShadowMaps::_createTileBuffer() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device->getPhysicalDevice(), &properties);
+
+	VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+	VkDeviceSize regionSize = sizeof(GpuShadowTile) * maxShadowTiles;
+	_tileRegionSize = alignment > 0 ? (regionSize + alignment - 1) & ~(alignment - 1) : regionSize;
+
+	std::tie(_tileBuffer, _tileBufferMemory) =
+		_device->createBuffer(_tileRegionSize * _frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	vkMapMemory(_device->getDevice(), _tileBufferMemory, 0, _tileRegionSize * _frameCount, 0, &_tileBufferMapped);
+}
+
+void ShadowMaps::_destroyTileBuffer() {
+	if (_tileBufferMapped != nullptr) {
+		vkUnmapMemory(_device->getDevice(), _tileBufferMemory);
+		_tileBufferMapped = nullptr;
+	}
+	_device->destroyBuffer(_tileBuffer, _tileBufferMemory);
+	_tileBuffer = VK_NULL_HANDLE;
+	_tileBufferMemory = VK_NULL_HANDLE;
+}
+
+
+/** Sampler */
+
+void ShadowMaps::_createSampler() {
+	// Comparing with a linear filter blends the results of the four nearest texels.
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_TRUE;
+	samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.mipLodBias = 0.0f;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	if (vkCreateSampler(_device->getDevice(), &samplerInfo, nullptr, &_atlasSampler) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create shadow sampler");
+	}
+}
+
+void ShadowMaps::_destroySampler() {
+	if (_atlasSampler != VK_NULL_HANDLE) {
+		vkDestroySampler(_device->getDevice(), _atlasSampler, nullptr);
+	}
+	_atlasSampler = VK_NULL_HANDLE;
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,213 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <array>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class Device;
+class FrameUniformBuffer;
+class RenderQueue;
+
+/** Must match cascadeCount in frag.glsl. */
+constexpr uint32_t shadowCascadeCount = 4;
+
+/**
+ * A shadow map of the frame, a square tile of the shadow atlas, read by the fragment shaders and laid out as std430.
+ * The rect of a tile is empty when the atlas had no room left for it, it casts no shadow.
+ */
+struct GpuShadowTile {
+	alignas(16) glm::mat4 matrix = glm::mat4(1.0f); /**< From the camera view space to the light clip space. */
+	alignas(16) glm::vec4 rect = glm::vec4(0.0f);	/**< Offset and size in atlas texture coordinates. */
+};
+
+/**
+ * Push constants of the shadow pipelines.
+ */
+struct ShadowPushConstants {
+	alignas(16) glm::mat4 transform = glm::mat4(1.0f); /**< From the stored positions to the clip space of the light. */
+};
+
+/**
+ * Renders the shadow maps of the casting lights into tiles of a depth atlas.
+ *
+ * The lights request their tiles during the traversal, a spot light one tile and an infinite directional light one
+ * tile per cascade. A light keeps the place of its tiles in the atlas while it requests them every frame, and gives
+ * them back once it stops.
+ *
+ * The opaque draws of the render queue are the shadow casters. The static casters are rendered in a second atlas,
+ * kept between frames: a tile is only rendered again when its light moved or when the static casters it sees changed.
+ * Every frame the static tiles are copied into the shadow atlas and the dynamic casters are rendered on top of them. A
+ * tile seeing no dynamic caster is left untouched once its static shadow is copied.
+ *
+ * The cascades are spheres around slices of the view frustum, centered on a grid of an eighth of their size in the
+ * space of the light. A moving camera only changes the cascades when their center crosses the grid, which keeps their
+ * static shadow and stops the shadow edges from shimmering.
+ */
+class ShadowMaps {
+public:
+	ShadowMaps() = delete;
+	ShadowMaps(const std::shared_ptr<Device> &device, const std::shared_ptr<FrameUniformBuffer> &frameUniformBuffer,
+			   uint32_t frameCount);
+	ShadowMaps(const ShadowMaps &) = delete;
+
+	virtual ~ShadowMaps();
+
+	/** Removes the requests of the previous frame, keeping the places of the tiles in the atlas. */
+	void clear();
+
+	/**
+	 * Requests a single shadow map for the frame.
+	 *
+	 * @param owner The light requesting the map, identifying its place in the atlas across frames.
+	 * @param viewProjection The transform from world space to the clip space of the light.
+	 * @param size The width of the map in texels, rounded to a power of two.
+	 * @return The index of the shadow tile, or -1 when the frame has no tile left.
+	 */
+	[[nodiscard]] int32_t requestMap(const void *owner, const glm::mat4 &viewProjection, uint32_t size);
+
+	/**
+	 * Requests the shadow cascades of an infinite directional light for the frame.
+	 *
+	 * @param owner The light requesting the cascades, identifying their places in the atlas across frames.
+	 * @param viewMatrix The view matrix of the camera.
+	 * @param projMatrix The projection matrix of the camera.
+	 * @param direction The direction of the light in world space.
+	 * @param shadowRange The distances from the camera where the shadows start and end. The far distance is also how
+	 * far the casters are looked for toward the light.
+	 * @param size The width of each cascade in texels, rounded to a power of two.
+	 * @param cascadeSplits Receives the view depth where each cascade ends.
+	 * @return The index of the tile of the first cascade, the others following it, or -1 when the frame has no tile
+	 * left.
+	 */
+	[[nodiscard]] int32_t requestCascades(const void *owner, const glm::mat4 &viewMatrix, const glm::mat4 &projMatrix,
+										  const glm::vec3 &direction, const glm::vec2 &shadowRange, uint32_t size,
+										  glm::vec4 &cascadeSplits);
+
+	/**
+	 * Places the requested tiles in the atlas, sorts the casters of each of them and writes the tiles of the frame.
+	 *
+	 * @param frameIndex The frame in flight being recorded.
+	 * @param renderQueue The draws of the frame, the opaque ones cast the shadows.
+	 * @param viewMatrix The view matrix of the camera, the fragment shaders find their shadows from the view space.
+	 */
+	void prepare(uint32_t frameIndex, const RenderQueue &renderQueue, const glm::mat4 &viewMatrix);
+
+	/**
+	 * Records the rendering of the shadows and the barrier making the atlas readable by the fragment shaders.
+	 * Must be recorded outside of the render pass, after the draws of the queue are ready to be read.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param renderQueue The draws given to prepare.
+	 */
+	void record(VkCommandBuffer commandBuffer, const RenderQueue &renderQueue) const;
+
+	[[nodiscard]] size_t getTileCount() const {
+		return _frameTileCount;
+	}
+
+	/** Returns the number of tiles whose static casters are rendered again this frame. */
+	[[nodiscard]] size_t getStaticRenderCount() const;
+
+private:
+	/** A tile kept in the atlas by a light across frames. */
+	struct CachedTile {
+		bool allocated = false;
+		glm::uvec2 offset = glm::uvec2(0);
+		glm::mat4 viewProjection = glm::mat4(1.0f); /**< The transform the static casters were rendered with. */
+		uint64_t staticHash = 0;					/**< Identifies the static casters rendered in the tile. */
+		bool staticValid = false;
+		bool hasDynamicCasters = false; /**< The shadow atlas holds dynamic casters over the static ones. */
+	};
+
+	struct CachedShadow {
+		uint32_t size = 0;
+		std::vector<CachedTile> tiles;
+		bool requested = false;
+	};
+
+	/** A tile of the frame, with the casters to render into it. */
+	struct FrameTile {
+		const void *owner = nullptr;
+		uint32_t index = 0; /**< Position of the tile among the tiles of its light. */
+		uint32_t size = 0;
+		glm::mat4 viewProjection = glm::mat4(1.0f);
+		glm::uvec2 offset = glm::uvec2(0);
+		bool allocated = false;
+		bool renderStatic = false;
+		bool copyStatic = false;
+		std::vector<uint32_t> staticCasters;  /**< Positions of the draws in the render queue. */
+		std::vector<uint32_t> dynamicCasters; /**< Positions of the draws in the render queue. */
+	};
+
+	[[nodiscard]] int32_t _pushTiles(const void *owner, uint32_t size, const glm::mat4 *viewProjections,
+									 uint32_t count);
+	void _placeTiles();
+	void _sortCasters(const RenderQueue &renderQueue);
+
+	[[nodiscard]] bool _allocateBlock(uint32_t size, glm::uvec2 &offset);
+	void _freeBlock(uint32_t size, const glm::uvec2 &offset);
+
+	void _recordCasters(VkCommandBuffer commandBuffer, const RenderQueue &renderQueue, const FrameTile &tile,
+						const std::vector<uint32_t> &casters) const;
+
+	void _createAtlases();
+	void _destroyAtlases();
+
+	void _createRenderPass();
+	void _destroyRenderPass();
+
+	void _createFramebuffers();
+	void _destroyFramebuffers();
+
+	void _createPipelines();
+	void _destroyPipelines();
+
+	void _createTileBuffer();
+	void _destroyTileBuffer();
+
+	void _createSampler();
+	void _destroySampler();
+
+	std::shared_ptr<Device> _device;
+	std::shared_ptr<FrameUniformBuffer> _frameUniformBuffer;
+	uint32_t _frameCount;
+	VkFormat _depthFormat = VK_FORMAT_UNDEFINED;
+
+	VkImage _staticAtlas = VK_NULL_HANDLE;
+	VkDeviceMemory _staticAtlasMemory = VK_NULL_HANDLE;
+	VkImageView _staticAtlasView = VK_NULL_HANDLE;
+	VkImage _shadowAtlas = VK_NULL_HANDLE;
+	VkDeviceMemory _shadowAtlasMemory = VK_NULL_HANDLE;
+	VkImageView _shadowAtlasView = VK_NULL_HANDLE;
+
+	VkRenderPass _renderPass = VK_NULL_HANDLE;
+	VkFramebuffer _staticFramebuffer = VK_NULL_HANDLE;
+	VkFramebuffer _shadowFramebuffer = VK_NULL_HANDLE;
+
+	VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+	std::array<VkPipeline, 3> _pipelines = {}; /**< Indexed by the vertex format of the casters. */
+
+	VkDeviceSize _tileRegionSize = 0;
+	VkBuffer _tileBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _tileBufferMemory = VK_NULL_HANDLE;
+	void *_tileBufferMapped = nullptr;
+
+	VkSampler _atlasSampler = VK_NULL_HANDLE;
+
+	std::vector<std::vector<glm::uvec2>> _freeBlocks; /**< Free blocks of the atlas by level, the whole atlas first. */
+	std::unordered_map<const void *, CachedShadow> _cachedShadows;
+	std::vector<FrameTile> _frameTiles; /**< Kept between frames with their caster lists, the first ones used. */
+	size_t _frameTileCount = 0;
+};
+
+} // namespace Stone::Render::Vulkan
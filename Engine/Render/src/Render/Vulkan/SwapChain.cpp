@@ -8,23 +8,21 @@
 namespace Stone::Render::Vulkan {
 
 SwapChain::SwapChain(const std::shared_ptr<Device> &device, const VkRenderPass &renderPass,
-					 const SwapChainProperties &props)
+					 const SwapChainProperties &props, VkSwapchainKHR oldSwapChain)
 	: _device(device) {
 	std::cout << "Creating swap chain" << std::endl;
-	_createSwapChain(props);
+	_createSwapChain(props, oldSwapChain);
+	_createSemaphores();
 	_createImageViews();
 	_createDepthResources();
 	_createFramebuffers(renderPass);
 }
 
 SwapChain::~SwapChain() {
-	if (_device) {
-		_device->waitIdle();
-	}
-
 	_destroyFramebuffers();
 	_destroyDepthResources();
 	_destroyImageViews();
+	_destroySemaphores();
 	_destroySwapChain();
 	std::cout << "Destroying swap chain" << std::endl;
 }
@@ -32,6 +30,9 @@ SwapChain::~SwapChain() {
 VkResult SwapChain::acquireNextImage(const VkSemaphore &semaphore, ImageContext &imageContext) {
 	VkResult result = vkAcquireNextImageKHR(_device->getDevice(), _swapChain, UINT64_MAX, semaphore, VK_NULL_HANDLE,
 											&imageContext.index);
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		return result;
+	}
 	imageContext.image = _images[imageContext.index];
 	imageContext.imageView = _imageViews[imageContext.index];
 	imageContext.framebuffer = _framebuffers[imageContext.index];
@@ -41,7 +42,7 @@ VkResult SwapChain::acquireNextImage(const VkSemaphore &semaphore, ImageContext
 
 /** Swap Chain */
 
-void SwapChain::_createSwapChain(const SwapChainProperties &props) {
+void SwapChain::_createSwapChain(const SwapChainProperties &props, VkSwapchainKHR oldSwapChain) {
 
 	VkSwapchainCreateInfoKHR createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -70,7 +71,8 @@ void SwapChain::_createSwapChain(const SwapChainProperties &props) {
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = props.presentMode;
 	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// The presentation engine can hand over the images of the replaced swap chain instead of dropping them.
+	createInfo.oldSwapchain = oldSwapChain;
 
 	if (vkCreateSwapchainKHR(_device->getDevice(), &createInfo, nullptr, &_swapChain) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create swap chain");
@@ -83,6 +85,7 @@ void SwapChain::_createSwapChain(const SwapChainProperties &props) {
 
 	_imageFormat = props.surfaceFormat.format;
 	_extent = props.extent;
+	_presentMode = props.presentMode;
 }
 
 void SwapChain::_destroySwapChain() {
@@ -94,6 +97,29 @@ void SwapChain::_destroySwapChain() {
 }
 
 
+/** Semaphores */
+
+void SwapChain::_createSemaphores() {
+	_renderFinishedSemaphores.resize(_imageCount, VK_NULL_HANDLE);
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (auto &semaphore : _renderFinishedSemaphores) {
+		if (vkCreateSemaphore(_device->getDevice(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create render finished semaphore");
+		}
+	}
+}
+
+void SwapChain::_destroySemaphores() {
+	for (auto semaphore : _renderFinishedSemaphores) {
+		vkDestroySemaphore(_device->getDevice(), semaphore, nullptr);
+	}
+	_renderFinishedSemaphores.clear();
+}
+
+
 /** Image Views */
 
 void SwapChain::_createImageViews() {
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "RenderContext.hpp"
 #include "Utilities/SwapChainProperties.hpp"
 
 #include <memory>
@@ -12,17 +13,17 @@ namespace Stone::Render::Vulkan {
 
 class Device;
 
-struct ImageContext {
-	uint32_t index;
-	VkImage image;
-	VkImageView imageView;
-	VkFramebuffer framebuffer;
-};
-
+/**
+ * The presentable images of the window surface, with their framebuffers.
+ *
+ * A swap chain is recreated from the one it replaces, which is retired but stays valid for the frames still using it.
+ * The device must have completed these frames when a swap chain is destroyed, it does not wait for the device.
+ */
 class SwapChain {
 public:
 	SwapChain() = delete;
-	SwapChain(const std::shared_ptr<Device> &device, const VkRenderPass &renderPass, const SwapChainProperties &props);
+	SwapChain(const std::shared_ptr<Device> &device, const VkRenderPass &renderPass, const SwapChainProperties &props,
+			  VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
 	SwapChain(const SwapChain &) = delete;
 
 	virtual ~SwapChain();
@@ -43,12 +44,35 @@ public:
 		return _imageCount;
 	}
 
+	[[nodiscard]] VkPresentModeKHR getPresentMode() const {
+		return _presentMode;
+	}
+
+	/**
+	 * Returns the semaphore the rendering into an image signals and its presentation waits on.
+	 *
+	 * @param index The index of the image.
+	 */
+	[[nodiscard]] VkSemaphore getRenderFinishedSemaphore(uint32_t index) const {
+		return _renderFinishedSemaphores[index];
+	}
+
+	/**
+	 * Acquires the next image to render into.
+	 *
+	 * @param semaphore The semaphore signaled once the image can be rendered into.
+	 * @param imageContext Filled with the image when one was acquired.
+	 * @return The result of vkAcquireNextImageKHR, the swap chain must be recreated on VK_ERROR_OUT_OF_DATE_KHR.
+	 */
 	VkResult acquireNextImage(const VkSemaphore &semaphore, ImageContext &imageContext);
 
 private:
-	void _createSwapChain(const SwapChainProperties &props);
+	void _createSwapChain(const SwapChainProperties &props, VkSwapchainKHR oldSwapChain);
 	void _destroySwapChain();
 
+	void _createSemaphores();
+	void _destroySemaphores();
+
 	void _createImageViews();
 	void _destroyImageViews();
 
@@ -65,6 +89,9 @@ private:
 	std::vector<VkImage> _images = {};
 	VkFormat _imageFormat = VK_FORMAT_UNDEFINED;
 	VkExtent2D _extent = {0, 0};
+	VkPresentModeKHR _presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+	std::vector<VkSemaphore> _renderFinishedSemaphores = {};
 
 	std::vector<VkImageView> _imageViews = {};
 
@@ -0,0 +1,115 @@
+// Copyright 2024 Stone-Engine
+
+#include "TextureStreamer.hpp"
+
+#include "VulkanRenderable/Texture.hpp"
+
+#include <algorithm>
+
+namespace Stone::Render::Vulkan {
+
+namespace {
+
+struct Candidate {
+	Texture *texture;
+	uint32_t mip; /**< The resident mip wanted for the texture. */
+	float footprint;
+};
+
+} // namespace
+
+TextureStreamer::TextureStreamer(VkDeviceSize budget, uint32_t startSize, uint32_t changesPerUpdate)
+	: _budget(budget), _startSize(startSize), _changesPerUpdate(std::max(changesPerUpdate, 1u)) {
+}
+
+void TextureStreamer::add(Texture *texture) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_textures.push_back(texture);
+}
+
+void TextureStreamer::remove(Texture *texture) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_textures.erase(std::remove(_textures.begin(), _textures.end(), texture), _textures.end());
+}
+
+void TextureStreamer::update() {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkDeviceSize residentSize = 0;
+	std::vector<Candidate> refinements;
+	std::vector<Candidate> evictions;
+	for (Texture *texture : _textures) {
+		texture->updatePendingMip();
+		residentSize += texture->getResidentSize();
+		float footprint = texture->getFootprint();
+		texture->clearFootprint();
+		// A texture waiting for its image keeps it until swapped, its size already counts the change.
+		if (texture->hasPendingMip()) {
+			continue;
+		}
+
+		// The textures not drawn since the previous update go back to their start level when memory is needed.
+		uint32_t mip = footprint > 0.0f ? texture->getMipForFootprint(footprint) : texture->getCoarsestMip();
+		if (mip < texture->getResidentMip()) {
+			refinements.push_back({texture, mip, footprint});
+		} else if (mip > texture->getResidentMip()) {
+			evictions.push_back({texture, mip, footprint});
+		}
+	}
+
+	// The textures not drawn have no footprint, they are evicted first.
+	std::sort(refinements.begin(), refinements.end(),
+			  [](const Candidate &a, const Candidate &b) { return a.footprint > b.footprint; });
+	std::sort(evictions.begin(), evictions.end(),
+			  [](const Candidate &a, const Candidate &b) { return a.footprint < b.footprint; });
+
+	uint32_t changes = 0;
+	size_t nextEviction = 0;
+	auto fits = [this](VkDeviceSize size) { return _budget == 0 || size <= _budget; };
+	auto evict = [&]() {
+		if (nextEviction == evictions.size() || changes == _changesPerUpdate) {
+			return false;
+		}
+		Texture *texture = evictions[nextEviction].texture;
+		residentSize -= texture->getResidentSize();
+		texture->setResidentMip(evictions[nextEviction].mip);
+		residentSize += texture->getResidentSize();
+		++nextEviction;
+		++changes;
+		return true;
+	};
+
+	while (!fits(residentSize) && evict()) {
+	}
+
+	for (const Candidate &refinement : refinements) {
+		Texture *texture = refinement.texture;
+		VkDeviceSize currentSize = texture->getResidentSize();
+		while (!fits(residentSize - currentSize + texture->getResidentSize(refinement.mip)) && evict()) {
+		}
+		if (changes == _changesPerUpdate) {
+			break;
+		}
+
+		// A refinement exceeding the budget still brings the finest level it allows.
+		uint32_t mip = refinement.mip;
+		while (mip < texture->getResidentMip() && !fits(residentSize - currentSize + texture->getResidentSize(mip))) {
+			++mip;
+		}
+		if (mip == texture->getResidentMip()) {
+			continue;
+		}
+		texture->setResidentMip(mip);
+		residentSize = residentSize - currentSize + texture->getResidentSize();
+		++changes;
+	}
+
+	_residentSize = residentSize;
+}
+
+VkDeviceSize TextureStreamer::getResidentSize() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _residentSize;
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,67 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Render::Vulkan {
+
+class Texture;
+
+/**
+ * Moves the resident mips of the textures from the footprints requested by the draws, within a memory budget.
+ *
+ * The textures start at a low level, and the largest ones on screen are refined first. Textures keep their levels
+ * while memory remains, and above the budget the high mips of the textures not drawn are evicted first, then the
+ * high mips of the smallest ones on screen.
+ *
+ * The textures change their resident mip without waiting for the device, they swap their image in a later update
+ * once it is filled. Refining still loads and decodes the image on the host, so only a few textures change per update.
+ */
+class TextureStreamer {
+public:
+	/**
+	 * @param budget The memory of the resident textures in bytes past which high mips are evicted, 0 for no limit.
+	 * @param startSize The size of the level the textures start at.
+	 * @param changesPerUpdate The textures whose resident mip changes in one update at most.
+	 */
+	TextureStreamer(VkDeviceSize budget, uint32_t startSize, uint32_t changesPerUpdate);
+	TextureStreamer(const TextureStreamer &) = delete;
+
+	virtual ~TextureStreamer() = default;
+
+	void add(Texture *texture);
+	void remove(Texture *texture);
+
+	/**
+	 * Swaps the images filled since the previous update, then refines and evicts the textures from the footprints
+	 * requested since then and clears them. Called before the traversal, the materials using the textures swapped
+	 * rewrite their sets during it.
+	 */
+	void update();
+
+	[[nodiscard]] uint32_t getStartSize() const {
+		return _startSize;
+	}
+
+	[[nodiscard]] VkDeviceSize getBudget() const {
+		return _budget;
+	}
+
+	/** The memory of the resident textures after the last update, in bytes. */
+	[[nodiscard]] VkDeviceSize getResidentSize() const;
+
+private:
+	VkDeviceSize _budget;
+	uint32_t _startSize;
+	uint32_t _changesPerUpdate;
+
+	mutable std::mutex _mutex;
+	std::vector<Texture *> _textures;
+	VkDeviceSize _residentSize = 0;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -5,13 +5,17 @@
 #include "Scene/Vertex.hpp"
 
 #include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace Stone::Render::Vulkan {
 
 template <typename T>
 VkVertexInputBindingDescription vertexBindingDescription() {
-	static_assert(std::is_same_v<T, Scene::Vertex> || std::is_same_v<T, Scene::WeightVertex>,
+	static_assert(std::is_same_v<T, Scene::Vertex> || std::is_same_v<T, Scene::WeightVertex> ||
+					  std::is_same_v<T, Scene::PackedVertex> || std::is_same_v<T, Scene::QuantizedVertex>,
 				  "Unsupported vertex type");
 	VkVertexInputBindingDescription bindingDescription = {};
 	bindingDescription.binding = 0;
@@ -23,13 +27,14 @@ VkVertexInputBindingDescription vertexBindingDescription() {
 
 template <typename T, std::size_t N>
 std::array<VkVertexInputAttributeDescription, N> vertexAttributeDescriptions() {
-	static_assert(std::is_same_v<T, Scene::Vertex> || std::is_same_v<T, Scene::WeightVertex>,
+	static_assert(std::is_same_v<T, Scene::Vertex> || std::is_same_v<T, Scene::WeightVertex> ||
+					  std::is_same_v<T, Scene::PackedVertex> || std::is_same_v<T, Scene::QuantizedVertex>,
 				  "Unsupported vertex type");
 	return {};
 }
 
 template <>
-std::array<VkVertexInputAttributeDescription, 5> vertexAttributeDescriptions<Scene::Vertex, 5>() {
+inline std::array<VkVertexInputAttributeDescription, 5> vertexAttributeDescriptions<Scene::Vertex, 5>() {
 	std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions = {};
 
 	attributeDescriptions[0].binding = 0;
@@ -61,7 +66,7 @@ std::array<VkVertexInputAttributeDescription, 5> vertexAttributeDescriptions<Sce
 }
 
 template <>
-std::array<VkVertexInputAttributeDescription, 7> vertexAttributeDescriptions<Scene::WeightVertex, 7>() {
+inline std::array<VkVertexInputAttributeDescription, 7> vertexAttributeDescriptions<Scene::WeightVertex, 7>() {
 	std::array<VkVertexInputAttributeDescription, 7> attributeDescriptions = {};
 
 	std::array<VkVertexInputAttributeDescription, 5> baseDescriptions = vertexAttributeDescriptions<Scene::Vertex, 5>();
@@ -83,4 +88,114 @@ std::array<VkVertexInputAttributeDescription, 7> vertexAttributeDescriptions<Sce
 	return attributeDescriptions;
 }
 
+/**
+ * Attributes of the compact vertex layouts, decoded by the packed vertex shaders.
+ * The tangent is read as integers to keep the sign stored in its lowest bit.
+ */
+template <typename T>
+std::array<VkVertexInputAttributeDescription, 4> packedVertexAttributeDescriptions(VkFormat positionFormat) {
+	std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = {};
+
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].format = positionFormat;
+	attributeDescriptions[0].offset = offsetof(T, position);
+
+	attributeDescriptions[1].binding = 0;
+	attributeDescriptions[1].location = 1;
+	attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+	attributeDescriptions[1].offset = offsetof(T, normal);
+
+	attributeDescriptions[2].binding = 0;
+	attributeDescriptions[2].location = 2;
+	attributeDescriptions[2].format = VK_FORMAT_R16G16_SINT;
+	attributeDescriptions[2].offset = offsetof(T, tangent);
+
+	attributeDescriptions[3].binding = 0;
+	attributeDescriptions[3].location = 3;
+	attributeDescriptions[3].format = VK_FORMAT_R16G16_SFLOAT;
+	attributeDescriptions[3].offset = offsetof(T, uv);
+
+	return attributeDescriptions;
+}
+
+template <>
+inline std::array<VkVertexInputAttributeDescription, 4> vertexAttributeDescriptions<Scene::PackedVertex, 4>() {
+	return packedVertexAttributeDescriptions<Scene::PackedVertex>(VK_FORMAT_R32G32B32_SFLOAT);
+}
+
+template <>
+inline std::array<VkVertexInputAttributeDescription, 4> vertexAttributeDescriptions<Scene::QuantizedVertex, 4>() {
+	return packedVertexAttributeDescriptions<Scene::QuantizedVertex>(VK_FORMAT_R16G16B16A16_UNORM);
+}
+
+/**
+ * The vertex streams a pipeline reads. Meshes store the positions and the other attributes in separate streams, so
+ * the passes only needing positions do not fetch the attributes.
+ */
+enum class VertexStreams : uint8_t {
+	Position = 0, /**< The position stream at binding 0. */
+	All = 1,	  /**< The position stream at binding 0 and the attribute stream at binding 1. */
+};
+
+/**
+ * Size of the position stream elements of a vertex type, its leading position member.
+ * The attribute stream holds the remaining members, with the layout they have in the interleaved vertex.
+ */
+template <typename T>
+constexpr uint32_t positionStreamStride() {
+	static_assert(offsetof(T, position) == 0, "The position must lead the vertex");
+	return static_cast<uint32_t>(sizeof(T::position));
+}
+
+template <typename T>
+constexpr uint32_t attributeStreamStride() {
+	return static_cast<uint32_t>(sizeof(T)) - positionStreamStride<T>();
+}
+
+/**
+ * The vertex input state of a vertex format, for pipelines choosing their layout per mesh.
+ */
+struct VertexInputDescription {
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+/**
+ * Splits the interleaved attributes of a vertex type into its streams.
+ *
+ * @param streams The streams read by the pipeline.
+ * @return The bindings of the read streams and their attributes.
+ */
+template <typename T, std::size_t N>
+VertexInputDescription vertexInputDescription(VertexStreams streams) {
+	std::array<VkVertexInputAttributeDescription, N> attributes = vertexAttributeDescriptions<T, N>();
+	constexpr uint32_t positionStride = positionStreamStride<T>();
+
+	VertexInputDescription description;
+	description.bindings.push_back({0, positionStride, VK_VERTEX_INPUT_RATE_VERTEX});
+	description.attributes.push_back(attributes[0]);
+	if (streams == VertexStreams::Position) {
+		return description;
+	}
+
+	description.bindings.push_back({1, attributeStreamStride<T>(), VK_VERTEX_INPUT_RATE_VERTEX});
+	for (std::size_t i = 1; i < N; ++i) {
+		VkVertexInputAttributeDescription attribute = attributes[i];
+		attribute.binding = 1;
+		attribute.offset -= positionStride;
+		description.attributes.push_back(attribute);
+	}
+	return description;
+}
+
+inline VertexInputDescription vertexInputDescription(Scene::VertexFormat format, VertexStreams streams) {
+	switch (format) {
+	case Scene::VertexFormat::Float: return vertexInputDescription<Scene::Vertex, 5>(streams);
+	case Scene::VertexFormat::Packed: return vertexInputDescription<Scene::PackedVertex, 4>(streams);
+	case Scene::VertexFormat::Quantized: return vertexInputDescription<Scene::QuantizedVertex, 4>(streams);
+	}
+	throw std::runtime_error("Unsupported vertex format");
+}
+
 } // namespace Stone::Render::Vulkan
@@ -81,8 +81,11 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surfa
 			indices.graphicsFamily = i;
 		}
 
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		// Without a surface nothing is presented, the graphics queue stands in for the present queue.
+		VkBool32 presentSupport = surface == VK_NULL_HANDLE && (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT);
+		if (surface != VK_NULL_HANDLE) {
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		}
 		if (presentSupport) {
 			indices.presentFamily = i;
 		}
@@ -127,9 +130,10 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
 	return availableFormats[0];
 }
 
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
+VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes,
+									   VkPresentModeKHR preferredPresentMode) {
 	for (const auto &availablePresentMode : availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+		if (availablePresentMode == preferredPresentMode) {
 			return availablePresentMode;
 		}
 	}
@@ -0,0 +1,142 @@
+// Copyright 2024 Stone-Engine
+
+#include "LightNode.hpp"
+
+#include "../RenderContext.hpp"
+#include "../ShadowMaps.hpp"
+#include "Scene/Node/LightNode.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <glm/mat3x3.hpp>
+#include <glm/matrix.hpp>
+
+namespace Stone::Render::Vulkan {
+
+LightNode::LightNode(const std::shared_ptr<Scene::AmbientLightNode> &ambientLightNode) : _type(Type::Ambient) {
+	update(ambientLightNode);
+}
+
+LightNode::LightNode(const std::shared_ptr<Scene::PointLightNode> &pointLightNode) : _type(Type::Point) {
+	update(pointLightNode);
+}
+
+LightNode::LightNode(const std::shared_ptr<Scene::SpotLightNode> &spotLightNode) : _type(Type::Spot) {
+	update(spotLightNode);
+}
+
+LightNode::LightNode(const std::shared_ptr<Scene::DirectionalLightNode> &directionalLightNode)
+	: _type(Type::Directional) {
+	update(directionalLightNode);
+}
+
+LightNode::~LightNode() {
+}
+
+void LightNode::render(Scene::RenderContext &context) {
+	assert(dynamic_cast<Vulkan::RenderContext *>(&context));
+	auto vulkanContext = reinterpret_cast<Vulkan::RenderContext *>(&context);
+
+	if (vulkanContext->lights == nullptr) {
+		return;
+	}
+
+	if (_type == Type::Ambient) {
+		vulkanContext->lights->pushAmbient(glm::vec3(_light.color));
+		return;
+	}
+
+	glm::mat4 viewModel = context.mvp.viewMatrix * context.mvp.modelMatrix;
+	glm::vec3 position(viewModel[3]);
+	glm::vec3 direction = glm::normalize(-glm::vec3(viewModel[2]));
+	ShadowMaps *shadows = _castShadow ? vulkanContext->shadows : nullptr;
+
+	if (_type == Type::Directional) {
+		GpuDirectionalLight light;
+		light.direction = glm::vec4(direction, -1.0f);
+		light.color = glm::vec4(glm::vec3(_light.color), 0.0f);
+		if (shadows != nullptr && _infinite) {
+			glm::vec3 worldDirection = glm::normalize(-glm::vec3(context.mvp.modelMatrix[2]));
+			int32_t tile = shadows->requestCascades(this, context.mvp.viewMatrix, context.mvp.projMatrix,
+													worldDirection, _shadowRange, _shadowMapSize, light.cascadeSplits);
+			light.direction.w = static_cast<float>(tile);
+			light.color.w = 1.0f;
+		} else if (shadows != nullptr) {
+			glm::mat4 viewProjection = _shadowProjection * glm::inverse(context.mvp.modelMatrix);
+			light.direction.w = static_cast<float>(shadows->requestMap(this, viewProjection, _shadowMapSize));
+		}
+		vulkanContext->lights->pushDirectional(light);
+		return;
+	}
+
+	float range = _light.position.w;
+
+	GpuLight light = _light;
+	light.position = glm::vec4(position, range);
+	light.direction = glm::vec4(direction, _light.direction.w);
+	light.boundingSphere = glm::vec4(position, range);
+
+	if (_type == Type::Spot) {
+		// The smallest sphere around the cone, centered on its base for the wide cones.
+		float cosine = _light.direction.w;
+		float sine = std::sqrt(std::max(1.0f - cosine * cosine, 0.0f));
+		if (cosine < std::sqrt(0.5f)) {
+			light.boundingSphere = glm::vec4(position + direction * (cosine * range), sine * range);
+		} else {
+			float radius = range / (2.0f * cosine);
+			light.boundingSphere = glm::vec4(position + direction * radius, radius);
+		}
+	}
+
+	if (shadows != nullptr && _type == Type::Spot) {
+		glm::mat4 viewProjection = _shadowProjection * glm::inverse(context.mvp.modelMatrix);
+		light.attenuation.w = static_cast<float>(shadows->requestMap(this, viewProjection, _shadowMapSize));
+	}
+
+	vulkanContext->lights->push(light);
+}
+
+void LightNode::update(const std::shared_ptr<Scene::AmbientLightNode> &ambientLightNode) {
+	_light.color = glm::vec4(ambientLightNode->getColor() * ambientLightNode->getIntensity(), 0.0f);
+}
+
+void LightNode::update(const std::shared_ptr<Scene::PointLightNode> &pointLightNode) {
+	float intensity = pointLightNode->getIntensity();
+	_light.position.w = pointLightNode->getRange();
+	_light.direction.w = -2.0f;
+	_light.color = glm::vec4(pointLightNode->getColor() * intensity, -1.0f);
+	_light.specular = glm::vec4(pointLightNode->getSpecular() * intensity, 0.0f);
+	_light.attenuation = glm::vec4(pointLightNode->getAttenuation(), -1.0f);
+}
+
+void LightNode::update(const std::shared_ptr<Scene::SpotLightNode> &spotLightNode) {
+	// The cone angle is the field of view of the shadow projection, the cone attenuation the fading part of it.
+	float outerAngle = spotLightNode->getConeAngle() * 0.5f;
+	float innerAngle = outerAngle * (1.0f - std::clamp(spotLightNode->getConeAttenuation(), 0.0f, 1.0f));
+	glm::vec3 color = spotLightNode->getColor() * spotLightNode->getIntensity();
+
+	_light.position.w = spotLightNode->getShadowClipFar();
+	_light.direction.w = std::cos(outerAngle);
+	_light.color = glm::vec4(color, std::cos(innerAngle));
+	_light.specular = glm::vec4(color, 0.0f);
+	_light.attenuation = glm::vec4(1.0f, 0.0f, 0.0f, -1.0f);
+
+	const glm::ivec2 &shadowMapSize = spotLightNode->getShadowMapSize();
+	_castShadow = spotLightNode->isCastingShadow();
+	_shadowMapSize = static_cast<uint32_t>(std::max({shadowMapSize.x, shadowMapSize.y, 1}));
+	_shadowProjection = spotLightNode->getProjectionMatrix();
+}
+
+void LightNode::update(const std::shared_ptr<Scene::DirectionalLightNode> &directionalLightNode) {
+	_light.color = glm::vec4(directionalLightNode->getColor() * directionalLightNode->getIntensity(), 0.0f);
+
+	const glm::ivec2 &shadowMapSize = directionalLightNode->getShadowMapSize();
+	_castShadow = directionalLightNode->isCastingShadow();
+	_infinite = directionalLightNode->isInfinite();
+	_shadowMapSize = static_cast<uint32_t>(std::max({shadowMapSize.x, shadowMapSize.y, 1}));
+	_shadowRange = glm::vec2(directionalLightNode->getShadowClipNear(), directionalLightNode->getShadowClipFar());
+	_shadowProjection = directionalLightNode->getProjectionMatrix();
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,62 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "../LightClusters.hpp"
+#include "Scene/Renderable/IRenderable.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <memory>
+
+namespace Stone::Scene {
+class AmbientLightNode;
+class DirectionalLightNode;
+class PointLightNode;
+class SpotLightNode;
+} // namespace Stone::Scene
+
+namespace Stone::Render::Vulkan {
+
+/**
+ * Pushes a light of the scene to the light clusters of the frame, and requests its shadow when it casts one.
+ *
+ * The properties of the light are copied when the scene node is updated, its position and direction are taken from
+ * the render context of every frame, so moving a light does not update it.
+ */
+class LightNode : public Scene::IRendererObject {
+public:
+	explicit LightNode(const std::shared_ptr<Scene::AmbientLightNode> &ambientLightNode);
+	explicit LightNode(const std::shared_ptr<Scene::PointLightNode> &pointLightNode);
+	explicit LightNode(const std::shared_ptr<Scene::SpotLightNode> &spotLightNode);
+	explicit LightNode(const std::shared_ptr<Scene::DirectionalLightNode> &directionalLightNode);
+
+	~LightNode() override;
+
+	void render(Scene::RenderContext &context) override;
+
+	/** Copies the properties of the light after they changed. */
+	void update(const std::shared_ptr<Scene::AmbientLightNode> &ambientLightNode);
+	void update(const std::shared_ptr<Scene::PointLightNode> &pointLightNode);
+	void update(const std::shared_ptr<Scene::SpotLightNode> &spotLightNode);
+	void update(const std::shared_ptr<Scene::DirectionalLightNode> &directionalLightNode);
+
+private:
+	enum class Type : uint8_t {
+		Ambient = 0, /**< Only adds its color to the ambient light of the frame. */
+		Point = 1,
+		Spot = 2,
+		Directional = 3, /**< Lights every fragment, shaded outside of the clusters. */
+	};
+
+	Type _type;
+	GpuLight _light; /**< The light in the space of the node, lighting along -z. */
+
+	bool _castShadow = false;
+	bool _infinite = false; /**< A directional light shadowing the view with cascades rather than its projection. */
+	uint32_t _shadowMapSize = 0;
+	glm::vec2 _shadowRange = glm::vec2(0.0f); /**< Distances from the camera where the cascades start and end. */
+	glm::mat4 _shadowProjection = glm::mat4(1.0f);
+};
+
+} // namespace Stone::Render::Vulkan
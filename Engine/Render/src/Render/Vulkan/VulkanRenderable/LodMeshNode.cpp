@@ -0,0 +1,68 @@
+// Copyright 2024 Stone-Engine
+
+#include "LodMeshNode.hpp"
+
+#include "Material.hpp"
+#include "Mesh.hpp"
+#include "Render/Vulkan/VulkanRenderer.hpp"
+#include "Scene/Node/LodMeshNode.hpp"
+#include "Scene/Renderable/Material.hpp"
+#include "Scene/Renderable/Mesh.hpp"
+
+namespace Stone::Render::Vulkan {
+
+/** The node drawing a coarser level, built from the mesh of the level and the material of the node. */
+class LodMeshNode::LevelNode : public MeshNode {
+public:
+	LevelNode(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material,
+			  const std::shared_ptr<VulkanRenderer> &renderer)
+		: MeshNode(std::move(mesh), std::move(material), renderer) {
+	}
+};
+
+LodMeshNode::LodMeshNode(const std::shared_ptr<Scene::LodMeshNode> &lodMeshNode,
+						 const std::shared_ptr<VulkanRenderer> &renderer)
+	: MeshNode(lodMeshNode, renderer) {
+	for (const Scene::LodMeshNode::Lod &lod : lodMeshNode->getLods()) {
+		auto mesh = lod.mesh ? lod.mesh->getRendererObject<Mesh>() : nullptr;
+		if (mesh == nullptr) {
+			continue;
+		}
+		_levels.push_back({std::make_shared<LevelNode>(mesh, _material, renderer), lod.screenSize});
+	}
+	setStatic(lodMeshNode->isStatic());
+}
+
+LodMeshNode::~LodMeshNode() {
+}
+
+void LodMeshNode::setStatic(bool isStatic) {
+	MeshNode::setStatic(isStatic);
+	for (Level &level : _levels) {
+		level.meshNode->setStatic(isStatic);
+	}
+}
+
+void LodMeshNode::render(Scene::RenderContext &context) {
+	if (_mesh == nullptr) {
+		return;
+	}
+
+	// The bounding sphere is stored in the space of the positions of the mesh, quantized ones included.
+	Scene::MvpMatrices mvp = context.mvp;
+	mvp.modelMatrix = mvp.modelMatrix * _mesh->getPositionTransform();
+	float screenSize = Scene::LodMeshNode::computeScreenSize(mvp, _mesh->getBoundingSphere());
+
+	size_t level = 0;
+	while (level < _levels.size() && screenSize < _levels[level].screenSize) {
+		++level;
+	}
+
+	if (level == 0) {
+		MeshNode::render(context);
+	} else {
+		_levels[level - 1].meshNode->render(context);
+	}
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,48 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "MeshNode.hpp"
+
+#include <vector>
+
+namespace Stone::Scene {
+class LodMeshNode;
+} // namespace Stone::Scene
+
+namespace Stone::Render::Vulkan {
+
+/**
+ * Draws the level of detail of a mesh matching its size on screen.
+ *
+ * The node draws its most detailed mesh itself, and owns a mesh node for each coarser level. Every frame the bounding
+ * sphere of the most detailed mesh is projected with the camera of the context, and only the selected level is pushed
+ * to the render queue.
+ */
+class LodMeshNode : public MeshNode {
+public:
+	LodMeshNode(const std::shared_ptr<Scene::LodMeshNode> &lodMeshNode,
+				const std::shared_ptr<VulkanRenderer> &renderer);
+
+	~LodMeshNode() override;
+
+	void render(Scene::RenderContext &context) override;
+
+	void setStatic(bool isStatic) override;
+
+	[[nodiscard]] size_t getLevelCount() const {
+		return _levels.size() + 1;
+	}
+
+private:
+	class LevelNode;
+
+	struct Level {
+		std::shared_ptr<MeshNode> meshNode;
+		float screenSize; /**< The screen size under which the level is drawn. */
+	};
+
+	std::vector<Level> _levels; /**< The levels coarser than the mesh of the node, by decreasing screen size. */
+};
+
+} // namespace Stone::Render::Vulkan
@@ -2,18 +2,227 @@
 
 #include "Material.hpp"
 
+#include "../DescriptorLayoutCache.hpp"
+#include "../Device.hpp"
+#include "Render/Vulkan/VulkanRenderer.hpp"
+#include "Scene/Renderable/Material.hpp"
+#include "Scene/Renderable/Shader.hpp"
+#include "Scene/Renderable/Texture.hpp"
+#include "Shader.hpp"
+#include "Texture.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
 namespace Stone::Render::Vulkan {
 
-Material::Material(const std::shared_ptr<Scene::Material> &material, const std::shared_ptr<VulkanRenderer> &renderer) {
-	(void)material;
-	(void)renderer;
+namespace {
+uint32_t nextMaterialId = 0;
+
+/** Returns the variant of the fragment shader of a material for its keywords, null for the default shader. */
+std::shared_ptr<ShaderVariant> selectFragmentShader(const Scene::Material &material) {
+	auto fragmentShader = material.getFragmentShader();
+	auto shader = fragmentShader ? fragmentShader->getRendererObject<Shader>() : nullptr;
+	return shader ? shader->getVariant(material.getVariantMask()) : nullptr;
+}
+} // namespace
+
+Material::Material(const std::shared_ptr<Scene::Material> &material, const std::shared_ptr<VulkanRenderer> &renderer)
+	: _device(renderer->getDevice()), _layoutCache(renderer->getDescriptorLayoutCache()),
+	  _descriptorAllocator(renderer->getDescriptorAllocator()), _sceneMaterial(material), _id(nextMaterialId++),
+	  _fragmentShader(selectFragmentShader(*material)) {
+	(void)prepare();
 }
 
 Material::~Material() {
+	_destroyDescriptorSets();
+	_destroyDescriptorSetLayout();
 }
 
 void Material::render(Scene::RenderContext &context) {
 	(void)context;
 }
 
+void Material::update(const std::shared_ptr<Scene::Material> &material) {
+	_destroyDescriptorSets();
+	_destroyDescriptorSetLayout();
+	_textures.clear();
+	_prepared = false;
+	_failed = false;
+	_fragmentShader = selectFragmentShader(*material);
+	++_revision;
+	(void)prepare();
+}
+
+bool Material::prepare() {
+	if (_prepared || _failed) {
+		return _prepared;
+	}
+	// The layout is reflected from the SPIR-V, reading it before the compilation ends would stall the frame.
+	if (_fragmentShader && !_fragmentShader->isReady()) {
+		return false;
+	}
+	auto material = _sceneMaterial.lock();
+	if (material == nullptr) {
+		return false;
+	}
+
+	_collectTextures(material);
+	try {
+		_createDescriptorSetLayout(_layoutCache);
+	} catch (const std::exception &e) {
+		std::cerr << "Failed to prepare material: " << e.what() << std::endl;
+		_textures.clear();
+		_failed = true;
+		return false;
+	}
+	_createDescriptorSets();
+	_prepared = true;
+	return true;
+}
+
+void Material::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const {
+	if (_descriptorSet.descriptorSet == VK_NULL_HANDLE) {
+		return;
+	}
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, materialSet, 1,
+							&_descriptorSet.descriptorSet, 0, nullptr);
+}
+
+void Material::refreshDescriptorSet() {
+	bool replaced = std::any_of(_textures.begin(), _textures.end(), [](const BoundTexture &bound) {
+		return bound.texture->getGeneration() != bound.generation;
+	});
+	if (!replaced) {
+		return;
+	}
+	_destroyDescriptorSets();
+	_createDescriptorSets();
+}
+
+void Material::requestFootprint(float footprint) const {
+	for (const BoundTexture &bound : _textures) {
+		bound.texture->requestFootprint(footprint);
+	}
+}
+
+void Material::_createDescriptorSetLayout(const std::shared_ptr<DescriptorLayoutCache> &layoutCache) {
+	// The set holds every descriptor the fragment shader declares in it, so that materials of identical shaders share
+	// their layout whatever textures they set. A bound set must have all of them written.
+	std::vector<VkDescriptorSetLayoutBinding> bindings = {};
+	if (_fragmentShader) {
+		bindings = _fragmentShader->getReflection().getSetBindings(materialSet);
+	}
+	for (const VkDescriptorSetLayoutBinding &binding : bindings) {
+		if (std::none_of(_textures.begin(), _textures.end(),
+						 [&](const BoundTexture &bound) { return bound.binding == binding.binding; })) {
+			throw std::runtime_error("Binding " + std::to_string(binding.binding) +
+									 " of the fragment shader is not set by the material");
+		}
+	}
+
+	// The textures of a stripped SPIR-V are only known by the locations set on the scene shader.
+	for (const BoundTexture &bound : _textures) {
+		if (std::any_of(bindings.begin(), bindings.end(),
+						[&](const VkDescriptorSetLayoutBinding &other) { return other.binding == bound.binding; })) {
+			continue;
+		}
+		VkDescriptorSetLayoutBinding samplerLayoutBinding;
+		samplerLayoutBinding.binding = bound.binding;
+		samplerLayoutBinding.descriptorCount = 1;
+		samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		samplerLayoutBinding.pImmutableSamplers = nullptr;
+		bindings.push_back(samplerLayoutBinding);
+	}
+
+	if (bindings.empty()) {
+		return;
+	}
+
+	_descriptorSetLayout = layoutCache->getLayout(bindings);
+}
+
+void Material::_destroyDescriptorSetLayout() {
+	// The layout is owned by the cache.
+	_descriptorSetLayout = VK_NULL_HANDLE;
+}
+
+void Material::_collectTextures(const std::shared_ptr<Scene::Material> &material) {
+	auto shader = material->getFragmentShader();
+	if (shader == nullptr) {
+		return;
+	}
+
+	material->forEachTextures([&](const std::pair<const std::string, std::shared_ptr<Scene::Texture>> &texture) {
+		std::optional<uint32_t> binding = _findTextureBinding(*shader, texture.first);
+		if (!binding.has_value()) {
+			std::cerr << "Material texture " << texture.first << " is not declared by its fragment shader, ignored"
+					  << std::endl;
+			return;
+		}
+		_textures.push_back({*binding, texture.second->getRendererObject<Texture>(), 0});
+	});
+}
+
+void Material::_createDescriptorSets() {
+	if (_descriptorSetLayout == VK_NULL_HANDLE) {
+		return;
+	}
+
+	_descriptorSet = _descriptorAllocator->allocate(_descriptorSetLayout);
+
+	std::vector<VkDescriptorImageInfo> imagesInfo;
+	std::vector<VkWriteDescriptorSet> descriptorWrites = {};
+
+	for (BoundTexture &bound : _textures) {
+		bound.generation = bound.texture->getGeneration();
+
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = bound.texture->getImageView();
+		imageInfo.sampler = bound.texture->getSampler();
+		imagesInfo.push_back(imageInfo);
+
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = _descriptorSet.descriptorSet;
+		descriptorWrite.dstBinding = bound.binding;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrites.push_back(descriptorWrite);
+	}
+
+	// The image infos are linked once gathered, pushing into the vector could have moved them.
+	for (size_t i = 0; i < descriptorWrites.size(); ++i) {
+		descriptorWrites[i].pImageInfo = &imagesInfo[i];
+	}
+
+	vkUpdateDescriptorSets(_device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+						   descriptorWrites.data(), 0, nullptr);
+}
+
+void Material::_destroyDescriptorSets() {
+	if (_descriptorAllocator) {
+		_descriptorAllocator->release(_descriptorSet);
+	}
+}
+
+std::optional<uint32_t> Material::_findTextureBinding(const Scene::Shader &shader, const std::string &name) const {
+	if (_fragmentShader) {
+		if (const ReflectedBinding *binding = _fragmentShader->getReflection().findBinding(materialSet, name)) {
+			return binding->binding;
+		}
+	}
+	// The locations set by hand remain for the SPIR-V stripped of its names.
+	int location = shader.getLocation(name);
+	if (location < 0) {
+		return std::nullopt;
+	}
+	return static_cast<uint32_t>(location);
+}
+
 } // namespace Stone::Render::Vulkan
@@ -2,30 +2,148 @@
 
 #pragma once
 
+#include "../DescriptorAllocator.hpp"
 #include "../RenderContext.hpp"
 #include "Scene/Renderable/IRenderable.hpp"
 
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 namespace Stone::Scene {
 class Material;
+class Shader;
 } // namespace Stone::Scene
 
 namespace Stone::Render::Vulkan {
 
 class VulkanRenderer;
+class DescriptorLayoutCache;
 class Device;
 class RenderPass;
+class ShaderVariant;
 class SwapChain;
+class Texture;
 
+/**
+ * Descriptor set holding the textures of a material, shared by every node using it. Bound at set 1.
+ * The variant of the fragment shader selected by the material replaces the default shader in the pipelines of its
+ * nodes. The layout of the set
+ * and the bindings of the textures are reflected from its SPIR-V, the locations set on the scene shader are only used
+ * for the textures it does not name. The textures the shader does not declare are ignored, and a material leaving one
+ * of the descriptors of its shader unset fails to be prepared.
+ *
+ * The textures of a material may replace their image view as they are streamed, the set is then written again in a
+ * new allocation, the previous one being still bound by the frames in flight.
+ *
+ * The layout and the set are only created once the variant is compiled, so that a new material never waits for its
+ * shader: its nodes are not drawn until it is prepared. A material whose variant fails to compile is never prepared.
+ * Updating the material, a keyword toggled or a texture set, builds it again and its nodes request their pipeline
+ * again.
+ */
 class Material : public Scene::IRendererObject {
 public:
+	/** The index of the material set in the pipeline layouts. */
+	static constexpr uint32_t materialSet = 1;
+
 	Material(const std::shared_ptr<Scene::Material> &material, const std::shared_ptr<VulkanRenderer> &renderer);
 
 	~Material() override;
 
 	void render(Scene::RenderContext &context) override;
+
+	/**
+	 * Builds the material again from the scene material, selecting the variant of its keywords. The set of the
+	 * previous build is released once the frames in flight completed.
+	 *
+	 * @param material The scene material of this renderer object.
+	 */
+	void update(const std::shared_ptr<Scene::Material> &material);
+
+	/**
+	 * Creates the layout and the set of the material once its variant is compiled, without waiting for it.
+	 *
+	 * @return Whether the material is prepared, false while its variant compiles or after it failed to.
+	 */
+	bool prepare();
+
+	/**
+	 * Binds the descriptor set of the material, does nothing for a material without textures.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param pipelineLayout The layout of the bound pipeline.
+	 */
+	void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const;
+
+	/**
+	 * Writes the set again when a texture replaced its image view. Called during the traversal, before the draws
+	 * binding the set are recorded.
+	 */
+	void refreshDescriptorSet();
+
+	/**
+	 * Requests the textures of the material for a draw covering a number of pixels.
+	 *
+	 * @param footprint The size of the draw on screen in pixels.
+	 */
+	void requestFootprint(float footprint) const;
+
+	/** The layout of the material set, VK_NULL_HANDLE for a material without textures or not prepared yet. */
+	[[nodiscard]] VkDescriptorSetLayout getDescriptorSetLayout() const {
+		return _descriptorSetLayout;
+	}
+
+	/** The variant of the fragment shader of the material, null to use the default shader. */
+	[[nodiscard]] const std::shared_ptr<ShaderVariant> &getFragmentShader() const {
+		return _fragmentShader;
+	}
+
+	/** Incremented whenever the material is built again, its layout or its variant may have changed. */
+	[[nodiscard]] uint32_t getRevision() const {
+		return _revision;
+	}
+
+	/** Small identifier used to group the draws of the same material in the render queue. */
+	[[nodiscard]] uint32_t getId() const {
+		return _id;
+	}
+
+private:
+	void _createDescriptorSetLayout(const std::shared_ptr<DescriptorLayoutCache> &layoutCache);
+	void _destroyDescriptorSetLayout();
+
+	void _collectTextures(const std::shared_ptr<Scene::Material> &material);
+
+	void _createDescriptorSets();
+	void _destroyDescriptorSets();
+
+	/** The binding of a texture in the material set, nothing when the fragment shader does not declare it. */
+	[[nodiscard]] std::optional<uint32_t> _findTextureBinding(const Scene::Shader &shader,
+															  const std::string &name) const;
+
+	std::shared_ptr<Device> _device;
+	std::shared_ptr<DescriptorLayoutCache> _layoutCache;
+	std::shared_ptr<DescriptorAllocator> _descriptorAllocator;
+	std::weak_ptr<Scene::Material> _sceneMaterial; /**< Read when the material is prepared. */
+
+	uint32_t _id;
+	uint32_t _revision = 0;
+	std::shared_ptr<ShaderVariant> _fragmentShader;
+
+	bool _prepared = false;
+	bool _failed = false;
+
+	VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+	DescriptorAllocation _descriptorSet;
+
+	struct BoundTexture {
+		uint32_t binding;
+		std::shared_ptr<Texture> texture;
+		uint32_t generation; /**< The generation of the texture when the set was written. */
+	};
+	std::vector<BoundTexture> _textures;
 };
 
 } // namespace Stone::Render::Vulkan
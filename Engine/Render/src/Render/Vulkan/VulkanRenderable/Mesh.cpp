@@ -2,14 +2,63 @@
 
 #include "Mesh.hpp"
 
+#include "../Device.hpp"
+#include "../FramesRenderer.hpp"
+#include "Render/Vulkan/VulkanRenderer.hpp"
+#include "RenderableUtils.hpp"
+#include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Vertex.hpp"
+#include "SkinMesh.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+
 namespace Stone::Render::Vulkan {
 
-Mesh::Mesh(const std::shared_ptr<Scene::DynamicMesh> &mesh, const std::shared_ptr<VulkanRenderer> &renderer) {
-	(void)mesh;
-	(void)renderer;
+namespace {
+
+uint32_t nextMeshId = 0;
+
+/** The pending ranges of a region past which it is copied whole. */
+constexpr size_t maxPendingRanges = 64;
+
+template <typename T>
+void splitVertex(const T &vertex, size_t index, std::byte *positions, std::byte *attributes) {
+	constexpr size_t positionStride = positionStreamStride<T>();
+	constexpr size_t attributeStride = attributeStreamStride<T>();
+
+	auto bytes = reinterpret_cast<const std::byte *>(&vertex);
+	std::memcpy(positions + index * positionStride, bytes, positionStride);
+	std::memcpy(attributes + index * attributeStride, bytes + positionStride, attributeStride);
+}
+
+} // namespace
+
+Mesh::Mesh(const std::shared_ptr<Scene::DynamicMesh> &mesh, const std::shared_ptr<VulkanRenderer> &renderer)
+	: _device(renderer->getDevice()), _id(nextMeshId++), _vertexFormat(mesh->getVertexFormat()),
+	  _streamed(mesh->isStreamed()), _frameCount(renderer->getFramesRenderer()->getFrameCount()) {
+	// The quantization bounds would move with the streamed vertices, the positions are kept in half floats.
+	if (_streamed && _vertexFormat == Scene::VertexFormat::Quantized) {
+		_vertexFormat = Scene::VertexFormat::Packed;
+	}
+	_computeBoundingSphere(mesh);
+	_copyMeshlets(mesh);
+	_createVertexBuffer(mesh);
+	_createIndexBuffer(mesh);
+}
+
+Mesh::Mesh(const std::shared_ptr<SkinMesh> &skinMesh, const std::shared_ptr<VulkanRenderer> &renderer)
+	: _device(renderer->getDevice()), _skinMesh(skinMesh), _id(nextMeshId++),
+	  _boundingSphere(skinMesh->getBoundingSphere()), _indexBuffer(skinMesh->getIndexBuffer()),
+	  _indexCount(skinMesh->getIndexCount()), _indexType(skinMesh->getIndexType()) {
+	_createPosedVertexBuffer(skinMesh->getVertexCount());
 }
 
 Mesh::~Mesh() {
+	_destroyIndexBuffer();
+	_destroyVertexBuffer();
 }
 
 void Mesh::render(Scene::RenderContext &context) {
@@ -18,4 +67,307 @@ void Mesh::render(Scene::RenderContext &context) {
 	(void)vulkanContext;
 }
 
+void Mesh::update(const std::shared_ptr<Scene::DynamicMesh> &mesh) {
+	const std::vector<Scene::Vertex> &vertices = mesh->getVertices();
+	const std::vector<Scene::VertexRange> &ranges = mesh->getDirtyVertexRanges();
+
+	// The ranges are only reported while the indices and meshlets are kept.
+	if (_streamed && !ranges.empty() && vertices.size() == _vertexCount) {
+		for (Scene::VertexRange range : ranges) {
+			range.first = std::min<size_t>(range.first, _vertexCount);
+			range.count = std::min<size_t>(range.count, _vertexCount - range.first);
+			if (range.count == 0) {
+				continue;
+			}
+			_writeHostVertices(vertices, range);
+			_growBoundingSphere(vertices, range);
+			_addPendingRange(range);
+		}
+		return;
+	}
+
+	// The previous buffers may still be read by the frames in flight, their destruction is deferred.
+	_destroyIndexBuffer();
+	_destroyVertexBuffer();
+	_positionTransform = glm::mat4(1.0f);
+	_boundingSphere = glm::vec4(0.0f);
+	_computeBoundingSphere(mesh);
+	_copyMeshlets(mesh);
+	_createVertexBuffer(mesh);
+	_createIndexBuffer(mesh);
+}
+
+void Mesh::stream(uint32_t frameIndex) {
+	if (!_streamed || _vertexBufferMapped == nullptr) {
+		return;
+	}
+
+	_regionOffset = _regionSize * frameIndex;
+	auto region = static_cast<std::byte *>(_vertexBufferMapped) + _regionOffset;
+	auto [positionStride, attributeStride] = _getStreamStrides();
+	for (const Scene::VertexRange &range : _pendingRanges[frameIndex]) {
+		std::memcpy(region + range.first * positionStride, _hostVertices.data() + range.first * positionStride,
+					range.count * positionStride);
+		VkDeviceSize attributes = _attributeOffset + range.first * attributeStride;
+		std::memcpy(region + attributes, _hostVertices.data() + attributes, range.count * attributeStride);
+	}
+	_pendingRanges[frameIndex].clear();
+}
+
+void Mesh::bind(VkCommandBuffer commandBuffer, VertexStreams streams) const {
+	VkBuffer vertexBuffers[] = {_vertexBuffer, _vertexBuffer};
+	VkDeviceSize offsets[] = {_regionOffset, _regionOffset + _attributeOffset};
+	uint32_t bindingCount = streams == VertexStreams::All ? 2 : 1;
+	vkCmdBindVertexBuffers(commandBuffer, 0, bindingCount, vertexBuffers, offsets);
+
+	vkCmdBindIndexBuffer(commandBuffer, _indexBuffer, 0, _indexType);
+}
+
+void Mesh::_computeBoundingSphere(const std::shared_ptr<Scene::DynamicMesh> &mesh) {
+	const std::vector<Scene::Vertex> &vertices = mesh->getVertices();
+	if (vertices.empty()) {
+		return;
+	}
+
+	glm::vec3 min = vertices.front().position;
+	glm::vec3 max = vertices.front().position;
+	for (const Scene::Vertex &vertex : vertices) {
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+
+	glm::vec3 center = (min + max) * 0.5f;
+	float radius = 0.0f;
+	for (const Scene::Vertex &vertex : vertices) {
+		radius = std::max(radius, glm::length(vertex.position - center));
+	}
+	_boundingSphere = glm::vec4(center, radius);
+
+	if (_vertexFormat != Scene::VertexFormat::Quantized) {
+		return;
+	}
+
+	// A uniform scale keeps the bounding sphere a sphere, moved in the quantized space like the positions.
+	glm::vec3 size = max - min;
+	float extent = std::max({size.x, size.y, size.z});
+	if (extent <= 0.0f) {
+		extent = 1.0f;
+	}
+	_positionTransform = glm::scale(glm::translate(glm::mat4(1.0f), min), glm::vec3(extent));
+	_boundingSphere = glm::vec4((center - min) / extent, radius / extent);
+}
+
+void Mesh::_growBoundingSphere(const std::vector<Scene::Vertex> &vertices, const Scene::VertexRange &range) {
+	// The streamed positions are not quantized, the sphere is in object space.
+	glm::vec3 center(_boundingSphere);
+	float radius = _boundingSphere.w;
+	for (size_t i = range.first; i < range.first + range.count; ++i) {
+		glm::vec3 offset = vertices[i].position - center;
+		float distance = glm::length(offset);
+		if (distance <= radius) {
+			continue;
+		}
+		// The smallest sphere enclosing the previous one and the vertex.
+		float newRadius = (radius + distance) * 0.5f;
+		center += offset * ((newRadius - radius) / distance);
+		radius = newRadius;
+	}
+	_boundingSphere = glm::vec4(center, radius);
+}
+
+void Mesh::_copyMeshlets(const std::shared_ptr<Scene::DynamicMesh> &mesh) {
+	// The bounds and cones of the meshlets of a streamed mesh would not follow its vertices.
+	if (_streamed) {
+		_meshlets.clear();
+		return;
+	}
+	_meshlets = mesh->getMeshlets();
+
+	// The position transform is a translation and a uniform scale, the cone axes are left unchanged.
+	glm::vec3 origin(_positionTransform[3]);
+	float extent = _positionTransform[0][0];
+	for (Scene::Meshlet &meshlet : _meshlets) {
+		glm::vec3 center = (glm::vec3(meshlet.boundingSphere) - origin) / extent;
+		meshlet.boundingSphere = glm::vec4(center, meshlet.boundingSphere.w / extent);
+	}
+}
+
+void Mesh::_createVertexBuffer(const std::shared_ptr<Scene::DynamicMesh> &mesh) {
+	const std::vector<Scene::Vertex> &vertices = mesh->getVertices();
+	_vertexCount = static_cast<uint32_t>(vertices.size());
+
+	if (_streamed) {
+		_createStreamedVertexBuffer(mesh);
+		return;
+	}
+
+	switch (_vertexFormat) {
+	case Scene::VertexFormat::Float: {
+		_uploadVertexBuffer(vertices);
+		break;
+	}
+	case Scene::VertexFormat::Packed: {
+		std::vector<Scene::PackedVertex> packedVertices;
+		packedVertices.reserve(vertices.size());
+		for (const Scene::Vertex &vertex : vertices) {
+			packedVertices.push_back(Scene::packVertex(vertex));
+		}
+		_uploadVertexBuffer(packedVertices);
+		break;
+	}
+	case Scene::VertexFormat::Quantized: {
+		glm::vec3 origin(_positionTransform[3]);
+		float extent = _positionTransform[0][0];
+		std::vector<Scene::QuantizedVertex> quantizedVertices;
+		quantizedVertices.reserve(vertices.size());
+		for (const Scene::Vertex &vertex : vertices) {
+			quantizedVertices.push_back(Scene::quantizeVertex(vertex, origin, extent));
+		}
+		_uploadVertexBuffer(quantizedVertices);
+		break;
+	}
+	}
+}
+
+template <typename T>
+void Mesh::_uploadVertexBuffer(const std::vector<T> &vertices) {
+	VkDeviceSize bufferSize = sizeof(T) * vertices.size();
+	_attributeOffset = positionStreamStride<T>() * vertices.size();
+
+	auto [stagingBuffer, stagingBufferMemory] =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	void *data;
+	vkMapMemory(_device->getDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
+	// The interleaved vertices are split into the position stream followed by the attribute stream.
+	auto positions = static_cast<std::byte *>(data);
+	auto attributes = positions + _attributeOffset;
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		splitVertex(vertices[i], i, positions, attributes);
+	}
+	vkUnmapMemory(_device->getDevice(), stagingBufferMemory);
+
+	std::tie(_vertexBuffer, _vertexBufferMemory) =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	_device->bufferCopy(_vertexBuffer, stagingBuffer, bufferSize);
+
+	_device->destroyBuffer(stagingBuffer, stagingBufferMemory);
+}
+
+void Mesh::_createPosedVertexBuffer(uint32_t vertexCount) {
+	VkDeviceSize bufferSize = sizeof(Scene::Vertex) * vertexCount;
+	_attributeOffset = positionStreamStride<Scene::Vertex>() * vertexCount;
+
+	std::tie(_vertexBuffer, _vertexBufferMemory) =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void Mesh::_createStreamedVertexBuffer(const std::shared_ptr<Scene::DynamicMesh> &mesh) {
+	const std::vector<Scene::Vertex> &vertices = mesh->getVertices();
+	auto [positionStride, attributeStride] = _getStreamStrides();
+
+	VkDeviceSize vertexSize = (positionStride + attributeStride) * vertices.size();
+	_attributeOffset = positionStride * vertices.size();
+	_hostVertices.resize(vertexSize);
+	_writeHostVertices(vertices, {0, vertices.size()});
+
+	// The regions start on 16 bytes, aligned for every attribute format.
+	_regionSize = (vertexSize + 15) & ~VkDeviceSize(15);
+	_regionOffset = 0;
+	std::tie(_vertexBuffer, _vertexBufferMemory) =
+		_device->createBuffer(_regionSize * _frameCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	vkMapMemory(_device->getDevice(), _vertexBufferMemory, 0, _regionSize * _frameCount, 0, &_vertexBufferMapped);
+	for (uint32_t i = 0; i < _frameCount; ++i) {
+		std::memcpy(static_cast<std::byte *>(_vertexBufferMapped) + _regionSize * i, _hostVertices.data(),
+					_hostVertices.size());
+	}
+	_pendingRanges.assign(_frameCount, {});
+}
+
+void Mesh::_writeHostVertices(const std::vector<Scene::Vertex> &vertices, const Scene::VertexRange &range) {
+	std::byte *positions = _hostVertices.data();
+	std::byte *attributes = positions + _attributeOffset;
+	for (size_t i = range.first; i < range.first + range.count; ++i) {
+		if (_vertexFormat == Scene::VertexFormat::Float) {
+			splitVertex(vertices[i], i, positions, attributes);
+		} else {
+			splitVertex(Scene::packVertex(vertices[i]), i, positions, attributes);
+		}
+	}
+}
+
+void Mesh::_addPendingRange(const Scene::VertexRange &range) {
+	for (std::vector<Scene::VertexRange> &pendingRanges : _pendingRanges) {
+		// A region missing many updates, not drawn for a while, is copied whole.
+		if (pendingRanges.size() >= maxPendingRanges) {
+			pendingRanges.assign(1, {0, _vertexCount});
+		} else if (pendingRanges.size() != 1 || pendingRanges.front().count != _vertexCount) {
+			pendingRanges.push_back(range);
+		}
+	}
+}
+
+std::pair<size_t, size_t> Mesh::_getStreamStrides() const {
+	switch (_vertexFormat) {
+	case Scene::VertexFormat::Packed:
+		return {positionStreamStride<Scene::PackedVertex>(), attributeStreamStride<Scene::PackedVertex>()};
+	case Scene::VertexFormat::Quantized:
+		return {positionStreamStride<Scene::QuantizedVertex>(), attributeStreamStride<Scene::QuantizedVertex>()};
+	case Scene::VertexFormat::Float: break;
+	}
+	return {positionStreamStride<Scene::Vertex>(), attributeStreamStride<Scene::Vertex>()};
+}
+
+void Mesh::_destroyVertexBuffer() {
+	if (_vertexBufferMapped != nullptr) {
+		vkUnmapMemory(_device->getDevice(), _vertexBufferMemory);
+		_vertexBufferMapped = nullptr;
+	}
+	if (_device) {
+		_device->releaseBuffer(_vertexBuffer, _vertexBufferMemory);
+	}
+	_vertexBuffer = VK_NULL_HANDLE;
+	_vertexBufferMemory = VK_NULL_HANDLE;
+}
+
+void Mesh::_createIndexBuffer(const std::shared_ptr<Scene::DynamicMesh> &mesh) {
+	const std::vector<uint32_t> &indices = mesh->getIndices();
+	_indexCount = static_cast<uint32_t>(indices.size());
+	_indexType = indexTypeForVertexCount(mesh->getVertices().size());
+	std::vector<uint8_t> indexData = packIndices(indices, _indexType);
+
+	VkDeviceSize bufferSize = indexData.size();
+
+	auto [stagingBuffer, stagingBufferMemory] =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	void *data;
+	vkMapMemory(_device->getDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
+	std::memcpy(data, indexData.data(), (size_t)bufferSize);
+	vkUnmapMemory(_device->getDevice(), stagingBufferMemory);
+
+	std::tie(_indexBuffer, _indexBufferMemory) =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	_device->bufferCopy(_indexBuffer, stagingBuffer, bufferSize);
+
+	_device->destroyBuffer(stagingBuffer, stagingBufferMemory);
+}
+
+void Mesh::_destroyIndexBuffer() {
+	// The index buffer of a posed mesh belongs to its skin mesh.
+	if (_device && _skinMesh == nullptr) {
+		_device->releaseBuffer(_indexBuffer, _indexBufferMemory);
+		_indexBuffer = VK_NULL_HANDLE;
+		_indexBufferMemory = VK_NULL_HANDLE;
+	}
+}
+
 } // namespace Stone::Render::Vulkan
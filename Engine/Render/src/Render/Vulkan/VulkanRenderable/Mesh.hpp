@@ -3,13 +3,21 @@
 #pragma once
 
 #include "../RenderContext.hpp"
+#include "../Utilities/VertexBinding.hpp"
 #include "Scene/Renderable/IRenderable.hpp"
+#include "Scene/Renderable/Meshlet.hpp"
+#include "Scene/Vertex.hpp"
 
+#include <cstddef>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <utility>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 namespace Stone::Scene {
 class DynamicMesh;
+struct VertexRange;
 } // namespace Stone::Scene
 
 namespace Stone::Render::Vulkan {
@@ -17,15 +25,159 @@ namespace Stone::Render::Vulkan {
 class VulkanRenderer;
 class Device;
 class RenderPass;
+class SkinMesh;
 class SwapChain;
 
+/**
+ * GPU copy of a mesh, shared by every node drawing it.
+ *
+ * The vertices are uploaded in the vertex format of the source mesh. Quantized positions are stored relative to the
+ * bounds of the mesh, the nodes drawing it apply the position transform before their model matrix.
+ *
+ * The vertex buffer holds the position stream of every vertex followed by their attribute stream, so the depth only
+ * passes fetch the positions alone.
+ *
+ * The meshlets of the source mesh are kept on the host with their bounds moved to the space of the stored positions,
+ * the culling pass uploads them as clusters every frame.
+ *
+ * A streamed mesh keeps its vertices in a persistently mapped host visible buffer, with a region per frame in flight.
+ * The dirty ranges of an update are written to a host copy, and each region receives them when its frame is rendered,
+ * after its fence is signaled. Quantized streamed meshes are stored Packed, since their bounds change with the
+ * vertices, and their meshlets are dropped.
+ */
 class Mesh : public Scene::IRendererObject {
 public:
 	Mesh(const std::shared_ptr<Scene::DynamicMesh> &mesh, const std::shared_ptr<VulkanRenderer> &renderer);
 
+	/**
+	 * Creates the posed copy of a skin mesh owned by one node.
+	 * The vertex buffer is written by the skinning pass, the index buffer is shared with the skin mesh.
+	 *
+	 * @param skinMesh The skin mesh to pose, kept alive by the posed mesh.
+	 * @param renderer The renderer owning the device.
+	 */
+	Mesh(const std::shared_ptr<SkinMesh> &skinMesh, const std::shared_ptr<VulkanRenderer> &renderer);
+
 	~Mesh() override;
 
 	void render(Scene::RenderContext &context) override;
+
+	/**
+	 * Updates the mesh from its dirty source.
+	 * A streamed mesh keeping its vertex count only writes the dirty vertex ranges, the other meshes are uploaded
+	 * again. The vertex format and the streaming of the mesh are kept.
+	 *
+	 * @param mesh The source mesh, its dirty vertex ranges not yet cleared.
+	 */
+	void update(const std::shared_ptr<Scene::DynamicMesh> &mesh);
+
+	/**
+	 * Copies the vertices modified since the region of a frame was last written, and binds this region next.
+	 * Does nothing for the meshes not streamed.
+	 *
+	 * @param frameIndex The frame in flight being recorded, its fence already waited.
+	 */
+	void stream(uint32_t frameIndex);
+
+	/**
+	 * Binds the vertex streams and the index buffer of the mesh.
+	 *
+	 * @param commandBuffer The command buffer to record into.
+	 * @param streams The streams read by the bound pipeline.
+	 */
+	void bind(VkCommandBuffer commandBuffer, VertexStreams streams = VertexStreams::All) const;
+
+	[[nodiscard]] uint32_t getIndexCount() const {
+		return _indexCount;
+	}
+
+	[[nodiscard]] VkIndexType getIndexType() const {
+		return _indexType;
+	}
+
+	[[nodiscard]] VkBuffer getVertexBuffer() const {
+		return _vertexBuffer;
+	}
+
+	/** Offset of the attribute stream in the vertex buffer, the position stream starts at 0. Per region if streamed. */
+	[[nodiscard]] VkDeviceSize getAttributeOffset() const {
+		return _attributeOffset;
+	}
+
+	[[nodiscard]] bool isStreamed() const {
+		return _streamed;
+	}
+
+	/** Layout of the vertex buffer, selecting the pipelines able to draw the mesh. */
+	[[nodiscard]] Scene::VertexFormat getVertexFormat() const {
+		return _vertexFormat;
+	}
+
+	/** Transform from the stored positions to object space, the dequantization of Quantized meshes or identity. */
+	[[nodiscard]] const glm::mat4 &getPositionTransform() const {
+		return _positionTransform;
+	}
+
+	/** Sphere containing the vertices, center in xyz and radius in w, in the space of the stored positions. */
+	[[nodiscard]] const glm::vec4 &getBoundingSphere() const {
+		return _boundingSphere;
+	}
+
+	/** Meshlets of the source mesh, bounds in the space of the stored positions. Empty for posed skin meshes. */
+	[[nodiscard]] const std::vector<Scene::Meshlet> &getMeshlets() const {
+		return _meshlets;
+	}
+
+	/** Small identifier used to group the draws of the same mesh in the render queue. */
+	[[nodiscard]] uint32_t getId() const {
+		return _id;
+	}
+
+private:
+	void _computeBoundingSphere(const std::shared_ptr<Scene::DynamicMesh> &mesh);
+	void _growBoundingSphere(const std::vector<Scene::Vertex> &vertices, const Scene::VertexRange &range);
+	void _copyMeshlets(const std::shared_ptr<Scene::DynamicMesh> &mesh);
+
+	void _createVertexBuffer(const std::shared_ptr<Scene::DynamicMesh> &mesh);
+	template <typename T>
+	void _uploadVertexBuffer(const std::vector<T> &vertices);
+	void _createPosedVertexBuffer(uint32_t vertexCount);
+	void _createStreamedVertexBuffer(const std::shared_ptr<Scene::DynamicMesh> &mesh);
+	void _writeHostVertices(const std::vector<Scene::Vertex> &vertices, const Scene::VertexRange &range);
+	void _addPendingRange(const Scene::VertexRange &range);
+	[[nodiscard]] std::pair<size_t, size_t> _getStreamStrides() const;
+	void _destroyVertexBuffer();
+
+	void _createIndexBuffer(const std::shared_ptr<Scene::DynamicMesh> &mesh);
+	void _destroyIndexBuffer();
+
+	std::shared_ptr<Device> _device;
+	std::shared_ptr<SkinMesh> _skinMesh; /**< Owns the index buffer of a posed mesh. */
+
+	uint32_t _id;
+	glm::vec4 _boundingSphere = glm::vec4(0.0f);
+	Scene::VertexFormat _vertexFormat = Scene::VertexFormat::Float;
+	glm::mat4 _positionTransform = glm::mat4(1.0f);
+	std::vector<Scene::Meshlet> _meshlets;
+
+	VkBuffer _vertexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _vertexBufferMemory = VK_NULL_HANDLE;
+	VkDeviceSize _attributeOffset = 0;
+	uint32_t _vertexCount = 0;
+
+	bool _streamed = false;
+	uint32_t _frameCount = 1;
+	void *_vertexBufferMapped = nullptr;
+	VkDeviceSize _regionSize = 0;
+	VkDeviceSize _regionOffset = 0;			/**< Region bound by the draws, the one of the frame last streamed. */
+	std::vector<std::byte> _hostVertices;	/**< Host copy of a region, in the layout of the vertex buffer. */
+	std::vector<std::vector<Scene::VertexRange>> _pendingRanges; /**< Ranges not yet copied, per region. */
+
+	VkBuffer _indexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _indexBufferMemory = VK_NULL_HANDLE;
+	uint32_t _indexCount = 0;
+	VkIndexType _indexType = VK_INDEX_TYPE_UINT32; /**< 16-bit for the meshes with less than 65536 vertices. */
+	// TODO: Use only one buffer for vertices and indices and use offsets
 };
 
 } // namespace Stone::Render::Vulkan
@@ -2,7 +2,9 @@
 
 #pragma once
 
+#include "../PipelineCache.hpp"
 #include "../RenderContext.hpp"
+#include "../RenderQueue.hpp"
 #include "Scene/Renderable/IRenderable.hpp"
 
 #include <vector>
@@ -15,9 +17,8 @@ class MeshNode;
 namespace Stone::Render::Vulkan {
 
 class VulkanRenderer;
-class Device;
-class RenderPass;
-class SwapChain;
+class Material;
+class Mesh;
 
 class MeshNode : public Scene::IRendererObject {
 public:
@@ -27,51 +28,66 @@ public:
 
 	void render(Scene::RenderContext &context) override;
 
-private:
-	void _updateUniformBuffers(Vulkan::RenderContext &context);
-
-	void _createDescriptorSetLayout();
-	void _destroyDescriptorSetLayout();
-
-	void _createGraphicPipeline(const std::shared_ptr<RenderPass> &renderPass, VkExtent2D extent);
-	void _destroyGraphicPipeline();
-
-	void _createVertexBuffer();
-	void _destroyVertexBuffer();
-
-	void _createIndexBuffer();
-	void _destroyIndexBuffer();
-
-	void _createUniformBuffers(const std::shared_ptr<SwapChain> &swapChain);
-	void _destroyUniformBuffers();
-
-	void _createDescriptorPool(const std::shared_ptr<SwapChain> &swapChain);
-	void _destroyDescriptorPool();
-
-	void _createDescriptorSets(const std::shared_ptr<SwapChain> &swapChain);
-	void _destroyDescriptorSets();
-
-	std::shared_ptr<Device> _device;
-
-	std::weak_ptr<Scene::MeshNode> _sceneMeshNode;
-
-	VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
-
-	VkPipeline _graphicPipeline = VK_NULL_HANDLE;
-	VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
-
-	VkBuffer _vertexBuffer = VK_NULL_HANDLE;
-	VkDeviceMemory _vertexBufferMemory = VK_NULL_HANDLE;
-	VkBuffer _indexBuffer = VK_NULL_HANDLE;
-	VkDeviceMemory _indexBufferMemory = VK_NULL_HANDLE;
-	// TODO: Use only one buffer for vertices and indices and use offsets
-
-	std::vector<VkBuffer> _uniformBuffers;
-	std::vector<VkDeviceMemory> _uniformBuffersMemory;
-	std::vector<void *> _uniformBuffersMapped;
-
-	VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
-	std::vector<VkDescriptorSet> _descriptorSets;
+	/**
+	 * Records the draw of the node, skipping the binds already done by the previous draw.
+	 * Only reads the node so it can be called from several threads at once.
+	 *
+	 * @param commandBuffer The command buffer to record into, with the frame uniforms already bound.
+	 * @param modelMatrix The world matrix of the node.
+	 * @param boundState The state bound in the command buffer, updated with the binds of this draw.
+	 */
+	void recordDraw(VkCommandBuffer commandBuffer, const glm::mat4 &modelMatrix, BoundDrawState &boundState) const;
+
+	/**
+	 * Records the depth prepass draw of the node, binding only the position stream of its mesh.
+	 * Only reads the node so it can be called from several threads at once.
+	 *
+	 * @param commandBuffer The command buffer to record into, with the frame uniforms already bound.
+	 * @param modelMatrix The world matrix of the node.
+	 * @param boundState The state bound in the command buffer, updated with the binds of this draw.
+	 */
+	void recordDepthDraw(VkCommandBuffer commandBuffer, const glm::mat4 &modelMatrix, BoundDrawState &boundState) const;
+
+	[[nodiscard]] const std::shared_ptr<Mesh> &getMesh() const {
+		return _mesh;
+	}
+
+	[[nodiscard]] const std::shared_ptr<Material> &getMaterial() const {
+		return _material;
+	}
+
+	[[nodiscard]] bool isStatic() const {
+		return _static;
+	}
+
+	/**
+	 * Sets whether the node is static, the shadows cast by static nodes are cached.
+	 *
+	 * @param isStatic True if the node keeps its transform and mesh.
+	 */
+	virtual void setStatic(bool isStatic);
+
+protected:
+	/**
+	 * Creates a node drawing the given mesh, for the nodes providing their own mesh.
+	 *
+	 * @param mesh The mesh to draw, the node draws nothing when it is null.
+	 * @param material The material of the draws, may be null.
+	 * @param renderer The renderer providing the pipeline.
+	 */
+	MeshNode(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material,
+			 const std::shared_ptr<VulkanRenderer> &renderer);
+
+	/** Requests the pipeline of the node once its material is prepared, the pipeline depends on the material set. */
+	void _requestGraphicPipeline();
+
+	std::shared_ptr<PipelineCache> _pipelineCache;
+	std::shared_ptr<Mesh> _mesh;
+	std::shared_ptr<Material> _material;
+	const GraphicPipeline *_graphicPipeline = nullptr; /**< Owned by the pipeline cache, null until requested. */
+	uint32_t _materialRevision = 0; /**< The revision of the material the pipeline was requested for. */
+	const GraphicPipeline *_depthPipeline = nullptr; /**< Null unless the renderer has a depth prepass. */
+	bool _static = false;
 };
 
 } // namespace Stone::Render::Vulkan
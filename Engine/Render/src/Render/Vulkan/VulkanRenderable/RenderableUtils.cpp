@@ -2,6 +2,9 @@
 
 #include "RenderableUtils.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace Stone::Render::Vulkan {
 
 VkFormat imageChannelToVkFormat(Core::Image::Channel channel) {
@@ -14,6 +17,19 @@ VkFormat imageChannelToVkFormat(Core::Image::Channel channel) {
 	}
 }
 
+VkFormat blockFormatToVkFormat(Core::Image::BlockFormat format) {
+	switch (format) {
+	case Core::Image::BlockFormat::BC1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case Core::Image::BlockFormat::BC2: return VK_FORMAT_BC2_UNORM_BLOCK;
+	case Core::Image::BlockFormat::BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+	case Core::Image::BlockFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+	case Core::Image::BlockFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+	case Core::Image::BlockFormat::BC6H: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+	case Core::Image::BlockFormat::BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+	default: throw std::runtime_error("Unsupported block format");
+	}
+}
+
 VkFilter textureFilterToVkFilter(Scene::TextureFilter filter) {
 	switch (filter) {
 	case Scene::TextureFilter::Nearest: return VK_FILTER_NEAREST;
@@ -33,4 +49,69 @@ VkSamplerAddressMode textureWrapToVkSamplerAddressMode(Scene::TextureWrap wrap)
 	}
 }
 
+VkSamplerMipmapMode textureFilterToVkSamplerMipmapMode(Scene::TextureFilter filter) {
+	switch (filter) {
+	case Scene::TextureFilter::Nearest: return VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	case Scene::TextureFilter::Linear:
+	case Scene::TextureFilter::Cubic: return VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	default: throw std::runtime_error("Unsupported texture filter");
+	}
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+		++levels;
+	}
+	return levels;
+}
+
+std::vector<uint8_t> downsamplePixels(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pixelSize,
+									  uint32_t levels) {
+	std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * pixelSize);
+	for (uint32_t i = 0; i < levels; ++i) {
+		uint32_t halfWidth = std::max(width / 2, 1u);
+		uint32_t halfHeight = std::max(height / 2, 1u);
+		std::vector<uint8_t> half(static_cast<size_t>(halfWidth) * halfHeight * pixelSize);
+		for (uint32_t y = 0; y < halfHeight; ++y) {
+			// The last row and column of a side of 1 are sampled twice.
+			size_t row0 = static_cast<size_t>(std::min(y * 2, height - 1)) * width;
+			size_t row1 = static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width;
+			for (uint32_t x = 0; x < halfWidth; ++x) {
+				size_t column0 = std::min(x * 2, width - 1);
+				size_t column1 = std::min(x * 2 + 1, width - 1);
+				uint8_t *target = &half[(static_cast<size_t>(y) * halfWidth + x) * pixelSize];
+				for (uint32_t c = 0; c < pixelSize; ++c) {
+					uint32_t sum = level[(row0 + column0) * pixelSize + c] + level[(row0 + column1) * pixelSize + c] +
+								   level[(row1 + column0) * pixelSize + c] + level[(row1 + column1) * pixelSize + c];
+					target[c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+		level = std::move(half);
+		width = halfWidth;
+		height = halfHeight;
+	}
+	return level;
+}
+
+VkIndexType indexTypeForVertexCount(size_t vertexCount) {
+	return vertexCount < 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+std::vector<uint8_t> packIndices(const std::vector<uint32_t> &indices, VkIndexType indexType) {
+	if (indexType == VK_INDEX_TYPE_UINT32) {
+		std::vector<uint8_t> bytes(indices.size() * sizeof(uint32_t));
+		std::memcpy(bytes.data(), indices.data(), bytes.size());
+		return bytes;
+	}
+
+	std::vector<uint8_t> bytes(indices.size() * sizeof(uint16_t));
+	auto narrowed = reinterpret_cast<uint16_t *>(bytes.data());
+	for (size_t i = 0; i < indices.size(); ++i) {
+		narrowed[i] = static_cast<uint16_t>(indices[i]);
+	}
+	return bytes;
+}
+
 } // namespace Stone::Render::Vulkan
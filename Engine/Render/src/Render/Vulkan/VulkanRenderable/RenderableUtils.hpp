@@ -5,14 +5,42 @@
 #include "Core/Image/ImageTypes.hpp"
 #include "Scene/Renderable/Texture.hpp"
 
+#include <cstdint>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace Stone::Render::Vulkan {
 
 VkFormat imageChannelToVkFormat(Core::Image::Channel channel);
 
+VkFormat blockFormatToVkFormat(Core::Image::BlockFormat format);
+
 VkFilter textureFilterToVkFilter(Scene::TextureFilter filter);
 
 VkSamplerAddressMode textureWrapToVkSamplerAddressMode(Scene::TextureWrap wrap);
 
+VkSamplerMipmapMode textureFilterToVkSamplerMipmapMode(Scene::TextureFilter filter);
+
+/** Number of levels of a full mip chain, down to a 1x1 level. */
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+/**
+ * Halves 8 bit pixels as many times as requested with a box filter, following the sizes of a mip chain.
+ *
+ * @param pixels The pixels row by row.
+ * @param width The width of the pixels.
+ * @param height The height of the pixels.
+ * @param pixelSize The bytes of a pixel, one per channel.
+ * @param levels The number of halvings, the level of the mip chain returned.
+ * @return The pixels of the level, max(1, width >> levels) by max(1, height >> levels).
+ */
+std::vector<uint8_t> downsamplePixels(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pixelSize,
+									  uint32_t levels);
+
+/** The smallest index type addressing the vertices, 16-bit indices below 65536 vertices. */
+VkIndexType indexTypeForVertexCount(size_t vertexCount);
+
+/** The indices narrowed to the index type, as the bytes of the index buffer. */
+std::vector<uint8_t> packIndices(const std::vector<uint32_t> &indices, VkIndexType indexType);
+
 } // namespace Stone::Render::Vulkan
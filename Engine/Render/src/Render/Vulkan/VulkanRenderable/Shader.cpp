@@ -2,11 +2,84 @@
 
 #include "Shader.hpp"
 
+#include "Render/Vulkan/VulkanRenderer.hpp"
+#include "Scene/Renderable/Shader.hpp"
+#include "Utils/FileSystem.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+
 namespace Stone::Render::Vulkan {
 
-Shader::Shader(const std::shared_ptr<Scene::Shader> &shader, const std::shared_ptr<VulkanRenderer> &renderer) {
-	(void)shader;
-	(void)renderer;
+namespace {
+
+std::optional<VkShaderStageFlagBits> stageFromFileName(const std::string &path) {
+	std::string fileName = std::filesystem::path(path).filename().string();
+	if (fileName.find("vert") != std::string::npos) {
+		return VK_SHADER_STAGE_VERTEX_BIT;
+	}
+	if (fileName.find("frag") != std::string::npos) {
+		return VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	if (fileName.find("comp") != std::string::npos) {
+		return VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	return std::nullopt;
+}
+
+std::shared_future<std::vector<char>> readyCode(std::vector<char> code) {
+	std::promise<std::vector<char>> promise;
+	promise.set_value(std::move(code));
+	return promise.get_future().share();
+}
+
+} // namespace
+
+ShaderVariant::ShaderVariant(std::shared_future<std::vector<char>> code, std::string function, uint32_t mask,
+							 uint64_t key, std::optional<ShaderSource> source)
+	: _code(std::move(code)), _function(std::move(function)), _mask(mask), _key(key == 0 ? 1 : key),
+	  _source(std::move(source)) {
+}
+
+bool ShaderVariant::isReady() const {
+	return _code.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+const std::vector<char> &ShaderVariant::getCode() const {
+	return _code.get();
+}
+
+const ShaderReflection &ShaderVariant::getReflection() const {
+	// A failed reflection leaves the flag unset and throws again on the next request.
+	std::call_once(_reflected, [this]() { _reflection = reflectShader(getCode()); });
+	return _reflection;
+}
+
+Shader::Shader(const std::shared_ptr<Scene::Shader> &shader, const std::shared_ptr<VulkanRenderer> &renderer)
+	: _compiler(renderer->getShaderCompiler()), _keywords(shader->getKeywords()) {
+	_source.entryPoint = shader->getFunction();
+	auto [contentType, content] = shader->getContent();
+	switch (contentType) {
+	case Scene::Shader::ContentType::SourceCode: _source.code = content; break;
+	case Scene::Shader::ContentType::SourceFile:
+		_source.path = content;
+		_source.stage = stageFromFileName(content);
+		break;
+	case Scene::Shader::ContentType::CompiledCode:
+		_compiledCode = readyCode(std::vector<char>(content.begin(), content.end()));
+		_keywords.clear();
+		break;
+	case Scene::Shader::ContentType::CompiledFile:
+		_compiledCode = readyCode(Utils::readBinaryFile(content));
+		_keywords.clear();
+		break;
+	}
+	// The SPIR-V is hashed like an inline code to identify the single variant of a compiled shader.
+	if (_compiledCode.valid()) {
+		const std::vector<char> &code = _compiledCode.get();
+		_source.code.assign(code.begin(), code.end());
+	}
 }
 
 Shader::~Shader() {
@@ -16,4 +89,33 @@ void Shader::render(Scene::RenderContext &context) {
 	(void)context;
 }
 
+const std::shared_ptr<ShaderVariant> &Shader::getVariant(uint32_t mask) {
+	mask &= _keywords.size() < 32 ? (1u << _keywords.size()) - 1 : ~0u;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto it = _variants.find(mask);
+	if (it != _variants.end()) {
+		return it->second;
+	}
+
+	ShaderSource source = _source;
+	for (size_t i = 0; i < _keywords.size(); ++i) {
+		if ((mask >> i) & 1u) {
+			source.defines.emplace_back(_keywords[i], "1");
+		}
+	}
+	uint64_t key = ShaderCompiler::computeSourceKey(source);
+
+	std::shared_future<std::vector<char>> code = _compiledCode;
+	std::optional<ShaderSource> fileSource;
+	if (!code.valid()) {
+		if (!source.path.empty()) {
+			fileSource = source;
+		}
+		code = _compiler->compileAsync(std::move(source));
+	}
+	auto variant = std::make_shared<ShaderVariant>(std::move(code), _source.entryPoint, mask, key, fileSource);
+	return _variants.emplace(mask, std::move(variant)).first->second;
+}
+
 } // namespace Stone::Render::Vulkan
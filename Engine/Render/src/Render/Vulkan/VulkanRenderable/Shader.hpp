@@ -2,8 +2,17 @@
 
 #pragma once
 
+#include "../ShaderCompiler.hpp"
+#include "../ShaderReflection.hpp"
 #include "Scene/Renderable/IRenderable.hpp"
 
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace Stone::Scene {
@@ -14,12 +23,112 @@ namespace Stone::Render::Vulkan {
 
 class VulkanRenderer;
 
+/**
+ * The SPIR-V of a variant of a shader, compiled with the keywords of its mask defined.
+ *
+ * The interface of the SPIR-V is reflected once, on first request, to derive the layouts of the pipelines using it.
+ */
+class ShaderVariant {
+public:
+	ShaderVariant() = delete;
+
+	/**
+	 * @param code The future SPIR-V of the variant.
+	 * @param function The entry point of the shader.
+	 * @param mask The keywords defined in the variant.
+	 * @param key Identifies the variant between runs, see ShaderCompiler::computeSourceKey.
+	 * @param source The description of a variant compiled from a file, to compile it again in another run.
+	 */
+	ShaderVariant(std::shared_future<std::vector<char>> code, std::string function, uint32_t mask, uint64_t key,
+				  std::optional<ShaderSource> source);
+	ShaderVariant(const ShaderVariant &) = delete;
+
+	/** Whether the SPIR-V is available without waiting, or the compilation failed. */
+	[[nodiscard]] bool isReady() const;
+
+	/**
+	 * Returns the SPIR-V of the variant, waiting for its compilation.
+	 *
+	 * @throws std::runtime_error When the variant failed to compile.
+	 */
+	[[nodiscard]] const std::vector<char> &getCode() const;
+
+	/**
+	 * Returns the descriptors, push constants and vertex inputs of the variant, waiting for its compilation.
+	 *
+	 * @throws std::runtime_error When the variant failed to compile or to be reflected.
+	 */
+	[[nodiscard]] const ShaderReflection &getReflection() const;
+
+	/** The entry point of the shader. */
+	[[nodiscard]] const std::string &getFunction() const {
+		return _function;
+	}
+
+	/** The keywords defined in the variant, a bit per keyword of the shader. */
+	[[nodiscard]] uint32_t getMask() const {
+		return _mask;
+	}
+
+	/** Identifies the variant between runs, the same for the variants of identical shaders. Never 0. */
+	[[nodiscard]] uint64_t getKey() const {
+		return _key;
+	}
+
+	/** The description of a variant compiled from a file, empty for the other variants. */
+	[[nodiscard]] const std::optional<ShaderSource> &getSource() const {
+		return _source;
+	}
+
+private:
+	std::shared_future<std::vector<char>> _code;
+	std::string _function;
+	uint32_t _mask;
+	uint64_t _key;
+	std::optional<ShaderSource> _source;
+
+	mutable std::once_flag _reflected;
+	mutable ShaderReflection _reflection;
+};
+
+/**
+ * The variants of a shader of the scene.
+ *
+ * The GLSL shaders are compiled by the shader compiler of the renderer on its worker threads, or read from its cache,
+ * while the compiled ones are read as they are. The stage of a GLSL file is guessed from its name (`vert`, `frag` or
+ * `comp`), an inline code declares it with `#pragma shader_stage`.
+ *
+ * A variant is compiled on its first request, with the keywords of its mask defined to 1. Listed in the variant
+ * manifest of the compiler, the variants of a build are compiled ahead of time into the cache.
+ */
 class Shader : public Scene::IRendererObject {
 public:
 	Shader(const std::shared_ptr<Scene::Shader> &shader, const std::shared_ptr<VulkanRenderer> &renderer);
 	~Shader() override;
 
 	void render(Scene::RenderContext &context) override;
+
+	/**
+	 * Returns a variant of the shader, starting its compilation on first request.
+	 *
+	 * @param mask The keywords defined in the variant, the bits past the keywords of the shader are ignored. A
+	 * compiled shader has the single variant 0.
+	 * @return The variant.
+	 */
+	[[nodiscard]] const std::shared_ptr<ShaderVariant> &getVariant(uint32_t mask);
+
+	[[nodiscard]] const std::vector<std::string> &getKeywords() const {
+		return _keywords;
+	}
+
+private:
+	std::shared_ptr<ShaderCompiler> _compiler;
+	ShaderSource _source;
+	std::vector<std::string> _keywords;
+	std::shared_future<std::vector<char>> _compiledCode; /**< The SPIR-V of a compiled shader, invalid for GLSL. */
+
+	std::mutex _mutex;
+	std::unordered_map<uint32_t, std::shared_ptr<ShaderVariant>> _variants;
 };
 
 } // namespace Stone::Render::Vulkan
@@ -0,0 +1,117 @@
+// Copyright 2024 Stone-Engine
+
+#include "SkinMesh.hpp"
+
+#include "../Device.hpp"
+#include "Render/Vulkan/VulkanRenderer.hpp"
+#include "RenderableUtils.hpp"
+#include "Scene/Renderable/SkinMesh.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Stone::Render::Vulkan {
+
+SkinMesh::SkinMesh(const std::shared_ptr<Scene::DynamicSkinMesh> &skinMesh,
+				   const std::shared_ptr<VulkanRenderer> &renderer)
+	: _device(renderer->getDevice()) {
+	_computeBoundingSphere(skinMesh);
+	_createSourceBuffer(skinMesh);
+	_createIndexBuffer(skinMesh);
+}
+
+SkinMesh::~SkinMesh() {
+	_destroyIndexBuffer();
+	_destroySourceBuffer();
+}
+
+void SkinMesh::render(Scene::RenderContext &context) {
+	assert(dynamic_cast<Vulkan::RenderContext *>(&context));
+	auto vulkanContext = reinterpret_cast<Vulkan::RenderContext *>(&context);
+	(void)vulkanContext;
+}
+
+void SkinMesh::_computeBoundingSphere(const std::shared_ptr<Scene::DynamicSkinMesh> &skinMesh) {
+	const std::vector<Scene::WeightVertex> &vertices = skinMesh->getVertices();
+	if (vertices.empty()) {
+		return;
+	}
+
+	glm::vec3 min = vertices.front().position;
+	glm::vec3 max = vertices.front().position;
+	for (const Scene::WeightVertex &vertex : vertices) {
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+
+	glm::vec3 center = (min + max) * 0.5f;
+	float radius = 0.0f;
+	for (const Scene::WeightVertex &vertex : vertices) {
+		radius = std::max(radius, glm::length(vertex.position - center));
+	}
+	_boundingSphere = glm::vec4(center, radius);
+}
+
+void SkinMesh::_createSourceBuffer(const std::shared_ptr<Scene::DynamicSkinMesh> &skinMesh) {
+	const std::vector<Scene::WeightVertex> &vertices = skinMesh->getVertices();
+	_vertexCount = static_cast<uint32_t>(vertices.size());
+
+	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+
+	auto [stagingBuffer, stagingBufferMemory] =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	void *data;
+	vkMapMemory(_device->getDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
+	std::memcpy(data, vertices.data(), (size_t)bufferSize);
+	vkUnmapMemory(_device->getDevice(), stagingBufferMemory);
+
+	std::tie(_sourceBuffer, _sourceBufferMemory) =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	_device->bufferCopy(_sourceBuffer, stagingBuffer, bufferSize);
+
+	_device->destroyBuffer(stagingBuffer, stagingBufferMemory);
+}
+
+void SkinMesh::_destroySourceBuffer() {
+	if (_device) {
+		_device->releaseBuffer(_sourceBuffer, _sourceBufferMemory);
+	}
+}
+
+void SkinMesh::_createIndexBuffer(const std::shared_ptr<Scene::DynamicSkinMesh> &skinMesh) {
+	const std::vector<uint32_t> &indices = skinMesh->getIndices();
+	_indexCount = static_cast<uint32_t>(indices.size());
+	_indexType = indexTypeForVertexCount(skinMesh->getVertices().size());
+	std::vector<uint8_t> indexData = packIndices(indices, _indexType);
+
+	VkDeviceSize bufferSize = indexData.size();
+
+	auto [stagingBuffer, stagingBufferMemory] =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	void *data;
+	vkMapMemory(_device->getDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
+	std::memcpy(data, indexData.data(), (size_t)bufferSize);
+	vkUnmapMemory(_device->getDevice(), stagingBufferMemory);
+
+	std::tie(_indexBuffer, _indexBufferMemory) =
+		_device->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+							  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	_device->bufferCopy(_indexBuffer, stagingBuffer, bufferSize);
+
+	_device->destroyBuffer(stagingBuffer, stagingBufferMemory);
+}
+
+void SkinMesh::_destroyIndexBuffer() {
+	if (_device) {
+		_device->releaseBuffer(_indexBuffer, _indexBufferMemory);
+	}
+}
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,83 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "../RenderContext.hpp"
+#include "Scene/Renderable/IRenderable.hpp"
+
+#include <glm/vec4.hpp>
+#include <vulkan/vulkan.h>
+
+namespace Stone::Scene {
+class DynamicSkinMesh;
+} // namespace Stone::Scene
+
+namespace Stone::Render::Vulkan {
+
+class VulkanRenderer;
+class Device;
+
+/**
+ * GPU copy of a skin mesh, shared by every node drawing it.
+ *
+ * The weighted vertices are only read by the skinning pass, each node blends them into its own posed vertex buffer
+ * and draws it with the shared index buffer.
+ */
+class SkinMesh : public Scene::IRendererObject {
+public:
+	SkinMesh(const std::shared_ptr<Scene::DynamicSkinMesh> &skinMesh, const std::shared_ptr<VulkanRenderer> &renderer);
+
+	~SkinMesh() override;
+
+	void render(Scene::RenderContext &context) override;
+
+	/** Storage buffer of the weighted vertices, tightly packed Scene::WeightVertex. */
+	[[nodiscard]] VkBuffer getSourceBuffer() const {
+		return _sourceBuffer;
+	}
+
+	[[nodiscard]] VkBuffer getIndexBuffer() const {
+		return _indexBuffer;
+	}
+
+	/** 16-bit indices for the meshes with less than 65536 vertices. */
+	[[nodiscard]] VkIndexType getIndexType() const {
+		return _indexType;
+	}
+
+	[[nodiscard]] uint32_t getVertexCount() const {
+		return _vertexCount;
+	}
+
+	[[nodiscard]] uint32_t getIndexCount() const {
+		return _indexCount;
+	}
+
+	/** Sphere containing the vertices at their bind pose, center in xyz and radius in w, in object space. */
+	[[nodiscard]] const glm::vec4 &getBoundingSphere() const {
+		return _boundingSphere;
+	}
+
+private:
+	void _computeBoundingSphere(const std::shared_ptr<Scene::DynamicSkinMesh> &skinMesh);
+
+	void _createSourceBuffer(const std::shared_ptr<Scene::DynamicSkinMesh> &skinMesh);
+	void _destroySourceBuffer();
+
+	void _createIndexBuffer(const std::shared_ptr<Scene::DynamicSkinMesh> &skinMesh);
+	void _destroyIndexBuffer();
+
+	std::shared_ptr<Device> _device;
+
+	glm::vec4 _boundingSphere = glm::vec4(0.0f);
+
+	VkBuffer _sourceBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _sourceBufferMemory = VK_NULL_HANDLE;
+	VkBuffer _indexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _indexBufferMemory = VK_NULL_HANDLE;
+	uint32_t _vertexCount = 0;
+	uint32_t _indexCount = 0;
+	VkIndexType _indexType = VK_INDEX_TYPE_UINT32;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -0,0 +1,74 @@
+// Copyright 2024 Stone-Engine
+
+#include "SkinMeshNode.hpp"
+
+#include "../GpuSkinning.hpp"
+#include "../RenderContext.hpp"
+#include "Material.hpp"
+#include "Mesh.hpp"
+#include "Render/Vulkan/VulkanRenderer.hpp"
+#include "Scene/Node/SkeletonNode.hpp"
+#include "Scene/Node/SkinMeshNode.hpp"
+#include "Scene/Renderable/Material.hpp"
+#include "Scene/Renderable/SkinMesh.hpp"
+#include "SkinMesh.hpp"
+
+namespace Stone::Render::Vulkan {
+
+static std::shared_ptr<SkinMesh> getSkinMesh(const std::shared_ptr<Scene::SkinMeshNode> &skinMeshNode) {
+	return skinMeshNode->getSkinMesh() ? skinMeshNode->getSkinMesh()->getRendererObject<SkinMesh>() : nullptr;
+}
+
+static std::shared_ptr<Mesh> createPosedMesh(const std::shared_ptr<SkinMesh> &skinMesh,
+											 const std::shared_ptr<VulkanRenderer> &renderer) {
+	if (skinMesh == nullptr || skinMesh->getVertexCount() == 0) {
+		return nullptr;
+	}
+	return std::make_shared<Mesh>(skinMesh, renderer);
+}
+
+SkinMeshNode::SkinMeshNode(const std::shared_ptr<Scene::SkinMeshNode> &skinMeshNode,
+						   const std::shared_ptr<VulkanRenderer> &renderer)
+	: MeshNode(createPosedMesh(getSkinMesh(skinMeshNode), renderer),
+			   skinMeshNode->getMaterial() ? skinMeshNode->getMaterial()->getRendererObject<Material>() : nullptr,
+			   renderer),
+	  _sceneSkinMeshNode(skinMeshNode), _skinMesh(getSkinMesh(skinMeshNode)),
+	  _gpuSkinning(renderer->getGpuSkinning()) {
+	if (_mesh) {
+		_vertexSet = _gpuSkinning->createVertexSet(_skinMesh->getSourceBuffer(), _mesh->getVertexBuffer());
+	}
+}
+
+SkinMeshNode::~SkinMeshNode() {
+	if (_vertexSet.descriptorSet != VK_NULL_HANDLE) {
+		_gpuSkinning->freeVertexSet(_vertexSet);
+	}
+}
+
+void SkinMeshNode::render(Scene::RenderContext &context) {
+	assert(dynamic_cast<Vulkan::RenderContext *>(&context));
+	auto vulkanContext = reinterpret_cast<Vulkan::RenderContext *>(&context);
+
+	if (_mesh == nullptr) {
+		return;
+	}
+
+	// Without a skeleton the vertices are posed once at their bind pose.
+	_boneMatrices.clear();
+	std::shared_ptr<Scene::SkinMeshNode> sceneSkinMeshNode = _sceneSkinMeshNode.lock();
+	std::shared_ptr<Scene::SkeletonNode> skeleton = sceneSkinMeshNode ? sceneSkinMeshNode->getSkeleton() : nullptr;
+	if (skeleton) {
+		skeleton->computeBoneMatrices(sceneSkinMeshNode, _boneMatrices);
+	}
+
+	// The posed buffer keeps the vertices of the last dispatch, they are only blended again when the pose changed.
+	if (!_posed || _boneMatrices != _posedBoneMatrices) {
+		vulkanContext->skinning->push(_vertexSet.descriptorSet, _skinMesh->getVertexCount(), _boneMatrices);
+		_posedBoneMatrices = _boneMatrices;
+		_posed = true;
+	}
+
+	MeshNode::render(context);
+}
+
+} // namespace Stone::Render::Vulkan
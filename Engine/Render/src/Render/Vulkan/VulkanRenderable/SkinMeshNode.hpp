@@ -0,0 +1,46 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "../DescriptorAllocator.hpp"
+#include "MeshNode.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <vector>
+
+namespace Stone::Scene {
+class SkinMeshNode;
+} // namespace Stone::Scene
+
+namespace Stone::Render::Vulkan {
+
+class GpuSkinning;
+class SkinMesh;
+
+/**
+ * Draws a skin mesh posed by the GPU skinning pass.
+ *
+ * The node owns the posed vertex buffer of its skin mesh and is drawn like a mesh node once posed. The skinning is
+ * only dispatched in the frames where the bone matrices changed, a still character keeps its posed vertices.
+ */
+class SkinMeshNode : public MeshNode {
+public:
+	SkinMeshNode(const std::shared_ptr<Scene::SkinMeshNode> &skinMeshNode,
+				 const std::shared_ptr<VulkanRenderer> &renderer);
+
+	~SkinMeshNode() override;
+
+	void render(Scene::RenderContext &context) override;
+
+private:
+	std::weak_ptr<Scene::SkinMeshNode> _sceneSkinMeshNode;
+	std::shared_ptr<SkinMesh> _skinMesh;
+	std::shared_ptr<GpuSkinning> _gpuSkinning;
+	DescriptorAllocation _vertexSet;
+
+	std::vector<glm::mat4> _boneMatrices;
+	std::vector<glm::mat4> _posedBoneMatrices; /**< The matrices of the last dispatch. */
+	bool _posed = false;
+};
+
+} // namespace Stone::Render::Vulkan
@@ -6,24 +6,70 @@
 #include "../RenderContext.hpp"
 #include "../RenderPass.hpp"
 #include "../SwapChain.hpp"
+#include "../TextureStreamer.hpp"
+#include "Core/Image/BlockCompression.hpp"
 #include "Core/Image/ImageData.hpp"
 #include "Core/Image/ImageSource.hpp"
 #include "Render/Vulkan/VulkanRenderer.hpp"
 #include "RenderableUtils.hpp"
 #include "Scene/Renderable/Texture.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 
 namespace Stone::Render::Vulkan {
 
+namespace {
+
+/** Moves every level of a sampled image between the shader layout and the transfer source layout. */
+void transitionSampledImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels, VkImageLayout oldLayout,
+							VkImageLayout newLayout) {
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	// Only reads are ordered, the layout changes once the frames submitted before stopped sampling the image.
+	bool toTransfer = newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = toTransfer ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT;
+	VkPipelineStageFlags sourceStage =
+		toTransfer ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+	VkPipelineStageFlags destinationStage =
+		toTransfer ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+} // namespace
+
 Texture::Texture(const std::shared_ptr<Scene::Texture> &texture, const std::shared_ptr<VulkanRenderer> &renderer)
-	: _device(renderer->getDevice()), _sceneTexture(texture) {
-	_createTextureImage();
-	_createTextureImageView();
+	: _device(renderer->getDevice()), _streamer(renderer->getTextureStreamer()), _sceneTexture(texture) {
+	_describeMipChain(*texture->getImage()->getLoadedImage(true));
+	// The first image is waited for, the materials bind its view as soon as they are created.
+	_pendingImage = _loadTextureImage(_residentMip);
+	_device->waitSubmission(_pendingImage->submission);
+	_adoptPendingImage();
 	_createTextureSampler();
+	if (_streamer) {
+		_streamer->add(this);
+	}
 }
 
 Texture::~Texture() {
+	if (_streamer) {
+		_streamer->remove(this);
+	}
+	_releasePendingImage();
 	_destroyTextureImageView();
 	_destroyTextureImage();
 	_destroyTextureSampler();
@@ -40,54 +86,281 @@ VkSampler Texture::getSampler() const {
 	return _textureSampler;
 }
 
+void Texture::requestFootprint(float footprint) {
+	_footprint = std::max(_footprint, footprint);
+}
+
+void Texture::clearFootprint() {
+	_footprint = 0.0f;
+}
+
+uint32_t Texture::getMipForFootprint(float footprint) const {
+	float texels = static_cast<float>(std::max(_width, _height));
+	if (footprint >= texels) {
+		return 0;
+	}
+	auto mip = static_cast<uint32_t>(std::log2(texels / std::max(footprint, 1.0f)));
+	return std::min(mip, _coarsestMip);
+}
+
+VkDeviceSize Texture::getResidentSize(uint32_t mip) const {
+	VkDeviceSize size = 0;
+	for (uint32_t level = mip; level < _levelSizes.size(); ++level) {
+		size += _levelSizes[level];
+	}
+	return size;
+}
+
+void Texture::setResidentMip(uint32_t mip) {
+	mip = std::min(mip, _coarsestMip);
+	if (_pendingImage || mip == _residentMip) {
+		return;
+	}
+
+	if (mip > _residentMip) {
+		_pendingImage = _copyTextureImage(mip);
+	} else if (!_sceneTexture.expired()) {
+		_pendingImage = _loadTextureImage(mip);
+	}
+}
+
+bool Texture::updatePendingMip() {
+	if (!_pendingImage || !_device->isSubmissionComplete(_pendingImage->submission)) {
+		return false;
+	}
+	_adoptPendingImage();
+	return true;
+}
+
+void Texture::_describeMipChain(const Core::Image::ImageData &image) {
+	_width = static_cast<uint32_t>(image.getSize().x);
+	_height = static_cast<uint32_t>(image.getSize().y);
+	_storedMipChain = image.isCompressed() && _device->getEnabledFeatures().textureCompressionBC;
+
+	uint32_t mipCount = 1;
+	if (_storedMipChain) {
+		_format = blockFormatToVkFormat(image.getBlockFormat());
+		for (const Core::Image::MipLevel &level : image.getMipLevels()) {
+			_levelSizes.push_back(level.byteSize);
+		}
+		mipCount = static_cast<uint32_t>(_levelSizes.size());
+	} else {
+		// Devices that cannot sample BC formats get the first level decoded, the mip chain is generated again.
+		_format = image.isCompressed() ? VK_FORMAT_R8G8B8A8_UNORM : imageChannelToVkFormat(image.getChannels());
+		_pixelSize = image.isCompressed() ? 4 : static_cast<uint32_t>(image.getDataSize() / (_width * _height));
+		// Formats the device cannot blit keep a single level rather than failing the upload.
+		mipCount = _device->supportsLinearBlit(_format) ? mipLevelCount(_width, _height) : 1;
+		for (uint32_t level = 0; level < mipCount; ++level) {
+			_levelSizes.push_back(VkDeviceSize(std::max(_width >> level, 1u)) * std::max(_height >> level, 1u) *
+								  _pixelSize);
+		}
+	}
+
+	// A streamed texture starts at the largest level within the start size.
+	uint32_t startSize = _streamer ? _streamer->getStartSize() : 0;
+	_coarsestMip = 0;
+	while (startSize > 0 && _coarsestMip + 1 < mipCount &&
+		   std::max(_width >> _coarsestMip, _height >> _coarsestMip) > startSize) {
+		++_coarsestMip;
+	}
+	_residentMip = _coarsestMip;
+}
+
 
-void Texture::_createTextureImage() {
+Texture::PendingImage Texture::_loadTextureImage(uint32_t mip) {
 	auto texture = _sceneTexture.lock();
 	const std::shared_ptr<Core::Image::ImageData> &image = texture->getImage()->getLoadedImage(true);
 
-	VkDeviceSize imageSize = image->getSize().x * image->getSize().y * static_cast<int>(image->getChannels());
-	auto [stagingBuffer, stagingBufferMemory] =
-		_device->createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	PendingImage pendingImage;
+	if (_storedMipChain) {
+		// Block compressed images are uploaded as stored, mip chain included from the first level.
+		std::vector<Core::Image::MipLevel> levels(image->getMipLevels().begin() + mip, image->getMipLevels().end());
+		size_t offset = levels.front().offset;
+		for (Core::Image::MipLevel &level : levels) {
+			level.offset -= offset;
+		}
+		pendingImage = _uploadTextureImage(image->getData() + offset, image->getDataSize() - offset, levels, mip);
+	} else {
+		const uint8_t *pixels = image->getData();
+		std::vector<uint8_t> decodedPixels;
+		if (image->isCompressed()) {
+			decodedPixels = Core::Image::decodeBlocks(image->getBlockFormat(), image->getData(), image->getSize());
+			pixels = decodedPixels.data();
+		}
+		// The levels above the first one are skipped on the host, the GPU generates the ones below it.
+		std::vector<uint8_t> residentPixels;
+		if (mip > 0) {
+			residentPixels = downsamplePixels(pixels, _width, _height, _pixelSize, mip);
+			pixels = residentPixels.data();
+		}
 
-	void *data;
-	vkMapMemory(_device->getDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-	std::memcpy(data, image->getData(), static_cast<size_t>(imageSize));
-	vkUnmapMemory(_device->getDevice(), stagingBufferMemory);
+		Core::Image::MipLevel level;
+		level.size = Core::Image::Size(std::max(_width >> mip, 1u), std::max(_height >> mip, 1u));
+		level.byteSize = _levelSizes[mip];
+		pendingImage = _uploadTextureImage(pixels, level.byteSize, {level}, mip);
+	}
 
 	texture->getImage()->unloadData();
+	return pendingImage;
+}
+
+Texture::PendingImage Texture::_copyTextureImage(uint32_t mip) {
+	// The levels kept are already on the device, the image is not read again.
+	PendingImage pendingImage;
+	pendingImage.residentMip = mip;
+	pendingImage.mipLevels = static_cast<uint32_t>(_levelSizes.size()) - mip;
 
-	std::tie(_textureImage, _textureImageMemory) = _device->createImage(
-		image->getSize().x, image->getSize().y, 1, VK_SAMPLE_COUNT_1_BIT, imageChannelToVkFormat(image->getChannels()),
-		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	uint32_t width = std::max(_width >> mip, 1u);
+	uint32_t height = std::max(_height >> mip, 1u);
+	std::tie(pendingImage.image, pendingImage.memory) = _device->createImage(
+		width, height, pendingImage.mipLevels, VK_SAMPLE_COUNT_1_BIT, _format, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	_device->transitionImageLayout(_textureImage, imageChannelToVkFormat(image->getChannels()),
-								   VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	std::vector<VkImageCopy> regions;
+	for (uint32_t level = 0; level < pendingImage.mipLevels; ++level) {
+		VkImageCopy region = {};
+		region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.srcSubresource.mipLevel = mip - _residentMip + level;
+		region.srcSubresource.baseArrayLayer = 0;
+		region.srcSubresource.layerCount = 1;
+		region.dstSubresource = region.srcSubresource;
+		region.dstSubresource.mipLevel = level;
+		region.extent = {std::max(width >> level, 1u), std::max(height >> level, 1u), 1};
+		regions.push_back(region);
+	}
 
-	_device->copyBufferToImage(stagingBuffer, _textureImage, image->getSize().x, image->getSize().y);
+	// The frames in flight sample the current image, it is back in the shader layout for the frames submitted next.
+	pendingImage.submission = _device->submitSingleCommandBuffer([&](VkCommandBuffer commandBuffer) {
+		transitionSampledImage(commandBuffer, _textureImage, _mipLevels, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+							   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		_device->transitionImageLayout(pendingImage.image, _format, VK_IMAGE_LAYOUT_UNDEFINED,
+									   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, pendingImage.mipLevels, commandBuffer);
 
-	_device->transitionImageLayout(_textureImage, imageChannelToVkFormat(image->getChannels()),
-								   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		vkCmdCopyImage(commandBuffer, _textureImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, pendingImage.image,
+					   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
 
-	vkDestroyBuffer(_device->getDevice(), stagingBuffer, nullptr);
-	vkFreeMemory(_device->getDevice(), stagingBufferMemory, nullptr);
+		transitionSampledImage(commandBuffer, _textureImage, _mipLevels, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+							   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		_device->transitionImageLayout(pendingImage.image, _format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+									   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, pendingImage.mipLevels,
+									   commandBuffer);
+	});
+	return pendingImage;
+}
+
+Texture::PendingImage Texture::_uploadTextureImage(const uint8_t *data, VkDeviceSize dataSize,
+												   const std::vector<Core::Image::MipLevel> &storedLevels,
+												   uint32_t mip) {
+	PendingImage pendingImage;
+	pendingImage.residentMip = mip;
+	pendingImage.mipLevels = static_cast<uint32_t>(_levelSizes.size()) - mip;
+
+	// The staging buffer is kept until the upload completes, see _adoptPendingImage.
+	std::tie(pendingImage.stagingBuffer, pendingImage.stagingBufferMemory) =
+		_device->createBuffer(dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+							  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	void *mapped;
+	vkMapMemory(_device->getDevice(), pendingImage.stagingBufferMemory, 0, dataSize, 0, &mapped);
+	std::memcpy(mapped, data, static_cast<size_t>(dataSize));
+	vkUnmapMemory(_device->getDevice(), pendingImage.stagingBufferMemory);
+
+	uint32_t width = storedLevels.front().size.x;
+	uint32_t height = storedLevels.front().size.y;
+	std::tie(pendingImage.image, pendingImage.memory) = _device->createImage(
+		width, height, pendingImage.mipLevels, VK_SAMPLE_COUNT_1_BIT, _format, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	std::vector<VkBufferImageCopy> regions;
+	for (uint32_t level = 0; level < storedLevels.size(); ++level) {
+		VkBufferImageCopy region = {};
+		region.bufferOffset = storedLevels[level].offset;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = {0, 0, 0};
+		region.imageExtent = {static_cast<uint32_t>(storedLevels[level].size.x),
+							  static_cast<uint32_t>(storedLevels[level].size.y), 1};
+		regions.push_back(region);
+	}
+
+	// The upload and the mip chain are recorded in a single submission.
+	pendingImage.submission = _device->submitSingleCommandBuffer([&](VkCommandBuffer commandBuffer) {
+		_device->transitionImageLayout(pendingImage.image, _format, VK_IMAGE_LAYOUT_UNDEFINED,
+									   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, pendingImage.mipLevels, commandBuffer);
+
+		vkCmdCopyBufferToImage(commandBuffer, pendingImage.stagingBuffer, pendingImage.image,
+							   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()),
+							   regions.data());
+
+		if (pendingImage.mipLevels > storedLevels.size()) {
+			_device->generateMipmaps(pendingImage.image, width, height, pendingImage.mipLevels, commandBuffer);
+		} else {
+			_device->transitionImageLayout(pendingImage.image, _format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, pendingImage.mipLevels,
+										   commandBuffer);
+		}
+	});
+	return pendingImage;
+}
+
+void Texture::_adoptPendingImage() {
+	// The descriptor sets of the materials still reference the view, the frames in flight may sample it.
+	if (_textureImage != VK_NULL_HANDLE) {
+		_destroyTextureImageView();
+		_destroyTextureImage();
+	}
+
+	PendingImage &pendingImage = *_pendingImage;
+	_device->freeSubmission(pendingImage.submission);
+	_device->destroyBuffer(pendingImage.stagingBuffer, pendingImage.stagingBufferMemory);
+	_textureImage = pendingImage.image;
+	_textureImageMemory = pendingImage.memory;
+	_residentMip = pendingImage.residentMip;
+	_mipLevels = pendingImage.mipLevels;
+	_pendingImage.reset();
+
+	_createTextureImageView();
+	++_generation;
+}
+
+void Texture::_releasePendingImage() {
+	if (!_pendingImage) {
+		return;
+	}
+	// The image may still be filled by the device, it was submitted before the frames the deletion waits for.
+	_device->getDeletionQueue().push([device = _device.get(), pendingImage = *_pendingImage]() mutable {
+		device->waitSubmission(pendingImage.submission);
+		device->freeSubmission(pendingImage.submission);
+		device->destroyBuffer(pendingImage.stagingBuffer, pendingImage.stagingBufferMemory);
+		vkDestroyImage(device->getDevice(), pendingImage.image, nullptr);
+		vkFreeMemory(device->getDevice(), pendingImage.memory, nullptr);
+	});
+	_pendingImage.reset();
 }
 
 void Texture::_destroyTextureImage() {
-	vkDestroyImage(_device->getDevice(), _textureImage, nullptr);
-	vkFreeMemory(_device->getDevice(), _textureImageMemory, nullptr);
+	_device->getDeletionQueue().push(
+		[device = _device->getDevice(), image = _textureImage, memory = _textureImageMemory]() {
+			vkDestroyImage(device, image, nullptr);
+			vkFreeMemory(device, memory, nullptr);
+		});
+	_textureImage = VK_NULL_HANDLE;
+	_textureImageMemory = VK_NULL_HANDLE;
 }
 
 void Texture::_createTextureImageView() {
-	auto texture = _sceneTexture.lock();
-	const std::shared_ptr<Core::Image::ImageData> &image = texture->getImage()->getLoadedImage(true);
-
-	_textureImageView = _device->createImageView(_textureImage, imageChannelToVkFormat(image->getChannels()));
+	_textureImageView = _device->createImageView(_textureImage, _format, VK_IMAGE_ASPECT_COLOR_BIT, _mipLevels);
 }
 
 void Texture::_destroyTextureImageView() {
-	vkDestroyImageView(_device->getDevice(), _textureImageView, nullptr);
+	_device->getDeletionQueue().push([device = _device->getDevice(), imageView = _textureImageView]() {
+		vkDestroyImageView(device, imageView, nullptr);
+	});
+	_textureImageView = VK_NULL_HANDLE;
 }
 
 void Texture::_createTextureSampler() {
@@ -107,10 +380,11 @@ void Texture::_createTextureSampler() {
 	samplerInfo.unnormalizedCoordinates = VK_FALSE;
 	samplerInfo.compareEnable = VK_FALSE;
 	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.mipmapMode = textureFilterToVkSamplerMipmapMode(texture->getMinFilter());
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
+	// The levels are counted from the resident mip of the view, the full chain covers every resident mip.
+	samplerInfo.maxLod = static_cast<float>(_levelSizes.size());
 
 	if (vkCreateSampler(_device->getDevice(), &samplerInfo, nullptr, &_textureSampler) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create texture sampler");
@@ -118,7 +392,9 @@ void Texture::_createTextureSampler() {
 }
 
 void Texture::_destroyTextureSampler() {
-	vkDestroySampler(_device->getDevice(), _textureSampler, nullptr);
+	_device->getDeletionQueue().push([device = _device->getDevice(), sampler = _textureSampler]() {
+		vkDestroySampler(device, sampler, nullptr);
+	});
 }
 
 } // namespace Stone::Render::Vulkan
@@ -2,11 +2,19 @@
 
 #pragma once
 
+#include "../Device.hpp"
 #include "../RenderContext.hpp"
+#include "Core/Image/ImageTypes.hpp"
 #include "Scene/Renderable/IRenderable.hpp"
 
+#include <optional>
+#include <vector>
 #include <vulkan/vulkan.h>
 
+namespace Stone::Core::Image {
+class ImageData;
+} // namespace Stone::Core::Image
+
 namespace Stone::Scene {
 class Texture;
 } // namespace Stone::Scene
@@ -14,10 +22,19 @@ class Texture;
 namespace Stone::Render::Vulkan {
 
 class VulkanRenderer;
-class Device;
 class RenderPass;
 class SwapChain;
-
+class TextureStreamer;
+
+/**
+ * GPU image of a texture of the scene.
+ *
+ * With texture streaming, only the levels of the mip chain from a resident mip down are in memory. The texture starts
+ * at the level of the start size of the streamer, and the streamer moves the resident mip from the footprints the
+ * draws request. Evicting levels copies the ones kept into a smaller image on the device, refining loads the image
+ * again and uploads it. Neither waits for the device: the new image is pending until its submission completes, then
+ * it replaces the image view and the materials rewrite their sets.
+ */
 class Texture : public Scene::IRendererObject {
 public:
 	Texture(const std::shared_ptr<Scene::Texture> &texture, const std::shared_ptr<VulkanRenderer> &renderer);
@@ -29,8 +46,109 @@ public:
 	[[nodiscard]] VkImageView getImageView() const;
 	[[nodiscard]] VkSampler getSampler() const;
 
+	/** Incremented whenever the image view is replaced. */
+	[[nodiscard]] uint32_t getGeneration() const {
+		return _generation;
+	}
+
+	/**
+	 * Requests the texture for a draw covering a number of pixels, kept until the streamer reads it.
+	 *
+	 * @param footprint The size of the draw on screen in pixels, the largest request is kept.
+	 */
+	void requestFootprint(float footprint);
+
+	/** The largest footprint requested since the last update of the streamer, 0 when the texture was not drawn. */
+	[[nodiscard]] float getFootprint() const {
+		return _footprint;
+	}
+
+	void clearFootprint();
+
+	/** The first level of the mip chain in memory, 0 when the texture is fully resident. */
+	[[nodiscard]] uint32_t getResidentMip() const {
+		return _residentMip;
+	}
+
+	/** The level the texture started at, the coarsest it is evicted to. */
+	[[nodiscard]] uint32_t getCoarsestMip() const {
+		return _coarsestMip;
+	}
+
+	/**
+	 * Returns the level sampled when the texture covers a footprint, a texel per pixel.
+	 *
+	 * @param footprint The size of the draw on screen in pixels.
+	 * @return The level, between 0 and the coarsest mip.
+	 */
+	[[nodiscard]] uint32_t getMipForFootprint(float footprint) const;
+
+	/**
+	 * Returns the memory taken by the levels of the mip chain from a first level down.
+	 *
+	 * @param mip The first level in memory.
+	 * @return The size of the levels in bytes.
+	 */
+	[[nodiscard]] VkDeviceSize getResidentSize(uint32_t mip) const;
+
+	/** The memory taken by the levels of the texture, a pending change counted as done. */
+	[[nodiscard]] VkDeviceSize getResidentSize() const {
+		return getResidentSize(_pendingImage ? _pendingImage->residentMip : _residentMip);
+	}
+
+	/**
+	 * Starts filling an image with the levels of the mip chain from a first level down, without waiting for the
+	 * device. Does nothing while a previous change is pending.
+	 *
+	 * @param mip The first level in memory, clamped to the coarsest mip.
+	 */
+	void setResidentMip(uint32_t mip);
+
+	/** Whether an image started by setResidentMip is still being filled. */
+	[[nodiscard]] bool hasPendingMip() const {
+		return _pendingImage.has_value();
+	}
+
+	/**
+	 * Replaces the image with the pending one once the device filled it. The previous image is destroyed once the
+	 * frames in flight completed.
+	 *
+	 * @return Whether the image was replaced.
+	 */
+	bool updatePendingMip();
+
 private:
-	void _createTextureImage();
+	/** An image being filled by the device, replacing the image of the texture once its submission completes. */
+	struct PendingImage {
+		uint32_t residentMip = 0;
+		uint32_t mipLevels = 0;
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkBuffer stagingBuffer = VK_NULL_HANDLE; /**< Holds the uploaded levels, VK_NULL_HANDLE for a copy. */
+		VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
+		SingleSubmission submission;
+	};
+
+	/** Reads the format and the levels of the full mip chain from the first load of the image. */
+	void _describeMipChain(const Core::Image::ImageData &image);
+
+	/** Loads the image of the scene texture and uploads its levels from a first level down. */
+	[[nodiscard]] PendingImage _loadTextureImage(uint32_t mip);
+
+	/** Copies the levels of the current image from a first level down, below its resident mip. */
+	[[nodiscard]] PendingImage _copyTextureImage(uint32_t mip);
+
+	/**
+	 * Creates an image of the levels of the mip chain from a first level down, uploaded from the levels stored in
+	 * data. The levels that are not stored are generated from the first one.
+	 */
+	[[nodiscard]] PendingImage _uploadTextureImage(const uint8_t *data, VkDeviceSize dataSize,
+												   const std::vector<Core::Image::MipLevel> &storedLevels,
+												   uint32_t mip);
+
+	void _adoptPendingImage();
+	void _releasePendingImage();
+
 	void _destroyTextureImage();
 
 	void _createTextureImageView();
@@ -40,11 +158,25 @@ private:
 	void _destroyTextureSampler();
 
 	std::shared_ptr<Device> _device;
+	std::shared_ptr<TextureStreamer> _streamer; /**< Null when the textures are loaded whole. */
 
 	std::weak_ptr<Scene::Texture> _sceneTexture;
 
+	VkFormat _format = VK_FORMAT_UNDEFINED;
+	uint32_t _width = 0;
+	uint32_t _height = 0;
+	uint32_t _pixelSize = 0; /**< The bytes of a pixel of the images uploaded from raw pixels. */
+	bool _storedMipChain = false; /**< Whether the levels are uploaded as stored, block compressed images. */
+	std::vector<VkDeviceSize> _levelSizes; /**< The bytes of each level of the full mip chain. */
+	uint32_t _residentMip = 0;
+	uint32_t _coarsestMip = 0;
+	uint32_t _mipLevels = 1; /**< The levels in memory, from the resident mip down. */
+	uint32_t _generation = 0;
+	float _footprint = 0.0f;
+
 	VkImage _textureImage = VK_NULL_HANDLE;
 	VkDeviceMemory _textureImageMemory = VK_NULL_HANDLE;
+	std::optional<PendingImage> _pendingImage;
 
 	VkImageView _textureImageView = VK_NULL_HANDLE;
 
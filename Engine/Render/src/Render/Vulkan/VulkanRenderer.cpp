@@ -2,61 +2,197 @@
 
 #include "Render/Vulkan/VulkanRenderer.hpp"
 
+#include "DescriptorAllocator.hpp"
+#include "DescriptorLayoutCache.hpp"
 #include "Device.hpp"
 #include "FramesRenderer.hpp"
+#include "FrameUniformBuffer.hpp"
+#include "GpuCulling.hpp"
+#include "GpuProfiler.hpp"
+#include "GpuSkinning.hpp"
+#include "LightClusters.hpp"
+#include "OffscreenTarget.hpp"
+#include "PipelineCache.hpp"
 #include "RenderPass.hpp"
+#include "RenderQueue.hpp"
+#include "SecondaryCommandBuffers.hpp"
+#include "ShaderCompiler.hpp"
+#include "ShadowMaps.hpp"
 #include "SwapChain.hpp"
+#include "TextureStreamer.hpp"
+#include "Utils/ThreadPool.hpp"
+#include "Utils/TraceRecorder.hpp"
+
+#include <algorithm>
 
 namespace Stone::Render::Vulkan {
 
-VulkanRenderer::VulkanRenderer(RendererSettings &settings) : Renderer() {
+/** Matches the sRGB surface format preferred for the swap chain, so offscreen frames look the same. */
+constexpr VkFormat offscreenImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+/** Textures whose resident mip changes in a frame, each change waits for the upload of the image. */
+constexpr uint32_t textureChangesPerFrame = 2;
+
+VulkanRenderer::VulkanRenderer(RendererSettings &settings)
+	: Renderer(), _frameSize(settings.frame_size), _presentMode(settings.presentMode),
+	  _depthPrepass(settings.depthPrepass) {
 	std::cout << "VulkanRenderer created" << std::endl;
 
 	_device = std::make_shared<Device>(settings);
+	_descriptorLayoutCache = std::make_shared<DescriptorLayoutCache>(_device);
+	_descriptorAllocator = std::make_shared<DescriptorAllocator>(_device);
+	_framesRenderer = std::make_shared<FramesRenderer>(_device, std::max(settings.framesInFlight, 1u));
 
-	SwapChainProperties swapChainProperties = _device->createSwapChainProperties(settings.frame_size);
+	if (settings.headless) {
+		if (settings.frame_size.first == 0 || settings.frame_size.second == 0) {
+			throw std::runtime_error("Headless rendering requires a frame size");
+		}
+		_renderPass =
+			std::make_shared<RenderPass>(_device, offscreenImageFormat, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		// Each frame in flight renders into its own offscreen image.
+		_offscreenTarget =
+			std::make_shared<OffscreenTarget>(_device, _renderPass->getRenderPass(), offscreenImageFormat,
+											  VkExtent2D{settings.frame_size.first, settings.frame_size.second},
+											  _framesRenderer->getFrameCount());
+	} else {
+		SwapChainProperties swapChainProperties = _device->createSwapChainProperties(_frameSize, _presentMode);
+
+		_renderPass = std::make_shared<RenderPass>(_device, swapChainProperties.surfaceFormat.format);
+		_swapChain = std::make_shared<SwapChain>(_device, _renderPass->getRenderPass(), swapChainProperties);
+	}
+	_frameUniformBuffer = std::make_shared<FrameUniformBuffer>(_device, _descriptorLayoutCache, _descriptorAllocator,
+															   _framesRenderer->getFrameCount());
+
+	// The workers recording the draws also compile the shaders and create the pipelines in the background.
+	_threadPool = std::make_shared<ThreadPool>(settings.recordingWorkers.value_or(ThreadPool::defaultWorkerCount()));
+
+	_shaderCompiler = std::make_shared<ShaderCompiler>(settings.shaderCacheDirectory,
+													   std::vector<std::string>{"shaders"}, _threadPool);
+	if (!settings.shaderVariantManifest.empty()) {
+		_shaderCompiler->loadManifest(settings.shaderVariantManifest);
+	}
+	_pipelineCache =
+		std::make_shared<PipelineCache>(_device, _renderPass, _descriptorLayoutCache, _shaderCompiler, _threadPool,
+										_frameUniformBuffer->getDescriptorSetLayout(), settings.pipelineCacheFile);
+	if (!settings.pipelineManifest.empty()) {
+		_pipelineCache->loadManifest(settings.pipelineManifest);
+	}
+	_renderQueue = std::make_shared<RenderQueue>();
+
+	if (settings.gpuDrivenDrawing && GpuCulling::isSupported(_device)) {
+		_gpuCulling = std::make_shared<GpuCulling>(_device, _descriptorLayoutCache, _descriptorAllocator,
+												   _pipelineCache, _framesRenderer->getFrameCount(), _depthPrepass);
+	}
+
+	_gpuSkinning = std::make_shared<GpuSkinning>(_device, _descriptorLayoutCache, _descriptorAllocator,
+												 _framesRenderer->getFrameCount());
+
+	_lightClusters = std::make_shared<LightClusters>(_device, _descriptorLayoutCache, _descriptorAllocator,
+													 _frameUniformBuffer, _framesRenderer->getFrameCount());
+	_shadowMaps = std::make_shared<ShadowMaps>(_device, _frameUniformBuffer, _framesRenderer->getFrameCount());
+
+	if (settings.textureStreaming) {
+		_textureStreamer = std::make_shared<TextureStreamer>(settings.textureBudget, settings.textureStartSize,
+															 textureChangesPerFrame);
+	}
+
+	if (settings.profiling) {
+		_traceRecorder = std::make_shared<TraceRecorder>();
+		if (GpuProfiler::isSupported(_device)) {
+			_gpuProfiler =
+				std::make_shared<GpuProfiler>(_device, _framesRenderer->getFrameCount(), _traceRecorder.get());
+		}
+	}
 
-	_renderPass = std::make_shared<RenderPass>(_device, swapChainProperties.surfaceFormat.format);
-	_swapChain = std::make_shared<SwapChain>(_device, _renderPass->getRenderPass(), swapChainProperties);
-	_framesRenderer = std::make_shared<FramesRenderer>(_device, _swapChain->getImageCount());
-	assert(_framesRenderer->getImageCount() == _swapChain->getImageCount());
+	// Each recording thread records a chunk of the depth prepass then a chunk of the shaded draws.
+	uint32_t passCount = _depthPrepass ? 2 : 1;
+	_secondaryCommandBuffers = std::make_shared<SecondaryCommandBuffers>(
+		_device, _framesRenderer->getFrameCount(), passCount * static_cast<uint32_t>(_threadPool->getThreadCount()));
 }
 
 VulkanRenderer::~VulkanRenderer() {
 	if (_device) {
 		_device->waitIdle();
+		processFrameCaptures(true);
+		// No frame is in flight anymore, the resources released from now on are destroyed at once.
+		_device->getDeletionQueue().flush();
 	}
 
+	_secondaryCommandBuffers.reset();
+	_threadPool.reset();
+	_gpuProfiler.reset();
+	_traceRecorder.reset();
+	_textureStreamer.reset();
+	_shadowMaps.reset();
+	_lightClusters.reset();
+	_gpuSkinning.reset();
+	_gpuCulling.reset();
+	_renderQueue.reset();
+	_pipelineCache.reset();
+	_shaderCompiler.reset();
+	_frameUniformBuffer.reset();
 	_framesRenderer.reset();
+	_retiredSwapChains.clear();
 	_swapChain.reset();
+	_offscreenTarget.reset();
 	_renderPass.reset();
+	_descriptorAllocator.reset();
+	_descriptorLayoutCache.reset();
 	_device.reset();
 
 	std::cout << "VulkanRenderer destroyed" << std::endl;
 }
 
 void VulkanRenderer::updateFrameSize(std::pair<uint32_t, uint32_t> size) {
-	_recreateSwapChain(size);
+	_frameSize = size;
+	if (_offscreenTarget) {
+		_recreateOffscreenTarget();
+	} else {
+		// Resizing a window sends many sizes, the swap chain is only recreated for the next frame.
+		_swapChainOutdated = true;
+	}
 }
 
-void VulkanRenderer::_recreateSwapChain(std::pair<uint32_t, uint32_t> size) {
-	if (_device == nullptr) {
-		return;
-	}
+void VulkanRenderer::setPresentMode(VkPresentModeKHR presentMode) {
+	_presentMode = presentMode;
+	_swapChainOutdated = _swapChain != nullptr;
+}
 
-	_device->waitIdle();
+bool VulkanRenderer::_recreateSwapChain() {
+	SwapChainProperties swapChainProperties = _device->createSwapChainProperties(_frameSize, _presentMode);
+	if (swapChainProperties.extent.width == 0 || swapChainProperties.extent.height == 0) {
+		return false;
+	}
 
-	_swapChain.reset();
+	auto swapChain = std::make_shared<SwapChain>(_device, _renderPass->getRenderPass(), swapChainProperties,
+												 _swapChain ? _swapChain->getSwapChain() : VK_NULL_HANDLE);
+	if (_swapChain) {
+		// The frames recorded so far may still use the images, each frame in flight must be waited on once more.
+		_retiredSwapChains.push_back({std::move(_swapChain), _frameNumber + _framesRenderer->getFrameCount()});
+	}
+	_swapChain = std::move(swapChain);
+	_swapChainOutdated = false;
+	return true;
+}
 
-	SwapChainProperties swapChainSettings = _device->createSwapChainProperties(size);
-	_swapChain = std::make_shared<SwapChain>(_device, _renderPass->getRenderPass(), swapChainSettings);
+void VulkanRenderer::_releaseRetiredSwapChains() {
+	std::erase_if(_retiredSwapChains,
+				  [this](const RetiredSwapChain &retired) { return _frameNumber >= retired.releaseFrame; });
+}
 
-	if (_framesRenderer == nullptr || _framesRenderer->getImageCount() != _swapChain->getImageCount()) {
-		_framesRenderer.reset();
-		_framesRenderer = std::make_shared<FramesRenderer>(_device, _swapChain->getImageCount());
+void VulkanRenderer::_recreateOffscreenTarget() {
+	if (_device == nullptr) {
+		return;
 	}
 
-	assert(_framesRenderer->getImageCount() == _swapChain->getImageCount());
+	_device->waitIdle();
+	// The captured frames are read from the images about to be destroyed.
+	processFrameCaptures(true);
+
+	_offscreenTarget.reset();
+	_offscreenTarget = std::make_shared<OffscreenTarget>(_device, _renderPass->getRenderPass(), offscreenImageFormat,
+														 VkExtent2D{_frameSize.first, _frameSize.second},
+														 _framesRenderer->getFrameCount());
 }
 
 const std::shared_ptr<Device> &VulkanRenderer::getDevice() const {
@@ -75,5 +211,82 @@ const std::shared_ptr<SwapChain> &VulkanRenderer::getSwapChain() const {
 	return _swapChain;
 }
 
+const std::shared_ptr<FrameUniformBuffer> &VulkanRenderer::getFrameUniformBuffer() const {
+	return _frameUniformBuffer;
+}
+
+const std::shared_ptr<DescriptorLayoutCache> &VulkanRenderer::getDescriptorLayoutCache() const {
+	return _descriptorLayoutCache;
+}
+
+const std::shared_ptr<DescriptorAllocator> &VulkanRenderer::getDescriptorAllocator() const {
+	return _descriptorAllocator;
+}
+
+const std::shared_ptr<PipelineCache> &VulkanRenderer::getPipelineCache() const {
+	return _pipelineCache;
+}
+
+const std::shared_ptr<OffscreenTarget> &VulkanRenderer::getOffscreenTarget() const {
+	return _offscreenTarget;
+}
+
+const std::shared_ptr<GpuSkinning> &VulkanRenderer::getGpuSkinning() const {
+	return _gpuSkinning;
+}
+
+const std::shared_ptr<TextureStreamer> &VulkanRenderer::getTextureStreamer() const {
+	return _textureStreamer;
+}
+
+const std::shared_ptr<ShaderCompiler> &VulkanRenderer::getShaderCompiler() const {
+	return _shaderCompiler;
+}
+
+const std::shared_ptr<GpuProfiler> &VulkanRenderer::getGpuProfiler() const {
+	return _gpuProfiler;
+}
+
+const std::shared_ptr<TraceRecorder> &VulkanRenderer::getTraceRecorder() const {
+	return _traceRecorder;
+}
+
+bool VulkanRenderer::isHeadless() const {
+	return _offscreenTarget != nullptr;
+}
+
+bool VulkanRenderer::hasDepthPrepass() const {
+	return _depthPrepass;
+}
+
+VkExtent2D VulkanRenderer::_getFrameExtent() const {
+	return _offscreenTarget ? _offscreenTarget->getExtent() : _swapChain->getExtent();
+}
+
+std::future<std::shared_ptr<Core::Image::ImageData>> VulkanRenderer::captureNextFrame() {
+	if (!isHeadless()) {
+		throw std::runtime_error("Frame capture requires a headless renderer");
+	}
+	_requestedCaptures.emplace_back();
+	return _requestedCaptures.back().get_future();
+}
+
+void VulkanRenderer::processFrameCaptures(bool wait) {
+	for (auto it = _frameCaptures.begin(); it != _frameCaptures.end();) {
+		if (wait) {
+			vkWaitForFences(_device->getDevice(), 1, &it->fence, VK_TRUE, UINT64_MAX);
+		} else if (vkGetFenceStatus(_device->getDevice(), it->fence) != VK_SUCCESS) {
+			++it;
+			continue;
+		}
+
+		std::shared_ptr<Core::Image::ImageData> image = _offscreenTarget->readImage(it->imageIndex);
+		for (auto &promise : it->promises) {
+			promise.set_value(image);
+		}
+		it = _frameCaptures.erase(it);
+	}
+}
+
 
 } // namespace Stone::Render::Vulkan
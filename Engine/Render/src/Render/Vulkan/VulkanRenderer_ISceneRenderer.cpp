@@ -2,22 +2,56 @@
 
 #include "Device.hpp"
 #include "FramesRenderer.hpp"
+#include "FrameUniformBuffer.hpp"
+#include "GpuCulling.hpp"
+#include "GpuProfiler.hpp"
+#include "GpuSkinning.hpp"
+#include "LightClusters.hpp"
+#include "OffscreenTarget.hpp"
+#include "PipelineCache.hpp"
 #include "Render/Vulkan/VulkanRenderer.hpp"
 #include "RenderContext.hpp"
 #include "RendererObjectManager.hpp"
 #include "RenderPass.hpp"
+#include "RenderQueue.hpp"
 #include "Scene.hpp"
 #include "Scene/ISceneRenderer.hpp"
+#include "SecondaryCommandBuffers.hpp"
+#include "ShadowMaps.hpp"
 #include "SwapChain.hpp"
+#include "TextureStreamer.hpp"
+#include "Utils/ThreadPool.hpp"
+#include "Utils/TraceRecorder.hpp"
+#include "VulkanRenderable/MeshNode.hpp"
+
+#include <algorithm>
+#include <glm/matrix.hpp>
 
 namespace Stone::Render::Vulkan {
 
+/** Below this number of draws per thread, recording in parallel costs more than it saves. */
+constexpr size_t minDrawsPerSecondaryBuffer = 256;
+
 void VulkanRenderer::updateDataForWorld(const std::shared_ptr<Scene::WorldNode> &world) {
 	RendererObjectManager manager(std::static_pointer_cast<VulkanRenderer>(shared_from_this()));
 	world->traverseTopDown([&manager](const std::shared_ptr<Scene::Node> &node) {
 		auto renderElement = std::dynamic_pointer_cast<Scene::IRenderable>(node);
 		if (renderElement && renderElement->isDirty()) {
 			manager.updateRenderable(node);
+			return;
+		}
+		// A mesh or a material modified in place does not dirty the nodes drawing it.
+		auto meshNode = std::dynamic_pointer_cast<Scene::MeshNode>(node);
+		auto skinMeshNode = std::dynamic_pointer_cast<Scene::SkinMeshNode>(node);
+		std::shared_ptr<Scene::Material> material;
+		if (meshNode) {
+			material = meshNode->getMaterial();
+		} else if (skinMeshNode) {
+			material = skinMeshNode->getMaterial();
+		}
+		bool meshDirty = meshNode && meshNode->getMesh() && meshNode->getMesh()->isDirty();
+		if (meshDirty || (material && material->isDirty())) {
+			manager.updateRenderable(node);
 		}
 	});
 }
@@ -28,45 +62,92 @@ void VulkanRenderer::renderWorld(const std::shared_ptr<Scene::WorldNode> &world)
 		return;
 	}
 
+	ScopedTrace frameTrace(_traceRecorder.get(), "Frame");
+
 	FrameContext frameContext = _framesRenderer->newFrameContext();
 	SyncronizedObjects &syncObject = frameContext.syncObject;
+	++_frameNumber;
 
-	vkWaitForFences(_device->getDevice(), 1, &syncObject.inFlight, VK_TRUE, UINT64_MAX);
+	{
+		ScopedTrace waitTrace(_traceRecorder.get(), "Wait for frame");
+		vkWaitForFences(_device->getDevice(), 1, &syncObject.inFlight, VK_TRUE, UINT64_MAX);
+	}
+	// The fence is about to be reset, the captures it guards are read back first.
+	processFrameCaptures();
+	_releaseRetiredSwapChains();
+	// The fence of this frame was last signaled by the frame a frame count before, the frames up to it completed.
+	uint64_t frameCount = _framesRenderer->getFrameCount();
+	_device->getDeletionQueue().beginFrame(_frameNumber, _frameNumber > frameCount ? _frameNumber - frameCount : 0);
+	if (_textureStreamer) {
+		// The footprints were requested by the previous traversal, the materials pick up the new views in this one.
+		ScopedTrace streamTrace(_traceRecorder.get(), "Stream textures");
+		_textureStreamer->update();
+	}
 
 	ImageContext imageContext{};
-	VkResult result = _swapChain->acquireNextImage(syncObject.imageAvailable, imageContext);
+	if (_offscreenTarget) {
+		// Each frame in flight owns its offscreen image, it is free once the fence of the frame is signaled.
+		imageContext = _offscreenTarget->getImageContext(frameContext.frameIndex);
+	} else {
+		if (_swapChainOutdated && !_recreateSwapChain()) {
+			return;
+		}
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		std::cout << "Must recreate swap chain" << std::endl;
-	} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-		throw std::runtime_error("failed to acquire swap chain image!");
+		VkResult result = _swapChain->acquireNextImage(syncObject.imageAvailable, imageContext);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			// Nothing was acquired nor signaled, the frame is skipped and the fence stays signaled.
+			_swapChainOutdated = true;
+			return;
+		}
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			throw std::runtime_error("Failed to acquire swap chain image");
+		}
+		// A suboptimal image is still rendered and presented, the swap chain is recreated afterwards.
+		_swapChainOutdated = result == VK_SUBOPTIMAL_KHR;
 	}
 
 	vkResetFences(_device->getDevice(), 1, &syncObject.inFlight);
 
 	vkResetCommandBuffer(frameContext.commandBuffer, 0);
 
-	_recordCommandBuffer(frameContext.commandBuffer, &imageContext, world);
+	{
+		ScopedTrace recordTrace(_traceRecorder.get(), "Record");
+		_recordCommandBuffer(frameContext, &imageContext, world);
+	}
+
+	ScopedTrace submitTrace(_traceRecorder.get(), "Submit");
 
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+	// Offscreen images are not acquired nor presented, the fence of the frame is the only synchronization.
+	uint32_t semaphoreCount = _offscreenTarget ? 0 : 1;
+
 	VkSemaphore waitSemaphores[] = {syncObject.imageAvailable};
 	VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.waitSemaphoreCount = semaphoreCount;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &frameContext.commandBuffer;
 
-	VkSemaphore signalSemaphores[] = {syncObject.renderFinished};
-	submitInfo.signalSemaphoreCount = 1;
+	VkSemaphore signalSemaphores[] = {_swapChain ? _swapChain->getRenderFinishedSemaphore(imageContext.index)
+												: VK_NULL_HANDLE};
+	submitInfo.signalSemaphoreCount = semaphoreCount;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	if (vkQueueSubmit(_device->getGraphicsQueue(), 1, &submitInfo, syncObject.inFlight) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
 
+	if (_offscreenTarget) {
+		if (!_requestedCaptures.empty()) {
+			_frameCaptures.push_back({imageContext.index, syncObject.inFlight, std::move(_requestedCaptures)});
+			_requestedCaptures.clear();
+		}
+		return;
+	}
+
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
@@ -77,11 +158,18 @@ void VulkanRenderer::renderWorld(const std::shared_ptr<Scene::WorldNode> &world)
 	presentInfo.pSwapchains = swapChains;
 	presentInfo.pImageIndices = &imageContext.index;
 
-	vkQueuePresentKHR(_device->getPresentQueue(), &presentInfo);
+	VkResult result = vkQueuePresentKHR(_device->getPresentQueue(), &presentInfo);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+		_swapChainOutdated = true;
+	} else if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to present swap chain image");
+	}
 }
 
-void VulkanRenderer::_recordCommandBuffer(VkCommandBuffer commandBuffer, ImageContext *imageContext,
+void VulkanRenderer::_recordCommandBuffer(const FrameContext &frameContext, ImageContext *imageContext,
 										  const std::shared_ptr<Scene::WorldNode> &world) {
+	VkCommandBuffer commandBuffer = frameContext.commandBuffer;
+
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -89,6 +177,90 @@ void VulkanRenderer::_recordCommandBuffer(VkCommandBuffer commandBuffer, ImageCo
 		throw std::runtime_error("Failed to begin recording command buffer");
 	}
 
+	// The results of the previous use of this frame are read before its queries are reset.
+	if (_gpuProfiler) {
+		_gpuProfiler->beginFrame(commandBuffer, frameContext.frameIndex);
+	}
+
+	Vulkan::RenderContext context;
+	context.commandBuffer = commandBuffer;
+	context.extent = _getFrameExtent();
+	context.imageIndex = imageContext->index;
+	context.frameIndex = frameContext.frameIndex;
+	context.renderQueue = _renderQueue.get();
+	context.skinning = _gpuSkinning.get();
+	context.lights = _lightClusters.get();
+	context.shadows = _shadowMaps.get();
+
+	world->initializeRenderContext(context);
+
+	// The traversal only collects the draws, they are sorted to share states then recorded.
+	_renderQueue->clear();
+	_gpuSkinning->clear();
+	_lightClusters->clear();
+	_shadowMaps->clear();
+	// The nodes skip their draws until their pipelines are created, a captured frame waits for them to be complete.
+	if (!_requestedCaptures.empty()) {
+		ScopedTrace pipelinesTrace(_traceRecorder.get(), "Wait for pipelines");
+		_pipelineCache->waitIdle();
+	}
+	{
+		ScopedTrace traverseTrace(_traceRecorder.get(), "Traverse");
+		world->render(context);
+	}
+
+	// The lights gathered by the traversal set the lighting parameters of the frame uniforms.
+	FrameUniforms frameUniforms;
+	frameUniforms.viewMatrix = context.mvp.viewMatrix;
+	frameUniforms.projMatrix = context.mvp.projMatrix;
+	_lightClusters->prepare(context.frameIndex, context.mvp.projMatrix, context.extent, frameUniforms);
+	_frameUniformBuffer->update(context.frameIndex, frameUniforms);
+
+	{
+		ScopedTrace sortTrace(_traceRecorder.get(), "Sort");
+		_renderQueue->sort();
+	}
+
+	// The shadow tiles are placed once the lights requested them, the opaque draws are sorted into their casters.
+	{
+		ScopedTrace shadowTrace(_traceRecorder.get(), "Shadows");
+		_shadowMaps->prepare(context.frameIndex, *_renderQueue, context.mvp.viewMatrix);
+	}
+
+	// The posed vertices are read by every draw of the skin meshes, they are written before any pass.
+	if (_gpuSkinning->getMeshCount() > 0) {
+		GpuProfileScope skinningScope(_gpuProfiler.get(), commandBuffer, context.frameIndex, "Skinning");
+		_gpuSkinning->dispatch(commandBuffer, context.frameIndex);
+	}
+
+	// The shadows are rendered from the posed vertices, outside of the render pass sampling them.
+	if (_shadowMaps->getTileCount() > 0) {
+		GpuProfileScope shadowScope(_gpuProfiler.get(), commandBuffer, context.frameIndex, "Shadows");
+		_shadowMaps->record(commandBuffer, *_renderQueue);
+	}
+
+	// The cluster lists are read by the fragment shaders of every pass.
+	{
+		GpuProfileScope clusteringScope(_gpuProfiler.get(), commandBuffer, context.frameIndex, "Light clustering");
+		_lightClusters->dispatch(commandBuffer, context.frameIndex);
+	}
+
+	// The culling dispatch writes the indirect commands, it has to be recorded before the render pass begins.
+	if (_gpuCulling) {
+		_gpuCulling->prepare(context.frameIndex, *_renderQueue);
+		GpuProfileScope cullingScope(_gpuProfiler.get(), commandBuffer, context.frameIndex, "Culling");
+		glm::vec3 cameraPosition(glm::inverse(context.mvp.viewMatrix)[3]);
+		_gpuCulling->cull(commandBuffer, context.frameIndex, context.mvp.projMatrix * context.mvp.viewMatrix,
+						  cameraPosition);
+	}
+
+	// With a depth prepass, half of the slots record the depth of the opaque draws and the other half shades them.
+	size_t passCount = _depthPrepass ? 2 : 1;
+	size_t drawCount = _renderQueue->size();
+	size_t chunkCount = std::min<size_t>(_secondaryCommandBuffers->getSlotCount() / passCount,
+										 (drawCount + minDrawsPerSecondaryBuffer - 1) / minDrawsPerSecondaryBuffer);
+	bool useSecondaryBuffers = !_gpuCulling && chunkCount > 1;
+
 	std::array<VkClearValue, 2> clearValues = {};
 	clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
 	clearValues[1].depthStencil = {1.0f, 0};
@@ -98,38 +270,157 @@ void VulkanRenderer::_recordCommandBuffer(VkCommandBuffer commandBuffer, ImageCo
 	renderPassInfo.renderPass = _renderPass->getRenderPass();
 	renderPassInfo.framebuffer = imageContext->framebuffer;
 	renderPassInfo.renderArea.offset = {0, 0};
-	renderPassInfo.renderArea.extent = _swapChain->getExtent();
+	renderPassInfo.renderArea.extent = context.extent;
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	VkSubpassContents subpassContents =
+		useSecondaryBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+
+	// Begun outside of the render pass, its statistics query covers the secondary command buffers too.
+	if (_gpuProfiler) {
+		_gpuProfiler->beginScope(commandBuffer, context.frameIndex, "Main pass");
+	}
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, subpassContents);
+
+	if (useSecondaryBuffers) {
+		_secondaryCommandBuffers->reset(context.frameIndex);
+
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = _renderPass->getRenderPass();
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = imageContext->framebuffer;
+		inheritanceInfo.pipelineStatistics = _gpuProfiler ? _gpuProfiler->getActiveStatistics(context.frameIndex) : 0;
+
+		// The depth of every opaque draw is laid before any draw is shaded, the depth chunks are executed first.
+		size_t opaqueCount = 0;
+		while (opaqueCount < drawCount && _renderQueue->getDrawPass(opaqueCount) == DrawPass::Opaque) {
+			++opaqueCount;
+		}
+		size_t depthChunkSize = (opaqueCount + chunkCount - 1) / chunkCount;
+		size_t chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+
+		std::vector<VkCommandBuffer> secondaryBuffers(passCount * chunkCount);
+
+		_threadPool->parallelFor(secondaryBuffers.size(), [&](size_t slot) {
+			VkCommandBuffer secondaryBuffer =
+				_secondaryCommandBuffers->getCommandBuffer(context.frameIndex, static_cast<uint32_t>(slot));
+
+			VkCommandBufferBeginInfo secondaryBeginInfo = {};
+			secondaryBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			secondaryBeginInfo.flags =
+				VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			if (vkBeginCommandBuffer(secondaryBuffer, &secondaryBeginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to begin recording secondary command buffer");
+			}
+
+			_setDrawStates(secondaryBuffer, context);
+			size_t chunk = slot % chunkCount;
+			if (slot < chunkCount && _depthPrepass) {
+				size_t first = std::min(chunk * depthChunkSize, opaqueCount);
+				_recordDepthDraws(secondaryBuffer, context, first, std::min(first + depthChunkSize, opaqueCount));
+			} else {
+				size_t first = std::min(chunk * chunkSize, drawCount);
+				_recordColorDraws(secondaryBuffer, context, first, std::min(first + chunkSize, drawCount));
+			}
+
+			if (vkEndCommandBuffer(secondaryBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to record secondary command buffer");
+			}
+			secondaryBuffers[slot] = secondaryBuffer;
+		});
+
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+	} else if (_gpuProfiler && !_gpuCulling) {
+		// Timestamps cannot be written in a subpass executing secondary command buffers, only inline passes are split.
+		// The passes are contiguous in the sorted queue, each one is profiled as a group of draws.
+		for (size_t first = 0; first < drawCount;) {
+			DrawPass pass = _renderQueue->getDrawPass(first);
+			size_t last = first + 1;
+			while (last < drawCount && _renderQueue->getDrawPass(last) == pass) {
+				++last;
+			}
+
+			GpuProfileScope passScope(_gpuProfiler.get(), commandBuffer, context.frameIndex,
+									  pass == DrawPass::Opaque ? "Opaque draws" : "Transparent draws");
+			_recordDraws(commandBuffer, context, first, last);
+			first = last;
+		}
+	} else {
+		GpuProfileScope drawScope(_gpuProfiler.get(), commandBuffer, context.frameIndex, "Indirect draws");
+		_recordDraws(commandBuffer, context, 0, drawCount);
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+	if (_gpuProfiler) {
+		_gpuProfiler->endScope(commandBuffer, context.frameIndex);
+	}
+
+	if (_offscreenTarget && !_requestedCaptures.empty()) {
+		_offscreenTarget->recordReadback(commandBuffer, imageContext->index);
+	}
 
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record command buffer");
+	}
+}
+
+void VulkanRenderer::_setDrawStates(VkCommandBuffer commandBuffer, const RenderContext &context) const {
+	// Dynamic states and bound descriptor sets are not inherited by secondary command buffers.
 	VkViewport viewport = {};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(_swapChain->getExtent().width);
-	viewport.height = static_cast<float>(_swapChain->getExtent().height);
+	viewport.width = static_cast<float>(context.extent.width);
+	viewport.height = static_cast<float>(context.extent.height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
 	VkRect2D scissor = {};
 	scissor.offset = {0, 0};
-	scissor.extent = _swapChain->getExtent();
+	scissor.extent = context.extent;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	Vulkan::RenderContext context;
-	context.commandBuffer = commandBuffer;
-	context.extent = _swapChain->getExtent();
-	context.imageIndex = imageContext->index;
+	_frameUniformBuffer->bind(commandBuffer, context.frameIndex);
+}
 
-	world->initializeRenderContext(context);
-	world->render(context);
+void VulkanRenderer::_recordDraws(VkCommandBuffer commandBuffer, const RenderContext &context, size_t first,
+								  size_t last) const {
+	_setDrawStates(commandBuffer, context);
 
-	vkCmdEndRenderPass(commandBuffer);
+	if (_gpuCulling) {
+		// One indirect call per batch, the culled draws have no instance.
+		if (_depthPrepass) {
+			_gpuCulling->drawDepth(commandBuffer, context.frameIndex);
+		}
+		_gpuCulling->draw(commandBuffer, context.frameIndex);
+		return;
+	}
 
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to record command buffer");
+	if (_depthPrepass) {
+		_recordDepthDraws(commandBuffer, context, first, last);
+	}
+	_recordColorDraws(commandBuffer, context, first, last);
+}
+
+void VulkanRenderer::_recordDepthDraws(VkCommandBuffer commandBuffer, const RenderContext &context, size_t first,
+									   size_t last) const {
+	BoundDrawState depthState;
+	for (size_t i = first; i < last && context.renderQueue->getDrawPass(i) == DrawPass::Opaque; ++i) {
+		const DrawItem &drawItem = context.renderQueue->getDrawItem(i);
+		drawItem.meshNode->recordDepthDraw(commandBuffer, drawItem.modelMatrix, depthState);
+	}
+}
+
+void VulkanRenderer::_recordColorDraws(VkCommandBuffer commandBuffer, const RenderContext &context, size_t first,
+									   size_t last) const {
+	BoundDrawState boundState;
+	for (size_t i = first; i < last; ++i) {
+		const DrawItem &drawItem = context.renderQueue->getDrawItem(i);
+		drawItem.meshNode->recordDraw(commandBuffer, drawItem.modelMatrix, boundState);
 	}
 }
 
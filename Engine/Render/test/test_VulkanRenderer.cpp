@@ -1,11 +1,62 @@
+#include "Core/Image/ImageData.hpp"
 #include "Render/Vulkan/RendererSettings.hpp"
 #include "Render/Vulkan/VulkanRenderer.hpp"
+#include "Scene/Node/MeshNode.hpp"
+#include "Scene/Node/WorldNode.hpp"
+#include "Scene/Renderable/Material.hpp"
+#include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Renderable/Shader.hpp"
+#include "Utils/TraceRecorder.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
 
 using namespace Stone::Render::Vulkan;
 using namespace Stone::Scene;
 
+/** Creates a renderer drawing 64x32 frames offscreen, null when no Vulkan device is available. */
+static std::shared_ptr<VulkanRenderer> createHeadlessRenderer(bool profiling = false) {
+	RendererSettings settings;
+	settings.headless = true;
+	settings.profiling = profiling;
+	settings.frame_size = {64, 32};
+
+	try {
+		return std::make_shared<VulkanRenderer>(settings);
+	} catch (const std::runtime_error &e) {
+		std::cerr << "No Vulkan device available: " << e.what() << std::endl;
+		return nullptr;
+	}
+}
+
+/**
+ * Renders and captures frames until a pixel has the expected color, the shaders and pipelines of the world being
+ * created asynchronously.
+ *
+ * @return The color of the pixel in the last captured frame.
+ */
+static std::array<uint8_t, 4> waitForPixel(VulkanRenderer &renderer, const std::shared_ptr<WorldNode> &world, int x,
+										   int y, const std::array<uint8_t, 4> &expected) {
+	std::array<uint8_t, 4> color = {};
+	for (int frame = 0; frame < 200 && color != expected; ++frame) {
+		auto capture = renderer.captureNextFrame();
+		renderer.renderWorld(world);
+		renderer.processFrameCaptures(true);
+
+		std::shared_ptr<Stone::Core::Image::ImageData> image = capture.get();
+		const uint8_t *pixel = image->getData() + (static_cast<size_t>(y) * image->getSize().x + x) * 4;
+		std::copy(pixel, pixel + 4, color.begin());
+		if (color != expected) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	return color;
+}
+
 TEST(VulkanRender, InstanciateCore) {
 	RendererSettings settings;
 
@@ -21,3 +72,104 @@ TEST(VulkanRender, InstanciateCore) {
 		FAIL() << e.what();
 	}
 }
+
+TEST(VulkanRender, HeadlessFrameCapture) {
+	std::shared_ptr<VulkanRenderer> renderer = createHeadlessRenderer();
+	if (renderer == nullptr) {
+		GTEST_SKIP() << "No Vulkan device available";
+	}
+
+	auto world = WorldNode::create();
+	auto capture = renderer->captureNextFrame();
+	renderer->updateDataForWorld(world);
+	renderer->renderWorld(world);
+	renderer->processFrameCaptures(true);
+
+	ASSERT_EQ(capture.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+	std::shared_ptr<Stone::Core::Image::ImageData> image = capture.get();
+	EXPECT_EQ(image->getSize(), Stone::Core::Image::Size(64, 32));
+	EXPECT_EQ(image->getChannels(), Stone::Core::Image::Channel::RGBA);
+	ASSERT_EQ(image->getDataSize(), 64u * 32u * 4u);
+	// An empty world only shows the opaque black clear color.
+	EXPECT_EQ(image->getData()[3], 255);
+}
+
+TEST(VulkanRender, ProfilingTraces) {
+	std::shared_ptr<VulkanRenderer> renderer = createHeadlessRenderer(true);
+	if (renderer == nullptr) {
+		GTEST_SKIP() << "No Vulkan device available";
+	}
+
+	ASSERT_NE(renderer->getTraceRecorder(), nullptr);
+
+	// The GPU timings of a frame are read when its frame slot is recorded again.
+	auto world = WorldNode::create();
+	renderer->updateDataForWorld(world);
+	for (int i = 0; i < 4; ++i) {
+		renderer->renderWorld(world);
+	}
+
+	std::vector<Stone::TraceRecorder::Event> events = renderer->getTraceRecorder()->getEvents();
+	auto countEvents = [&events](const std::string &name, const std::string &track) {
+		return std::count_if(events.begin(), events.end(), [&](const Stone::TraceRecorder::Event &event) {
+			return event.name == name && event.track == track;
+		});
+	};
+	EXPECT_EQ(countEvents("Frame", "CPU"), 4);
+	EXPECT_EQ(countEvents("Record", "CPU"), 4);
+
+	if (renderer->getGpuProfiler()) {
+		EXPECT_GE(countEvents("Main pass", "GPU"), 1);
+	}
+}
+
+TEST(VulkanRender, MaterialKeywordToggledAfterUpdate) {
+	std::shared_ptr<VulkanRenderer> renderer = createHeadlessRenderer();
+	if (renderer == nullptr) {
+		GTEST_SKIP() << "No Vulkan device available";
+	}
+
+	auto shader = std::make_shared<Shader>(Shader::ContentType::SourceCode, R"(#version 450
+#pragma shader_stage(fragment)
+layout(location = 0) out vec4 outColor;
+void main() {
+#ifdef RED
+	outColor = vec4(1.0, 0.0, 0.0, 1.0);
+#else
+	outColor = vec4(0.0, 0.0, 1.0, 1.0);
+#endif
+}
+)");
+	shader->setKeywords({"RED"});
+	auto material = std::make_shared<Material>();
+	material->setFragmentShader(shader);
+
+	auto mesh = std::make_shared<DynamicMesh>();
+	mesh->verticesRef().resize(3);
+	mesh->verticesRef()[1].position = {1.0f, 0.0f, 0.0f};
+	mesh->verticesRef()[2].position = {0.0f, 1.0f, 0.0f};
+	mesh->indicesRef() = {0, 1, 2};
+
+	auto world = WorldNode::create();
+	auto meshNode = world->addChild<MeshNode>("mesh");
+	meshNode->setMesh(mesh);
+	meshNode->setMaterial(material);
+
+	// Without a camera the triangle is drawn in clip space, covering this pixel of the bottom right quarter.
+	const int x = 40;
+	const int y = 20;
+	const std::array<uint8_t, 4> blue = {0, 0, 255, 255};
+	const std::array<uint8_t, 4> red = {255, 0, 0, 255};
+
+	renderer->updateDataForWorld(world);
+	EXPECT_FALSE(material->isDirty());
+	EXPECT_EQ(waitForPixel(*renderer, world, x, y, blue), blue);
+
+	// The node itself stays clean, the material toggled in place is still built again with its new variant.
+	material->setKeyword("RED", true);
+	EXPECT_TRUE(material->isDirty());
+	EXPECT_EQ(material->getVariantMask(), 1u);
+	renderer->updateDataForWorld(world);
+	EXPECT_FALSE(material->isDirty());
+	EXPECT_EQ(waitForPixel(*renderer, world, x, y, red), red);
+}
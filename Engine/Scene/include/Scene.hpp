@@ -5,6 +5,7 @@
 #include "Scene/Node/CameraNode.hpp"
 #include "Scene/Node/InstancedMeshNode.hpp"
 #include "Scene/Node/LightNode.hpp"
+#include "Scene/Node/LodMeshNode.hpp"
 #include "Scene/Node/MeshNode.hpp"
 #include "Scene/Node/Node.hpp"
 #include "Scene/Node/PivotNode.hpp"
@@ -13,6 +14,8 @@
 #include "Scene/Node/WorldNode.hpp"
 #include "Scene/Renderable/Material.hpp"
 #include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Renderable/MeshOptimizer.hpp"
+#include "Scene/Renderable/MeshSimplifier.hpp"
 #include "Scene/Renderable/Shader.hpp"
 #include "Scene/Renderable/SkinMesh.hpp"
 #include "Scene/Renderable/Texture.hpp"
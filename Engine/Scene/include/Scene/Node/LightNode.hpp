@@ -3,10 +3,19 @@
 #pragma once
 
 #include "Scene/Node/PivotNode.hpp"
+#include "Scene/Renderable/IRenderable.hpp"
+
+#include <vector>
 
 namespace Stone::Scene {
 
-class LightNode : public PivotNode {
+/**
+ * @brief Base class of the lights of a scene.
+ *
+ * The lights are renderable, their renderer object gathers them during the traversal with the world transform of the
+ * node. Changing a property of the light marks it dirty.
+ */
+class LightNode : public PivotNode, public IRenderable {
 	STONE_ABSTRACT_NODE(LightNode);
 
 public:
@@ -17,6 +26,8 @@ public:
 
 	std::ostream &writeToStream(std::ostream &stream, bool closing_bracer) const override;
 
+	void render(RenderContext &context) override;
+
 	[[nodiscard]] virtual bool isCastingShadow() const;
 
 	[[nodiscard]] float getIntensity() const;
@@ -59,6 +70,15 @@ public:
 	[[nodiscard]] const glm::vec3 &getSpecular() const;
 	void setSpecular(const glm::vec3 &specular);
 
+	/**
+	 * @brief Computes the distance at which the attenuated light becomes negligible.
+	 *
+	 * The renderer only lights the surfaces within this distance of the light.
+	 *
+	 * @return The distance where the brightest channel of the light falls under 1/256, or 0 for a black light.
+	 */
+	[[nodiscard]] float getRange() const;
+
 	std::ostream &writeToStream(std::ostream &stream, bool closing_bracer) const override;
 
 protected:
@@ -120,6 +140,21 @@ public:
 	[[nodiscard]] const glm::vec2 &getShadowOrthoSize() const;
 	void setShadowOrthoSize(const glm::vec2 &shadowOrthoSize);
 
+	/**
+	 * @brief Splits a depth range of the camera between the shadow cascades of an infinite light.
+	 *
+	 * The split distances blend a logarithmic distribution, matching the perspective of the camera, with a uniform one
+	 * keeping the far cascades from growing too large.
+	 *
+	 * @param nearDistance The distance from the camera where the first cascade starts, greater than 0.
+	 * @param farDistance The distance from the camera where the last cascade ends.
+	 * @param cascadeCount The number of cascades.
+	 * @param blend The weight of the logarithmic distribution, from 0 for uniform to 1 for logarithmic.
+	 * @return The cascadeCount + 1 distances bounding the cascades, from nearDistance to farDistance.
+	 */
+	[[nodiscard]] static std::vector<float> computeCascadeSplits(float nearDistance, float farDistance,
+																 uint32_t cascadeCount, float blend = 0.75f);
+
 protected:
 	bool _infinite;
 	glm::vec2 _shadowOrthoSize;
@@ -0,0 +1,85 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "Scene/Node/MeshNode.hpp"
+
+#include <vector>
+
+namespace Stone::Scene {
+
+/**
+ * @class LodMeshNode
+ * @brief Represents a mesh node drawing coarser meshes as it gets smaller on screen.
+ *
+ * The mesh of the node is the most detailed level. Each additional level is drawn once the bounding sphere of the
+ * mesh covers less than the screen size of the level, measured as a fraction of the height of the viewport.
+ */
+class LodMeshNode : public MeshNode {
+	STONE_NODE(LodMeshNode);
+
+public:
+	/**
+	 * @brief A level of detail, drawn under its screen size.
+	 */
+	struct Lod {
+		std::shared_ptr<IMeshInterface> mesh; /**< The mesh drawn by the level. */
+		float screenSize;					  /**< The screen size under which the level is drawn. */
+	};
+
+	explicit LodMeshNode(const std::string &name = "lodmesh");
+	LodMeshNode(const LodMeshNode &other) = default;
+
+	~LodMeshNode() override = default;
+
+	std::ostream &writeToStream(std::ostream &stream, bool closing_bracer) const override;
+
+	/**
+	 * @brief Adds a level of detail, the levels are kept ordered by decreasing screen size.
+	 *
+	 * @param mesh The mesh drawn by the level.
+	 * @param screenSize The screen size under which the level is drawn.
+	 */
+	void addLod(std::shared_ptr<IMeshInterface> mesh, float screenSize);
+	void removeLod(int index);
+	void clearLods();
+
+	[[nodiscard]] const std::vector<Lod> &getLods() const;
+
+	/**
+	 * @brief Replaces the levels of detail with levels simplified from the mesh of the node.
+	 *
+	 * The levels are static meshes when the mesh of the node is one. Does nothing when the vertices of the mesh are
+	 * no longer available, after a StaticMesh has been uploaded.
+	 *
+	 * @param levelCount The maximal number of levels to generate.
+	 * @param ratio The part of the triangles of the previous level kept by each level.
+	 * @param firstScreenSize The screen size of the first level, each next level is drawn at sqrt(ratio) times the
+	 * screen size of the previous one, keeping about the same number of triangles per pixel.
+	 */
+	void generateLods(uint32_t levelCount, float ratio = 0.5f, float firstScreenSize = 0.5f);
+
+	/**
+	 * @brief Selects the level of detail to draw at the given screen size.
+	 *
+	 * @param screenSize The screen size of the bounding sphere of the mesh.
+	 * @return 0 for the mesh of the node, or the index of the level in getLods plus one.
+	 */
+	[[nodiscard]] size_t selectLod(float screenSize) const;
+
+	/**
+	 * @brief Computes the height covered on screen by a bounding sphere, as a fraction of the viewport height.
+	 *
+	 * Works with perspective and orthographic projections, the spheres around the camera cover the whole screen.
+	 *
+	 * @param mvp The matrices of the draw, the model matrix placing the sphere.
+	 * @param sphere The sphere in model space, center in xyz and radius in w.
+	 * @return The screen size of the sphere.
+	 */
+	[[nodiscard]] static float computeScreenSize(const MvpMatrices &mvp, const glm::vec4 &sphere);
+
+protected:
+	std::vector<Lod> _lods;
+};
+
+} // namespace Stone::Scene
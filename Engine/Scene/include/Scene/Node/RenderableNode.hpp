@@ -10,6 +10,9 @@ namespace Stone::Scene {
 /**
  * @class RenderableNode
  * @brief Represents a node that can be rendered.
+ *
+ * A static node is expected to keep its transform and renderable, the renderer caches the work done for it across
+ * frames, like the shadows it casts.
  */
 class RenderableNode : public Node, public IRenderable {
 	STONE_ABSTRACT_NODE(RenderableNode)
@@ -21,6 +24,12 @@ public:
 	~RenderableNode() override = default;
 
 	void render(RenderContext &context) override;
+
+	[[nodiscard]] bool isStatic() const;
+	void setStatic(bool isStatic);
+
+protected:
+	bool _static;
 };
 
 } // namespace Stone::Scene
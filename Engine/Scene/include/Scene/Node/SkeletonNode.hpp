@@ -39,6 +39,17 @@ public:
 	void addBone(const std::shared_ptr<PivotNode> &pivot);
 	void addBone(const std::shared_ptr<PivotNode> &pivot, const glm::mat4 &offset);
 
+	/**
+	 * @brief Computes the matrices moving the vertices of a skin mesh from the bind pose to the current pose.
+	 *
+	 * Each matrix is the transform of the bone pivot relative to the mesh node, times the inverse bind matrix.
+	 * Bones whose pivot was destroyed keep the bind pose.
+	 *
+	 * @param meshNode The node of the skin mesh, the matrices are expressed in its space.
+	 * @param matrices Filled with one matrix per bone, in the order of the bones.
+	 */
+	void computeBoneMatrices(const std::shared_ptr<Node> &meshNode, std::vector<glm::mat4> &matrices) const;
+
 protected:
 	std::vector<Bone> _bones;
 
@@ -8,6 +8,7 @@
 #include <functional>
 #include <glm/vec3.hpp>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace Stone::Scene {
 
@@ -135,10 +136,36 @@ public:
 	 */
 	[[nodiscard]] std::shared_ptr<Shader> getFragmentShader() const;
 
+	/**
+	 * @brief Enable or disable a keyword of the fragment shader for the Material.
+	 *
+	 * @param keyword The keyword, see `Shader::setKeywords`.
+	 * @param enabled Whether the keyword is defined when compiling the shader of the Material.
+	 */
+	void setKeyword(const std::string &keyword, bool enabled);
+
+	/**
+	 * @brief Check whether a keyword is enabled on the Material, or by one of its textures.
+	 *
+	 * @param keyword The keyword to check.
+	 * @return True when the keyword is defined for the shader of the Material.
+	 */
+	[[nodiscard]] bool isKeywordEnabled(const std::string &keyword) const;
+
+	/**
+	 * @brief Get the variant of the fragment shader used by the Material, the bit `i` being set when the keyword `i`
+	 * of the shader is enabled. A texture parameter enables the keyword `HAS_` followed by its name in upper case,
+	 * `HAS_NORMALS` for the texture "normals".
+	 *
+	 * @return The variant mask, 0 without fragment shader.
+	 */
+	[[nodiscard]] uint32_t getVariantMask() const;
+
 protected:
 	std::unordered_map<std::string, std::shared_ptr<Texture>> _textures; /**< Map of texture parameters. */
 	std::unordered_map<std::string, glm::vec3> _vectors;				 /**< Map of vector parameters. */
 	std::unordered_map<std::string, float> _scalars;					 /**< Map of scalar parameters. */
+	std::unordered_set<std::string> _keywords;							 /**< The keywords enabled by hand. */
 
 	std::shared_ptr<Shader>
 		_vertexShader; /**< The vertex shader used by the material. nullptr means using the standard shader. */
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "Scene/Renderable/IMeshObject.hpp"
+#include "Scene/Renderable/Meshlet.hpp"
 #include "Scene/Vertex.hpp"
 
 #include <vector>
@@ -16,11 +17,22 @@ namespace Stone::Scene {
 
 class IMeshInterface : public IMeshObject {};
 
+/**
+ * @brief A range of vertices of a mesh modified since the renderer last updated it.
+ */
+struct VertexRange {
+	size_t first = 0; /**< The index of the first modified vertex. */
+	size_t count = 0; /**< The number of modified vertices. */
+};
+
 /**
  * @brief Represents a dynamic mesh used for rendering in the scene.
  *
  * A dynamic mesh is a mesh that can be modified at runtime.
  * It provides functionality for managing vertices and indices of the mesh.
+ *
+ * A streamed mesh is deformed every frame, such as water or cloth: the renderer keeps its vertices in host visible
+ * memory and copies the ranges reported as modified, instead of uploading the whole mesh again.
  */
 class DynamicMesh : public IMeshInterface {
 	STONE_OBJECT(DynamicMesh);
@@ -63,6 +75,25 @@ public:
 	 */
 	std::vector<Vertex> &verticesRef();
 
+	/**
+	 * @brief Retrieves a reference to the vector of vertices, to modify a range of them.
+	 *
+	 * @note Using this method marks the range as dirty, a streamed mesh only copies the dirty ranges to the GPU. The
+	 * number of vertices must be kept.
+	 *
+	 * @param first The index of the first vertex modified.
+	 * @param count The number of vertices modified.
+	 * @return A reference to the vector of vertices.
+	 */
+	std::vector<Vertex> &verticesRef(size_t first, size_t count);
+
+	/**
+	 * @brief Retrieves the ranges of vertices modified since the renderer last updated the mesh.
+	 *
+	 * @return The dirty ranges, empty when the whole mesh is dirty or when it is clean.
+	 */
+	[[nodiscard]] const std::vector<VertexRange> &getDirtyVertexRanges() const;
+
 	/**
 	 * @brief Retrieves a reference to the vector of indices.
 	 *
@@ -72,9 +103,65 @@ public:
 	 */
 	std::vector<uint32_t> &indicesRef();
 
+	/**
+	 * @brief Retrieves the meshlets grouping the triangles of the mesh, empty unless they were built.
+	 *
+	 * @return A constant reference to the vector of meshlets.
+	 */
+	[[nodiscard]] const std::vector<Meshlet> &getMeshlets() const;
+
+	/**
+	 * @brief Retrieves a reference to the vector of meshlets.
+	 *
+	 * @note Using this method marks the mesh as dirty. The meshlets index the indices of the mesh, they must be
+	 * rebuilt or cleared when the triangles are changed.
+	 *
+	 * @return A reference to the vector of meshlets.
+	 */
+	std::vector<Meshlet> &meshletsRef();
+
+	/**
+	 * @brief Retrieves the format the vertices are uploaded to the GPU with.
+	 *
+	 * @return The vertex format, Float by default.
+	 */
+	[[nodiscard]] VertexFormat getVertexFormat() const;
+
+	/**
+	 * @brief Sets the format the vertices are uploaded to the GPU with.
+	 *
+	 * @note The format is read when the renderer creates the buffers of the mesh, it should be chosen beforehand.
+	 *
+	 * @param vertexFormat The vertex format.
+	 */
+	void setVertexFormat(VertexFormat vertexFormat);
+
+	/**
+	 * @brief Checks whether the renderer streams the vertices of the mesh.
+	 *
+	 * @return True when the mesh is streamed, false by default.
+	 */
+	[[nodiscard]] bool isStreamed() const;
+
+	/**
+	 * @brief Sets whether the renderer streams the vertices of the mesh from host visible memory.
+	 *
+	 * @note Like the vertex format, it is read when the renderer creates the buffers of the mesh and should be chosen
+	 * beforehand. A streamed mesh is culled as a whole, its meshlets are ignored.
+	 *
+	 * @param streamed Whether the mesh is streamed.
+	 */
+	void setStreamed(bool streamed);
+
 protected:
-	std::vector<Vertex> _vertices;	/**< The vector of vertices. */
-	std::vector<uint32_t> _indices; /**< The vector of indices. */
+	friend class RendererObjectManager;
+
+	std::vector<Vertex> _vertices;					  /**< The vector of vertices. */
+	std::vector<uint32_t> _indices;					  /**< The vector of indices. */
+	std::vector<Meshlet> _meshlets;					  /**< The meshlets, contiguous ranges of the indices. */
+	VertexFormat _vertexFormat = VertexFormat::Float; /**< The format of the vertices on the GPU. */
+	bool _streamed = false;							  /**< Whether the vertices are streamed. */
+	std::vector<VertexRange> _dirtyVertexRanges;	  /**< The vertices modified, empty when all of them are. */
 };
 
 
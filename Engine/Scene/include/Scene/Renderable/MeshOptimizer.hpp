@@ -0,0 +1,105 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include "Scene/Renderable/Meshlet.hpp"
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <vector>
+
+namespace Stone::Scene {
+
+class DynamicMesh;
+class DynamicSkinMesh;
+
+/**
+ * @brief The steps of optimizeMesh, all enabled by default but the meshlets, meant for the densest meshes.
+ */
+struct MeshOptimizationSettings {
+	bool weldVertices = true;		 /**< Merge the vertices with identical attributes. */
+	bool optimizeVertexCache = true; /**< Reorder the triangles for the post-transform vertex cache. */
+	bool optimizeOverdraw = true;	 /**< Reorder clusters of triangles to draw the outer facing ones first. */
+	bool optimizeVertexFetch = true; /**< Reorder the vertices in their order of first use, dropping unused ones. */
+	bool buildMeshlets = false;		 /**< Group the triangles into meshlets culled separately by the renderer. */
+	uint32_t cacheSize = 16;		 /**< Number of vertices of the simulated post-transform cache. */
+	float overdrawThreshold = 1.05f; /**< Miss ratio allowed to the overdraw clusters, relative to the cache order. */
+	uint32_t meshletVertices = 64;	 /**< Most vertices in a meshlet, see maxMeshletVertices. */
+	uint32_t meshletTriangles = 124; /**< Most triangles in a meshlet, see maxMeshletTriangles. */
+};
+
+/**
+ * @brief Reorders the triangles so their vertices are reused while in the post-transform cache (Tipsify).
+ *
+ * @param indices The triangle list to reorder in place.
+ * @param vertexCount The number of vertices referenced by the indices.
+ * @param cacheSize The number of vertices of the targeted cache.
+ */
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+/**
+ * @brief Reorders clusters of triangles to draw the ones facing away from the center of the mesh first.
+ *
+ * The clusters are split where the vertex cache order already restarts, and where the cache miss ratio of the
+ * cluster stays within the threshold, so the reordering keeps most of the vertex cache efficiency.
+ *
+ * @param indices The triangle list to reorder in place, expected to be optimized for the vertex cache.
+ * @param positions The positions of the vertices referenced by the indices.
+ * @param cacheSize The number of vertices of the targeted cache.
+ * @param threshold The cache miss ratio the clusters may reach, relative to the ratio of the cache order.
+ */
+void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions,
+					  uint32_t cacheSize = 16, float threshold = 1.05f);
+
+/**
+ * @brief Computes the order of first use of the vertices, to fetch them sequentially.
+ *
+ * @param indices The triangle list.
+ * @param vertexCount The number of vertices referenced by the indices.
+ * @return The new index of every vertex, UINT32_MAX for the unused ones.
+ */
+[[nodiscard]] std::vector<uint32_t> computeVertexFetchRemap(const std::vector<uint32_t> &indices, size_t vertexCount);
+
+/**
+ * @brief Simulates a FIFO post-transform cache to measure the efficiency of a triangle order.
+ *
+ * @param indices The triangle list.
+ * @param vertexCount The number of vertices referenced by the indices.
+ * @param cacheSize The number of vertices of the simulated cache.
+ * @return The average number of vertices transformed per triangle, between 0.5 and 3.
+ */
+[[nodiscard]] float computeCacheMissRatio(const std::vector<uint32_t> &indices, size_t vertexCount,
+										  uint32_t cacheSize = 16);
+
+/**
+ * @brief Groups the triangles into meshlets, growing each one with the neighboring triangles adding the fewest
+ * vertices, and computes their bounding spheres and normal cones.
+ *
+ * @param indices The triangle list, reordered in place so the triangles of each meshlet are contiguous.
+ * @param positions The positions of the vertices referenced by the indices.
+ * @param maxVertices The most vertices in a meshlet.
+ * @param maxTriangles The most triangles in a meshlet.
+ * @return The meshlets, in the order of their triangles.
+ */
+[[nodiscard]] std::vector<Meshlet> buildMeshlets(std::vector<uint32_t> &indices,
+												 const std::vector<glm::vec3> &positions,
+												 uint32_t maxVertices = maxMeshletVertices,
+												 uint32_t maxTriangles = maxMeshletTriangles);
+
+/**
+ * @brief Runs the enabled optimization steps on the vertices and indices of a mesh, meant for import or cook time.
+ *
+ * @param mesh The mesh to optimize, its meshlets are rebuilt or cleared since the triangles move.
+ * @param settings The steps to run.
+ */
+void optimizeMesh(DynamicMesh &mesh, const MeshOptimizationSettings &settings = {});
+
+/**
+ * @brief Runs the enabled optimization steps on the vertices and indices of a skin mesh.
+ *
+ * @param mesh The skin mesh to optimize, the bone weights are welded with the other attributes.
+ * @param settings The steps to run, no meshlets are built since the posed triangles move.
+ */
+void optimizeMesh(DynamicSkinMesh &mesh, const MeshOptimizationSettings &settings = {});
+
+} // namespace Stone::Scene
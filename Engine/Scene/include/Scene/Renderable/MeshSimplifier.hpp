@@ -0,0 +1,57 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <vector>
+
+namespace Stone::Scene {
+
+class DynamicMesh;
+
+/**
+ * @brief Removes triangles from a triangle list with edge collapses ordered by their quadric error.
+ *
+ * The collapses merge a vertex into one of its neighbors, so the kept vertices keep their attributes as they are.
+ * The vertices sharing their position with another vertex, where the normals or the texture coordinates are split,
+ * and the vertices on the open borders are never removed, keeping the seams and the outline of the mesh in place.
+ *
+ * @param indices The triangle list to simplify in place.
+ * @param positions The positions of the vertices referenced by the indices.
+ * @param targetIndexCount The number of indices to reach, the simplification stops above it when the error is reached.
+ * @param targetError The largest distance a surface may move, relative to the extent of the mesh.
+ * @return The largest error of the collapses done, relative to the extent of the mesh.
+ */
+float simplifyIndices(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions, size_t targetIndexCount,
+					  float targetError = 0.01f);
+
+/**
+ * @brief Creates a simplified copy of a mesh, with only the vertices still used by its triangles.
+ *
+ * @param mesh The mesh to simplify, expected to have its identical vertices welded.
+ * @param ratio The part of the triangles to keep.
+ * @param targetError The largest distance a surface may move, relative to the extent of the mesh.
+ * @return The simplified mesh, optimized for the vertex cache.
+ */
+[[nodiscard]] std::shared_ptr<DynamicMesh> simplifyMesh(const DynamicMesh &mesh, float ratio,
+														float targetError = 0.01f);
+
+/**
+ * @brief Creates the chain of levels of detail of a mesh, each level simplified from the previous one.
+ *
+ * Each level is meant to be drawn at sqrt(ratio) times the screen size of the previous one, so the error allowed
+ * grows by the inverse of that factor to stay about the same on screen. The chain stops early when a level can no
+ * longer be simplified within its error.
+ *
+ * @param mesh The mesh of the most detailed level, not part of the returned chain.
+ * @param levelCount The maximal number of levels to create.
+ * @param ratio The part of the triangles of the previous level kept by each level.
+ * @param targetError The error allowed to the first level, relative to the extent of the mesh.
+ * @return The levels, from the most detailed to the coarsest.
+ */
+[[nodiscard]] std::vector<std::shared_ptr<DynamicMesh>> generateLods(const DynamicMesh &mesh, uint32_t levelCount,
+																	 float ratio = 0.5f, float targetError = 0.01f);
+
+} // namespace Stone::Scene
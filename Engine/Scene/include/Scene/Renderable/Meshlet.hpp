@@ -0,0 +1,45 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Stone::Scene {
+
+/**
+ * @brief A cluster of neighboring triangles of a mesh, culled as a whole by the renderer.
+ *
+ * The triangles of a meshlet are contiguous in the index list of the mesh. The normal cone bounds the directions the
+ * triangles face, the meshlet is entirely back facing when seen from inside the opposite cone.
+ */
+struct Meshlet {
+	uint32_t firstIndex = 0;						 /**< First index of the meshlet in the index list of the mesh. */
+	uint32_t indexCount = 0;						 /**< Three times the number of triangles. */
+	uint32_t vertexCount = 0;						 /**< Number of distinct vertices used by the triangles. */
+	glm::vec4 boundingSphere = glm::vec4(0.0f);		 /**< Center in xyz and radius in w. */
+	glm::vec4 normalCone = {0.0f, 0.0f, 0.0f, 1.0f}; /**< Axis in xyz and the sine of its spread in w. */
+};
+
+/** Most vertices in a meshlet, the limit of the mesh shading hardware. */
+constexpr uint32_t maxMeshletVertices = 64;
+
+/** Most triangles in a meshlet, keeping the local index list of a meshlet within 372 bytes. */
+constexpr uint32_t maxMeshletTriangles = 124;
+
+/**
+ * @brief Checks whether every triangle of a meshlet faces away from a point of view.
+ *
+ * The renderer runs the same test in its culling pass.
+ *
+ * @param meshlet The meshlet to test.
+ * @param cameraPosition The point of view, in the space of the mesh.
+ * @return True if no triangle of the meshlet can be seen from the point of view.
+ */
+[[nodiscard]] inline bool isMeshletBackFacing(const Meshlet &meshlet, const glm::vec3 &cameraPosition) {
+	glm::vec3 offset = glm::vec3(meshlet.boundingSphere) - cameraPosition;
+	return glm::dot(offset, glm::vec3(meshlet.normalCone)) >=
+		   meshlet.normalCone.w * glm::length(offset) + meshlet.boundingSphere.w;
+}
+
+} // namespace Stone::Scene
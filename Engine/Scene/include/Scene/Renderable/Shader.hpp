@@ -6,6 +6,7 @@
 #include "Scene/Renderable/IRenderable.hpp"
 
 #include <unordered_map>
+#include <vector>
 
 namespace Stone::Scene {
 
@@ -16,6 +17,9 @@ class Shader : public Core::Object, public IRenderable {
 	STONE_OBJECT(Shader);
 
 public:
+	/** The maximum number of keywords of a shader, a bit of the variant masks each. */
+	static constexpr size_t maxKeywords = 32;
+
 	enum class ContentType {
 		SourceCode,	  /** The content is the full shader code in a readable shading language (cf. `.glsl`, `.metal`) */
 		SourceFile,	  /** The content is a link to a file containing the readable code file. */
@@ -87,6 +91,20 @@ public:
 	 */
 	void setLocation(const std::string &name, int location);
 
+	/**
+	 * @brief Get the keywords of the shader, see `setKeywords`.
+	 */
+	[[nodiscard]] const std::vector<std::string> &getKeywords() const;
+
+	/**
+	 * @brief Set the keywords the source code of the shader tests with `#ifdef`. A variant of the shader is compiled
+	 * for each combination of keywords used, the keyword at position `i` being defined when the bit `i` of the
+	 * variant mask is set. Compiled shaders have a single variant.
+	 *
+	 * @param keywords The keywords of the shader, at most `maxKeywords`.
+	 */
+	void setKeywords(std::vector<std::string> keywords);
+
 private:
 	ContentType _contentType = ContentType::SourceCode; /** The type of the content. */
 	std::string _content = "#version 450 core\n";		/** The content of the shader. */
@@ -94,6 +112,8 @@ private:
 
 	std::unordered_map<std::string, int> _locations = {}; /** The binding locations of the variables in the shader. */
 	int _maxLocation = -1;								  /** The cached maximum value from the locations. */
+
+	std::vector<std::string> _keywords = {}; /** The macros selecting the variants of the shader. */
 };
 
 } // namespace Stone::Scene
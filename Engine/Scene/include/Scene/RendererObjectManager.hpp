@@ -43,12 +43,42 @@ public:
 	 */
 	virtual void updateInstancedMeshNode(const std::shared_ptr<InstancedMeshNode> &instancedMeshNode);
 
+	/**
+	 * @brief Updates the renderer data for a given level of detail mesh node, and the meshes of its levels.
+	 * @param lodMeshNode The level of detail mesh node to be updated.
+	 */
+	virtual void updateLodMeshNode(const std::shared_ptr<LodMeshNode> &lodMeshNode);
+
 	/**
 	 * @brief Updates the renderer data for a given skin mesh node.
 	 * @param skinMeshNode The skin mesh node to be updated.
 	 */
 	virtual void updateSkinMeshNode(const std::shared_ptr<SkinMeshNode> &skinMeshNode);
 
+	/**
+	 * @brief Updates the renderer data for a given ambient light node.
+	 * @param ambientLightNode The ambient light node to be updated.
+	 */
+	virtual void updateAmbientLightNode(const std::shared_ptr<AmbientLightNode> &ambientLightNode);
+
+	/**
+	 * @brief Updates the renderer data for a given point light node.
+	 * @param pointLightNode The point light node to be updated.
+	 */
+	virtual void updatePointLightNode(const std::shared_ptr<PointLightNode> &pointLightNode);
+
+	/**
+	 * @brief Updates the renderer data for a given spot light node.
+	 * @param spotLightNode The spot light node to be updated.
+	 */
+	virtual void updateSpotLightNode(const std::shared_ptr<SpotLightNode> &spotLightNode);
+
+	/**
+	 * @brief Updates the renderer data for a given directional light node.
+	 * @param directionalLightNode The directional light node to be updated.
+	 */
+	virtual void updateDirectionalLightNode(const std::shared_ptr<DirectionalLightNode> &directionalLightNode);
+
 	/**
 	 * @brief Updates the renderer data for a given material.
 	 * @param material The material to be updated.
@@ -56,7 +86,7 @@ public:
 	virtual void updateMaterial(const std::shared_ptr<Material> &material);
 
 	/**
-	 * @brief Updates the renderer data for a given dynamic mesh.
+	 * @brief Updates the renderer data for a given dynamic mesh, and forgets its dirty vertex ranges.
 	 * @param mesh The dynamic mesh to be updated.
 	 */
 	virtual void updateDynamicMesh(const std::shared_ptr<DynamicMesh> &mesh);
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <glm/gtc/type_precision.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
@@ -38,6 +40,77 @@ struct WeightVertex : Vertex {
 	WeightVertex(const glm::vec3 &p, const glm::vec2 &uv);
 };
 
+/**
+ * @brief The layouts a mesh can be uploaded with, trading precision for memory and vertex fetch bandwidth.
+ */
+enum class VertexFormat : uint8_t {
+	Float = 0,		/**< Vertex as is, 56 bytes. */
+	Packed = 1,	/**< PackedVertex, float position with compressed normal, tangent and uv, 24 bytes. */
+	Quantized = 2, /**< QuantizedVertex, Packed with 16-bit positions in the bounds of the mesh, 20 bytes. */
+};
+
+/**
+ * @brief Compact layout of a Vertex.
+ *
+ * The normal and the tangent are octahedral encoded as pairs of 16-bit signed normalized integers. The bitangent is
+ * rebuilt as cross(normal, tangent) times a sign, stored in the lowest bit of the tangent. The uv are half floats.
+ */
+struct PackedVertex {
+	glm::vec3 position = glm::vec3(0);		/**< The position of the vertex. */
+	glm::i16vec2 normal = glm::i16vec2(0);	/**< The octahedral encoded normal. */
+	glm::i16vec2 tangent = glm::i16vec2(0); /**< The octahedral encoded tangent, the lowest bit of y is the sign. */
+	glm::u16vec2 uv = glm::u16vec2(0);		/**< The texture coordinates as half floats. */
+};
+
+/**
+ * @brief PackedVertex with a position quantized to 16 bits in the bounds of its mesh.
+ *
+ * The positions are unsigned normalized, their dequantization is a per mesh scale and offset folded in the model
+ * matrix. The scale is the same on every axis so bounding spheres stay spheres in the quantized space.
+ */
+struct QuantizedVertex {
+	glm::u16vec4 position = glm::u16vec4(0); /**< The quantized position, w is padding. */
+	glm::i16vec2 normal = glm::i16vec2(0);	 /**< The octahedral encoded normal. */
+	glm::i16vec2 tangent = glm::i16vec2(0);	 /**< The octahedral encoded tangent, the lowest bit of y is the sign. */
+	glm::u16vec2 uv = glm::u16vec2(0);		 /**< The texture coordinates as half floats. */
+};
+
+/**
+ * @brief Maps a direction to the octahedron unfolded on the [-1, 1] square, with a near uniform precision.
+ *
+ * @param direction The direction to encode, not necessarily normalized.
+ * @return The encoded direction, (0, 0) for a null direction.
+ */
+[[nodiscard]] glm::vec2 octahedralEncode(const glm::vec3 &direction);
+
+/**
+ * @brief Maps a point of the unfolded octahedron back to a unit direction.
+ *
+ * @param encoded The encoded direction.
+ * @return The normalized direction.
+ */
+[[nodiscard]] glm::vec3 octahedralDecode(const glm::vec2 &encoded);
+
+/**
+ * @brief Compresses a vertex to the Packed format.
+ */
+[[nodiscard]] PackedVertex packVertex(const Vertex &vertex);
+
+/**
+ * @brief Compresses a vertex to the Quantized format.
+ *
+ * @param vertex The vertex to compress.
+ * @param origin The minimum corner of the bounds of the mesh.
+ * @param extent The largest size of the bounds of the mesh.
+ * @return The compressed vertex, its position being (position - origin) / extent in unsigned normalized integers.
+ */
+[[nodiscard]] QuantizedVertex quantizeVertex(const Vertex &vertex, const glm::vec3 &origin, float extent);
+
+/**
+ * @brief Expands a packed vertex, as the vertex shaders decode it.
+ */
+[[nodiscard]] Vertex unpackVertex(const PackedVertex &vertex);
+
 /**
  * @brief Enum class representing the axis directions.
  */
@@ -20,6 +20,7 @@ class DirectionalLightNode;
 class SpotLightNode;
 class MeshNode;
 class InstancedMeshNode;
+class LodMeshNode;
 class SkeletonNode;
 class SkinMeshNode;
 class WorldNode;
@@ -7,12 +7,15 @@
 #include "Scene/Node/MeshNode.hpp"
 #include "Scene/Node/Node.hpp"
 #include "Scene/Node/PivotNode.hpp"
+#include "Scene/Node/SkeletonNode.hpp"
 #include "Scene/Node/SkinMeshNode.hpp"
 #include "Scene/Renderable/Material.hpp"
 #include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Renderable/MeshOptimizer.hpp"
 #include "Scene/Renderable/SkinMesh.hpp"
 #include "Scene/Renderable/Texture.hpp"
 
+#include <algorithm>
 #include <assimp/Exporter.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
@@ -89,25 +92,69 @@ void emplace_indices(std::vector<uint32_t> &indices, const aiMesh *mesh) {
 	}
 }
 
+/** Triangles above which a mesh is split into meshlets, the smaller ones are culled as a whole just as well. */
+constexpr unsigned int meshletMinTriangleCount = 16 * maxMeshletTriangles;
+
 void loadMesh(AssetResource &assetResource, const aiMesh *mesh) {
 	std::shared_ptr<DynamicMesh> newMesh = std::make_shared<DynamicMesh>();
 
 	emplace_vertices(newMesh->verticesRef(), mesh);
 	emplace_indices(newMesh->indicesRef(), mesh);
 
+	MeshOptimizationSettings settings;
+	settings.buildMeshlets = mesh->mNumFaces >= meshletMinTriangleCount;
+	optimizeMesh(*newMesh, settings);
+
 	std::shared_ptr<StaticMesh> newStaticMesh = std::make_shared<StaticMesh>();
 	newStaticMesh->setSourceMesh(newMesh);
 
 	assetResource.getMeshesRef().push_back(newStaticMesh);
 }
 
+/** Keeps the four strongest influences of a vertex, a weaker one replaces the weakest slot. */
+void add_bone_weight(WeightVertex &vertex, int boneId, float weight) {
+	int weakest = 0;
+	for (int slot = 1; slot < 4; slot++) {
+		if (vertex.weights[slot] < vertex.weights[weakest]) {
+			weakest = slot;
+		}
+	}
+	if (weight > vertex.weights[weakest]) {
+		vertex.weights[weakest] = weight;
+		vertex.ids[weakest] = boneId;
+	}
+}
+
+void emplace_weights(std::vector<WeightVertex> &vertices, const aiMesh *mesh) {
+	for (unsigned int i = 0; i < mesh->mNumBones; i++) {
+		const aiBone *bone = mesh->mBones[i];
+		for (unsigned int j = 0; j < bone->mNumWeights; j++) {
+			const aiVertexWeight &vertexWeight = bone->mWeights[j];
+			assert(vertexWeight.mVertexId < vertices.size());
+			add_bone_weight(vertices[vertexWeight.mVertexId], static_cast<int>(i), vertexWeight.mWeight);
+		}
+	}
+
+	// The dropped influences are redistributed so the weights still sum to one.
+	for (WeightVertex &vertex : vertices) {
+		float sum = vertex.weights.x + vertex.weights.y + vertex.weights.z + vertex.weights.w;
+		if (sum > 0.0f) {
+			vertex.weights /= sum;
+		}
+	}
+}
+
 void loadSkinMesh(AssetResource &assetResource, const aiMesh *mesh) {
 	std::shared_ptr<DynamicSkinMesh> newMesh = std::make_shared<DynamicSkinMesh>();
 
 	emplace_vertices(newMesh->verticesRef(), mesh);
 	emplace_indices(newMesh->indicesRef(), mesh);
 
-	// TODO: Load bones and weights. REQUIREMENT: Skeleton must be loaded first.
+	// The bone ids index the bones of the aiMesh, the skeleton is built in the same order once the nodes exist.
+	emplace_weights(newMesh->verticesRef(), mesh);
+
+	// Welding reorders the vertices, so it runs once the weights are attached to them.
+	optimizeMesh(*newMesh);
 
 	std::shared_ptr<StaticSkinMesh> newStaticMesh = std::make_shared<StaticSkinMesh>();
 	newStaticMesh->setSourceMesh(newMesh);
@@ -263,6 +310,51 @@ void loadNode(AssetResource &assetResource, const aiNode *node, const std::share
 	}
 }
 
+std::shared_ptr<SkeletonNode> loadSkeleton(const aiMesh *mesh, const std::shared_ptr<PivotNode> &rootNode) {
+	std::shared_ptr<SkeletonNode> skeleton = std::make_shared<SkeletonNode>();
+
+	for (unsigned int i = 0; i < mesh->mNumBones; i++) {
+		const aiBone *bone = mesh->mBones[i];
+		std::string boneName = bone->mName.C_Str();
+
+		std::shared_ptr<PivotNode> pivot = rootNode->getName() == boneName
+											   ? rootNode
+											   : rootNode->getChildByPath<PivotNode>("*/" + boneName);
+		if (pivot == nullptr) {
+			// Keeps the bone ids aligned with the weights, the vertices stay at their bind pose.
+			pivot = std::make_shared<PivotNode>(boneName);
+			skeleton->addChild(pivot);
+		}
+		skeleton->addBone(pivot, convert(bone->mOffsetMatrix));
+	}
+
+	return skeleton;
+}
+
+void loadSkeletons(AssetResource &assetResource, const aiScene *scene, const std::shared_ptr<PivotNode> &rootNode) {
+	std::vector<std::shared_ptr<SkinMeshNode>> skinMeshNodes;
+	rootNode->traverseTopDown([&skinMeshNodes](const std::shared_ptr<Node> &node) {
+		if (auto skinMeshNode = std::dynamic_pointer_cast<SkinMeshNode>(node)) {
+			skinMeshNodes.push_back(skinMeshNode);
+		}
+	});
+
+	const auto &meshes = assetResource.getMeshes();
+	for (const std::shared_ptr<SkinMeshNode> &skinMeshNode : skinMeshNodes) {
+		auto it = std::find(meshes.begin(), meshes.end(), skinMeshNode->getSkinMesh());
+		if (it == meshes.end()) {
+			continue;
+		}
+
+		// The skin mesh node only references its skeleton, the parent of the node owns it.
+		std::shared_ptr<SkeletonNode> skeleton =
+			loadSkeleton(scene->mMeshes[std::distance(meshes.begin(), it)], rootNode);
+		skeleton->setName(skinMeshNode->getName() + "_skeleton");
+		skinMeshNode->getParent()->addChild(skeleton);
+		skinMeshNode->setSkeleton(skeleton);
+	}
+}
+
 void AssetResource::loadFromAssimp() {
 	Assimp::Importer &importer = getAssimpImporter();
 
@@ -273,6 +365,7 @@ void AssetResource::loadFromAssimp() {
 	// Additional flags:
 	// aiProcess_OptimizeMeshes
 	// aiProcess_SplitLargeMeshes
+	// The vertices are welded and reordered by optimizeMesh once loaded, see MeshOptimizer.hpp.
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
 		throw Core::FileLoadingError(getFullPath(), importer.GetErrorString());
@@ -323,6 +416,7 @@ void AssetResource::loadFromAssimp() {
 	loadMaterials(*this, scene);
 
 	loadNode(*this, scene->mRootNode, _rootNode);
+	loadSkeletons(*this, scene, _rootNode);
 }
 
 } // namespace Stone::Scene
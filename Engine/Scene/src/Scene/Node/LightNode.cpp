@@ -2,11 +2,15 @@
 
 #include "Scene/Node/LightNode.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace Stone::Scene {
 
 STONE_ABSTRACT_NODE_IMPLEMENTATION(LightNode);
 
-LightNode::LightNode(const std::string &name) : PivotNode(name), _intensity(1.0f), _color(1.0f) {
+LightNode::LightNode(const std::string &name) : PivotNode(name), IRenderable(), _intensity(1.0f), _color(1.0f) {
 }
 
 std::ostream &LightNode::writeToStream(std::ostream &stream, bool closing_bracer) const {
@@ -18,6 +22,16 @@ std::ostream &LightNode::writeToStream(std::ostream &stream, bool closing_bracer
 	return stream;
 }
 
+void LightNode::render(RenderContext &context) {
+	if (_rendererObject) {
+		glm::mat4 previousModelMatrix = context.mvp.modelMatrix;
+		context.mvp.modelMatrix = context.mvp.modelMatrix * getTransformMatrix();
+		_rendererObject->render(context);
+		context.mvp.modelMatrix = previousModelMatrix;
+	}
+	PivotNode::render(context);
+}
+
 bool LightNode::isCastingShadow() const {
 	return false;
 }
@@ -28,6 +42,7 @@ float LightNode::getIntensity() const {
 
 void LightNode::setIntensity(float intensity) {
 	_intensity = intensity;
+	markDirty();
 }
 
 const glm::vec3 &LightNode::getColor() const {
@@ -36,6 +51,7 @@ const glm::vec3 &LightNode::getColor() const {
 
 void LightNode::setColor(const glm::vec3 &color) {
 	_color = color;
+	markDirty();
 }
 
 const char *LightNode::_termClassColor() const {
@@ -62,6 +78,7 @@ const glm::vec3 &PointLightNode::getAttenuation() const {
 
 void PointLightNode::setAttenuation(const glm::vec3 &attenuation) {
 	_attenuation = attenuation;
+	markDirty();
 }
 
 const glm::vec3 &PointLightNode::getSpecular() const {
@@ -70,6 +87,28 @@ const glm::vec3 &PointLightNode::getSpecular() const {
 
 void PointLightNode::setSpecular(const glm::vec3 &specular) {
 	_specular = specular;
+	markDirty();
+}
+
+float PointLightNode::getRange() const {
+	float brightness = _intensity * std::max({_color.x, _color.y, _color.z, _specular.x, _specular.y, _specular.z});
+	if (brightness <= 0.0f) {
+		return 0.0f;
+	}
+
+	// Solves constant + linear * d + quadratic * d^2 = 256 * brightness.
+	float constant = _attenuation.x - 256.0f * brightness;
+	if (constant >= 0.0f) {
+		return 0.0f;
+	}
+	if (_attenuation.z > 0.0f) {
+		float discriminant = _attenuation.y * _attenuation.y - 4.0f * _attenuation.z * constant;
+		return (std::sqrt(discriminant) - _attenuation.y) / (2.0f * _attenuation.z);
+	}
+	if (_attenuation.y > 0.0f) {
+		return -constant / _attenuation.y;
+	}
+	return std::numeric_limits<float>::max();
 }
 
 std::ostream &PointLightNode::writeToStream(std::ostream &stream, bool closing_bracer) const {
@@ -105,6 +144,7 @@ bool CastingLightNode::isCastingShadow() const {
 
 void CastingLightNode::setCastingShadow(bool castShadow) {
 	_castShadow = castShadow;
+	markDirty();
 }
 
 const glm::mat4 &CastingLightNode::getProjectionMatrix() const {
@@ -118,6 +158,7 @@ float CastingLightNode::getShadowClipNear() const {
 void CastingLightNode::setShadowClipNear(float shadowClipNear) {
 	_shadowClipNear = shadowClipNear;
 	_updateProjectionMatrix();
+	markDirty();
 }
 
 float CastingLightNode::getShadowClipFar() const {
@@ -127,6 +168,7 @@ float CastingLightNode::getShadowClipFar() const {
 void CastingLightNode::setShadowClipFar(float shadowClipFar) {
 	_shadowClipFar = shadowClipFar;
 	_updateProjectionMatrix();
+	markDirty();
 }
 
 const glm::ivec2 &CastingLightNode::getShadowMapSize() const {
@@ -135,6 +177,7 @@ const glm::ivec2 &CastingLightNode::getShadowMapSize() const {
 
 void CastingLightNode::setShadowMapSize(const glm::ivec2 &shadowMapSize) {
 	_shadowMapSize = shadowMapSize;
+	markDirty();
 }
 
 const char *CastingLightNode::_termClassColor() const {
@@ -163,6 +206,7 @@ bool DirectionalLightNode::isInfinite() const {
 
 void DirectionalLightNode::setInfinite(bool infinite) {
 	_infinite = infinite;
+	markDirty();
 }
 
 const glm::vec2 &DirectionalLightNode::getShadowOrthoSize() const {
@@ -172,6 +216,19 @@ const glm::vec2 &DirectionalLightNode::getShadowOrthoSize() const {
 void DirectionalLightNode::setShadowOrthoSize(const glm::vec2 &shadowOrthoSize) {
 	_shadowOrthoSize = shadowOrthoSize;
 	_updateProjectionMatrix();
+	markDirty();
+}
+
+std::vector<float> DirectionalLightNode::computeCascadeSplits(float nearDistance, float farDistance,
+															  uint32_t cascadeCount, float blend) {
+	std::vector<float> splits(cascadeCount + 1);
+	for (uint32_t i = 0; i <= cascadeCount; ++i) {
+		float ratio = static_cast<float>(i) / static_cast<float>(cascadeCount);
+		float logarithmic = nearDistance * std::pow(farDistance / nearDistance, ratio);
+		float uniform = nearDistance + (farDistance - nearDistance) * ratio;
+		splits[i] = blend * logarithmic + (1.0f - blend) * uniform;
+	}
+	return splits;
 }
 
 void DirectionalLightNode::_updateProjectionMatrix() {
@@ -202,6 +259,7 @@ float SpotLightNode::getConeAngle() const {
 void SpotLightNode::setConeAngle(float coneAngle) {
 	_coneAngle = coneAngle;
 	_updateProjectionMatrix();
+	markDirty();
 }
 
 float SpotLightNode::getConeAttenuation() const {
@@ -210,6 +268,7 @@ float SpotLightNode::getConeAttenuation() const {
 
 void SpotLightNode::setConeAttenuation(float coneAttenuation) {
 	_coneAttenuation = coneAttenuation;
+	markDirty();
 }
 
 void SpotLightNode::_updateProjectionMatrix() {
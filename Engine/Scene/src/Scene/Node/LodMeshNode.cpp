@@ -0,0 +1,98 @@
+// Copyright 2024 Stone-Engine
+
+#include "Scene/Node/LodMeshNode.hpp"
+
+#include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Renderable/MeshSimplifier.hpp"
+#include "Scene/RendererObjectManager.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Stone::Scene {
+
+STONE_NODE_IMPLEMENTATION(LodMeshNode)
+
+LodMeshNode::LodMeshNode(const std::string &name) : MeshNode(name), _lods() {
+}
+
+std::ostream &LodMeshNode::writeToStream(std::ostream &stream, bool closing_bracer) const {
+	MeshNode::writeToStream(stream, false);
+	stream << ",lods:" << _lods.size();
+	if (closing_bracer)
+		stream << "}";
+	return stream;
+}
+
+void LodMeshNode::addLod(std::shared_ptr<IMeshInterface> mesh, float screenSize) {
+	auto it = std::find_if(_lods.begin(), _lods.end(),
+						   [screenSize](const Lod &lod) { return lod.screenSize < screenSize; });
+	_lods.insert(it, {std::move(mesh), screenSize});
+	markDirty();
+}
+
+void LodMeshNode::removeLod(int index) {
+	assert(index < static_cast<int>(_lods.size()));
+	_lods.erase(_lods.begin() + index);
+	markDirty();
+}
+
+void LodMeshNode::clearLods() {
+	_lods.clear();
+	markDirty();
+}
+
+const std::vector<LodMeshNode::Lod> &LodMeshNode::getLods() const {
+	return _lods;
+}
+
+void LodMeshNode::generateLods(uint32_t levelCount, float ratio, float firstScreenSize) {
+	std::shared_ptr<DynamicMesh> sourceMesh = std::dynamic_pointer_cast<DynamicMesh>(_mesh);
+	auto staticMesh = std::dynamic_pointer_cast<StaticMesh>(_mesh);
+	if (staticMesh) {
+		sourceMesh = staticMesh->getSourceMesh();
+	}
+	if (sourceMesh == nullptr) {
+		return;
+	}
+
+	_lods.clear();
+	float screenSize = firstScreenSize;
+	for (const std::shared_ptr<DynamicMesh> &lodMesh : Scene::generateLods(*sourceMesh, levelCount, ratio)) {
+		if (staticMesh) {
+			auto lodStaticMesh = std::make_shared<StaticMesh>();
+			lodStaticMesh->setSourceMesh(lodMesh);
+			_lods.push_back({lodStaticMesh, screenSize});
+		} else {
+			_lods.push_back({lodMesh, screenSize});
+		}
+		screenSize *= std::sqrt(ratio);
+	}
+	markDirty();
+}
+
+size_t LodMeshNode::selectLod(float screenSize) const {
+	size_t level = 0;
+	while (level < _lods.size() && screenSize < _lods[level].screenSize) {
+		++level;
+	}
+	return level;
+}
+
+float LodMeshNode::computeScreenSize(const MvpMatrices &mvp, const glm::vec4 &sphere) {
+	glm::mat4 modelView = mvp.viewMatrix * mvp.modelMatrix;
+	glm::vec4 center = modelView * glm::vec4(glm::vec3(sphere), 1.0f);
+	float scale = std::max(std::max(glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1]))),
+						   glm::length(glm::vec3(modelView[2])));
+
+	// The clip w is the distance along the view axis with a perspective projection, and 1 with an orthographic one.
+	float clipW = (mvp.projMatrix * center).w;
+	if (clipW <= 0.0f) {
+		return std::numeric_limits<float>::max();
+	}
+	// The viewport spans 2 units of normalized device coordinates.
+	return sphere.w * scale * std::abs(mvp.projMatrix[1][1]) / clipW;
+}
+
+} // namespace Stone::Scene
@@ -6,7 +6,7 @@ namespace Stone::Scene {
 
 STONE_ABSTRACT_NODE_IMPLEMENTATION(RenderableNode)
 
-RenderableNode::RenderableNode(const std::string &name) : Node(name), IRenderable() {
+RenderableNode::RenderableNode(const std::string &name) : Node(name), IRenderable(), _static(false) {
 }
 
 void RenderableNode::render(RenderContext &context) {
@@ -16,6 +16,15 @@ void RenderableNode::render(RenderContext &context) {
 	Node::render(context);
 }
 
+bool RenderableNode::isStatic() const {
+	return _static;
+}
+
+void RenderableNode::setStatic(bool isStatic) {
+	_static = isStatic;
+	markDirty();
+}
+
 // TODO: Benchmark diamond inheritance with PivotNode vs pivot usage
 
 } // namespace Stone::Scene
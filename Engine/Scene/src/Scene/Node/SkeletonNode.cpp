@@ -47,6 +47,15 @@ void SkeletonNode::addBone(const std::shared_ptr<PivotNode> &pivot, const glm::m
 	_bones.push_back(bone);
 }
 
+void SkeletonNode::computeBoneMatrices(const std::shared_ptr<Node> &meshNode, std::vector<glm::mat4> &matrices) const {
+	matrices.resize(_bones.size());
+	for (size_t i = 0; i < _bones.size(); ++i) {
+		std::shared_ptr<PivotNode> pivot = _bones[i].pivot.lock();
+		matrices[i] = pivot ? pivot->getTransformMatrixRelativeToNode(meshNode) * _bones[i].inverseBindMatrix
+							: glm::mat4(1.0f);
+	}
+}
+
 const char *SkeletonNode::_termClassColor() const {
 	return TERM_COLOR_BOLD TERM_COLOR_CYAN;
 }
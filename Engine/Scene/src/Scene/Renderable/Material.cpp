@@ -2,12 +2,28 @@
 
 #include "Scene/Renderable/Material.hpp"
 
+#include "Scene/Renderable/Shader.hpp"
 #include "Scene/Renderable/Texture.hpp"
 #include "Scene/RendererObjectManager.hpp"
 #include "Utils/Glm.hpp"
 
+#include <algorithm>
+#include <cctype>
+
 namespace Stone::Scene {
 
+namespace {
+
+std::string textureKeyword(const std::string &textureName) {
+	std::string keyword = "HAS_";
+	for (char c : textureName) {
+		keyword += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(c)) : '_';
+	}
+	return keyword;
+}
+
+} // namespace
+
 std::ostream &Material::writeToStream(std::ostream &stream, bool closing_bracer) const {
 	Object::writeToStream(stream, false);
 	stream << ",textures:{";
@@ -102,4 +118,36 @@ std::shared_ptr<Shader> Material::getFragmentShader() const {
 	return _fragmentShader;
 }
 
+void Material::setKeyword(const std::string &keyword, bool enabled) {
+	if (enabled) {
+		_keywords.insert(keyword);
+	} else {
+		_keywords.erase(keyword);
+	}
+	markDirty();
+}
+
+bool Material::isKeywordEnabled(const std::string &keyword) const {
+	if (_keywords.count(keyword) != 0) {
+		return true;
+	}
+	return std::any_of(_textures.begin(), _textures.end(), [&](const auto &texture) {
+		return texture.second != nullptr && textureKeyword(texture.first) == keyword;
+	});
+}
+
+uint32_t Material::getVariantMask() const {
+	if (_fragmentShader == nullptr) {
+		return 0;
+	}
+	uint32_t mask = 0;
+	const std::vector<std::string> &keywords = _fragmentShader->getKeywords();
+	for (size_t i = 0; i < keywords.size(); ++i) {
+		if (isKeywordEnabled(keywords[i])) {
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+}
+
 } // namespace Stone::Scene
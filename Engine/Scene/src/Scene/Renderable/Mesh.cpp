@@ -10,6 +10,7 @@ std::ostream &DynamicMesh::writeToStream(std::ostream &stream, bool closing_brac
 	Object::writeToStream(stream, false);
 	stream << ",vertices:" << _vertices.size();
 	stream << ",indices:" << _indices.size();
+	stream << ",meshlets:" << _meshlets.size();
 	if (closing_bracer)
 		stream << "}";
 	return stream;
@@ -24,15 +25,60 @@ const std::vector<uint32_t> &DynamicMesh::getIndices() const {
 }
 
 std::vector<Vertex> &DynamicMesh::verticesRef() {
+	_dirtyVertexRanges.clear();
 	markDirty();
 	return _vertices;
 }
 
+std::vector<Vertex> &DynamicMesh::verticesRef(size_t first, size_t count) {
+	// A mesh already dirty without ranges is updated as a whole.
+	if (!isDirty() || !_dirtyVertexRanges.empty()) {
+		_dirtyVertexRanges.push_back({first, count});
+	}
+	markDirty();
+	return _vertices;
+}
+
+const std::vector<VertexRange> &DynamicMesh::getDirtyVertexRanges() const {
+	return _dirtyVertexRanges;
+}
+
 std::vector<uint32_t> &DynamicMesh::indicesRef() {
+	_dirtyVertexRanges.clear();
 	markDirty();
 	return _indices;
 }
 
+const std::vector<Meshlet> &DynamicMesh::getMeshlets() const {
+	return _meshlets;
+}
+
+std::vector<Meshlet> &DynamicMesh::meshletsRef() {
+	_dirtyVertexRanges.clear();
+	markDirty();
+	return _meshlets;
+}
+
+VertexFormat DynamicMesh::getVertexFormat() const {
+	return _vertexFormat;
+}
+
+void DynamicMesh::setVertexFormat(VertexFormat vertexFormat) {
+	_vertexFormat = vertexFormat;
+	_dirtyVertexRanges.clear();
+	markDirty();
+}
+
+bool DynamicMesh::isStreamed() const {
+	return _streamed;
+}
+
+void DynamicMesh::setStreamed(bool streamed) {
+	_streamed = streamed;
+	_dirtyVertexRanges.clear();
+	markDirty();
+}
+
 
 std::ostream &StaticMesh::writeToStream(std::ostream &stream, bool closing_bracer) const {
 	Object::writeToStream(stream, false);
@@ -0,0 +1,548 @@
+// Copyright 2024 Stone-Engine
+
+#include "Scene/Renderable/MeshOptimizer.hpp"
+
+#include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Renderable/SkinMesh.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace Stone::Scene {
+
+namespace {
+
+/** FIFO post-transform cache, a vertex is cached while fewer than cacheSize misses happened since its own miss. */
+class VertexCache {
+public:
+	VertexCache(size_t vertexCount, uint32_t cacheSize) : _timestamps(vertexCount, 0), _cacheSize(cacheSize) {
+		_time = cacheSize + 1;
+	}
+
+	/** Whether the vertex had to be transformed, it is then cached. */
+	bool access(uint32_t vertex) {
+		if (_time - _timestamps[vertex] <= _cacheSize) {
+			return false;
+		}
+		_timestamps[vertex] = _time++;
+		return true;
+	}
+
+	/** Evicts every vertex. */
+	void flush() {
+		_time += _cacheSize + 1;
+	}
+
+private:
+	std::vector<uint32_t> _timestamps;
+	uint32_t _cacheSize;
+	uint32_t _time;
+};
+
+/** The triangles using each vertex, as offsets into a shared list. */
+struct TriangleAdjacency {
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+
+	TriangleAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount) : offsets(vertexCount + 1, 0) {
+		for (uint32_t index : indices) {
+			++offsets[index + 1];
+		}
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		triangles.resize(indices.size());
+		std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i) {
+			triangles[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+};
+
+template <typename VertexType>
+size_t hashVertex(const VertexType &vertex) {
+	// FNV-1a over the bytes, the vertex types have no padding.
+	auto bytes = reinterpret_cast<const unsigned char *>(&vertex);
+	size_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < sizeof(VertexType); ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+/** Merges the vertices sharing every attribute bit for bit, and points the indices to the kept ones. */
+template <typename VertexType>
+void weldVertices(std::vector<VertexType> &vertices, std::vector<uint32_t> &indices) {
+	auto hash = [&vertices](uint32_t index) { return hashVertex(vertices[index]); };
+	auto equal = [&vertices](uint32_t lhs, uint32_t rhs) {
+		return std::memcmp(&vertices[lhs], &vertices[rhs], sizeof(VertexType)) == 0;
+	};
+	std::unordered_map<uint32_t, uint32_t, decltype(hash), decltype(equal)> uniqueVertices(vertices.size(), hash,
+																							equal);
+
+	std::vector<uint32_t> remap(vertices.size());
+	std::vector<VertexType> weldedVertices;
+	weldedVertices.reserve(vertices.size());
+	for (uint32_t i = 0; i < vertices.size(); ++i) {
+		auto [it, inserted] = uniqueVertices.emplace(i, static_cast<uint32_t>(weldedVertices.size()));
+		if (inserted) {
+			weldedVertices.push_back(vertices[i]);
+		}
+		remap[i] = it->second;
+	}
+
+	for (uint32_t &index : indices) {
+		index = remap[index];
+	}
+	vertices = std::move(weldedVertices);
+}
+
+template <typename VertexType>
+void remapVertices(std::vector<VertexType> &vertices, std::vector<uint32_t> &indices,
+				   const std::vector<uint32_t> &remap) {
+	size_t usedCount = 0;
+	for (uint32_t index : remap) {
+		if (index != std::numeric_limits<uint32_t>::max()) {
+			++usedCount;
+		}
+	}
+
+	std::vector<VertexType> remappedVertices(usedCount);
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		if (remap[i] != std::numeric_limits<uint32_t>::max()) {
+			remappedVertices[remap[i]] = vertices[i];
+		}
+	}
+
+	for (uint32_t &index : indices) {
+		index = remap[index];
+	}
+	vertices = std::move(remappedVertices);
+}
+
+/** Runs the enabled steps, the meshlets are built when a list is given to store them. */
+template <typename VertexType>
+void optimizeMeshData(std::vector<VertexType> &vertices, std::vector<uint32_t> &indices,
+					  const MeshOptimizationSettings &settings, std::vector<Meshlet> *meshlets = nullptr) {
+	if (meshlets != nullptr) {
+		meshlets->clear();
+	}
+	if (vertices.empty() || indices.size() < 3) {
+		return;
+	}
+
+	if (settings.weldVertices) {
+		weldVertices(vertices, indices);
+	}
+
+	if (settings.optimizeVertexCache) {
+		optimizeVertexCache(indices, vertices.size(), settings.cacheSize);
+	}
+
+	std::vector<glm::vec3> positions;
+	if (settings.optimizeOverdraw || (settings.buildMeshlets && meshlets != nullptr)) {
+		positions.reserve(vertices.size());
+		for (const VertexType &vertex : vertices) {
+			positions.push_back(vertex.position);
+		}
+	}
+
+	if (settings.optimizeOverdraw) {
+		optimizeOverdraw(indices, positions, settings.cacheSize, settings.overdrawThreshold);
+	}
+
+	// The meshlets are grown from the cache order, and keep their triangles in that order.
+	if (settings.buildMeshlets && meshlets != nullptr) {
+		*meshlets = buildMeshlets(indices, positions, settings.meshletVertices, settings.meshletTriangles);
+	}
+
+	// Last, the fetch order follows the final triangle order.
+	if (settings.optimizeVertexFetch) {
+		remapVertices(vertices, indices, computeVertexFetchRemap(indices, vertices.size()));
+	}
+}
+
+/** Splits the triangle order where the vertex cache order restarts, on triangles missing all of their vertices. */
+std::vector<size_t> findHardBoundaries(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+	std::vector<size_t> boundaries;
+	VertexCache cache(vertexCount, cacheSize);
+	size_t triangleCount = indices.size() / 3;
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+		int misses = 0;
+		for (size_t corner = 0; corner < 3; ++corner) {
+			misses += cache.access(indices[triangle * 3 + corner]) ? 1 : 0;
+		}
+		if (misses == 3) {
+			boundaries.push_back(triangle);
+		}
+	}
+	if (boundaries.empty() || boundaries.front() != 0) {
+		boundaries.insert(boundaries.begin(), 0);
+	}
+	return boundaries;
+}
+
+/** Splits the hard clusters further, wherever the cluster started so far has a good enough cache miss ratio. */
+std::vector<size_t> findSoftBoundaries(const std::vector<uint32_t> &indices, size_t vertexCount,
+									   const std::vector<size_t> &hardBoundaries, uint32_t cacheSize,
+									   float threshold) {
+	std::vector<size_t> boundaries;
+	VertexCache cache(vertexCount, cacheSize);
+	size_t triangleCount = indices.size() / 3;
+
+	for (size_t cluster = 0; cluster < hardBoundaries.size(); ++cluster) {
+		size_t start = hardBoundaries[cluster];
+		size_t end = cluster + 1 < hardBoundaries.size() ? hardBoundaries[cluster + 1] : triangleCount;
+
+		cache.flush();
+		size_t clusterMisses = 0;
+		for (size_t i = start * 3; i < end * 3; ++i) {
+			clusterMisses += cache.access(indices[i]) ? 1 : 0;
+		}
+		float clusterRatio = static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+		cache.flush();
+		boundaries.push_back(start);
+		size_t misses = 0;
+		size_t triangles = 0;
+		for (size_t triangle = start; triangle < end; ++triangle) {
+			for (size_t corner = 0; corner < 3; ++corner) {
+				misses += cache.access(indices[triangle * 3 + corner]) ? 1 : 0;
+			}
+			++triangles;
+
+			if (triangle + 1 < end &&
+				static_cast<float>(misses) / static_cast<float>(triangles) <= clusterRatio * threshold) {
+				boundaries.push_back(triangle + 1);
+				cache.flush();
+				misses = 0;
+				triangles = 0;
+			}
+		}
+	}
+	return boundaries;
+}
+
+/** Computes the bounding sphere and the normal cone of a meshlet from its triangles in the reordered indices. */
+void computeMeshletBounds(Meshlet &meshlet, const std::vector<uint32_t> &indices,
+						  const std::vector<glm::vec3> &positions) {
+	glm::vec3 min(std::numeric_limits<float>::max());
+	glm::vec3 max(std::numeric_limits<float>::lowest());
+	glm::vec3 normalSum(0.0f);
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.indexCount / 3);
+	for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+		const glm::vec3 &p0 = positions[indices[i]];
+		const glm::vec3 &p1 = positions[indices[i + 1]];
+		const glm::vec3 &p2 = positions[indices[i + 2]];
+		min = glm::min(min, glm::min(p0, glm::min(p1, p2)));
+		max = glm::max(max, glm::max(p0, glm::max(p1, p2)));
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length > 0.0f) {
+			normals.push_back(normal / length);
+			normalSum += normals.back();
+		}
+	}
+
+	glm::vec3 center = (min + max) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i) {
+		radius = std::max(radius, glm::length(positions[indices[i]] - center));
+	}
+	meshlet.boundingSphere = glm::vec4(center, radius);
+
+	// Without a narrow enough cone, the meshlet is never back facing.
+	meshlet.normalCone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float sumLength = glm::length(normalSum);
+	if (normals.empty() || sumLength <= 0.0f) {
+		return;
+	}
+	glm::vec3 axis = normalSum / sumLength;
+	float minDot = 1.0f;
+	for (const glm::vec3 &normal : normals) {
+		minDot = std::min(minDot, glm::dot(axis, normal));
+	}
+	if (minDot <= 0.1f) {
+		return;
+	}
+	meshlet.normalCone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+}
+
+} // namespace
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	TriangleAdjacency adjacency(indices, vertexCount);
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+		liveTriangles[vertex] = adjacency.offsets[vertex + 1] - adjacency.offsets[vertex];
+	}
+
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	size_t cursor = 0;
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	// Fans around a vertex, then continues with the cached candidate that will stay cached the longest.
+	int64_t fanningVertex = 0;
+	while (fanningVertex >= 0) {
+		candidates.clear();
+		auto vertex = static_cast<uint32_t>(fanningVertex);
+		for (uint32_t i = adjacency.offsets[vertex]; i < adjacency.offsets[vertex + 1]; ++i) {
+			uint32_t triangle = adjacency.triangles[i];
+			if (emitted[triangle]) {
+				continue;
+			}
+			emitted[triangle] = true;
+
+			for (size_t corner = 0; corner < 3; ++corner) {
+				uint32_t index = indices[triangle * 3 + corner];
+				result.push_back(index);
+				deadEnd.push_back(index);
+				candidates.push_back(index);
+				--liveTriangles[index];
+				if (time - cacheTimestamps[index] > cacheSize) {
+					cacheTimestamps[index] = time++;
+				}
+			}
+		}
+
+		fanningVertex = -1;
+		int64_t bestPriority = -1;
+		for (uint32_t candidate : candidates) {
+			if (liveTriangles[candidate] == 0) {
+				continue;
+			}
+			// A candidate is only worth it if its remaining triangles fit before it leaves the cache.
+			int64_t priority = 0;
+			if (time - cacheTimestamps[candidate] + 2 * liveTriangles[candidate] <= cacheSize) {
+				priority = time - cacheTimestamps[candidate];
+			}
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fanningVertex = candidate;
+			}
+		}
+
+		if (fanningVertex >= 0) {
+			continue;
+		}
+
+		// Dead end, restart from the most recent vertex still having triangles, else from the next one in order.
+		while (!deadEnd.empty() && fanningVertex < 0) {
+			uint32_t candidate = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[candidate] > 0) {
+				fanningVertex = candidate;
+			}
+		}
+		while (cursor < vertexCount && fanningVertex < 0) {
+			if (liveTriangles[cursor] > 0) {
+				fanningVertex = static_cast<int64_t>(cursor);
+			}
+			++cursor;
+		}
+	}
+
+	indices = std::move(result);
+}
+
+void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions, uint32_t cacheSize,
+					  float threshold) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	std::vector<size_t> hardBoundaries = findHardBoundaries(indices, positions.size(), cacheSize);
+	std::vector<size_t> clusters = findSoftBoundaries(indices, positions.size(), hardBoundaries, cacheSize, threshold);
+
+	glm::vec3 meshCentroid(0.0f);
+	for (uint32_t index : indices) {
+		meshCentroid += positions[index];
+	}
+	meshCentroid /= static_cast<float>(indices.size());
+
+	// Clusters facing away from the center are more likely to occlude the others, they are drawn first.
+	std::vector<float> sortKeys(clusters.size());
+	for (size_t cluster = 0; cluster < clusters.size(); ++cluster) {
+		size_t start = clusters[cluster];
+		size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (size_t triangle = start; triangle < end; ++triangle) {
+			const glm::vec3 &a = positions[indices[triangle * 3]];
+			const glm::vec3 &b = positions[indices[triangle * 3 + 1]];
+			const glm::vec3 &c = positions[indices[triangle * 3 + 2]];
+			glm::vec3 areaNormal = glm::cross(b - a, c - a);
+			float triangleArea = glm::length(areaNormal);
+			centroid += (a + b + c) * (triangleArea / 3.0f);
+			normal += areaNormal;
+			area += triangleArea;
+		}
+
+		float normalLength = glm::length(normal);
+		if (area <= 0.0f || normalLength <= 0.0f) {
+			sortKeys[cluster] = 0.0f;
+			continue;
+		}
+		sortKeys[cluster] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+	}
+
+	std::vector<size_t> order(clusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t lhs, size_t rhs) {
+		return sortKeys[lhs] > sortKeys[rhs];
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (size_t cluster : order) {
+		size_t start = clusters[cluster];
+		size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+		result.insert(result.end(), indices.begin() + static_cast<std::ptrdiff_t>(start * 3),
+					  indices.begin() + static_cast<std::ptrdiff_t>(end * 3));
+	}
+	indices = std::move(result);
+}
+
+std::vector<uint32_t> computeVertexFetchRemap(const std::vector<uint32_t> &indices, size_t vertexCount) {
+	std::vector<uint32_t> remap(vertexCount, std::numeric_limits<uint32_t>::max());
+	uint32_t next = 0;
+	for (uint32_t index : indices) {
+		if (remap[index] == std::numeric_limits<uint32_t>::max()) {
+			remap[index] = next++;
+		}
+	}
+	return remap;
+}
+
+float computeCacheMissRatio(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return 0.0f;
+	}
+
+	VertexCache cache(vertexCount, cacheSize);
+	size_t misses = 0;
+	for (uint32_t index : indices) {
+		misses += cache.access(index) ? 1 : 0;
+	}
+	return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
+
+std::vector<Meshlet> buildMeshlets(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions,
+								   uint32_t maxVertices, uint32_t maxTriangles) {
+	assert(maxVertices >= 3 && maxTriangles >= 1);
+
+	size_t triangleCount = indices.size() / 3;
+	TriangleAdjacency adjacency(indices, positions.size());
+	std::vector<bool> emitted(triangleCount, false);
+	// The meshlet each vertex was last added to, to count the vertices a triangle would add.
+	std::vector<uint32_t> vertexMeshlet(positions.size(), std::numeric_limits<uint32_t>::max());
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletIndices;
+	meshletIndices.reserve(indices.size());
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> meshletTriangles;
+
+	size_t nextSeed = 0;
+	while (true) {
+		while (nextSeed < triangleCount && emitted[nextSeed]) {
+			++nextSeed;
+		}
+		if (nextSeed == triangleCount) {
+			break;
+		}
+
+		auto meshletId = static_cast<uint32_t>(meshlets.size());
+		auto addedVertexCount = [&](uint32_t triangle) {
+			uint32_t count = 0;
+			for (size_t corner = 0; corner < 3; ++corner) {
+				count += vertexMeshlet[indices[triangle * 3 + corner]] != meshletId ? 1 : 0;
+			}
+			return count;
+		};
+		auto addTriangle = [&](uint32_t triangle) {
+			for (size_t corner = 0; corner < 3; ++corner) {
+				uint32_t vertex = indices[triangle * 3 + corner];
+				if (vertexMeshlet[vertex] != meshletId) {
+					vertexMeshlet[vertex] = meshletId;
+					meshletVertices.push_back(vertex);
+				}
+			}
+			meshletTriangles.push_back(triangle);
+			emitted[triangle] = true;
+		};
+
+		meshletVertices.clear();
+		meshletTriangles.clear();
+		addTriangle(static_cast<uint32_t>(nextSeed));
+
+		// Grow with the neighboring triangle adding the fewest vertices, the meshlet ends when none fits.
+		while (meshletTriangles.size() < maxTriangles) {
+			uint32_t bestTriangle = std::numeric_limits<uint32_t>::max();
+			uint32_t bestCount = 4;
+			for (size_t i = 0; i < meshletVertices.size() && bestCount > 0; ++i) {
+				uint32_t vertex = meshletVertices[i];
+				for (uint32_t j = adjacency.offsets[vertex]; j < adjacency.offsets[vertex + 1]; ++j) {
+					uint32_t triangle = adjacency.triangles[j];
+					if (emitted[triangle]) {
+						continue;
+					}
+					uint32_t count = addedVertexCount(triangle);
+					if (count < bestCount && meshletVertices.size() + count <= maxVertices) {
+						bestTriangle = triangle;
+						bestCount = count;
+					}
+				}
+			}
+			if (bestTriangle == std::numeric_limits<uint32_t>::max()) {
+				break;
+			}
+			addTriangle(bestTriangle);
+		}
+
+		Meshlet meshlet;
+		meshlet.firstIndex = static_cast<uint32_t>(meshletIndices.size());
+		meshlet.indexCount = static_cast<uint32_t>(meshletTriangles.size() * 3);
+		meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+		for (uint32_t triangle : meshletTriangles) {
+			meshletIndices.insert(meshletIndices.end(), indices.begin() + triangle * 3,
+								  indices.begin() + triangle * 3 + 3);
+		}
+		computeMeshletBounds(meshlet, meshletIndices, positions);
+		meshlets.push_back(meshlet);
+	}
+
+	indices = std::move(meshletIndices);
+	return meshlets;
+}
+
+void optimizeMesh(DynamicMesh &mesh, const MeshOptimizationSettings &settings) {
+	optimizeMeshData(mesh.verticesRef(), mesh.indicesRef(), settings, &mesh.meshletsRef());
+}
+
+void optimizeMesh(DynamicSkinMesh &mesh, const MeshOptimizationSettings &settings) {
+	optimizeMeshData(mesh.verticesRef(), mesh.indicesRef(), settings);
+}
+
+} // namespace Stone::Scene
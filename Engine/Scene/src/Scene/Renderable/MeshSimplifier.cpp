@@ -0,0 +1,346 @@
+// Copyright 2024 Stone-Engine
+
+#include "Scene/Renderable/MeshSimplifier.hpp"
+
+#include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Renderable/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace Stone::Scene {
+
+namespace {
+
+/** Sum of the squared distances to a set of planes, weighted by the area of the triangles they come from. */
+struct Quadric {
+	float a00 = 0.0f, a01 = 0.0f, a02 = 0.0f, a11 = 0.0f, a12 = 0.0f, a22 = 0.0f;
+	float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+	float c = 0.0f;
+	float weight = 0.0f;
+
+	/** The quadric of the plane dot(normal, p) + distance = 0. */
+	static Quadric fromPlane(const glm::vec3 &normal, float distance, float weight) {
+		Quadric quadric;
+		quadric.a00 = normal.x * normal.x * weight;
+		quadric.a01 = normal.x * normal.y * weight;
+		quadric.a02 = normal.x * normal.z * weight;
+		quadric.a11 = normal.y * normal.y * weight;
+		quadric.a12 = normal.y * normal.z * weight;
+		quadric.a22 = normal.z * normal.z * weight;
+		quadric.b0 = normal.x * distance * weight;
+		quadric.b1 = normal.y * distance * weight;
+		quadric.b2 = normal.z * distance * weight;
+		quadric.c = distance * distance * weight;
+		quadric.weight = weight;
+		return quadric;
+	}
+
+	void add(const Quadric &other) {
+		a00 += other.a00, a01 += other.a01, a02 += other.a02;
+		a11 += other.a11, a12 += other.a12, a22 += other.a22;
+		b0 += other.b0, b1 += other.b1, b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	/** The average squared distance from the point to the planes. */
+	[[nodiscard]] float evaluate(const glm::vec3 &p) const {
+		if (weight <= 0.0f) {
+			return 0.0f;
+		}
+		float value = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z;
+		value += 2.0f * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z);
+		value += 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+		return std::max(value, 0.0f) / weight;
+	}
+};
+
+struct PositionHash {
+	size_t operator()(const glm::vec3 &position) const {
+		// FNV-1a over the bytes of the three floats.
+		auto bytes = reinterpret_cast<const unsigned char *>(&position);
+		size_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(glm::vec3); ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+};
+
+/** The triangles using each vertex, as offsets into a shared list. */
+struct VertexTriangles {
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+
+	VertexTriangles(const std::vector<uint32_t> &indices, size_t vertexCount) : offsets(vertexCount + 1, 0) {
+		for (uint32_t index : indices) {
+			++offsets[index + 1];
+		}
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		triangles.resize(indices.size());
+		std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i) {
+			triangles[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+};
+
+/** A collapse moving the vertex from onto the vertex to. */
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	float error;
+};
+
+/**
+ * Marks the vertices sharing their position with another one, and the vertices on the edges not shared by exactly
+ * two triangles, which are open borders or non manifold parts of the surface.
+ */
+std::vector<bool> findLockedVertices(const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions) {
+	std::unordered_map<glm::vec3, uint32_t, PositionHash> positionIds(positions.size());
+	std::vector<uint32_t> vertexPositionIds(positions.size());
+	std::vector<uint32_t> sharingCounts;
+	for (size_t i = 0; i < positions.size(); ++i) {
+		auto [it, inserted] = positionIds.emplace(positions[i], static_cast<uint32_t>(sharingCounts.size()));
+		if (inserted) {
+			sharingCounts.push_back(0);
+		}
+		vertexPositionIds[i] = it->second;
+		++sharingCounts[it->second];
+	}
+
+	std::vector<bool> locked(positions.size(), false);
+	for (size_t i = 0; i < positions.size(); ++i) {
+		locked[i] = sharingCounts[vertexPositionIds[i]] > 1;
+	}
+
+	// The edges are counted between positions, the edges along a seam are used once on each side.
+	auto edgeKey = [&vertexPositionIds](uint32_t a, uint32_t b) {
+		uint64_t first = vertexPositionIds[a];
+		uint64_t second = vertexPositionIds[b];
+		return first < second ? (first << 32) | second : (second << 32) | first;
+	};
+	std::unordered_map<uint64_t, uint32_t> edgeUses(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (size_t corner = 0; corner < 3; ++corner) {
+			++edgeUses[edgeKey(indices[i + corner], indices[i + (corner + 1) % 3])];
+		}
+	}
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t a = indices[i + corner];
+			uint32_t b = indices[i + (corner + 1) % 3];
+			if (edgeUses[edgeKey(a, b)] != 2) {
+				locked[a] = true;
+				locked[b] = true;
+			}
+		}
+	}
+	return locked;
+}
+
+/** Whether moving a vertex would turn one of its triangles over, or make it much steeper. */
+bool collapseFlipsTriangle(const Collapse &collapse, const std::vector<uint32_t> &indices,
+						   const VertexTriangles &adjacency, const std::vector<glm::vec3> &points) {
+	for (uint32_t i = adjacency.offsets[collapse.from]; i < adjacency.offsets[collapse.from + 1]; ++i) {
+		const uint32_t *corners = &indices[adjacency.triangles[i] * 3];
+		if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+			// Removed by the collapse.
+			continue;
+		}
+
+		glm::vec3 before[3];
+		glm::vec3 after[3];
+		for (size_t corner = 0; corner < 3; ++corner) {
+			before[corner] = points[corners[corner]];
+			after[corner] = corners[corner] == collapse.from ? points[collapse.to] : before[corner];
+		}
+		glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+		glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+		if (glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+float simplifyIndices(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions, size_t targetIndexCount,
+					  float targetError) {
+	size_t vertexCount = positions.size();
+	if (indices.size() <= targetIndexCount || vertexCount == 0) {
+		return 0.0f;
+	}
+
+	// The errors are measured on positions scaled to the unit cube, to be relative to the extent of the mesh.
+	glm::vec3 min(std::numeric_limits<float>::max());
+	glm::vec3 max(std::numeric_limits<float>::lowest());
+	for (const glm::vec3 &position : positions) {
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+	float extent = std::max(std::max(max.x - min.x, max.y - min.y), max.z - min.z);
+	if (extent <= 0.0f) {
+		return 0.0f;
+	}
+	std::vector<glm::vec3> points(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i) {
+		points[i] = (positions[i] - min) / extent;
+	}
+
+	std::vector<bool> locked = findLockedVertices(indices, positions);
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		const glm::vec3 &p0 = points[indices[i]];
+		glm::vec3 normal = glm::cross(points[indices[i + 1]] - p0, points[indices[i + 2]] - p0);
+		float doubleArea = glm::length(normal);
+		if (doubleArea <= 0.0f) {
+			continue;
+		}
+		normal /= doubleArea;
+		Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5f);
+		for (size_t corner = 0; corner < 3; ++corner) {
+			quadrics[indices[i + corner]].add(plane);
+		}
+	}
+
+	size_t triangleCount = indices.size() / 3;
+	size_t targetTriangleCount = targetIndexCount / 3;
+	float errorLimit = targetError * targetError;
+	float largestError = 0.0f;
+	std::vector<bool> touched(vertexCount);
+	std::vector<Collapse> collapses;
+
+	// Each pass collapses the cheapest edges whose triangles were not changed yet by the pass, so the costs and the
+	// adjacency computed at its start stay valid.
+	while (triangleCount > targetTriangleCount) {
+		VertexTriangles adjacency(indices, vertexCount);
+
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			for (size_t corner = 0; corner < 3; ++corner) {
+				uint32_t from = indices[i + corner];
+				if (locked[from]) {
+					continue;
+				}
+				for (size_t other : {(corner + 1) % 3, (corner + 2) % 3}) {
+					uint32_t to = indices[i + other];
+					float error = quadrics[from].evaluate(points[to]);
+					if (error <= errorLimit) {
+						collapses.push_back({from, to, error});
+					}
+				}
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(),
+				  [](const Collapse &lhs, const Collapse &rhs) { return lhs.error < rhs.error; });
+
+		std::fill(touched.begin(), touched.end(), false);
+		size_t collapsedCount = 0;
+		for (const Collapse &collapse : collapses) {
+			if (triangleCount <= targetTriangleCount) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to] ||
+				collapseFlipsTriangle(collapse, indices, adjacency, points)) {
+				continue;
+			}
+
+			for (uint32_t i = adjacency.offsets[collapse.from]; i < adjacency.offsets[collapse.from + 1]; ++i) {
+				uint32_t *corners = &indices[adjacency.triangles[i] * 3];
+				if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+					--triangleCount;
+				}
+				for (size_t corner = 0; corner < 3; ++corner) {
+					touched[corners[corner]] = true;
+					if (corners[corner] == collapse.from) {
+						corners[corner] = collapse.to;
+					}
+				}
+			}
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			largestError = std::max(largestError, collapse.error);
+			++collapsedCount;
+		}
+		if (collapsedCount == 0) {
+			break;
+		}
+
+		size_t kept = 0;
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			if (a != b && b != c && c != a) {
+				indices[kept++] = a;
+				indices[kept++] = b;
+				indices[kept++] = c;
+			}
+		}
+		indices.resize(kept);
+	}
+
+	return std::sqrt(largestError);
+}
+
+std::shared_ptr<DynamicMesh> simplifyMesh(const DynamicMesh &mesh, float ratio, float targetError) {
+	const std::vector<Vertex> &vertices = mesh.getVertices();
+	std::vector<glm::vec3> positions;
+	positions.reserve(vertices.size());
+	for (const Vertex &vertex : vertices) {
+		positions.push_back(vertex.position);
+	}
+
+	std::vector<uint32_t> indices = mesh.getIndices();
+	size_t targetIndexCount = static_cast<size_t>(static_cast<float>(indices.size() / 3) * ratio) * 3;
+	simplifyIndices(indices, positions, targetIndexCount, targetError);
+	optimizeVertexCache(indices, vertices.size());
+
+	auto simplified = std::make_shared<DynamicMesh>();
+	simplified->setVertexFormat(mesh.getVertexFormat());
+	std::vector<uint32_t> remap = computeVertexFetchRemap(indices, vertices.size());
+	std::vector<Vertex> &simplifiedVertices = simplified->verticesRef();
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		if (remap[i] != std::numeric_limits<uint32_t>::max()) {
+			simplifiedVertices.resize(std::max<size_t>(simplifiedVertices.size(), remap[i] + 1));
+			simplifiedVertices[remap[i]] = vertices[i];
+		}
+	}
+	for (uint32_t &index : indices) {
+		index = remap[index];
+	}
+	simplified->indicesRef() = std::move(indices);
+	return simplified;
+}
+
+std::vector<std::shared_ptr<DynamicMesh>> generateLods(const DynamicMesh &mesh, uint32_t levelCount, float ratio,
+													   float targetError) {
+	std::vector<std::shared_ptr<DynamicMesh>> lods;
+	const DynamicMesh *previous = &mesh;
+	float levelError = targetError;
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		std::shared_ptr<DynamicMesh> lod = simplifyMesh(*previous, ratio, levelError);
+
+		// A level keeping most of the triangles of the previous one would only cost memory.
+		size_t previousIndexCount = previous->getIndices().size();
+		float largestIndexCount = static_cast<float>(previousIndexCount) * (1.0f + ratio) * 0.5f;
+		if (lod->getIndices().empty() || static_cast<float>(lod->getIndices().size()) > largestIndexCount) {
+			break;
+		}
+
+		lods.push_back(lod);
+		previous = lod.get();
+		levelError /= std::sqrt(ratio);
+	}
+	return lods;
+}
+
+} // namespace Stone::Scene
@@ -5,6 +5,7 @@
 #include "Scene/RendererObjectManager.hpp"
 #include "Utils/StringExt.hpp"
 
+#include <cassert>
 #include <iomanip>
 
 namespace Stone::Scene {
@@ -86,4 +87,14 @@ void Shader::setLocation(const std::string &name, int location) {
 	markDirty();
 }
 
+const std::vector<std::string> &Shader::getKeywords() const {
+	return _keywords;
+}
+
+void Shader::setKeywords(std::vector<std::string> keywords) {
+	assert(keywords.size() <= maxKeywords);
+	_keywords = std::move(keywords);
+	markDirty();
+}
+
 } // namespace Stone::Scene
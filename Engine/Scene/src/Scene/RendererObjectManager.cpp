@@ -20,6 +20,11 @@ const std::unordered_map<std::intptr_t, CastFunction> updateCastedFunctions = {
 	CASTED_FUNCTION_MAP_ENTRY(DynamicMesh),		CASTED_FUNCTION_MAP_ENTRY(StaticMesh),
 	CASTED_FUNCTION_MAP_ENTRY(DynamicSkinMesh), CASTED_FUNCTION_MAP_ENTRY(StaticSkinMesh),
 	CASTED_FUNCTION_MAP_ENTRY(Texture),			CASTED_FUNCTION_MAP_ENTRY(Shader),
+	CASTED_FUNCTION_MAP_ENTRY(LodMeshNode),
+	CASTED_FUNCTION_MAP_ENTRY(AmbientLightNode),
+	CASTED_FUNCTION_MAP_ENTRY(PointLightNode),
+	CASTED_FUNCTION_MAP_ENTRY(SpotLightNode),
+	CASTED_FUNCTION_MAP_ENTRY(DirectionalLightNode),
 };
 
 void RendererObjectManager::updateRenderable(const std::shared_ptr<Core::Object> &renderable) {
@@ -45,6 +50,18 @@ void RendererObjectManager::updateInstancedMeshNode(const std::shared_ptr<Instan
 	instancedMeshNode->markUndirty();
 }
 
+void RendererObjectManager::updateLodMeshNode(const std::shared_ptr<LodMeshNode> &lodMeshNode) {
+	if (lodMeshNode->getMaterial() && lodMeshNode->getMaterial()->isDirty())
+		updateMaterial(lodMeshNode->getMaterial());
+	if (lodMeshNode->getMesh() && lodMeshNode->getMesh()->isDirty())
+		updateRenderable(lodMeshNode->getMesh());
+	for (const LodMeshNode::Lod &lod : lodMeshNode->getLods()) {
+		if (lod.mesh && lod.mesh->isDirty())
+			updateRenderable(lod.mesh);
+	}
+	lodMeshNode->markUndirty();
+}
+
 void RendererObjectManager::updateSkinMeshNode(const std::shared_ptr<SkinMeshNode> &skinMeshNode) {
 	if (skinMeshNode->getMaterial() && skinMeshNode->getMaterial()->isDirty())
 		updateMaterial(skinMeshNode->getMaterial());
@@ -53,6 +70,23 @@ void RendererObjectManager::updateSkinMeshNode(const std::shared_ptr<SkinMeshNod
 	skinMeshNode->markUndirty();
 }
 
+void RendererObjectManager::updateAmbientLightNode(const std::shared_ptr<AmbientLightNode> &ambientLightNode) {
+	ambientLightNode->markUndirty();
+}
+
+void RendererObjectManager::updatePointLightNode(const std::shared_ptr<PointLightNode> &pointLightNode) {
+	pointLightNode->markUndirty();
+}
+
+void RendererObjectManager::updateSpotLightNode(const std::shared_ptr<SpotLightNode> &spotLightNode) {
+	spotLightNode->markUndirty();
+}
+
+void RendererObjectManager::updateDirectionalLightNode(
+	const std::shared_ptr<DirectionalLightNode> &directionalLightNode) {
+	directionalLightNode->markUndirty();
+}
+
 void RendererObjectManager::updateMaterial(const std::shared_ptr<Material> &material) {
 	auto vertexShader = material->getVertexShader();
 	if (vertexShader && vertexShader->isDirty()) {
@@ -70,6 +104,7 @@ void RendererObjectManager::updateMaterial(const std::shared_ptr<Material> &mate
 }
 
 void RendererObjectManager::updateDynamicMesh(const std::shared_ptr<DynamicMesh> &mesh) {
+	mesh->_dirtyVertexRanges.clear();
 	mesh->markUndirty();
 }
 
@@ -2,7 +2,10 @@
 
 #include "Scene/Vertex.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 namespace Stone::Scene {
 
@@ -36,4 +39,80 @@ WeightVertex::WeightVertex(const glm::vec3 &p, const glm::vec3 &n, const glm::ve
 WeightVertex::WeightVertex(const glm::vec3 &p, const glm::vec2 &uv) : WeightVertex(p, glm::vec3(0, 1, 0), uv) {
 }
 
+glm::vec2 octahedralEncode(const glm::vec3 &direction) {
+	float norm = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+	if (norm == 0.0f) {
+		return glm::vec2(0.0f);
+	}
+
+	glm::vec3 octahedron = direction / norm;
+	if (octahedron.z >= 0.0f) {
+		return {octahedron.x, octahedron.y};
+	}
+
+	// The lower half is folded over the corners of the square.
+	return {(1.0f - std::abs(octahedron.y)) * (octahedron.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(octahedron.x)) * (octahedron.y >= 0.0f ? 1.0f : -1.0f)};
+}
+
+glm::vec3 octahedralDecode(const glm::vec2 &encoded) {
+	glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	float fold = std::max(-direction.z, 0.0f);
+	direction.x += direction.x >= 0.0f ? -fold : fold;
+	direction.y += direction.y >= 0.0f ? -fold : fold;
+	return glm::normalize(direction);
+}
+
+static int16_t packSnorm16(float value) {
+	return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static float unpackSnorm16(int16_t value) {
+	return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+static glm::i16vec2 packOctahedral(const glm::vec3 &direction) {
+	glm::vec2 encoded = octahedralEncode(direction);
+	return {packSnorm16(encoded.x), packSnorm16(encoded.y)};
+}
+
+static glm::vec3 unpackOctahedral(const glm::i16vec2 &packed) {
+	return octahedralDecode(glm::vec2(unpackSnorm16(packed.x), unpackSnorm16(packed.y)));
+}
+
+PackedVertex packVertex(const Vertex &vertex) {
+	PackedVertex packed;
+	packed.position = vertex.position;
+	packed.normal = packOctahedral(vertex.normal);
+	packed.tangent = packOctahedral(vertex.tangent);
+	packed.uv = glm::u16vec2(glm::packHalf1x16(vertex.uv.x), glm::packHalf1x16(vertex.uv.y));
+
+	// Costs the lowest bit of precision of the tangent, the bitangent is only needed for its handedness.
+	bool mirrored = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f;
+	packed.tangent.y = static_cast<int16_t>((packed.tangent.y & ~1) | (mirrored ? 1 : 0));
+	return packed;
+}
+
+QuantizedVertex quantizeVertex(const Vertex &vertex, const glm::vec3 &origin, float extent) {
+	PackedVertex packed = packVertex(vertex);
+
+	QuantizedVertex quantized;
+	glm::vec3 position = glm::clamp((vertex.position - origin) / extent, 0.0f, 1.0f);
+	quantized.position = glm::u16vec4(static_cast<uint16_t>(std::round(position.x * 65535.0f)),
+									  static_cast<uint16_t>(std::round(position.y * 65535.0f)),
+									  static_cast<uint16_t>(std::round(position.z * 65535.0f)), 0);
+	quantized.normal = packed.normal;
+	quantized.tangent = packed.tangent;
+	quantized.uv = packed.uv;
+	return quantized;
+}
+
+Vertex unpackVertex(const PackedVertex &vertex) {
+	glm::vec3 normal = unpackOctahedral(vertex.normal);
+	glm::vec3 tangent = unpackOctahedral(vertex.tangent);
+	float handedness = (vertex.tangent.y & 1) != 0 ? -1.0f : 1.0f;
+	glm::vec2 uv(glm::unpackHalf1x16(vertex.uv.x), glm::unpackHalf1x16(vertex.uv.y));
+	return {vertex.position, normal, tangent, glm::cross(normal, tangent) * handedness, uv};
+}
+
 } // namespace Stone::Scene
@@ -0,0 +1,151 @@
+#include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Renderable/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+
+using namespace Stone::Scene;
+
+/** A grid of quads with one vertex per triangle corner, as imported without joining the vertices. */
+static std::shared_ptr<DynamicMesh> makeUnweldedGrid(int size) {
+	auto mesh = std::make_shared<DynamicMesh>();
+	auto corner = [size](int x, int y) {
+		return Vertex(glm::vec3(x, y, 0.0f), glm::vec2(x, y) / static_cast<float>(size));
+	};
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			for (const Vertex &vertex : {corner(x, y), corner(x + 1, y), corner(x + 1, y + 1), corner(x, y),
+										 corner(x + 1, y + 1), corner(x, y + 1)}) {
+				mesh->indicesRef().push_back(static_cast<uint32_t>(mesh->getVertices().size()));
+				mesh->verticesRef().push_back(vertex);
+			}
+		}
+	}
+	return mesh;
+}
+
+/** The triangles of a mesh by their corner positions, in a comparable order. */
+static std::vector<std::array<float, 9>> sortedTriangles(const DynamicMesh &mesh) {
+	std::vector<std::array<float, 9>> triangles;
+	const std::vector<uint32_t> &indices = mesh.getIndices();
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		std::array<float, 9> triangle = {};
+		for (size_t corner = 0; corner < 3; ++corner) {
+			const glm::vec3 &position = mesh.getVertices()[indices[i + corner]].position;
+			triangle[corner * 3] = position.x;
+			triangle[corner * 3 + 1] = position.y;
+			triangle[corner * 3 + 2] = position.z;
+		}
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+TEST(MeshOptimizer, WeldVertices) {
+	auto mesh = makeUnweldedGrid(8);
+	auto triangles = sortedTriangles(*mesh);
+
+	MeshOptimizationSettings settings;
+	settings.optimizeVertexCache = false;
+	settings.optimizeOverdraw = false;
+	settings.optimizeVertexFetch = false;
+	optimizeMesh(*mesh, settings);
+
+	EXPECT_EQ(mesh->getVertices().size(), 9u * 9u);
+	EXPECT_EQ(mesh->getIndices().size(), 8u * 8u * 6u);
+	EXPECT_EQ(sortedTriangles(*mesh), triangles);
+}
+
+TEST(MeshOptimizer, VertexCache) {
+	auto mesh = makeUnweldedGrid(32);
+	MeshOptimizationSettings settings;
+	settings.optimizeVertexCache = false;
+	settings.optimizeOverdraw = false;
+	settings.optimizeVertexFetch = false;
+	optimizeMesh(*mesh, settings);
+
+	// Shuffles the triangles to start from the worst order.
+	std::vector<uint32_t> &indices = mesh->indicesRef();
+	std::vector<size_t> order(indices.size() / 3);
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), std::mt19937(42));
+	std::vector<uint32_t> shuffled;
+	for (size_t triangle : order) {
+		shuffled.insert(shuffled.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+	}
+	indices = shuffled;
+	auto triangles = sortedTriangles(*mesh);
+
+	float shuffledRatio = computeCacheMissRatio(indices, mesh->getVertices().size());
+	optimizeVertexCache(indices, mesh->getVertices().size());
+	float optimizedRatio = computeCacheMissRatio(indices, mesh->getVertices().size());
+
+	EXPECT_LT(optimizedRatio, shuffledRatio * 0.5f);
+	EXPECT_LT(optimizedRatio, 1.0f);
+	EXPECT_EQ(sortedTriangles(*mesh), triangles);
+}
+
+TEST(MeshOptimizer, OptimizeMesh) {
+	auto mesh = makeUnweldedGrid(16);
+	auto triangles = sortedTriangles(*mesh);
+	mesh->verticesRef().push_back(Vertex(glm::vec3(100.0f), glm::vec2(0.0f)));
+
+	optimizeMesh(*mesh);
+
+	// The unused vertex is dropped, the others are fetched in their order of first use.
+	EXPECT_EQ(mesh->getVertices().size(), 17u * 17u);
+	EXPECT_EQ(sortedTriangles(*mesh), triangles);
+	uint32_t nextVertex = 0;
+	for (uint32_t index : mesh->getIndices()) {
+		EXPECT_LE(index, nextVertex);
+		nextVertex = std::max(nextVertex, index + 1);
+	}
+	EXPECT_LT(computeCacheMissRatio(mesh->getIndices(), mesh->getVertices().size()), 1.0f);
+}
+
+TEST(MeshOptimizer, BuildMeshlets) {
+	auto mesh = makeUnweldedGrid(32);
+	auto triangles = sortedTriangles(*mesh);
+
+	MeshOptimizationSettings settings;
+	settings.buildMeshlets = true;
+	optimizeMesh(*mesh, settings);
+
+	const std::vector<Meshlet> &meshlets = mesh->getMeshlets();
+	const std::vector<uint32_t> &indices = mesh->getIndices();
+	ASSERT_FALSE(meshlets.empty());
+	EXPECT_EQ(sortedTriangles(*mesh), triangles);
+
+	// The meshlets cover the indices in order, within their limits and their bounding spheres.
+	uint32_t nextIndex = 0;
+	for (const Meshlet &meshlet : meshlets) {
+		EXPECT_EQ(meshlet.firstIndex, nextIndex);
+		nextIndex += meshlet.indexCount;
+		EXPECT_LE(meshlet.indexCount, maxMeshletTriangles * 3);
+		EXPECT_LE(meshlet.vertexCount, maxMeshletVertices);
+
+		for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i) {
+			glm::vec3 offset = mesh->getVertices()[indices[i]].position - glm::vec3(meshlet.boundingSphere);
+			EXPECT_LE(glm::length(offset), meshlet.boundingSphere.w + 1e-4f);
+		}
+
+		// The grid faces +z, it is only hidden from below.
+		EXPECT_NEAR(meshlet.normalCone.z, 1.0f, 1e-4f);
+		glm::vec3 center(meshlet.boundingSphere);
+		EXPECT_TRUE(isMeshletBackFacing(meshlet, center - glm::vec3(0.0f, 0.0f, 10.0f)));
+		EXPECT_FALSE(isMeshletBackFacing(meshlet, center + glm::vec3(0.0f, 0.0f, 10.0f)));
+		EXPECT_FALSE(isMeshletBackFacing(meshlet, center + glm::vec3(100.0f, 0.0f, 0.1f)));
+	}
+	EXPECT_EQ(nextIndex, indices.size());
+
+	// Growing from the neighbors fills the meshlets close to the vertex limit of a square patch.
+	EXPECT_GT(indices.size() / 3 / meshlets.size(), 64u);
+
+	// Reordering the triangles again drops the meshlets indexing them.
+	optimizeMesh(*mesh);
+	EXPECT_TRUE(mesh->getMeshlets().empty());
+}
@@ -0,0 +1,118 @@
+#include "Scene/Renderable/Mesh.hpp"
+#include "Scene/Renderable/MeshSimplifier.hpp"
+
+#include <gtest/gtest.h>
+#include <set>
+
+using namespace Stone::Scene;
+
+/**
+ * A welded grid of quads in the xy plane, raised along z by the height function. With a seam column, the vertices of
+ * that column are split in two with different texture coordinates, as imported along a UV seam.
+ */
+template <typename HeightFunction>
+static std::shared_ptr<DynamicMesh> makeGrid(int size, HeightFunction height, int seamColumn = -1) {
+	auto mesh = std::make_shared<DynamicMesh>();
+	std::vector<Vertex> &vertices = mesh->verticesRef();
+	std::vector<uint32_t> &indices = mesh->indicesRef();
+
+	auto vertexIndex = [&](int x, int y, bool rightSide) {
+		int rowSize = size + (seamColumn >= 0 ? 2 : 1);
+		int column = x + (seamColumn >= 0 && x >= seamColumn && (x > seamColumn || rightSide) ? 1 : 0);
+		return static_cast<uint32_t>(y * rowSize + column);
+	};
+	for (int y = 0; y <= size; ++y) {
+		for (int x = 0; x <= size; ++x) {
+			glm::vec3 position(x, y, height(x, y));
+			glm::vec2 uv = glm::vec2(x, y) / static_cast<float>(size);
+			vertices.emplace_back(position, uv);
+			if (x == seamColumn) {
+				vertices.emplace_back(position, uv + glm::vec2(0.5f, 0.0f));
+			}
+		}
+	}
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			bool rightSide = x >= seamColumn;
+			uint32_t corners[4] = {vertexIndex(x, y, rightSide), vertexIndex(x + 1, y, rightSide),
+								   vertexIndex(x + 1, y + 1, rightSide), vertexIndex(x, y + 1, rightSide)};
+			indices.insert(indices.end(), {corners[0], corners[1], corners[2], corners[0], corners[2], corners[3]});
+		}
+	}
+	return mesh;
+}
+
+static std::vector<glm::vec3> positionsOf(const DynamicMesh &mesh) {
+	std::vector<glm::vec3> positions;
+	for (const Vertex &vertex : mesh.getVertices()) {
+		positions.push_back(vertex.position);
+	}
+	return positions;
+}
+
+TEST(MeshSimplifier, FlatGridKeepsBorderAndOrientation) {
+	auto mesh = makeGrid(16, [](int, int) { return 0.0f; });
+	std::vector<glm::vec3> positions = positionsOf(*mesh);
+	std::vector<uint32_t> indices = mesh->getIndices();
+
+	size_t targetIndexCount = indices.size() / 4;
+	float error = simplifyIndices(indices, positions, targetIndexCount, 0.01f);
+	EXPECT_LE(indices.size(), targetIndexCount);
+	EXPECT_NEAR(error, 0.0f, 1e-4f);
+
+	std::set<uint32_t> used(indices.begin(), indices.end());
+	for (uint32_t i = 0; i < positions.size(); ++i) {
+		const glm::vec3 &position = positions[i];
+		if (position.x == 0.0f || position.y == 0.0f || position.x == 16.0f || position.y == 16.0f) {
+			EXPECT_TRUE(used.count(i)) << "border vertex " << i << " was removed";
+		}
+	}
+
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		glm::vec3 normal = glm::cross(positions[indices[i + 1]] - positions[indices[i]],
+									  positions[indices[i + 2]] - positions[indices[i]]);
+		EXPECT_GT(normal.z, 0.0f);
+	}
+}
+
+TEST(MeshSimplifier, KeepsSeamVertices) {
+	auto mesh = makeGrid(16, [](int, int) { return 0.0f; }, 8);
+	std::vector<glm::vec3> positions = positionsOf(*mesh);
+	std::vector<uint32_t> indices = mesh->getIndices();
+
+	simplifyIndices(indices, positions, indices.size() / 4, 0.01f);
+
+	std::set<uint32_t> used(indices.begin(), indices.end());
+	for (uint32_t i = 0; i < positions.size(); ++i) {
+		if (positions[i].x == 8.0f) {
+			EXPECT_TRUE(used.count(i)) << "seam vertex " << i << " was removed";
+		}
+	}
+}
+
+TEST(MeshSimplifier, StopsAtTargetError) {
+	auto mesh = makeGrid(16, [](int x, int y) { return 4.0f * std::sin(x * 0.4f) * std::cos(y * 0.4f); });
+	std::vector<glm::vec3> positions = positionsOf(*mesh);
+	std::vector<uint32_t> indices = mesh->getIndices();
+
+	float error = simplifyIndices(indices, positions, 0, 0.005f);
+	EXPECT_LE(error, 0.005f);
+	EXPECT_GT(indices.size(), 0u);
+	EXPECT_LT(indices.size(), mesh->getIndices().size());
+}
+
+TEST(MeshSimplifier, GenerateLods) {
+	auto mesh = makeGrid(32, [](int x, int y) { return 0.5f * std::sin(x * 0.2f) * std::cos(y * 0.2f); });
+
+	auto lods = generateLods(*mesh, 3, 0.5f, 0.01f);
+	ASSERT_FALSE(lods.empty());
+
+	size_t previousIndexCount = mesh->getIndices().size();
+	for (const std::shared_ptr<DynamicMesh> &lod : lods) {
+		EXPECT_LT(lod->getIndices().size(), previousIndexCount);
+		for (uint32_t index : lod->getIndices()) {
+			ASSERT_LT(index, lod->getVertices().size());
+		}
+		previousIndexCount = lod->getIndices().size();
+	}
+}
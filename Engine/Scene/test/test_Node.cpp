@@ -1,6 +1,13 @@
 
+#include "Scene/Node/LightNode.hpp"
+#include "Scene/Node/LodMeshNode.hpp"
 #include "Scene/Node/Node.hpp"
+#include "Scene/Node/PivotNode.hpp"
+#include "Scene/Node/SkeletonNode.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
 #include <gtest/gtest.h>
 
 using namespace Stone::Scene;
@@ -23,3 +30,101 @@ TEST(Node, GetGlobalName) {
 	EXPECT_EQ(child2->getGlobalName(), "/Root/Child2");
 	EXPECT_EQ(grandchild->getGlobalName(), "/Root/Child2/Grandchild");
 }
+
+TEST(SkeletonNode, ComputeBoneMatrices) {
+	auto root = std::make_shared<PivotNode>("Root");
+	auto meshNode = std::make_shared<Node>("Mesh");
+	auto bone = std::make_shared<PivotNode>("Bone");
+	auto skeleton = std::make_shared<SkeletonNode>("Skeleton");
+	root->addChild(meshNode);
+	root->addChild(bone);
+	root->addChild(skeleton);
+	root->getTransform().setPosition(glm::vec3(5.0f, 0.0f, 0.0f));
+	bone->getTransform().setPosition(glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// The bone is bound at its current pose.
+	skeleton->addBone(bone, glm::inverse(bone->getTransformMatrixRelativeToNode(meshNode)));
+
+	std::vector<glm::mat4> matrices;
+	skeleton->computeBoneMatrices(meshNode, matrices);
+	ASSERT_EQ(matrices.size(), 1);
+	glm::vec4 bound = matrices[0] * glm::vec4(0.0f, 1.5f, 0.0f, 1.0f);
+	EXPECT_FLOAT_EQ(bound.x, 0.0f);
+	EXPECT_FLOAT_EQ(bound.y, 1.5f);
+
+	// Moving the bone moves the vertices it influences, the root moves the mesh node with them.
+	bone->getTransform().setPosition(glm::vec3(2.0f, 1.0f, 0.0f));
+	skeleton->computeBoneMatrices(meshNode, matrices);
+	glm::vec4 posed = matrices[0] * glm::vec4(0.0f, 1.5f, 0.0f, 1.0f);
+	EXPECT_FLOAT_EQ(posed.x, 2.0f);
+	EXPECT_FLOAT_EQ(posed.y, 1.5f);
+}
+
+TEST(LodMeshNode, ComputeScreenSize) {
+	MvpMatrices mvp;
+	mvp.projMatrix = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+	mvp.modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f));
+	glm::vec4 sphere(0.0f, 0.0f, 0.0f, 1.0f);
+
+	EXPECT_NEAR(LodMeshNode::computeScreenSize(mvp, sphere), 0.1f, 1e-5f);
+
+	// Scaling the node scales the sphere, moving it away shrinks it.
+	mvp.modelMatrix = glm::scale(mvp.modelMatrix, glm::vec3(2.0f));
+	EXPECT_NEAR(LodMeshNode::computeScreenSize(mvp, sphere), 0.2f, 1e-5f);
+	mvp.modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -20.0f));
+	EXPECT_NEAR(LodMeshNode::computeScreenSize(mvp, sphere), 0.05f, 1e-5f);
+
+	// Behind the camera the sphere is never simplified.
+	mvp.modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 10.0f));
+	EXPECT_GT(LodMeshNode::computeScreenSize(mvp, sphere), 1.0f);
+
+	// The orthographic size does not depend on the distance.
+	mvp.projMatrix = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f);
+	mvp.modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -50.0f));
+	EXPECT_NEAR(LodMeshNode::computeScreenSize(mvp, sphere), 0.2f, 1e-5f);
+}
+
+TEST(LodMeshNode, SelectLod) {
+	auto node = std::make_shared<LodMeshNode>();
+	node->addLod(nullptr, 0.1f);
+	node->addLod(nullptr, 0.4f);
+	node->addLod(nullptr, 0.2f);
+
+	ASSERT_EQ(node->getLods().size(), 3u);
+	EXPECT_EQ(node->getLods()[0].screenSize, 0.4f);
+	EXPECT_EQ(node->getLods()[1].screenSize, 0.2f);
+	EXPECT_EQ(node->getLods()[2].screenSize, 0.1f);
+
+	EXPECT_EQ(node->selectLod(1.0f), 0u);
+	EXPECT_EQ(node->selectLod(0.4f), 0u);
+	EXPECT_EQ(node->selectLod(0.3f), 1u);
+	EXPECT_EQ(node->selectLod(0.15f), 2u);
+	EXPECT_EQ(node->selectLod(0.01f), 3u);
+}
+
+TEST(PointLightNode, GetRange) {
+	auto light = std::make_shared<PointLightNode>();
+	EXPECT_NEAR(light->getRange(), (std::sqrt(1021.0f) - 1.0f) / 2.0f, 1e-4f);
+
+	light->setAttenuation({1.0f, 0.5f, 0.0f});
+	EXPECT_NEAR(light->getRange(), 510.0f, 1e-3f);
+
+	light->setIntensity(0.0f);
+	EXPECT_EQ(light->getRange(), 0.0f);
+}
+
+TEST(DirectionalLightNode, ComputeCascadeSplits) {
+	std::vector<float> splits = DirectionalLightNode::computeCascadeSplits(1.0f, 1000.0f, 3);
+	ASSERT_EQ(splits.size(), 4);
+	EXPECT_FLOAT_EQ(splits.front(), 1.0f);
+	EXPECT_FLOAT_EQ(splits.back(), 1000.0f);
+	EXPECT_TRUE(std::is_sorted(splits.begin(), splits.end()));
+
+	std::vector<float> logarithmic = DirectionalLightNode::computeCascadeSplits(1.0f, 1000.0f, 3, 1.0f);
+	EXPECT_NEAR(logarithmic[1], 10.0f, 1e-3f);
+	EXPECT_NEAR(logarithmic[2], 100.0f, 1e-2f);
+
+	std::vector<float> uniform = DirectionalLightNode::computeCascadeSplits(1.0f, 1000.0f, 3, 0.0f);
+	EXPECT_NEAR(uniform[1], 334.0f, 1e-3f);
+	EXPECT_NEAR(uniform[2], 667.0f, 1e-3f);
+}
@@ -1,4 +1,5 @@
 #include "Scene.hpp"
+#include "Scene/RendererObjectManager.hpp"
 
 #include <gtest/gtest.h>
 
@@ -164,3 +165,54 @@ void testNodeDynamic() {
 	auto none = makeNode<Node>("Node", "none");
 	EXPECT_EQ(none, nullptr);
 }
+
+TEST(Scene, MaterialVariantMask) {
+	auto shader = std::make_shared<Shader>("shaders/frag.glsl");
+	shader->setKeywords({"HAS_DIFFUSE", "HAS_NORMALS", "ALPHA_TEST"});
+
+	auto material = std::make_shared<Material>();
+	EXPECT_EQ(material->getVariantMask(), 0u);
+
+	material->setFragmentShader(shader);
+	EXPECT_EQ(material->getVariantMask(), 0u);
+
+	// Textures enable their keyword, the others are enabled by hand.
+	material->setTextureParameter("diffuse", std::make_shared<Texture>());
+	EXPECT_EQ(material->getVariantMask(), 0b001u);
+	material->setKeyword("ALPHA_TEST", true);
+	EXPECT_EQ(material->getVariantMask(), 0b101u);
+	EXPECT_TRUE(material->isKeywordEnabled("HAS_DIFFUSE"));
+	EXPECT_FALSE(material->isKeywordEnabled("HAS_NORMALS"));
+
+	material->setKeyword("ALPHA_TEST", false);
+	material->setTextureParameter("normals", std::make_shared<Texture>());
+	EXPECT_EQ(material->getVariantMask(), 0b011u);
+}
+
+TEST(Scene, DynamicMeshDirtyVertexRanges) {
+	auto mesh = std::make_shared<DynamicMesh>();
+	mesh->verticesRef().resize(16);
+	RendererObjectManager manager;
+	manager.updateDynamicMesh(mesh);
+	EXPECT_FALSE(mesh->isDirty());
+	EXPECT_TRUE(mesh->getDirtyVertexRanges().empty());
+
+	mesh->verticesRef(2, 3)[2].position.x = 1.0f;
+	mesh->verticesRef(8, 1)[8].position.y = 1.0f;
+	EXPECT_TRUE(mesh->isDirty());
+	ASSERT_EQ(mesh->getDirtyVertexRanges().size(), 2u);
+	EXPECT_EQ(mesh->getDirtyVertexRanges()[0].first, 2u);
+	EXPECT_EQ(mesh->getDirtyVertexRanges()[0].count, 3u);
+	EXPECT_EQ(mesh->getDirtyVertexRanges()[1].first, 8u);
+
+	// Modifying the vertices without a range makes the whole mesh dirty, later ranges stay covered by it.
+	mesh->verticesRef();
+	mesh->verticesRef(4, 1);
+	EXPECT_TRUE(mesh->getDirtyVertexRanges().empty());
+
+	manager.updateDynamicMesh(mesh);
+	mesh->verticesRef(0, 1);
+	EXPECT_EQ(mesh->getDirtyVertexRanges().size(), 1u);
+	manager.updateDynamicMesh(mesh);
+	EXPECT_TRUE(mesh->getDirtyVertexRanges().empty());
+}
@@ -0,0 +1,70 @@
+#include "Scene/Vertex.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace Stone::Scene;
+
+static const glm::vec3 directions[] = {
+	{0.0f, 0.0f, 1.0f},
+	{0.0f, 0.0f, -1.0f},
+	{1.0f, 0.0f, 0.0f},
+	{0.0f, -1.0f, 0.0f},
+	{0.6f, 0.0f, -0.8f},
+	{-0.48f, 0.6f, 0.64f},
+	{0.36f, -0.48f, -0.8f},
+	{-0.57735f, -0.57735f, -0.57735f},
+};
+
+TEST(Vertex, OctahedralRoundTrip) {
+	for (const glm::vec3 &direction : directions) {
+		glm::vec2 encoded = octahedralEncode(direction);
+		EXPECT_LE(std::abs(encoded.x), 1.0f);
+		EXPECT_LE(std::abs(encoded.y), 1.0f);
+
+		glm::vec3 decoded = octahedralDecode(encoded);
+		EXPECT_NEAR(glm::dot(decoded, glm::normalize(direction)), 1.0f, 1e-5f);
+	}
+
+	EXPECT_EQ(octahedralEncode(glm::vec3(0.0f)), glm::vec2(0.0f));
+}
+
+TEST(Vertex, PackRoundTrip) {
+	for (const glm::vec3 &normal : directions) {
+		glm::vec3 helper = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 tangent = glm::normalize(glm::cross(helper, normal));
+
+		for (float handedness : {1.0f, -1.0f}) {
+			Vertex vertex;
+			vertex.position = glm::vec3(1.5f, -2.25f, 3.0f);
+			vertex.normal = normal;
+			vertex.tangent = tangent;
+			vertex.bitangent = glm::cross(normal, tangent) * handedness;
+			vertex.uv = glm::vec2(0.25f, 0.75f);
+
+			Vertex unpacked = unpackVertex(packVertex(vertex));
+			EXPECT_EQ(unpacked.position, vertex.position);
+			EXPECT_NEAR(glm::dot(unpacked.normal, vertex.normal), 1.0f, 1e-4f);
+			EXPECT_NEAR(glm::dot(unpacked.tangent, vertex.tangent), 1.0f, 1e-4f);
+			EXPECT_NEAR(glm::dot(unpacked.bitangent, vertex.bitangent), 1.0f, 1e-3f);
+			EXPECT_EQ(unpacked.uv, vertex.uv);
+		}
+	}
+}
+
+TEST(Vertex, Quantize) {
+	Vertex vertex;
+	glm::vec3 origin(-1.0f, -2.0f, -3.0f);
+	float extent = 4.0f;
+
+	vertex.position = origin;
+	EXPECT_EQ(quantizeVertex(vertex, origin, extent).position, glm::u16vec4(0, 0, 0, 0));
+
+	vertex.position = glm::vec3(1.0f, 0.0f, 1.0f);
+	QuantizedVertex quantized = quantizeVertex(vertex, origin, extent);
+	EXPECT_EQ(quantized.position, glm::u16vec4(32768, 32768, 65535, 0));
+
+	glm::vec3 dequantized = origin + glm::vec3(quantized.position) / 65535.0f * extent;
+	EXPECT_NEAR(dequantized.x, vertex.position.x, extent / 65535.0f);
+	EXPECT_NEAR(dequantized.y, vertex.position.y, extent / 65535.0f);
+	EXPECT_NEAR(dequantized.z, vertex.position.z, extent / 65535.0f);
+}
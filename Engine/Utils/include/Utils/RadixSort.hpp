@@ -0,0 +1,62 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace Stone {
+
+/**
+ * @brief Sorts items by an unsigned integer key with a least significant digit radix sort.
+ *
+ * The sort is stable. It runs one counting pass per byte of the key and skips the bytes shared by every key,
+ * so keys only using their low bits are sorted in fewer passes.
+ *
+ * @param items The items to sort.
+ * @param scratch A buffer that can be kept between calls to avoid allocations. Its content is unspecified.
+ * @param key A function returning the key of an item.
+ */
+template <typename T, typename KeyFunction>
+void radixSort(std::vector<T> &items, std::vector<T> &scratch, KeyFunction key) {
+	using Key = std::invoke_result_t<KeyFunction, const T &>;
+	static_assert(std::is_unsigned_v<Key>, "radixSort requires an unsigned integer key");
+
+	constexpr size_t digitCount = sizeof(Key);
+
+	if (items.size() < 2) {
+		return;
+	}
+	scratch.resize(items.size());
+
+	std::array<std::array<size_t, 256>, digitCount> counts = {};
+	for (const T &item : items) {
+		Key itemKey = key(item);
+		for (size_t digit = 0; digit < digitCount; ++digit) {
+			++counts[digit][(itemKey >> (digit * 8)) & 0xff];
+		}
+	}
+
+	for (size_t digit = 0; digit < digitCount; ++digit) {
+		std::array<size_t, 256> &count = counts[digit];
+		if (count[(key(items.front()) >> (digit * 8)) & 0xff] == items.size()) {
+			continue;
+		}
+
+		size_t offset = 0;
+		for (size_t &bucket : count) {
+			size_t bucketSize = bucket;
+			bucket = offset;
+			offset += bucketSize;
+		}
+
+		for (const T &item : items) {
+			scratch[count[(key(item) >> (digit * 8)) & 0xff]++] = item;
+		}
+		items.swap(scratch);
+	}
+}
+
+} // namespace Stone
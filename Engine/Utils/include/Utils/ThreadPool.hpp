@@ -0,0 +1,98 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Stone {
+
+/**
+ * @brief A fixed set of worker threads used to run indexed tasks in parallel, or background tasks in submission order.
+ *
+ * The calling thread takes part in the work, so a pool without worker threads runs every task inline.
+ * The workers run the tasks of a parallelFor before the submitted ones.
+ */
+class ThreadPool {
+public:
+	/**
+	 * @brief Creates the pool and starts its worker threads.
+	 * @param workerCount The number of worker threads, in addition to the calling thread.
+	 */
+	explicit ThreadPool(size_t workerCount = defaultWorkerCount());
+	ThreadPool(const ThreadPool &) = delete;
+
+	virtual ~ThreadPool();
+
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	/**
+	 * @brief Runs task(index) for every index in [0, count) and waits for all of them to complete.
+	 *
+	 * If a task throws, the remaining tasks still run and the first exception is rethrown to the caller.
+	 * Calling parallelFor from inside a task is not supported.
+	 *
+	 * @param count The number of tasks.
+	 * @param task The task to run for each index.
+	 */
+	void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+	/**
+	 * @brief Queues a task to run on a worker thread, without waiting for it.
+	 *
+	 * The tasks start in the order they are submitted. A pool without worker threads runs the task inline.
+	 * An exception thrown by the task is discarded, the task reports its own errors.
+	 * The tasks still queued when the pool is destroyed are run before its workers exit.
+	 *
+	 * @param task The task to run.
+	 */
+	void submit(std::function<void()> task);
+
+	/**
+	 * @brief Waits for every submitted task to complete.
+	 */
+	void waitIdle();
+
+	/**
+	 * @brief Returns the number of threads running tasks, including the calling thread.
+	 */
+	[[nodiscard]] size_t getThreadCount() const {
+		return _workers.size() + 1;
+	}
+
+	/**
+	 * @brief Returns the number of worker threads matching the hardware, leaving one core to the caller.
+	 */
+	static size_t defaultWorkerCount();
+
+private:
+	void _workerLoop();
+	void _runTasks();
+	void _runSubmittedTask(std::unique_lock<std::mutex> &lock);
+
+	std::vector<std::thread> _workers; ///< The worker threads.
+
+	std::mutex _mutex;						///< Guards the job state below.
+	std::condition_variable _jobCondition;	///< Signaled when a job is posted or the pool stops.
+	std::condition_variable _doneCondition; ///< Signaled when the last task of a job completes.
+	std::condition_variable _idleCondition; ///< Signaled when the last submitted task completes.
+
+	const std::function<void(size_t)> *_task = nullptr; ///< The task of the current job.
+	size_t _taskCount = 0;								///< The number of tasks of the current job.
+	std::atomic<size_t> _nextIndex = 0;					///< The next task index to run.
+	size_t _pendingCount = 0;							///< The number of tasks not completed yet.
+	size_t _activeWorkers = 0;							///< The number of workers inside the current job.
+	uint64_t _generation = 0;							///< Incremented for each posted job.
+	std::deque<std::function<void()>> _submittedTasks;	///< The submitted tasks not started yet.
+	size_t _runningSubmittedCount = 0;					///< The number of submitted tasks being run.
+	bool _stopping = false;								///< Flag asking the workers to exit.
+	std::exception_ptr _exception;						///< The first exception thrown by a task.
+};
+
+} // namespace Stone
@@ -0,0 +1,99 @@
+// Copyright 2024 Stone-Engine
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Stone {
+
+/**
+ * @brief Collects timed events and writes them in the Chrome trace event format, read by chrome://tracing and
+ * Perfetto.
+ *
+ * Events are grouped in named tracks, shown as threads in the trace viewers. The recorder keeps the most recent
+ * events up to its capacity, so it can stay enabled during long sessions. Events can be added from any thread.
+ */
+class TraceRecorder {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Event {
+		std::string name;
+		std::string track;
+		double startUs = 0.0;	 ///< Start time in microseconds since the creation of the recorder.
+		double durationUs = 0.0; ///< Duration in microseconds.
+		std::vector<std::pair<std::string, double>> args = {}; ///< Values shown with the event.
+	};
+
+	/**
+	 * @brief Creates an empty recorder, its time origin is the time of creation.
+	 * @param capacity The maximum number of events kept, the oldest ones are dropped first.
+	 */
+	explicit TraceRecorder(size_t capacity = 1 << 20);
+	TraceRecorder(const TraceRecorder &) = delete;
+
+	virtual ~TraceRecorder() = default;
+
+	TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+	/**
+	 * @brief Converts a time point to the time base of the events.
+	 */
+	[[nodiscard]] double toMicroseconds(Clock::time_point time) const;
+
+	/**
+	 * @brief Returns the current time in the time base of the events.
+	 */
+	[[nodiscard]] double now() const;
+
+	void addEvent(Event event);
+
+	[[nodiscard]] std::vector<Event> getEvents() const;
+
+	void clear();
+
+	/**
+	 * @brief Writes the events as a Chrome trace JSON document.
+	 */
+	void writeChromeTrace(std::ostream &stream) const;
+
+	/**
+	 * @brief Writes the events as a Chrome trace JSON file.
+	 * @param filename The path of the file, usually with a .json extension.
+	 */
+	void writeChromeTrace(const std::string &filename) const;
+
+private:
+	Clock::time_point _origin;
+	size_t _capacity;
+
+	mutable std::mutex _mutex;
+	std::deque<Event> _events;
+};
+
+/**
+ * @brief Adds an event covering its lifetime to a recorder. Does nothing when the recorder is null.
+ */
+class ScopedTrace {
+public:
+	ScopedTrace(TraceRecorder *recorder, std::string name, std::string track = "CPU");
+	ScopedTrace(const ScopedTrace &) = delete;
+
+	~ScopedTrace();
+
+	ScopedTrace &operator=(const ScopedTrace &) = delete;
+
+private:
+	TraceRecorder *_recorder;
+	std::string _name;
+	std::string _track;
+	double _startUs = 0.0;
+};
+
+} // namespace Stone
@@ -0,0 +1,158 @@
+// Copyright 2024 Stone-Engine
+
+#include "Utils/ThreadPool.hpp"
+
+#include <cassert>
+
+namespace Stone {
+
+ThreadPool::ThreadPool(size_t workerCount) {
+	_workers.reserve(workerCount);
+	for (size_t i = 0; i < workerCount; ++i) {
+		_workers.emplace_back([this] { _workerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_jobCondition.notify_all();
+	for (std::thread &worker : _workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &task) {
+	if (count == 0) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		assert(_task == nullptr);
+		_task = &task;
+		_taskCount = count;
+		_nextIndex = 0;
+		_pendingCount = count;
+		_exception = nullptr;
+		++_generation;
+	}
+	_jobCondition.notify_all();
+
+	_runTasks();
+
+	std::exception_ptr exception;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_doneCondition.wait(lock, [this] { return _pendingCount == 0 && _activeWorkers == 0; });
+		_task = nullptr;
+		_taskCount = 0;
+		exception = std::move(_exception);
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	if (_workers.empty()) {
+		try {
+			task();
+		} catch (...) {
+		}
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_submittedTasks.push_back(std::move(task));
+	}
+	_jobCondition.notify_one();
+}
+
+void ThreadPool::waitIdle() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idleCondition.wait(lock, [this] { return _submittedTasks.empty() && _runningSubmittedCount == 0; });
+}
+
+size_t ThreadPool::defaultWorkerCount() {
+	size_t hardwareCount = std::thread::hardware_concurrency();
+	return hardwareCount > 1 ? hardwareCount - 1 : 0;
+}
+
+void ThreadPool::_workerLoop() {
+	uint64_t seenGeneration = 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		_jobCondition.wait(lock, [&] {
+			return _stopping || !_submittedTasks.empty() || (_task != nullptr && _generation != seenGeneration);
+		});
+		if (_task == nullptr || _generation == seenGeneration) {
+			// The submitted tasks are drained before exiting.
+			if (_submittedTasks.empty()) {
+				return;
+			}
+			_runSubmittedTask(lock);
+			continue;
+		}
+		seenGeneration = _generation;
+		++_activeWorkers;
+		lock.unlock();
+
+		_runTasks();
+
+		lock.lock();
+		--_activeWorkers;
+		if (_pendingCount == 0 && _activeWorkers == 0) {
+			_doneCondition.notify_all();
+		}
+	}
+}
+
+void ThreadPool::_runSubmittedTask(std::unique_lock<std::mutex> &lock) {
+	std::function<void()> task = std::move(_submittedTasks.front());
+	_submittedTasks.pop_front();
+	++_runningSubmittedCount;
+	lock.unlock();
+
+	try {
+		task();
+	} catch (...) {
+	}
+	task = nullptr;
+
+	lock.lock();
+	--_runningSubmittedCount;
+	if (_submittedTasks.empty() && _runningSubmittedCount == 0) {
+		_idleCondition.notify_all();
+	}
+}
+
+void ThreadPool::_runTasks() {
+	size_t completed = 0;
+	size_t index;
+	while ((index = _nextIndex.fetch_add(1)) < _taskCount) {
+		try {
+			(*_task)(index);
+		} catch (...) {
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (!_exception) {
+				_exception = std::current_exception();
+			}
+		}
+		++completed;
+	}
+
+	if (completed > 0) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_pendingCount -= completed;
+		if (_pendingCount == 0 && _activeWorkers == 0) {
+			_doneCondition.notify_all();
+		}
+	}
+}
+
+} // namespace Stone
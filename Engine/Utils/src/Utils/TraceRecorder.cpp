@@ -0,0 +1,109 @@
+// Copyright 2024 Stone-Engine
+
+#include "Utils/TraceRecorder.hpp"
+
+#include "Utils/StringExt.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Stone {
+
+TraceRecorder::TraceRecorder(size_t capacity) : _origin(Clock::now()), _capacity(capacity) {
+}
+
+double TraceRecorder::toMicroseconds(Clock::time_point time) const {
+	return std::chrono::duration<double, std::micro>(time - _origin).count();
+}
+
+double TraceRecorder::now() const {
+	return toMicroseconds(Clock::now());
+}
+
+void TraceRecorder::addEvent(Event event) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_capacity == 0) {
+		return;
+	}
+	if (_events.size() == _capacity) {
+		_events.pop_front();
+	}
+	_events.push_back(std::move(event));
+}
+
+std::vector<TraceRecorder::Event> TraceRecorder::getEvents() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return {_events.begin(), _events.end()};
+}
+
+void TraceRecorder::clear() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_events.clear();
+}
+
+void TraceRecorder::writeChromeTrace(std::ostream &stream) const {
+	std::vector<Event> events = getEvents();
+
+	// Each track is shown as a thread of a single process, in order of appearance.
+	std::unordered_map<std::string, size_t> trackIds;
+	std::vector<const std::string *> tracks;
+	for (const Event &event : events) {
+		if (trackIds.emplace(event.track, tracks.size()).second) {
+			tracks.push_back(&event.track);
+		}
+	}
+
+	std::ios_base::fmtflags flags = stream.flags();
+	stream << std::fixed << std::setprecision(3);
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (size_t i = 0; i < tracks.size(); ++i) {
+		stream << (first ? "" : ",") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+			   << ",\"args\":{\"name\":\"" << escape_string(*tracks[i]) << "\"}}";
+		first = false;
+	}
+	for (const Event &event : events) {
+		stream << (first ? "" : ",") << "{\"name\":\"" << escape_string(event.name) << "\",\"cat\":\""
+			   << escape_string(event.track) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << trackIds[event.track]
+			   << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs;
+		if (!event.args.empty()) {
+			stream << ",\"args\":{";
+			for (size_t i = 0; i < event.args.size(); ++i) {
+				stream << (i == 0 ? "" : ",") << "\"" << escape_string(event.args[i].first)
+					   << "\":" << event.args[i].second;
+			}
+			stream << "}";
+		}
+		stream << "}";
+		first = false;
+	}
+	stream << "]}";
+	stream.flags(flags);
+}
+
+void TraceRecorder::writeChromeTrace(const std::string &filename) const {
+	std::ofstream file(filename);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	writeChromeTrace(file);
+}
+
+ScopedTrace::ScopedTrace(TraceRecorder *recorder, std::string name, std::string track)
+	: _recorder(recorder), _name(std::move(name)), _track(std::move(track)) {
+	if (_recorder) {
+		_startUs = _recorder->now();
+	}
+}
+
+ScopedTrace::~ScopedTrace() {
+	if (_recorder) {
+		_recorder->addEvent({std::move(_name), std::move(_track), _startUs, _recorder->now() - _startUs});
+	}
+}
+
+} // namespace Stone
@@ -0,0 +1,52 @@
+#include "Utils/RadixSort.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace Stone;
+
+TEST(RadixSortTest, SortsRandomKeys) {
+	std::mt19937_64 generator(42);
+	std::vector<uint64_t> keys(5000);
+	for (uint64_t &key : keys) {
+		key = generator();
+	}
+
+	std::vector<uint64_t> expected = keys;
+	std::sort(expected.begin(), expected.end());
+
+	std::vector<uint64_t> scratch;
+	radixSort(keys, scratch, [](uint64_t key) { return key; });
+
+	EXPECT_EQ(keys, expected);
+}
+
+TEST(RadixSortTest, IsStable) {
+	struct Item {
+		uint32_t key;
+		int order;
+	};
+
+	std::vector<Item> items = {{3, 0}, {1, 1}, {3, 2}, {0x300, 3}, {1, 4}, {3, 5}};
+	std::vector<Item> scratch;
+	radixSort(items, scratch, [](const Item &item) { return item.key; });
+
+	std::vector<int> orders;
+	for (const Item &item : items) {
+		orders.push_back(item.order);
+	}
+	EXPECT_EQ(orders, (std::vector<int>{1, 4, 0, 2, 5, 3}));
+}
+
+TEST(RadixSortTest, HandlesSmallInputs) {
+	std::vector<uint16_t> empty;
+	std::vector<uint16_t> single = {7};
+	std::vector<uint16_t> scratch;
+
+	radixSort(empty, scratch, [](uint16_t key) { return key; });
+	radixSort(single, scratch, [](uint16_t key) { return key; });
+
+	EXPECT_TRUE(empty.empty());
+	EXPECT_EQ(single, std::vector<uint16_t>{7});
+}
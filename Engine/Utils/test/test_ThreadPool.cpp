@@ -0,0 +1,106 @@
+#include "Utils/ThreadPool.hpp"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+using namespace Stone;
+
+TEST(ThreadPoolTest, RunsEveryIndexOnce) {
+	ThreadPool pool(3);
+
+	std::vector<std::atomic<int>> counts(1000);
+
+	pool.parallelFor(counts.size(), [&counts](size_t index) { ++counts[index]; });
+
+	for (const auto &count : counts) {
+		EXPECT_EQ(count.load(), 1);
+	}
+}
+
+TEST(ThreadPoolTest, ReusedForSeveralJobs) {
+	ThreadPool pool(2);
+
+	std::atomic<int> total{0};
+	for (int job = 0; job < 50; ++job) {
+		pool.parallelFor(10, [&total](size_t index) { total += static_cast<int>(index); });
+	}
+
+	EXPECT_EQ(total.load(), 50 * 45);
+}
+
+TEST(ThreadPoolTest, WithoutWorkers) {
+	ThreadPool pool(0);
+	EXPECT_EQ(pool.getThreadCount(), 1);
+
+	std::thread::id callerId = std::this_thread::get_id();
+	int count = 0;
+	pool.parallelFor(5, [&](size_t) {
+		EXPECT_EQ(std::this_thread::get_id(), callerId);
+		++count;
+	});
+
+	EXPECT_EQ(count, 5);
+}
+
+TEST(ThreadPoolTest, RethrowsTaskException) {
+	ThreadPool pool(2);
+
+	std::atomic<int> count{0};
+	EXPECT_THROW(pool.parallelFor(20,
+								  [&count](size_t index) {
+									  ++count;
+									  if (index == 7) {
+										  throw std::runtime_error("task failed");
+									  }
+								  }),
+				 std::runtime_error);
+
+	EXPECT_EQ(count.load(), 20);
+
+	// The pool is still usable after a failed job
+	count = 0;
+	pool.parallelFor(4, [&count](size_t) { ++count; });
+	EXPECT_EQ(count.load(), 4);
+}
+
+TEST(ThreadPoolTest, SubmitRunsTasksInOrder) {
+	ThreadPool pool(1);
+
+	std::vector<int> order;
+	for (int task = 0; task < 10; ++task) {
+		pool.submit([&order, task]() { order.push_back(task); });
+	}
+	pool.waitIdle();
+
+	ASSERT_EQ(order.size(), 10);
+	for (int task = 0; task < 10; ++task) {
+		EXPECT_EQ(order[task], task);
+	}
+}
+
+TEST(ThreadPoolTest, SubmitDuringParallelFor) {
+	ThreadPool pool(2);
+
+	std::atomic<int> submitted{0};
+	std::atomic<int> indexed{0};
+	for (int task = 0; task < 20; ++task) {
+		pool.submit([&submitted]() { ++submitted; });
+	}
+	pool.parallelFor(100, [&indexed](size_t) { ++indexed; });
+	pool.waitIdle();
+
+	EXPECT_EQ(submitted.load(), 20);
+	EXPECT_EQ(indexed.load(), 100);
+}
+
+TEST(ThreadPoolTest, DestructionRunsQueuedTasks) {
+	std::atomic<int> count{0};
+	{
+		ThreadPool pool(1);
+		for (int task = 0; task < 5; ++task) {
+			pool.submit([&count]() { ++count; });
+		}
+	}
+
+	EXPECT_EQ(count.load(), 5);
+}
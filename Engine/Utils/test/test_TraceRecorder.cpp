@@ -0,0 +1,64 @@
+#include "Utils/Json.hpp"
+#include "Utils/TraceRecorder.hpp"
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+
+using namespace Stone;
+
+TEST(TraceRecorder, ScopedTraceRecordsDuration) {
+	TraceRecorder recorder;
+	{
+		ScopedTrace trace(&recorder, "work");
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	std::vector<TraceRecorder::Event> events = recorder.getEvents();
+	ASSERT_EQ(events.size(), 1u);
+	EXPECT_EQ(events[0].name, "work");
+	EXPECT_EQ(events[0].track, "CPU");
+	EXPECT_GE(events[0].durationUs, 2000.0);
+	EXPECT_GE(events[0].startUs, 0.0);
+}
+
+TEST(TraceRecorder, NullRecorderIsIgnored) {
+	EXPECT_NO_THROW({ ScopedTrace trace(nullptr, "nothing"); });
+}
+
+TEST(TraceRecorder, DropsOldestEvents) {
+	TraceRecorder recorder(2);
+	recorder.addEvent({"a", "CPU", 0.0, 1.0});
+	recorder.addEvent({"b", "CPU", 1.0, 1.0});
+	recorder.addEvent({"c", "GPU", 2.0, 1.0});
+
+	std::vector<TraceRecorder::Event> events = recorder.getEvents();
+	ASSERT_EQ(events.size(), 2u);
+	EXPECT_EQ(events[0].name, "b");
+	EXPECT_EQ(events[1].name, "c");
+}
+
+TEST(TraceRecorder, WritesChromeTrace) {
+	TraceRecorder recorder;
+	recorder.addEvent({"frame \"1\"", "CPU", 10.5, 100.0});
+	recorder.addEvent({"main pass", "GPU", 20.0, 50.25, {{"fragments", 1024.0}}});
+
+	std::stringstream stream;
+	recorder.writeChromeTrace(stream);
+
+	auto json = Json::Value::parseString(stream.str());
+	ASSERT_TRUE(json->is<Json::Object>());
+	const Json::Array &traceEvents = json->get<Json::Object>().at("traceEvents")->get<Json::Array>();
+	// One metadata event naming each track, then the events.
+	ASSERT_EQ(traceEvents.size(), 4u);
+
+	const Json::Object &frame = traceEvents[2]->get<Json::Object>();
+	EXPECT_EQ(frame.at("name")->get<std::string>(), "frame \"1\"");
+	EXPECT_EQ(frame.at("ph")->get<std::string>(), "X");
+	EXPECT_DOUBLE_EQ(frame.at("ts")->get<double>(), 10.5);
+	EXPECT_DOUBLE_EQ(frame.at("dur")->get<double>(), 100.0);
+
+	const Json::Object &pass = traceEvents[3]->get<Json::Object>();
+	EXPECT_NE(pass.at("tid")->get<double>(), frame.at("tid")->get<double>());
+	EXPECT_DOUBLE_EQ(pass.at("args")->get<Json::Object>().at("fragments")->get<double>(), 1024.0);
+}
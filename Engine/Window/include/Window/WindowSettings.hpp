@@ -15,6 +15,10 @@ struct WindowSettings {
 	bool fullScreen = false;
 	bool resizable = true;
 	std::weak_ptr<class Window> shareContext;
+	std::string shaderCacheDirectory = {};
+	std::string shaderVariantManifest = {};
+	std::string pipelineManifest = {};
+	std::string pipelineCacheFile = {};
 };
 
 } // namespace Stone::Window
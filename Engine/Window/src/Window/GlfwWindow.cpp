@@ -41,6 +41,10 @@ GlfwWindow::GlfwWindow(const std::shared_ptr<App> &app, const WindowSettings &se
 	if (!_renderer) {
 		Render::Vulkan::RendererSettings rendererSettings;
 		rendererSettings.app_name = settings.title;
+		rendererSettings.shaderCacheDirectory = settings.shaderCacheDirectory;
+		rendererSettings.shaderVariantManifest = settings.shaderVariantManifest;
+		rendererSettings.pipelineManifest = settings.pipelineManifest;
+		rendererSettings.pipelineCacheFile = settings.pipelineCacheFile;
 
 		uint32_t glfwExtensionCount = 0;
 		const char **glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
@@ -2,3 +2,12 @@
 
 glslc -fshader-stage=vertex -c shaders/vert.glsl -o shaders/vert.spv
 glslc -fshader-stage=fragment -c shaders/frag.glsl -o shaders/frag.spv
+glslc -fshader-stage=vertex -c shaders/vert-indirect.glsl -o shaders/vert-indirect.spv
+glslc -fshader-stage=vertex -c shaders/vert-packed.glsl -o shaders/vert-packed.spv
+glslc -fshader-stage=vertex -c shaders/vert-indirect-packed.glsl -o shaders/vert-indirect-packed.spv
+glslc -fshader-stage=vertex -c shaders/vert-depth.glsl -o shaders/vert-depth.spv
+glslc -fshader-stage=vertex -c shaders/vert-indirect-depth.glsl -o shaders/vert-indirect-depth.spv
+glslc -fshader-stage=compute -c shaders/cull.glsl -o shaders/cull.spv
+glslc -fshader-stage=compute -c shaders/skin.glsl -o shaders/skin.spv
+glslc -fshader-stage=compute -c shaders/cluster-lights.glsl -o shaders/cluster-lights.spv
+glslc -fshader-stage=vertex -c shaders/vert-shadow.glsl -o shaders/vert-shadow.spv
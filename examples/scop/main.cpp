@@ -48,6 +48,10 @@ int main(int argc, char **argv) {
 		// Create a Window
 		Stone::Window::WindowSettings win_settings;
 		win_settings.title = "Scop";
+		win_settings.shaderCacheDirectory = "shader_cache";
+		win_settings.shaderVariantManifest = "shader_variants.txt";
+		win_settings.pipelineManifest = "pipelines.txt";
+		win_settings.pipelineCacheFile = "pipeline_cache.bin";
 		auto window = app->createWindow(win_settings);
 
 		// Create the assets bundle
@@ -0,0 +1,95 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+// Must match the cluster grid of LightClusters.cpp.
+const uvec3 clusterGrid = uvec3(16, 9, 24);
+const uint clusterCount = clusterGrid.x * clusterGrid.y * clusterGrid.z;
+const uint maxLightsPerCluster = 128;
+
+struct Light {
+    vec4 boundingSphere;
+    vec4 position;
+    vec4 direction;
+    vec4 color;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, set = 0, binding = 1) writeonly buffer Clusters {
+    uint lightCounts[clusterCount];
+    uint lightIndices[];
+};
+
+layout(push_constant) uniform Clustering {
+    mat4 inverseProjection;
+    float zNear;
+    float zFar;
+    uint lightCount;
+} clustering;
+
+shared vec4 sharedSpheres[gl_WorkGroupSize.x];
+
+// The view point on the line through a point of the near plane and a point of the far plane, at the view depth.
+vec3 pointAtDepth(vec2 ndc, float depth) {
+    vec4 nearPoint = clustering.inverseProjection * vec4(ndc, 0.0, 1.0);
+    vec4 farPoint = clustering.inverseProjection * vec4(ndc, 1.0, 1.0);
+    vec3 a = nearPoint.xyz / nearPoint.w;
+    vec3 b = farPoint.xyz / farPoint.w;
+    float t = (-depth - a.z) / (b.z - a.z);
+    return mix(a, b, t);
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    bool active = index < clusterCount;
+
+    // The bounds of the cluster in view space, spanning the corners of its tile at both ends of its slice.
+    uvec3 cluster = uvec3(index % clusterGrid.x, (index / clusterGrid.x) % clusterGrid.y,
+                          index / (clusterGrid.x * clusterGrid.y));
+    vec2 tileMin = vec2(cluster.xy) / vec2(clusterGrid.xy) * 2.0 - 1.0;
+    vec2 tileMax = vec2(cluster.xy + 1) / vec2(clusterGrid.xy) * 2.0 - 1.0;
+    float ratio = clustering.zFar / clustering.zNear;
+    float sliceNear = clustering.zNear * pow(ratio, float(cluster.z) / float(clusterGrid.z));
+    float sliceFar = clustering.zNear * pow(ratio, float(cluster.z + 1) / float(clusterGrid.z));
+
+    vec3 boundsMin = vec3(3.4e38);
+    vec3 boundsMax = vec3(-3.4e38);
+    for (int corner = 0; corner < 4; ++corner) {
+        vec2 ndc = vec2((corner & 1) == 0 ? tileMin.x : tileMax.x, (corner & 2) == 0 ? tileMin.y : tileMax.y);
+        vec3 nearCorner = pointAtDepth(ndc, sliceNear);
+        vec3 farCorner = pointAtDepth(ndc, sliceFar);
+        boundsMin = min(boundsMin, min(nearCorner, farCorner));
+        boundsMax = max(boundsMax, max(nearCorner, farCorner));
+    }
+
+    // The spheres are loaded by batches shared by the group, every invocation takes part in the barriers.
+    uint count = 0;
+    for (uint batch = 0; batch < clustering.lightCount; batch += gl_WorkGroupSize.x) {
+        uint lightIndex = batch + gl_LocalInvocationID.x;
+        if (lightIndex < clustering.lightCount) {
+            sharedSpheres[gl_LocalInvocationID.x] = lights[lightIndex].boundingSphere;
+        }
+        barrier();
+
+        uint batchSize = min(gl_WorkGroupSize.x, clustering.lightCount - batch);
+        for (uint i = 0; active && i < batchSize; ++i) {
+            vec4 sphere = sharedSpheres[i];
+            vec3 closest = clamp(sphere.xyz, boundsMin, boundsMax);
+            vec3 offset = closest - sphere.xyz;
+            if (dot(offset, offset) <= sphere.w * sphere.w && count < maxLightsPerCluster) {
+                lightIndices[index * maxLightsPerCluster + count] = batch + i;
+                ++count;
+            }
+        }
+        barrier();
+    }
+
+    if (active) {
+        lightCounts[index] = count;
+    }
+}
@@ -0,0 +1,75 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct Object {
+    mat4 model;
+};
+
+// A meshlet of an object, or the whole object when its mesh has none.
+struct Cluster {
+    vec4 boundingSphere;
+    vec4 normalCone;
+    uint firstIndex;
+    uint indexCount;
+    uint objectIndex;
+};
+
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Objects {
+    Object objects[];
+};
+
+layout(std430, set = 0, binding = 1) writeonly buffer DrawCommands {
+    DrawCommand commands[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Clusters {
+    Cluster clusters[];
+};
+
+layout(push_constant) uniform Culling {
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+    uint clusterCount;
+} culling;
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= culling.clusterCount) {
+        return;
+    }
+
+    Cluster cluster = clusters[index];
+    mat4 model = objects[cluster.objectIndex].model;
+    vec3 center = (model * vec4(cluster.boundingSphere.xyz, 1.0)).xyz;
+    vec3 scales = vec3(length(model[0].xyz), length(model[1].xyz), length(model[2].xyz));
+    float scale = max(max(scales.x, scales.y), scales.z);
+    float radius = cluster.boundingSphere.w * scale;
+
+    bool visible = true;
+    for (int i = 0; i < 6; ++i) {
+        visible = visible && dot(culling.frustumPlanes[i].xyz, center) + culling.frustumPlanes[i].w >= -radius;
+    }
+
+    // A non uniform scale bends the normals away from the cone, the cluster is then only frustum culled.
+    bool uniformScale = scale - min(min(scales.x, scales.y), scales.z) <= 1e-3 * scale;
+    if (visible && uniformScale) {
+        vec3 axis = mat3(model) * cluster.normalCone.xyz / scale;
+        vec3 offset = center - culling.cameraPosition.xyz;
+        visible = dot(offset, axis) < cluster.normalCone.w * length(offset) + radius;
+    }
+
+    commands[index].indexCount = cluster.indexCount;
+    commands[index].instanceCount = visible ? 1u : 0u;
+    commands[index].firstIndex = cluster.firstIndex;
+    commands[index].vertexOffset = 0;
+    commands[index].firstInstance = cluster.objectIndex;
+}
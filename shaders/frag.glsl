@@ -1,11 +1,172 @@
 #version 450
 
-layout(binding = 1) uniform sampler2D diffuse;
+// Must match the cluster grid of LightClusters.cpp.
+const uvec3 clusterGrid = uvec3(16, 9, 24);
+const uint clusterCount = clusterGrid.x * clusterGrid.y * clusterGrid.z;
+const uint maxLightsPerCluster = 128;
+
+// Must match maxDirectionalLights of FrameUniformBuffer.hpp and shadowCascadeCount of ShadowMaps.hpp.
+const uint maxDirectionalLights = 4;
+const uint cascadeCount = 4;
+
+const float shininess = 32.0;
+
+// Direction in view space with the first shadow tile in w, color with 1 in w when the tiles are cascades.
+struct DirectionalLight {
+    vec4 direction;
+    vec4 color;
+    vec4 cascadeSplits;
+};
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 proj;
+    vec4 ambientLight;
+    vec4 clusterScale;
+    DirectionalLight directionalLights[maxDirectionalLights];
+    uint directionalLightCount;
+} frame;
+
+// Positions and directions in view space, a point light has cone cosines of -1 and -2, the shadow tile in the w of
+// the attenuation.
+struct Light {
+    vec4 boundingSphere;
+    vec4 position;
+    vec4 direction;
+    vec4 color;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Clusters {
+    uint lightCounts[clusterCount];
+    uint lightIndices[];
+};
+
+// From the view space to the clip space of the light, the rect is empty when the atlas had no room for the tile.
+struct ShadowTile {
+    mat4 matrix;
+    vec4 rect;
+};
+
+layout(set = 0, binding = 3) uniform sampler2DShadow shadowAtlas;
+
+layout(std430, set = 0, binding = 4) readonly buffer ShadowTiles {
+    ShadowTile shadowTiles[];
+};
+
+layout(set = 1, binding = 1) uniform sampler2D diffuse;
 
 layout(location = 0) in vec2 fragUV;
+layout(location = 1) in vec3 fragViewPosition;
+layout(location = 2) in vec3 fragViewNormal;
 
 layout(location = 0) out vec4 outColor;
 
+// The fraction of the light reaching the fragment from a shadow tile, 1 without tile or outside of it.
+float shadowFactor(int tileIndex) {
+    if (tileIndex < 0) {
+        return 1.0;
+    }
+    ShadowTile tile = shadowTiles[tileIndex];
+    vec4 clip = tile.matrix * vec4(fragViewPosition, 1.0);
+    vec3 ndc = clip.xyz / clip.w;
+    if (tile.rect.z == 0.0 || clip.w <= 0.0 || any(greaterThan(abs(ndc.xy), vec2(1.0))) || ndc.z > 1.0) {
+        return 1.0;
+    }
+
+    // Four comparisons filtered by the sampler, kept inside the tile so that the taps never read its neighbours.
+    vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 uv = tile.rect.xy + (ndc.xy * 0.5 + 0.5) * tile.rect.zw;
+    vec2 low = tile.rect.xy + texel;
+    vec2 high = tile.rect.xy + tile.rect.zw - texel;
+    float lit = 0.0;
+    lit += texture(shadowAtlas, vec3(clamp(uv + vec2(-0.5, -0.5) * texel, low, high), ndc.z));
+    lit += texture(shadowAtlas, vec3(clamp(uv + vec2(0.5, -0.5) * texel, low, high), ndc.z));
+    lit += texture(shadowAtlas, vec3(clamp(uv + vec2(-0.5, 0.5) * texel, low, high), ndc.z));
+    lit += texture(shadowAtlas, vec3(clamp(uv + vec2(0.5, 0.5) * texel, low, high), ndc.z));
+    return lit * 0.25;
+}
+
 void main() {
-    outColor = texture(diffuse, fragUV);
+    vec4 albedo = texture(diffuse, fragUV);
+
+    // A frame without any light is drawn unlit.
+    if (frame.ambientLight.w == 0.0) {
+        outColor = albedo;
+        return;
+    }
+
+    float depth = max(-fragViewPosition.z, 1e-6);
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / frame.clusterScale.xy), clusterGrid.xy - 1);
+    uint slice = uint(clamp(log(depth) * frame.clusterScale.z - frame.clusterScale.w, 0.0,
+                            float(clusterGrid.z - 1)));
+    uint cluster = tile.x + clusterGrid.x * (tile.y + clusterGrid.y * slice);
+
+    vec3 normal = normalize(fragViewNormal);
+    vec3 toEye = normalize(-fragViewPosition);
+    if (!gl_FrontFacing) {
+        normal = -normal;
+    }
+
+    vec3 diffuseLight = frame.ambientLight.rgb;
+    vec3 specularLight = vec3(0.0);
+    uint lightCount = min(lightCounts[cluster], maxLightsPerCluster);
+    for (uint i = 0; i < lightCount; ++i) {
+        Light light = lights[lightIndices[cluster * maxLightsPerCluster + i]];
+
+        vec3 toLight = light.position.xyz - fragViewPosition;
+        float distance = length(toLight);
+        toLight /= max(distance, 1e-6);
+
+        // The attenuation is windowed to reach zero at the range, where the light leaves the clusters.
+        float falloff = 1.0 / max(dot(light.attenuation.xyz, vec3(1.0, distance, distance * distance)), 1e-6);
+        float window = clamp(1.0 - pow(distance / light.position.w, 4.0), 0.0, 1.0);
+        float cosOuter = light.direction.w;
+        float cosInner = light.color.w;
+        float cone = clamp((dot(-toLight, light.direction.xyz) - cosOuter) / max(cosInner - cosOuter, 1e-4), 0.0, 1.0);
+        float intensity = falloff * window * window * cone;
+        if (intensity > 0.0) {
+            intensity *= shadowFactor(int(light.attenuation.w));
+        }
+
+        float lambert = max(dot(normal, toLight), 0.0);
+        diffuseLight += light.color.rgb * (lambert * intensity);
+        if (lambert > 0.0) {
+            vec3 halfway = normalize(toLight + toEye);
+            specularLight += light.specular.rgb * (pow(max(dot(normal, halfway), 0.0), shininess) * intensity);
+        }
+    }
+
+    uint directionalLightCount = min(frame.directionalLightCount, maxDirectionalLights);
+    for (uint i = 0; i < directionalLightCount; ++i) {
+        DirectionalLight light = frame.directionalLights[i];
+        vec3 toLight = -light.direction.xyz;
+        float lambert = max(dot(normal, toLight), 0.0);
+        if (lambert == 0.0) {
+            continue;
+        }
+
+        // The cascade is the first one ending beyond the fragment, the fragments past the last one are unshadowed.
+        float shadow = 1.0;
+        int tileIndex = int(light.direction.w);
+        if (tileIndex >= 0 && light.color.w == 0.0) {
+            shadow = shadowFactor(tileIndex);
+        } else if (tileIndex >= 0) {
+            uint cascade = uint(dot(vec4(greaterThan(vec4(depth), light.cascadeSplits)), vec4(1.0)));
+            if (cascade < cascadeCount) {
+                shadow = shadowFactor(tileIndex + int(cascade));
+            }
+        }
+
+        vec3 halfway = normalize(toLight + toEye);
+        diffuseLight += light.color.rgb * (lambert * shadow);
+        specularLight += light.color.rgb * (pow(max(dot(normal, halfway), 0.0), shininess) * shadow);
+    }
+
+    outColor = vec4(albedo.rgb * diffuseLight + specularLight, albedo.a);
 }
@@ -0,0 +1,71 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+// Scene::WeightVertex and Scene::Vertex are tightly packed, they are addressed as arrays of floats.
+// The posed vertices are split in streams, the positions of every vertex followed by their other attributes.
+const uint sourceStride = 22;
+const uint positionStride = 3;
+const uint attributeStride = 11;
+
+layout(std430, set = 0, binding = 0) readonly buffer Palette {
+    mat4 bones[];
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer SourceVertices {
+    float source[];
+};
+
+layout(std430, set = 1, binding = 1) writeonly buffer PosedVertices {
+    float posed[];
+};
+
+layout(push_constant) uniform Skinning {
+    uint vertexCount;
+    uint boneOffset;
+    uint boneCount;
+} skinning;
+
+vec3 readVec3(uint offset) {
+    return vec3(source[offset], source[offset + 1], source[offset + 2]);
+}
+
+void writeVec3(uint offset, vec3 value) {
+    posed[offset] = value.x;
+    posed[offset + 1] = value.y;
+    posed[offset + 2] = value.z;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= skinning.vertexCount) {
+        return;
+    }
+
+    uint src = index * sourceStride;
+    uint position = index * positionStride;
+    uint dst = skinning.vertexCount * positionStride + index * attributeStride;
+
+    vec4 weights = vec4(source[src + 14], source[src + 15], source[src + 16], source[src + 17]);
+    ivec4 ids = ivec4(floatBitsToInt(source[src + 18]), floatBitsToInt(source[src + 19]),
+                      floatBitsToInt(source[src + 20]), floatBitsToInt(source[src + 21]));
+
+    // The weight missing from the valid influences keeps the bind pose, unweighted vertices do not move.
+    mat4 skin = mat4(0.0);
+    float total = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        if (weights[i] > 0.0 && ids[i] >= 0 && uint(ids[i]) < skinning.boneCount) {
+            skin += weights[i] * bones[skinning.boneOffset + uint(ids[i])];
+            total += weights[i];
+        }
+    }
+    skin += max(1.0 - total, 0.0) * mat4(1.0);
+
+    mat3 direction = mat3(skin);
+    writeVec3(position, (skin * vec4(readVec3(src), 1.0)).xyz);
+    writeVec3(dst, normalize(direction * readVec3(src + 3)));
+    writeVec3(dst + 3, normalize(direction * readVec3(src + 6)));
+    writeVec3(dst + 6, normalize(direction * readVec3(src + 9)));
+    posed[dst + 9] = source[src + 12];
+    posed[dst + 10] = source[src + 13];
+}
@@ -0,0 +1,20 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 proj;
+} frame;
+
+layout(push_constant) uniform ObjectPushConstants {
+    mat4 model;
+} object;
+
+// Only the position stream is bound, quantized positions are normalized by the vertex input like the others.
+layout(location = 0) in vec3 position;
+
+// Must match the positions of the shading pipelines, drawn over this depth with LESS_OR_EQUAL.
+invariant gl_Position;
+
+void main() {
+    gl_Position = frame.proj * frame.view * object.model * vec4(position, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 proj;
+} frame;
+
+struct Object {
+    mat4 model;
+};
+
+// Indexed by the instance index, set to the object index by the culling pass.
+layout(std430, set = 2, binding = 0) readonly buffer Objects {
+    Object objects[];
+};
+
+// Only the position stream is bound, quantized positions are normalized by the vertex input like the others.
+layout(location = 0) in vec3 position;
+
+// Must match the positions of the shading pipelines, drawn over this depth with LESS_OR_EQUAL.
+invariant gl_Position;
+
+void main() {
+    gl_Position = frame.proj * frame.view * objects[gl_InstanceIndex].model * vec4(position, 1.0);
+}
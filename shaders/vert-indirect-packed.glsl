@@ -0,0 +1,51 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 proj;
+} frame;
+
+struct Object {
+    mat4 model;
+};
+
+// Indexed by the instance index, set to the object index by the culling pass.
+layout(std430, set = 2, binding = 0) readonly buffer Objects {
+    Object objects[];
+};
+
+// Packed and Quantized vertices, the quantized positions are normalized by the vertex input and dequantized by the
+// model matrix. The normal frame is octahedral encoded, the lowest bit of the tangent holds the bitangent sign.
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 normal;
+layout(location = 2) in ivec2 tangent;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec2 fragUV;
+layout(location = 1) out vec3 fragViewPosition;
+layout(location = 2) out vec3 fragViewNormal;
+
+// Matches the depth laid by the depth pipelines, tested with LESS_OR_EQUAL.
+invariant gl_Position;
+
+// The cofactor matrix transforms the normals like the inverse transpose, up to a scale undone in the fragment shader.
+mat3 normalMatrix(mat4 viewModel) {
+    mat3 m = mat3(viewModel);
+    return mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+}
+
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-direction.z, 0.0);
+    direction.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(direction.xy, vec2(0.0)));
+    return normalize(direction);
+}
+
+void main() {
+    gl_Position = frame.proj * frame.view * objects[gl_InstanceIndex].model * vec4(position, 1.0);
+    fragUV = uv;
+
+    mat4 viewModel = frame.view * objects[gl_InstanceIndex].model;
+    fragViewPosition = (viewModel * vec4(position, 1.0)).xyz;
+    fragViewNormal = normalMatrix(viewModel) * octahedralDecode(normal);
+}
@@ -0,0 +1,43 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 proj;
+} frame;
+
+struct Object {
+    mat4 model;
+};
+
+// Indexed by the instance index, set to the object index by the culling pass.
+layout(std430, set = 2, binding = 0) readonly buffer Objects {
+    Object objects[];
+};
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec3 tangent;
+layout(location = 3) in vec3 bitangent;
+layout(location = 4) in vec2 uv;
+
+layout(location = 0) out vec2 fragUV;
+layout(location = 1) out vec3 fragViewPosition;
+layout(location = 2) out vec3 fragViewNormal;
+
+// Matches the depth laid by the depth pipelines, tested with LESS_OR_EQUAL.
+invariant gl_Position;
+
+// The cofactor matrix transforms the normals like the inverse transpose, up to a scale undone in the fragment shader.
+mat3 normalMatrix(mat4 viewModel) {
+    mat3 m = mat3(viewModel);
+    return mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+}
+
+void main() {
+    gl_Position = frame.proj * frame.view * objects[gl_InstanceIndex].model * vec4(position, 1.0);
+    fragUV = uv;
+
+    mat4 viewModel = frame.view * objects[gl_InstanceIndex].model;
+    fragViewPosition = (viewModel * vec4(position, 1.0)).xyz;
+    fragViewNormal = normalMatrix(viewModel) * normal;
+}
@@ -0,0 +1,12 @@
+#version 450
+
+layout(push_constant) uniform ShadowPushConstants {
+    mat4 transform;
+} object;
+
+// Only the position stream is bound, the transform includes the dequantization of quantized positions.
+layout(location = 0) in vec3 position;
+
+void main() {
+    gl_Position = object.transform * vec4(position, 1.0);
+}
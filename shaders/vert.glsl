@@ -1,10 +1,13 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(set = 0, binding = 0) uniform FrameUniforms {
     mat4 view;
     mat4 proj;
-} ubo;
+} frame;
+
+layout(push_constant) uniform ObjectPushConstants {
+    mat4 model;
+} object;
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
@@ -13,8 +16,23 @@ layout(location = 3) in vec3 bitangent;
 layout(location = 4) in vec2 uv;
 
 layout(location = 0) out vec2 fragUV;
+layout(location = 1) out vec3 fragViewPosition;
+layout(location = 2) out vec3 fragViewNormal;
+
+// Matches the depth laid by the depth pipelines, tested with LESS_OR_EQUAL.
+invariant gl_Position;
+
+// The cofactor matrix transforms the normals like the inverse transpose, up to a scale undone in the fragment shader.
+mat3 normalMatrix(mat4 viewModel) {
+    mat3 m = mat3(viewModel);
+    return mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+}
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1.0);
+    gl_Position = frame.proj * frame.view * object.model * vec4(position, 1.0);
     fragUV = uv;
+
+    mat4 viewModel = frame.view * object.model;
+    fragViewPosition = (viewModel * vec4(position, 1.0)).xyz;
+    fragViewNormal = normalMatrix(viewModel) * normal;
 }